@@ -0,0 +1,200 @@
+#include "baseline.h"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "log.h"
+
+namespace afre
+{
+	bool WriteResultsJson(const std::string& path, const std::vector<BenchmarkResult>& results, const std::vector<BaselineEntry>& thresholdsToKeep)
+	{
+		std::ofstream file{ path, std::ios::trunc };
+		if (!file.is_open())
+		{
+			AFRE_ERROR("Failed to open {} for writing!", path);
+			return false;
+		}
+
+		file << "{\n";
+		#ifdef AFRE_DEBUG
+			file << "\t\"configuration\": \"debug\",\n";
+		#else
+			file << "\t\"configuration\": \"release\",\n";
+		#endif
+		file << "\t\"benchmarks\": [\n";
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			file << fmt::format("\t\t{{ \"name\": \"{}\", \"ns_per_iteration\": {:.3f}, \"items_per_second\": {:.3f}, \"iterations\": {}",
+				results[i].m_name, results[i].m_nsPerIteration, results[i].m_itemsPerSecond, results[i].m_iterations);
+
+			if (results[i].m_bytesPerItem > 0.0) file << fmt::format(", \"bytes_per_item\": {:.3f}", results[i].m_bytesPerItem);
+
+			// Hand tuned thresholds in a baseline survive regenerating it.
+			for (const BaselineEntry& entry : thresholdsToKeep)
+			{
+				if (entry.m_name == results[i].m_name && entry.m_threshold >= 0.0)
+				{
+					file << fmt::format(", \"threshold\": {:.3f}", entry.m_threshold);
+				}
+			}
+
+			file << (i + 1 < results.size() ? " },\n" : " }\n");
+		}
+
+		file << "\t]\n}\n";
+
+		return true;
+	}
+
+	// Just enough JSON to read back the files written above: an array of flat objects under "benchmarks".
+	class BaselineParser
+	{
+	public:
+		explicit BaselineParser(const std::string& text) : m_text(text) {}
+
+		bool Parse(std::vector<BaselineEntry>& baseline)
+		{
+			const size_t benchmarksKey = m_text.find("\"benchmarks\"");
+			if (benchmarksKey == std::string::npos) return false;
+
+			m_position = m_text.find('[', benchmarksKey);
+			if (m_position == std::string::npos) return false;
+			m_position++;
+
+			while (true)
+			{
+				SkipWhitespace();
+				if (Peek() == ']') return true;
+				if (Peek() == ',') { m_position++; continue; }
+				if (Peek() != '{') return false;
+				m_position++;
+
+				BaselineEntry entry{};
+				while (true)
+				{
+					SkipWhitespace();
+					if (Peek() == '}') { m_position++; break; }
+					if (Peek() == ',') { m_position++; continue; }
+
+					std::string key{};
+					if (!ParseString(key)) return false;
+
+					SkipWhitespace();
+					if (Peek() != ':') return false;
+					m_position++;
+					SkipWhitespace();
+
+					if (Peek() == '"')
+					{
+						std::string value{};
+						if (!ParseString(value)) return false;
+						if (key == "name") entry.m_name = value;
+					}
+					else
+					{
+						double value = 0.0;
+						if (!ParseNumber(value)) return false;
+						if (key == "ns_per_iteration") entry.m_nsPerIteration = value;
+						else if (key == "threshold") entry.m_threshold = value;
+					}
+				}
+
+				baseline.push_back(entry);
+			}
+		}
+
+	private:
+		inline char Peek() const { return m_position < m_text.size() ? m_text[m_position] : '\0'; }
+
+		void SkipWhitespace()
+		{
+			while (m_position < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_position]))) m_position++;
+		}
+
+		bool ParseString(std::string& value)
+		{
+			if (Peek() != '"') return false;
+
+			const size_t end = m_text.find('"', m_position + 1);
+			if (end == std::string::npos) return false;
+
+			value = m_text.substr(m_position + 1, end - m_position - 1);
+			m_position = end + 1;
+
+			return true;
+		}
+
+		bool ParseNumber(double& value)
+		{
+			const char* start = m_text.c_str() + m_position;
+			char* end = nullptr;
+			value = std::strtod(start, &end);
+			if (end == start) return false;
+
+			m_position += static_cast<size_t>(end - start);
+
+			return true;
+		}
+
+		const std::string& m_text;
+		size_t m_position = 0;
+	};
+
+	bool ReadBaselineJson(const std::string& path, std::vector<BaselineEntry>& baseline)
+	{
+		std::ifstream file{ path };
+		if (!file.is_open())
+		{
+			AFRE_ERROR("Failed to open the baseline {}!", path);
+			return false;
+		}
+
+		std::stringstream text{};
+		text << file.rdbuf();
+
+		if (!BaselineParser{ text.str() }.Parse(baseline))
+		{
+			AFRE_ERROR("Failed to parse the baseline {}!", path);
+			return false;
+		}
+
+		return true;
+	}
+
+	uint32_t CompareWithBaseline(const std::vector<BenchmarkResult>& results, const std::vector<BaselineEntry>& baseline, double defaultThreshold)
+	{
+		uint32_t regressionCount = 0;
+
+		for (const BenchmarkResult& result : results)
+		{
+			const BaselineEntry* baselineEntry = nullptr;
+			for (const BaselineEntry& entry : baseline)
+			{
+				if (entry.m_name == result.m_name) baselineEntry = &entry;
+			}
+
+			if (!baselineEntry || baselineEntry->m_nsPerIteration <= 0.0)
+			{
+				AFRE_WARN("{:<48} has no baseline.", result.m_name);
+				continue;
+			}
+
+			const double threshold = baselineEntry->m_threshold >= 0.0 ? baselineEntry->m_threshold : defaultThreshold;
+			const double change = result.m_nsPerIteration / baselineEntry->m_nsPerIteration - 1.0;
+
+			if (change > threshold)
+			{
+				AFRE_ERROR("{:<48} {:+7.1f}% (allowed {:+.1f}%) REGRESSION", result.m_name, change * 100.0, threshold * 100.0);
+				regressionCount++;
+			}
+			else
+			{
+				AFRE_INFO("{:<48} {:+7.1f}%", result.m_name, change * 100.0);
+			}
+		}
+
+		return regressionCount;
+	}
+}
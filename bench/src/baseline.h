@@ -0,0 +1,20 @@
+#pragma once
+
+#include "benchmark.h"
+
+namespace afre
+{
+	struct BaselineEntry
+	{
+		std::string m_name{};
+		double m_nsPerIteration = 0.0;
+		// Negative means the default threshold passed on the command line is used.
+		double m_threshold = -1.0;
+	};
+
+	bool WriteResultsJson(const std::string& path, const std::vector<BenchmarkResult>& results, const std::vector<BaselineEntry>& thresholdsToKeep);
+	bool ReadBaselineJson(const std::string& path, std::vector<BaselineEntry>& baseline);
+
+	// Logs a comparison table and returns how many benchmarks are slower than their threshold allows.
+	uint32_t CompareWithBaseline(const std::vector<BenchmarkResult>& results, const std::vector<BaselineEntry>& baseline, double defaultThreshold);
+}
@@ -0,0 +1,55 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/world_generator.h"
+
+namespace afre
+{
+	VoxelWorld CreateTerrainWorld(const glm::uvec3& sizeInBricks)
+	{
+		VoxelWorld world{ sizeInBricks };
+
+		WorldGeneratorInfo worldGeneratorInfo{};
+		worldGeneratorInfo.m_seed = 1337;
+		GenerateWorld(world, worldGeneratorInfo);
+
+		return world;
+	}
+
+	Brick CreateTerrainBrick()
+	{
+		Brick brick{};
+
+		for (uint16_t z = 0; z < kBrickSize; z++)
+		{
+			for (uint16_t x = 0; x < kBrickSize; x++)
+			{
+				const uint16_t height = static_cast<uint16_t>(6 + (x * 3 + z * 5) % 5);
+				for (uint16_t y = 0; y < height; y++)
+				{
+					brick.At({ x, y, z }) = y + 1 == height ? 2 : 1;
+				}
+			}
+		}
+
+		return brick;
+	}
+
+	Brick CreateNoiseBrick(uint64_t seed)
+	{
+		Brick brick{};
+		BenchmarkRandom random{ seed };
+
+		glm::uint16_t* voxels = brick.m_voxels;
+		for (uint32_t i = 0; i < kBrickVoxelCount; i++)
+		{
+			voxels[i] = static_cast<glm::uint16_t>(random.NextBelow(3));
+		}
+
+		return brick;
+	}
+
+	BenchmarkRandom CreateVerifyRandom()
+	{
+		return BenchmarkRandom{ 0x9e3779b97f4a7c15ull };
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "benchmark.h"
+#include "core/voxel/voxel_world.h"
+
+namespace afre
+{
+	// Worlds and bricks shared between benchmarks so their numbers stay comparable.
+	VoxelWorld CreateTerrainWorld(const glm::uvec3& sizeInBricks);
+
+	// A brick cut through the terrain surface: ground, surface and air.
+	Brick CreateTerrainBrick();
+
+	// Random voxels, the worst case for compression.
+	Brick CreateNoiseBrick(uint64_t seed);
+
+	// The generator the verify runs draw from, always seeded the same so a failure reproduces.
+	BenchmarkRandom CreateVerifyRandom();
+}
@@ -0,0 +1,94 @@
+#include "benchmark.h"
+#include <algorithm>
+#include "log.h"
+
+namespace afre
+{
+	static volatile uint64_t s_keepAliveSink = 0;
+
+	std::vector<Benchmark>& GetBenchmarks()
+	{
+		// Function local so registration from other translation units doesn't depend on static init order.
+		static std::vector<Benchmark> benchmarks{};
+		return benchmarks;
+	}
+
+	bool RegisterBenchmark(const std::string& name, const BenchmarkFunction& function)
+	{
+		GetBenchmarks().push_back({ name, function });
+		return true;
+	}
+
+	void KeepAlive(uint64_t value)
+	{
+		s_keepAliveSink = s_keepAliveSink + value;
+	}
+
+	static double RunOnce(const Benchmark& benchmark, uint64_t iterations, uint64_t& itemsPerIteration, double& bytesPerItem)
+	{
+		BenchmarkState state{ iterations };
+		benchmark.m_function(state);
+
+		itemsPerIteration = state.GetItemsPerIteration();
+		bytesPerItem = state.GetBytesPerItem();
+
+		return state.GetElapsedNs();
+	}
+
+	std::vector<BenchmarkResult> RunBenchmarks(const BenchmarkRunInfo& benchmarkRunInfo)
+	{
+		std::vector<Benchmark> benchmarks = GetBenchmarks();
+		std::sort(benchmarks.begin(), benchmarks.end(), [](const Benchmark& a, const Benchmark& b) { return a.m_name < b.m_name; });
+
+		const double minTimeNs = benchmarkRunInfo.m_minTimeMs * 1e6;
+
+		std::vector<BenchmarkResult> results{};
+		for (const Benchmark& benchmark : benchmarks)
+		{
+			if (!benchmarkRunInfo.m_filter.empty() && benchmark.m_name.find(benchmarkRunInfo.m_filter) == std::string::npos) continue;
+
+			// Grows the iteration count until a single run is long enough to be measured reliably.
+			uint64_t itemsPerIteration = 1;
+			double bytesPerItem = 0.0;
+			uint64_t iterations = 1;
+			double elapsedNs = RunOnce(benchmark, iterations, itemsPerIteration, bytesPerItem);
+			while (elapsedNs < minTimeNs && iterations < (1ull << 40))
+			{
+				const double scale = elapsedNs > 0.0 ? std::clamp(minTimeNs / elapsedNs * 1.2, 1.5, 10.0) : 10.0;
+				iterations = static_cast<uint64_t>(static_cast<double>(iterations) * scale) + 1;
+				elapsedNs = RunOnce(benchmark, iterations, itemsPerIteration, bytesPerItem);
+			}
+
+			std::vector<double> nsPerIteration{ elapsedNs / static_cast<double>(iterations) };
+			for (uint32_t r = 1; r < benchmarkRunInfo.m_repetitions; r++)
+			{
+				nsPerIteration.push_back(RunOnce(benchmark, iterations, itemsPerIteration, bytesPerItem) / static_cast<double>(iterations));
+			}
+
+			// The median ignores the odd run disturbed by the scheduler.
+			std::sort(nsPerIteration.begin(), nsPerIteration.end());
+			const double medianNs = nsPerIteration[nsPerIteration.size() / 2];
+
+			BenchmarkResult result{};
+			result.m_name = benchmark.m_name;
+			result.m_nsPerIteration = medianNs;
+			result.m_itemsPerSecond = medianNs > 0.0 ? static_cast<double>(itemsPerIteration) * 1e9 / medianNs : 0.0;
+			result.m_iterations = iterations;
+			result.m_bytesPerItem = bytesPerItem;
+
+			if (result.m_bytesPerItem > 0.0)
+			{
+				AFRE_INFO("{:<48} {:>14.1f} ns/iter {:>14.3e} items/s ({} iterations, {:.1f} bytes/item)", result.m_name, result.m_nsPerIteration, result.m_itemsPerSecond,
+					result.m_iterations, result.m_bytesPerItem);
+			}
+			else
+			{
+				AFRE_INFO("{:<48} {:>14.1f} ns/iter {:>14.3e} items/s ({} iterations)", result.m_name, result.m_nsPerIteration, result.m_itemsPerSecond, result.m_iterations);
+			}
+
+			results.push_back(result);
+		}
+
+		return results;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace afre
+{
+	class BenchmarkState
+	{
+	public:
+		explicit BenchmarkState(uint64_t iterations) : m_iterations(iterations) {}
+
+		// Everything between these calls is measured, setup before StartTimer is not.
+		inline void StartTimer() { m_start = std::chrono::steady_clock::now(); }
+		inline void StopTimer() { m_elapsed += std::chrono::steady_clock::now() - m_start; }
+
+		// Number of items (voxels, rays, bricks...) one iteration processes, used for the throughput column.
+		inline void SetItemsPerIteration(uint64_t itemsPerIteration) { m_itemsPerIteration = itemsPerIteration; }
+		// For benchmarks of encodings, reported next to the timings but never compared against the baseline.
+		inline void SetBytesPerItem(double bytesPerItem) { m_bytesPerItem = bytesPerItem; }
+
+		inline uint64_t GetIterations() const { return m_iterations; }
+		inline uint64_t GetItemsPerIteration() const { return m_itemsPerIteration; }
+		inline double GetBytesPerItem() const { return m_bytesPerItem; }
+		inline double GetElapsedNs() const { return std::chrono::duration<double, std::nano>(m_elapsed).count(); }
+
+	private:
+		uint64_t m_iterations = 0;
+		uint64_t m_itemsPerIteration = 1;
+		double m_bytesPerItem = 0.0;
+
+		std::chrono::steady_clock::time_point m_start{};
+		std::chrono::steady_clock::duration m_elapsed{};
+	};
+
+	using BenchmarkFunction = std::function<void(BenchmarkState&)>;
+
+	struct Benchmark
+	{
+		std::string m_name{};
+		BenchmarkFunction m_function{};
+	};
+
+	struct BenchmarkResult
+	{
+		std::string m_name{};
+		double m_nsPerIteration = 0.0;
+		double m_itemsPerSecond = 0.0;
+		uint64_t m_iterations = 0;
+		// 0 when the benchmark doesn't set it.
+		double m_bytesPerItem = 0.0;
+	};
+
+	struct BenchmarkRunInfo
+	{
+		std::string m_filter{};
+		double m_minTimeMs = 100.0;
+		uint32_t m_repetitions = 5;
+	};
+
+	std::vector<Benchmark>& GetBenchmarks();
+	bool RegisterBenchmark(const std::string& name, const BenchmarkFunction& function);
+
+	std::vector<BenchmarkResult> RunBenchmarks(const BenchmarkRunInfo& benchmarkRunInfo);
+
+	// Writes the value somewhere the optimizer can't see through, so the measured work isn't removed.
+	void KeepAlive(uint64_t value);
+
+	// Small deterministic generator so every run measures the same access pattern.
+	class BenchmarkRandom
+	{
+	public:
+		explicit BenchmarkRandom(uint64_t seed) : m_state(seed ? seed : 0x9e3779b97f4a7c15ull) {}
+
+		inline uint64_t Next()
+		{
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 7;
+			m_state ^= m_state << 17;
+			return m_state;
+		}
+
+		inline uint32_t NextBelow(uint32_t bound) { return static_cast<uint32_t>(Next() % bound); }
+		// In [0, 1).
+		inline float NextFloat() { return static_cast<float>(Next() >> 40) / static_cast<float>(1u << 24); }
+
+	private:
+		uint64_t m_state;
+	};
+}
+
+#define AFRE_BENCHMARK_CONCAT_INNER(a, b) a##b
+#define AFRE_BENCHMARK_CONCAT(a, b) AFRE_BENCHMARK_CONCAT_INNER(a, b)
+
+#define AFRE_BENCHMARK(name, function) \
+	static const bool AFRE_BENCHMARK_CONCAT(s_benchmarkRegistered, __LINE__) = ::afre::RegisterBenchmark(name, function)
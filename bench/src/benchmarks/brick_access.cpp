@@ -0,0 +1,102 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+
+namespace afre
+{
+	// Walks the brick x fastest, memory order for the linear layout.
+	static void BrickAccessLinear(BenchmarkState& state)
+	{
+		const Brick brick = CreateTerrainBrick();
+		state.SetItemsPerIteration(kBrickVoxelCount);
+
+		uint64_t sum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint16_t z = 0; z < kBrickSize; z++)
+				for (uint16_t y = 0; y < kBrickSize; y++)
+					for (uint16_t x = 0; x < kBrickSize; x++)
+						sum += brick.At({ x, y, z });
+		}
+		state.StopTimer();
+
+		KeepAlive(sum);
+	}
+
+	// Same voxels with z fastest, what a DDA marching along z sees.
+	static void BrickAccessStrided(BenchmarkState& state)
+	{
+		const Brick brick = CreateTerrainBrick();
+		state.SetItemsPerIteration(kBrickVoxelCount);
+
+		uint64_t sum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint16_t x = 0; x < kBrickSize; x++)
+				for (uint16_t y = 0; y < kBrickSize; y++)
+					for (uint16_t z = 0; z < kBrickSize; z++)
+						sum += brick.At({ x, y, z });
+		}
+		state.StopTimer();
+
+		KeepAlive(sum);
+	}
+
+	static void BrickAccessRandom(BenchmarkState& state)
+	{
+		const Brick brick = CreateTerrainBrick();
+		state.SetItemsPerIteration(kBrickVoxelCount);
+
+		BenchmarkRandom random{ 42 };
+		std::vector<uint16_t> indices(kBrickVoxelCount);
+		for (uint16_t& index : indices)
+		{
+			index = static_cast<uint16_t>(random.NextBelow(kBrickVoxelCount));
+		}
+
+		const glm::uint16_t* voxels = brick.m_voxels;
+
+		uint64_t sum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint16_t index : indices)
+			{
+				sum += voxels[index];
+			}
+		}
+		state.StopTimer();
+
+		KeepAlive(sum);
+	}
+
+	// Goes through VoxelWorld::GetVoxel, crossing bricks along a diagonal.
+	static void WorldAccessDiagonal(BenchmarkState& state)
+	{
+		const VoxelWorld world = CreateTerrainWorld({ 8, 8, 8 });
+		const int32_t size = static_cast<int32_t>(world.GetSizeInVoxels().x);
+		state.SetItemsPerIteration(static_cast<uint64_t>(size) * size);
+
+		uint64_t sum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (int32_t offset = 0; offset < size; offset++)
+			{
+				for (int32_t d = 0; d < size; d++)
+				{
+					sum += world.GetVoxel({ d, (d + offset) % size, (d * 3 + offset) % size });
+				}
+			}
+		}
+		state.StopTimer();
+
+		KeepAlive(sum);
+	}
+
+	AFRE_BENCHMARK("brick_access/linear", BrickAccessLinear);
+	AFRE_BENCHMARK("brick_access/strided", BrickAccessStrided);
+	AFRE_BENCHMARK("brick_access/random", BrickAccessRandom);
+	AFRE_BENCHMARK("brick_access/world_diagonal", WorldAccessDiagonal);
+}
@@ -0,0 +1,52 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/brick_compression.h"
+
+namespace afre
+{
+	static void CompressBench(BenchmarkState& state, const Brick& brick)
+	{
+		state.SetItemsPerIteration(kBrickVoxelCount);
+
+		std::vector<glm::uint16_t> compressed{};
+		compressed.reserve(kBrickVoxelCount * 2);
+
+		uint64_t compressedSize = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			CompressBrick(brick, compressed);
+			compressedSize += compressed.size();
+		}
+		state.StopTimer();
+
+		KeepAlive(compressedSize);
+	}
+
+	static void DecompressBench(BenchmarkState& state, const Brick& brick)
+	{
+		state.SetItemsPerIteration(kBrickVoxelCount);
+
+		std::vector<glm::uint16_t> compressed{};
+		CompressBrick(brick, compressed);
+
+		Brick decompressed{};
+
+		uint64_t valid = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			valid += DecompressBrick(compressed.data(), compressed.size(), decompressed);
+		}
+		state.StopTimer();
+
+		KeepAlive(valid + decompressed.m_voxels[0]);
+	}
+
+	AFRE_BENCHMARK("brick_compression/compress_empty", [](BenchmarkState& state) { CompressBench(state, Brick{}); });
+	AFRE_BENCHMARK("brick_compression/compress_terrain", [](BenchmarkState& state) { CompressBench(state, CreateTerrainBrick()); });
+	AFRE_BENCHMARK("brick_compression/compress_noise", [](BenchmarkState& state) { CompressBench(state, CreateNoiseBrick(3)); });
+	AFRE_BENCHMARK("brick_compression/decompress_empty", [](BenchmarkState& state) { DecompressBench(state, Brick{}); });
+	AFRE_BENCHMARK("brick_compression/decompress_terrain", [](BenchmarkState& state) { DecompressBench(state, CreateTerrainBrick()); });
+	AFRE_BENCHMARK("brick_compression/decompress_noise", [](BenchmarkState& state) { DecompressBench(state, CreateNoiseBrick(3)); });
+}
@@ -0,0 +1,63 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/brick_culling.h"
+
+namespace afre
+{
+	// Camera at height looking across the terrain, like a player on a hill.
+	static BrickCullingCamera CreateCullingCamera(const glm::vec3& origin, const glm::vec3& target, float maxDistance)
+	{
+		const glm::vec3 forward = glm::normalize(target - origin);
+		const glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.f, 1.f, 0.f)));
+		const glm::vec3 up = glm::cross(right, forward);
+
+		BrickCullingCamera camera{};
+		camera.m_cameraToWorld[0] = glm::vec4(right, 0.f);
+		camera.m_cameraToWorld[1] = glm::vec4(up, 0.f);
+		camera.m_cameraToWorld[2] = glm::vec4(-forward, 0.f);
+		camera.m_cameraToWorld[3] = glm::vec4(origin, 1.f);
+		camera.m_maxDistance = maxDistance;
+
+		return camera;
+	}
+
+	static void CullBench(BenchmarkState& state, const glm::uvec3& sizeInBricks, float maxDistance)
+	{
+		const VoxelWorld world = CreateTerrainWorld(sizeInBricks);
+		const glm::vec3 worldSize = glm::vec3(world.GetSizeInVoxels());
+
+		BrickCullingGrid grid{};
+		grid.m_sizeInBricks = sizeInBricks;
+		for (uint32_t z = 0; z < sizeInBricks.z; z++)
+		{
+			for (uint32_t y = 0; y < sizeInBricks.y; y++)
+			{
+				for (uint32_t x = 0; x < sizeInBricks.x; x++)
+				{
+					glm::uint16_t voxel = 0;
+					grid.m_occluders.push_back(world.IsBrickUniform({ x, y, z }, voxel) && voxel > 0 ? 1 : 0);
+				}
+			}
+		}
+
+		const BrickCullingCamera camera = CreateCullingCamera(glm::vec3(worldSize.x * 0.1f, worldSize.y * 0.8f, worldSize.z * 0.1f), glm::vec3(worldSize.x * 0.6f, worldSize.y * 0.2f, worldSize.z * 0.6f), maxDistance);
+
+		BrickCuller brickCuller{};
+		BrickVisibility visibility{};
+		state.SetItemsPerIteration(world.GetBrickCount());
+
+		uint64_t visibleBricks = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			brickCuller.Cull(camera, grid, visibility);
+			visibleBricks += visibility.m_visibleBricks.size();
+		}
+		state.StopTimer();
+
+		KeepAlive(visibleBricks);
+	}
+
+	AFRE_BENCHMARK("brick_culling/terrain_3x3x3", [](BenchmarkState& state) { CullBench(state, { 3, 3, 3 }, 70.f); });
+	AFRE_BENCHMARK("brick_culling/terrain_16x4x16", [](BenchmarkState& state) { CullBench(state, { 16, 4, 16 }, 400.f); });
+}
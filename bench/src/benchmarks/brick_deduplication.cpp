@@ -0,0 +1,73 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/brick_deduplication.h"
+
+namespace afre
+{
+	// Every brick is written once first, so the pass has real work instead of finding the shared bricks from GenerateWorld.
+	static void DeduplicateBench(BenchmarkState& state, const glm::uvec3& sizeInBricks)
+	{
+		VoxelWorld world = CreateTerrainWorld(sizeInBricks);
+		state.SetItemsPerIteration(world.GetBrickCount());
+
+		uint64_t uniqueBricks = 0;
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint32_t z = 0; z < sizeInBricks.z; z++)
+			{
+				for (uint32_t y = 0; y < sizeInBricks.y; y++)
+				{
+					for (uint32_t x = 0; x < sizeInBricks.x; x++)
+					{
+						world.GetMutableBrick({ x, y, z });
+					}
+				}
+			}
+
+			state.StartTimer();
+			uniqueBricks += world.DeduplicateBricks().m_uniqueBricks;
+			state.StopTimer();
+		}
+
+		KeepAlive(uniqueBricks);
+	}
+
+	// The upload path: a 3x3x3 VoxelData packed into the brick table and pool.
+	static void PackBench(BenchmarkState& state, const Brick& centerBrick)
+	{
+		static VoxelData voxelData{};
+		static PackedVoxelData packedVoxelData{};
+		static Brick uniqueBricks[3 * 3 * 3]{};
+
+		for (uint32_t b = 0; b < 3 * 3 * 3; b++)
+		{
+			(&voxelData.m_bricks[0][0][0])[b] = Brick{};
+		}
+		for (uint32_t x = 0; x < 3; x++)
+		{
+			for (uint32_t z = 0; z < 3; z++)
+			{
+				voxelData.m_bricks[z][0][x] = CreateTerrainBrick();
+			}
+		}
+		voxelData.m_bricks[1][1][1] = centerBrick;
+
+		state.SetItemsPerIteration(3 * 3 * 3);
+
+		BrickDeduplicationStats stats{};
+		uint64_t poolCount = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			poolCount += PackBricks(&voxelData.m_bricks[0][0][0], 3 * 3 * 3, &packedVoxelData.m_brickTable[0][0][0], uniqueBricks, stats);
+		}
+		state.StopTimer();
+
+		KeepAlive(poolCount);
+	}
+
+	AFRE_BENCHMARK("brick_deduplication/deduplicate_8x4x8", [](BenchmarkState& state) { DeduplicateBench(state, { 8, 4, 8 }); });
+	AFRE_BENCHMARK("brick_deduplication/deduplicate_16x4x16", [](BenchmarkState& state) { DeduplicateBench(state, { 16, 4, 16 }); });
+	AFRE_BENCHMARK("brick_deduplication/pack_terrain", [](BenchmarkState& state) { PackBench(state, CreateTerrainBrick()); });
+	AFRE_BENCHMARK("brick_deduplication/pack_noise", [](BenchmarkState& state) { PackBench(state, CreateNoiseBrick(3)); });
+}
@@ -0,0 +1,154 @@
+#include "benchmark.h"
+#include "core/voxel/brick_kernels.h"
+
+namespace afre
+{
+	static constexpr uint32_t kKernelBenchBrickCount = 256;
+
+	// Terrain-like bricks, mostly solid with some air, and every other one a copy of the one before it.
+	static std::vector<Brick> CreateKernelBenchBricks()
+	{
+		BenchmarkRandom random{ 11 };
+
+		std::vector<Brick> bricks(kKernelBenchBrickCount);
+		for (uint32_t i = 0; i < kKernelBenchBrickCount; i++)
+		{
+			if (i % 2 == 1)
+			{
+				bricks[i] = bricks[i - 1];
+				continue;
+			}
+
+			for (glm::uint16_t& voxel : bricks[i].m_voxels) voxel = random.Next() % 4 == 0 ? 0 : static_cast<glm::uint16_t>(1 + random.Next() % 3);
+		}
+
+		return bricks;
+	}
+
+	// The dispatched table against the scalar one, so the names are the same whatever the CPU.
+	static const BrickKernels& GetBenchKernels(bool dispatched)
+	{
+		return dispatched ? GetBrickKernels() : *GetBrickKernels(SIMD_SCALAR);
+	}
+
+	// Items are voxels.
+	static void CountNonAirBench(BenchmarkState& state, bool dispatched)
+	{
+		const BrickKernels& kernels = GetBenchKernels(dispatched);
+		const std::vector<Brick> bricks = CreateKernelBenchBricks();
+
+		uint64_t checksum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+			for (const Brick& brick : bricks) checksum += kernels.m_countNonAir(brick.m_voxels);
+		state.StopTimer();
+
+		state.SetItemsPerIteration(static_cast<uint64_t>(kKernelBenchBrickCount) * kBrickVoxelCount);
+		KeepAlive(checksum);
+	}
+
+	static void EqualBench(BenchmarkState& state, bool dispatched)
+	{
+		const BrickKernels& kernels = GetBenchKernels(dispatched);
+		const std::vector<Brick> bricks = CreateKernelBenchBricks();
+
+		// Equal pairs run to the end, the rest stop at the first difference, so only count the equal ones.
+		uint64_t checksum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+			for (uint32_t brick = 0; brick < kKernelBenchBrickCount; brick += 2) checksum += kernels.m_equal(bricks[brick].m_voxels, bricks[brick + 1].m_voxels);
+		state.StopTimer();
+
+		state.SetItemsPerIteration(static_cast<uint64_t>(kKernelBenchBrickCount / 2) * kBrickVoxelCount);
+		KeepAlive(checksum);
+	}
+
+	static void BuildOccupancyBench(BenchmarkState& state, bool dispatched)
+	{
+		const BrickKernels& kernels = GetBenchKernels(dispatched);
+		const std::vector<Brick> bricks = CreateKernelBenchBricks();
+
+		glm::uint64_t occupancy[kBrickOccupancyWords]{};
+		uint64_t checksum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+			for (const Brick& brick : bricks)
+			{
+				kernels.m_buildOccupancy(brick.m_voxels, occupancy);
+				checksum += occupancy[0];
+			}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(static_cast<uint64_t>(kKernelBenchBrickCount) * kBrickVoxelCount);
+		KeepAlive(checksum);
+	}
+
+	static void DiffBench(BenchmarkState& state, bool dispatched)
+	{
+		const BrickKernels& kernels = GetBenchKernels(dispatched);
+		const std::vector<Brick> bricks = CreateKernelBenchBricks();
+
+		glm::uint64_t changed[kBrickOccupancyWords]{};
+		uint64_t checksum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+			for (uint32_t brick = 1; brick < kKernelBenchBrickCount; brick++) checksum += kernels.m_diff(bricks[brick - 1].m_voxels, bricks[brick].m_voxels, changed);
+		state.StopTimer();
+
+		state.SetItemsPerIteration(static_cast<uint64_t>(kKernelBenchBrickCount - 1) * kBrickVoxelCount);
+		KeepAlive(checksum);
+	}
+
+	static void DownsampleBench(BenchmarkState& state, bool dispatched)
+	{
+		const BrickKernels& kernels = GetBenchKernels(dispatched);
+		const std::vector<Brick> bricks = CreateKernelBenchBricks();
+
+		glm::uint16_t mip[kBrickMipVoxelCount]{};
+		uint64_t checksum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+			for (const Brick& brick : bricks)
+			{
+				kernels.m_downsample(brick.m_voxels, mip);
+				checksum += mip[0];
+			}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(static_cast<uint64_t>(kKernelBenchBrickCount) * kBrickVoxelCount);
+		KeepAlive(checksum);
+	}
+
+	// A 12x12x12 box in every brick, the size of a brush edit.
+	static void FillBoxBench(BenchmarkState& state, bool dispatched)
+	{
+		const BrickKernels& kernels = GetBenchKernels(dispatched);
+		std::vector<Brick> bricks = CreateKernelBenchBricks();
+
+		uint64_t checksum = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+			for (Brick& brick : bricks)
+			{
+				kernels.m_fillBox(brick.m_voxels, { 2, 2, 2 }, { 14, 14, 14 }, static_cast<glm::uint16_t>(i + 1));
+				checksum += brick.m_voxels[0];
+			}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(static_cast<uint64_t>(kKernelBenchBrickCount) * 12 * 12 * 12);
+		KeepAlive(checksum);
+	}
+
+	AFRE_BENCHMARK("brick_kernels/count_non_air_scalar", [](BenchmarkState& state) { CountNonAirBench(state, false); });
+	AFRE_BENCHMARK("brick_kernels/count_non_air_dispatched", [](BenchmarkState& state) { CountNonAirBench(state, true); });
+	AFRE_BENCHMARK("brick_kernels/equal_scalar", [](BenchmarkState& state) { EqualBench(state, false); });
+	AFRE_BENCHMARK("brick_kernels/equal_dispatched", [](BenchmarkState& state) { EqualBench(state, true); });
+	AFRE_BENCHMARK("brick_kernels/occupancy_scalar", [](BenchmarkState& state) { BuildOccupancyBench(state, false); });
+	AFRE_BENCHMARK("brick_kernels/occupancy_dispatched", [](BenchmarkState& state) { BuildOccupancyBench(state, true); });
+	AFRE_BENCHMARK("brick_kernels/diff_scalar", [](BenchmarkState& state) { DiffBench(state, false); });
+	AFRE_BENCHMARK("brick_kernels/diff_dispatched", [](BenchmarkState& state) { DiffBench(state, true); });
+	AFRE_BENCHMARK("brick_kernels/downsample_scalar", [](BenchmarkState& state) { DownsampleBench(state, false); });
+	AFRE_BENCHMARK("brick_kernels/downsample_dispatched", [](BenchmarkState& state) { DownsampleBench(state, true); });
+	AFRE_BENCHMARK("brick_kernels/fill_box_scalar", [](BenchmarkState& state) { FillBoxBench(state, false); });
+	AFRE_BENCHMARK("brick_kernels/fill_box_dispatched", [](BenchmarkState& state) { FillBoxBench(state, true); });
+}
@@ -0,0 +1,173 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+
+namespace afre
+{
+	using BrickVoxelIndexFn = uint32_t(*)(uint32_t, uint32_t, uint32_t);
+
+	// The engine is built with one AFRE_BRICK_LAYOUT, so these keep their own copy of the voxels
+	// in each layout to compare them in the same run.
+	template<BrickVoxelIndexFn GetIndex>
+	class LayoutWorld
+	{
+	public:
+		explicit LayoutWorld(const VoxelWorld& world) : m_sizeInBricks(world.GetSizeInBricks()), m_sizeInVoxels(world.GetSizeInVoxels())
+		{
+			m_voxels.resize(static_cast<size_t>(world.GetBrickCount()) * kBrickVoxelCount);
+
+			for (uint32_t z = 0; z < m_sizeInVoxels.z; z++)
+				for (uint32_t y = 0; y < m_sizeInVoxels.y; y++)
+					for (uint32_t x = 0; x < m_sizeInVoxels.x; x++)
+						m_voxels[GetVoxelIndex({ x, y, z })] = world.GetVoxel(glm::ivec3(x, y, z));
+		}
+
+		inline bool IsInside(const glm::ivec3& position) const
+		{
+			return position.x >= 0 && position.y >= 0 && position.z >= 0 &&
+				static_cast<uint32_t>(position.x) < m_sizeInVoxels.x && static_cast<uint32_t>(position.y) < m_sizeInVoxels.y && static_cast<uint32_t>(position.z) < m_sizeInVoxels.z;
+		}
+
+		inline size_t GetVoxelIndex(const glm::uvec3& position) const
+		{
+			const glm::uvec3 brickPosition = position >> kBrickSizeBits;
+			const glm::uvec3 local = position & (kBrickSize - 1u);
+
+			const size_t brickIndex = (static_cast<size_t>(brickPosition.z) * m_sizeInBricks.y + brickPosition.y) * m_sizeInBricks.x + brickPosition.x;
+			return brickIndex * kBrickVoxelCount + GetIndex(local.x, local.y, local.z);
+		}
+
+		glm::uvec3 m_sizeInBricks{};
+		glm::uvec3 m_sizeInVoxels{};
+		std::vector<glm::uint16_t> m_voxels{};
+	};
+
+	// Plain voxel by voxel DDA from random points above the terrain, every step reads a voxel.
+	template<BrickVoxelIndexFn GetIndex>
+	static void LayoutTraversal(BenchmarkState& state)
+	{
+		const LayoutWorld<GetIndex> world{ CreateTerrainWorld({ 16, 4, 16 }) };
+		const glm::vec3 worldSize = glm::vec3(world.m_sizeInVoxels);
+
+		constexpr uint32_t kRayCount = 1024;
+
+		BenchmarkRandom random{ 7 };
+		std::vector<glm::vec3> rayOrigins{};
+		std::vector<glm::vec3> rayDirs{};
+		for (uint32_t r = 0; r < kRayCount; r++)
+		{
+			rayOrigins.push_back(glm::vec3(random.NextFloat() * worldSize.x, worldSize.y * (0.6f + random.NextFloat() * 0.35f), random.NextFloat() * worldSize.z));
+			rayDirs.push_back(glm::normalize(glm::vec3(random.NextFloat() * 2.f - 1.f, -0.2f - random.NextFloat(), random.NextFloat() * 2.f - 1.f)));
+		}
+
+		uint64_t steps = 0;
+		uint64_t hits = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint32_t r = 0; r < kRayCount; r++)
+			{
+				const glm::vec3& rayOrigin = rayOrigins[r];
+				const glm::vec3& rayDir = rayDirs[r];
+
+				const glm::vec3 deltaDist = 1.f / glm::abs(rayDir);
+				glm::ivec3 voxelMap = glm::ivec3(glm::floor(rayOrigin));
+				const glm::ivec3 voxelStep = glm::ivec3(glm::sign(rayDir));
+
+				glm::vec3 sideDist{};
+				for (uint8_t a = 0; a < 3; a++)
+				{
+					const float fraction = rayOrigin[a] - static_cast<float>(voxelMap[a]);
+					sideDist[a] = (rayDir[a] < 0 ? fraction : 1.f - fraction) * deltaDist[a];
+				}
+
+				while (world.IsInside(voxelMap))
+				{
+					steps++;
+					if (world.m_voxels[world.GetVoxelIndex(glm::uvec3(voxelMap))] > 0)
+					{
+						hits++;
+						break;
+					}
+
+					uint8_t axis = 0;
+					if (sideDist.x < sideDist.y)
+					{
+						axis = sideDist.x < sideDist.z ? 0 : 2;
+					}
+					else
+					{
+						axis = sideDist.y < sideDist.z ? 1 : 2;
+					}
+
+					voxelMap[axis] += voxelStep[axis];
+					sideDist[axis] += deltaDist[axis];
+				}
+			}
+		}
+		state.StopTimer();
+
+		// Items are voxel reads, the step count doesn't depend on the layout.
+		state.SetItemsPerIteration(steps / state.GetIterations());
+
+		KeepAlive(hits);
+	}
+
+	// Carves radius 6 spheres at random points, the write pattern of a player digging.
+	template<BrickVoxelIndexFn GetIndex>
+	static void LayoutSphereEdits(BenchmarkState& state)
+	{
+		LayoutWorld<GetIndex> world{ CreateTerrainWorld({ 16, 4, 16 }) };
+
+		constexpr int32_t kRadius = 6;
+		constexpr uint32_t kEditCount = 64;
+
+		BenchmarkRandom random{ 11 };
+		std::vector<glm::ivec3> centers{};
+		for (uint32_t e = 0; e < kEditCount; e++)
+		{
+			centers.push_back(glm::ivec3(
+				static_cast<int32_t>(random.NextBelow(world.m_sizeInVoxels.x)),
+				static_cast<int32_t>(random.NextBelow(world.m_sizeInVoxels.y)),
+				static_cast<int32_t>(random.NextBelow(world.m_sizeInVoxels.z))));
+		}
+
+		uint64_t written = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			const glm::uint16_t voxel = static_cast<glm::uint16_t>(i & 1);
+
+			for (const glm::ivec3& center : centers)
+			{
+				for (int32_t z = -kRadius; z <= kRadius; z++)
+				{
+					for (int32_t y = -kRadius; y <= kRadius; y++)
+					{
+						for (int32_t x = -kRadius; x <= kRadius; x++)
+						{
+							if (x * x + y * y + z * z > kRadius * kRadius) continue;
+
+							const glm::ivec3 position = center + glm::ivec3(x, y, z);
+							if (!world.IsInside(position)) continue;
+
+							world.m_voxels[world.GetVoxelIndex(glm::uvec3(position))] = voxel;
+							written++;
+						}
+					}
+				}
+			}
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(written / state.GetIterations());
+
+		KeepAlive(world.m_voxels[0]);
+	}
+
+	AFRE_BENCHMARK("brick_layout/traversal_linear", LayoutTraversal<GetLinearBrickVoxelIndex>);
+	AFRE_BENCHMARK("brick_layout/traversal_morton", LayoutTraversal<GetMortonBrickVoxelIndex>);
+	AFRE_BENCHMARK("brick_layout/traversal_tiled", LayoutTraversal<GetTiledBrickVoxelIndex>);
+	AFRE_BENCHMARK("brick_layout/edit_sphere_linear", LayoutSphereEdits<GetLinearBrickVoxelIndex>);
+	AFRE_BENCHMARK("brick_layout/edit_sphere_morton", LayoutSphereEdits<GetMortonBrickVoxelIndex>);
+	AFRE_BENCHMARK("brick_layout/edit_sphere_tiled", LayoutSphereEdits<GetTiledBrickVoxelIndex>);
+}
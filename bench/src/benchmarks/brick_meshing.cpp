@@ -0,0 +1,93 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/brick_meshing.h"
+
+namespace afre
+{
+	static std::vector<glm::uint8_t> CreateOpaqueTable()
+	{
+		std::vector<glm::uint8_t> opaque(kMaxMaterials, 1);
+		opaque[0] = 0;
+
+		return opaque;
+	}
+
+	static void MeshBrickBench(BenchmarkState& state, const Brick& brick)
+	{
+		const std::shared_ptr<const WorldSnapshot> snapshot = WorldSnapshot::CopyFrom(&brick, { 1, 1, 1 });
+		const std::vector<glm::uint8_t> opaque = CreateOpaqueTable();
+		state.SetItemsPerIteration(kBrickVoxelCount);
+
+		BrickMesh brickMesh{};
+
+		uint64_t quadCount = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			MeshBrick(*snapshot, 0, opaque, brickMesh);
+			quadCount += brickMesh.m_quads.size();
+		}
+		state.StopTimer();
+
+		KeepAlive(quadCount);
+	}
+
+	// Every brick of a world on the calling thread, bytes_per_item being the mesh size per brick.
+	static void MeshWorldBench(BenchmarkState& state, const glm::uvec3& sizeInBricks)
+	{
+		VoxelWorld world = CreateTerrainWorld(sizeInBricks);
+		const std::shared_ptr<const WorldSnapshot> snapshot = world.TakeSnapshot();
+		const std::vector<glm::uint8_t> opaque = CreateOpaqueTable();
+		state.SetItemsPerIteration(snapshot->GetBrickCount());
+
+		BrickMesh brickMesh{};
+
+		uint64_t quadCount = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint32_t brickIndex = 0; brickIndex < snapshot->GetBrickCount(); brickIndex++)
+			{
+				MeshBrick(*snapshot, brickIndex, opaque, brickMesh);
+				quadCount += brickMesh.m_quads.size();
+			}
+		}
+		state.StopTimer();
+
+		state.SetBytesPerItem(static_cast<double>(quadCount * sizeof(BrickQuad)) / static_cast<double>(state.GetIterations() * snapshot->GetBrickCount()));
+		KeepAlive(quadCount);
+	}
+
+	// The whole world remeshed through the cache's workers, from request to the last mesh taken.
+	static void MeshCacheBench(BenchmarkState& state, const glm::uvec3& sizeInBricks, uint32_t workerCount)
+	{
+		VoxelWorld world = CreateTerrainWorld(sizeInBricks);
+		const std::shared_ptr<const WorldSnapshot> snapshot = world.TakeSnapshot();
+		state.SetItemsPerIteration(snapshot->GetBrickCount());
+
+		std::vector<uint32_t> brickIndices{};
+		for (uint32_t brickIndex = 0; brickIndex < snapshot->GetBrickCount(); brickIndex++) brickIndices.push_back(brickIndex);
+
+		BrickMeshCache brickMeshCache{ workerCount };
+
+		uint64_t meshedBricks = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			brickMeshCache.Rebuild(snapshot);
+			brickMeshCache.RequestMeshes(brickIndices);
+			brickMeshCache.WaitIdle();
+			brickMeshCache.TakeFinishedMeshes();
+
+			meshedBricks += brickMeshCache.GetMeshedBrickCount();
+		}
+		state.StopTimer();
+
+		KeepAlive(meshedBricks);
+	}
+
+	AFRE_BENCHMARK("brick_meshing/terrain_brick", [](BenchmarkState& state) { MeshBrickBench(state, CreateTerrainBrick()); });
+	AFRE_BENCHMARK("brick_meshing/noise_brick", [](BenchmarkState& state) { MeshBrickBench(state, CreateNoiseBrick(3)); });
+	AFRE_BENCHMARK("brick_meshing/terrain_8x4x8", [](BenchmarkState& state) { MeshWorldBench(state, { 8, 4, 8 }); });
+	AFRE_BENCHMARK("brick_meshing/cache_8x4x8_2_workers", [](BenchmarkState& state) { MeshCacheBench(state, { 8, 4, 8 }, 2); });
+}
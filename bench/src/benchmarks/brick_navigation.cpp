@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <functional>
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/brick_navigation.h"
+
+namespace afre
+{
+	static const glm::uvec3 kNavWorldSize{ 16, 4, 16 };
+	static constexpr uint32_t kNavPathCount = 256;
+	// The flat search only gets a slice of the paths, all of them take too long.
+	static constexpr uint32_t kFlatPathCount = 16;
+
+	// The voxel over the highest solid one of the column.
+	static glm::ivec3 GetSurfaceVoxel(const VoxelWorld& world, int32_t x, int32_t z)
+	{
+		int32_t y = static_cast<int32_t>(world.GetSizeInVoxels().y) - 1;
+		while (y > 0 && world.GetVoxel({ x, y - 1, z }) == 0) y--;
+
+		return { x, y, z };
+	}
+
+	static std::vector<NavPathRequest> CreatePathRequests(const VoxelWorld& world, uint32_t count)
+	{
+		const glm::uvec3 sizeInVoxels = world.GetSizeInVoxels();
+		BenchmarkRandom random{ 48 };
+
+		std::vector<NavPathRequest> requests{};
+		for (uint32_t r = 0; r < count; r++)
+		{
+			const glm::ivec3 start = GetSurfaceVoxel(world, random.NextBelow(sizeInVoxels.x), random.NextBelow(sizeInVoxels.z));
+			const glm::ivec3 goal = GetSurfaceVoxel(world, random.NextBelow(sizeInVoxels.x), random.NextBelow(sizeInVoxels.z));
+			requests.push_back({ start, goal, r });
+		}
+
+		return requests;
+	}
+
+	// The whole graph of a terrain world. Items are bricks.
+	static void BuildGraphBench(BenchmarkState& state)
+	{
+		VoxelWorld world = CreateTerrainWorld(kNavWorldSize);
+		const std::shared_ptr<const WorldSnapshot> snapshot = world.TakeSnapshot();
+
+		BrickNavigator navigator{ 1 };
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			navigator.Rebuild(snapshot);
+			navigator.WaitIdle();
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(snapshot->GetBrickCount());
+		KeepAlive(navigator.GetStats().m_portalCount);
+	}
+
+	// A hole dug into the surface per iteration, only the bricks around it are rebuilt. Items are edits.
+	static void EditGraphBench(BenchmarkState& state)
+	{
+		VoxelWorld world = CreateTerrainWorld(kNavWorldSize);
+		const glm::uvec3 sizeInVoxels = world.GetSizeInVoxels();
+
+		BrickNavigator navigator{ 1 };
+		navigator.SetSnapshot(world.TakeSnapshot());
+		navigator.WaitIdle();
+
+		BenchmarkRandom random{ 49 };
+		uint64_t rebuiltBricks = 0;
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			const glm::ivec3 surface = GetSurfaceVoxel(world, random.NextBelow(sizeInVoxels.x), random.NextBelow(sizeInVoxels.z));
+			if (surface.y > 0) world.SetVoxel(surface - glm::ivec3(0, 1, 0), 0);
+			const std::shared_ptr<const WorldSnapshot> snapshot = world.TakeSnapshot();
+
+			state.StartTimer();
+			navigator.SetSnapshot(snapshot);
+			navigator.WaitIdle();
+			state.StopTimer();
+
+			rebuiltBricks += navigator.GetStats().m_rebuiltBricks;
+		}
+
+		state.SetItemsPerIteration(1);
+		KeepAlive(rebuiltBricks);
+	}
+
+	// Paths between random surface voxels, queued at once. Items are paths.
+	static void FindPathsBench(BenchmarkState& state, uint32_t workerCount)
+	{
+		VoxelWorld world = CreateTerrainWorld(kNavWorldSize);
+		const std::vector<NavPathRequest> requests = CreatePathRequests(world, kNavPathCount);
+
+		BrickNavigator navigator{ workerCount };
+		navigator.SetSnapshot(world.TakeSnapshot());
+		navigator.WaitIdle();
+
+		std::vector<NavPath> paths{};
+		uint64_t pathVoxels = 0;
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			navigator.RequestPaths(requests);
+			navigator.WaitIdle();
+
+			paths.clear();
+			navigator.TakeFinishedPaths(paths);
+			for (const NavPath& path : paths) pathVoxels += path.m_voxels.size();
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(requests.size());
+		KeepAlive(pathVoxels);
+	}
+
+	// A* over every voxel of the world with the same moves, what the hierarchy replaces. Items are paths.
+	static void FlatPathsBench(BenchmarkState& state)
+	{
+		VoxelWorld world = CreateTerrainWorld(kNavWorldSize);
+		const std::vector<NavPathRequest> requests = CreatePathRequests(world, kFlatPathCount);
+
+		const glm::ivec3 size = glm::ivec3(world.GetSizeInVoxels());
+		const auto getIndex = [&](const glm::ivec3& position) { return (position.z * size.y + position.y) * size.x + position.x; };
+		const auto isSolid = [&](const glm::ivec3& position) { return world.IsInside(position) && world.GetVoxel(position) != 0; };
+
+		// Walkable and steppable for an agent two voxels tall, like the navigator's default.
+		std::vector<glm::uint8_t> flags(static_cast<size_t>(size.x) * size.y * size.z, 0);
+		for (int32_t z = 0; z < size.z; z++)
+		{
+			for (int32_t y = 1; y < size.y; y++)
+			{
+				for (int32_t x = 0; x < size.x; x++)
+				{
+					const glm::ivec3 position{ x, y, z };
+					if (isSolid(position) || !isSolid(position - glm::ivec3(0, 1, 0)) || isSolid(position + glm::ivec3(0, 1, 0))) continue;
+
+					flags[getIndex(position)] = isSolid(position + glm::ivec3(0, 2, 0)) ? 1 : 3;
+				}
+			}
+		}
+
+		std::vector<uint32_t> costs(flags.size());
+		std::vector<std::pair<uint32_t, int32_t>> open{};
+		uint64_t pathLengths = 0;
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (const NavPathRequest& request : requests)
+			{
+				std::fill(costs.begin(), costs.end(), ~0u);
+				open.clear();
+
+				const auto estimate = [&](const glm::ivec3& position) { return static_cast<uint32_t>(std::abs(position.x - request.m_goal.x) + std::abs(position.z - request.m_goal.z)); };
+
+				costs[getIndex(request.m_start)] = 0;
+				open.push_back({ estimate(request.m_start), getIndex(request.m_start) });
+
+				while (!open.empty())
+				{
+					std::pop_heap(open.begin(), open.end(), std::greater<std::pair<uint32_t, int32_t>>());
+					const int32_t index = open.back().second;
+					open.pop_back();
+
+					const glm::ivec3 position{ index % size.x, (index / size.x) % size.y, index / (size.x * size.y) };
+					if (position == request.m_goal)
+					{
+						pathLengths += costs[index];
+						break;
+					}
+
+					for (const glm::ivec2 direction : { glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1) })
+					{
+						for (const int32_t step : { 0, 1, -1 })
+						{
+							const glm::ivec3 next = position + glm::ivec3(direction.x, step, direction.y);
+							if (!world.IsInside(next) || flags[getIndex(next)] == 0) continue;
+							if (step > 0 && flags[index] != 3) continue;
+							if (step < 0 && flags[getIndex(next)] != 3) continue;
+
+							const uint32_t cost = costs[index] + 1;
+							if (cost >= costs[getIndex(next)]) continue;
+
+							costs[getIndex(next)] = cost;
+							open.push_back({ cost + estimate(next), getIndex(next) });
+							std::push_heap(open.begin(), open.end(), std::greater<std::pair<uint32_t, int32_t>>());
+						}
+					}
+				}
+			}
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(requests.size());
+		KeepAlive(pathLengths);
+	}
+
+	AFRE_BENCHMARK("brick_navigation/build_16x4x16", [](BenchmarkState& state) { BuildGraphBench(state); });
+	AFRE_BENCHMARK("brick_navigation/edit_16x4x16", [](BenchmarkState& state) { EditGraphBench(state); });
+	AFRE_BENCHMARK("brick_navigation/paths_1_worker", [](BenchmarkState& state) { FindPathsBench(state, 1); });
+	AFRE_BENCHMARK("brick_navigation/paths_3_workers", [](BenchmarkState& state) { FindPathsBench(state, 3); });
+	AFRE_BENCHMARK("brick_navigation/paths_flat_astar", [](BenchmarkState& state) { FlatPathsBench(state); });
+}
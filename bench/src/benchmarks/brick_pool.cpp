@@ -0,0 +1,88 @@
+#include <cstdlib>
+#include <thread>
+#include "benchmark.h"
+#include "core/voxel/brick_pool.h"
+
+namespace afre
+{
+	static constexpr uint32_t kChurnLiveBricks = 512;
+	static constexpr uint32_t kChurnOpsPerThread = 16384;
+
+	static Brick* ToBrick(Brick* brick)
+	{
+		return brick;
+	}
+
+	static Brick* ToBrick(BrickHandle handle)
+	{
+		return BrickPool::Get().Resolve(handle);
+	}
+
+	// Each thread keeps kChurnLiveBricks bricks alive and replaces a random one per op, writing to it like an edit
+	// would. Items are allocations over all threads, each with its free.
+	template<typename Allocate, typename Free>
+	static void ChurnBench(BenchmarkState& state, uint32_t threadCount, Allocate allocateBrick, Free freeBrick)
+	{
+		uint64_t checksum = 0;
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			std::vector<uint64_t> threadChecksums(threadCount);
+
+			state.StartTimer();
+			std::vector<std::thread> threads{};
+			for (uint32_t t = 0; t < threadCount; t++)
+			{
+				threads.emplace_back([&, t]()
+					{
+						BenchmarkRandom random{ 31 + t };
+
+						std::vector<decltype(allocateBrick())> live(kChurnLiveBricks);
+						for (auto& brick : live) brick = allocateBrick();
+
+						uint64_t threadChecksum = 0;
+						for (uint32_t op = 0; op < kChurnOpsPerThread; op++)
+						{
+							auto& brick = live[random.Next() % kChurnLiveBricks];
+							freeBrick(brick);
+							brick = allocateBrick();
+
+							Brick* voxels = ToBrick(brick);
+							voxels->m_voxels[0] = static_cast<glm::uint16_t>(op);
+							voxels->m_voxels[kBrickVoxelCount - 1] = static_cast<glm::uint16_t>(op);
+							threadChecksum += voxels->m_voxels[0];
+						}
+
+						for (auto& brick : live) freeBrick(brick);
+						threadChecksums[t] = threadChecksum;
+					});
+			}
+
+			for (std::thread& thread : threads) thread.join();
+			state.StopTimer();
+
+			for (uint64_t threadChecksum : threadChecksums) checksum += threadChecksum;
+		}
+
+		state.SetItemsPerIteration(static_cast<uint64_t>(threadCount) * (kChurnOpsPerThread + kChurnLiveBricks));
+		KeepAlive(checksum);
+	}
+
+	static void ChurnMallocBench(BenchmarkState& state, uint32_t threadCount)
+	{
+		ChurnBench(state, threadCount,
+			[]() { return static_cast<Brick*>(std::malloc(sizeof(Brick))); },
+			[](Brick* brick) { std::free(brick); });
+	}
+
+	static void ChurnPoolBench(BenchmarkState& state, uint32_t threadCount)
+	{
+		ChurnBench(state, threadCount,
+			[]() { return BrickPool::Get().Allocate(BRICK_POOL_OTHER); },
+			[](BrickHandle handle) { BrickPool::Get().Free(handle); });
+	}
+
+	AFRE_BENCHMARK("brick_pool/churn_malloc_1_thread", [](BenchmarkState& state) { ChurnMallocBench(state, 1); });
+	AFRE_BENCHMARK("brick_pool/churn_pool_1_thread", [](BenchmarkState& state) { ChurnPoolBench(state, 1); });
+	AFRE_BENCHMARK("brick_pool/churn_malloc_4_threads", [](BenchmarkState& state) { ChurnMallocBench(state, 4); });
+	AFRE_BENCHMARK("brick_pool/churn_pool_4_threads", [](BenchmarkState& state) { ChurnPoolBench(state, 4); });
+}
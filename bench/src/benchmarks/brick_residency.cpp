@@ -0,0 +1,49 @@
+#include <algorithm>
+#include "benchmark.h"
+#include "core/voxel/brick_residency.h"
+
+namespace afre
+{
+	// A camera moving through a world of brickCount unique bricks: every frame the rays read workingSet bricks from
+	// a window that slides on by stride, and ask for the ones without a slot. bytes_per_item is what gets uploaded per frame.
+	static void ResidencyBench(BenchmarkState& state, uint32_t brickCount, uint32_t slotBudget, uint32_t workingSet, uint32_t stride)
+	{
+		BrickResidency brickResidency{ slotBudget / 4, slotBudget };
+		brickResidency.Reset(brickCount);
+
+		std::vector<glm::uint32_t> usedSlots((slotBudget + 31) / 32);
+		std::vector<BrickUpload> brickUploads{};
+		BrickResidencyStats stats{};
+
+		uint64_t uploadedBricks = 0;
+		state.StartTimer();
+		for (uint64_t frame = 0; frame < state.GetIterations(); frame++)
+		{
+			std::fill(usedSlots.begin(), usedSlots.end(), 0u);
+
+			const uint32_t firstBrick = static_cast<uint32_t>((frame * stride) % brickCount);
+			for (uint32_t b = 0; b < workingSet; b++)
+			{
+				const uint32_t brick = (firstBrick + b) % brickCount;
+				const uint32_t slot = brickResidency.GetSlot(brick);
+
+				if (slot == BrickResidency::kNoSlot) brickResidency.Request(brick);
+				else usedSlots[slot >> 5] |= 1u << (slot & 31);
+			}
+
+			brickResidency.MarkSlotsUsed(usedSlots.data());
+
+			brickUploads.clear();
+			brickResidency.Update(brickUploads, stats);
+			uploadedBricks += stats.m_uploadedBricks;
+		}
+		state.StopTimer();
+
+		state.SetBytesPerItem(static_cast<double>(uploadedBricks * sizeof(Brick)) / static_cast<double>(state.GetIterations()));
+		KeepAlive(uploadedBricks);
+	}
+
+	AFRE_BENCHMARK("brick_residency/sliding_4096_bricks_1024_slots", [](BenchmarkState& state) { ResidencyBench(state, 4096, 1024, 768, 8); });
+	// More bricks read every frame than there are slots, the requests that don't fit wait.
+	AFRE_BENCHMARK("brick_residency/oversubscribed_4096_bricks_1024_slots", [](BenchmarkState& state) { ResidencyBench(state, 4096, 1024, 1280, 8); });
+}
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <cstring>
+#include "bench_worlds.h"
+#include "benchmark.h"
+
+namespace afre
+{
+	// The same terrain in every configuration, whatever the engine's brick size.
+	static const glm::uvec3 kSizedWorldVoxels{ 256, 64, 256 };
+
+	// The terrain as one array, x first, so converting it to each configuration costs the same.
+	static std::vector<glm::uint16_t> CreateFlatTerrain()
+	{
+		const VoxelWorld world = CreateTerrainWorld(kSizedWorldVoxels / static_cast<uint32_t>(kBrickSize));
+
+		std::vector<glm::uint16_t> voxels(static_cast<size_t>(kSizedWorldVoxels.x) * kSizedWorldVoxels.y * kSizedWorldVoxels.z);
+		for (uint32_t z = 0; z < kSizedWorldVoxels.z; z++)
+			for (uint32_t y = 0; y < kSizedWorldVoxels.y; y++)
+				for (uint32_t x = 0; x < kSizedWorldVoxels.x; x++)
+					voxels[(static_cast<size_t>(z) * kSizedWorldVoxels.y + y) * kSizedWorldVoxels.x + x] = world.GetVoxel(glm::ivec3(x, y, z));
+
+		return voxels;
+	}
+
+	// What the GPU gets in one configuration: a table entry per brick, uniform bricks keep their voxel in it like in
+	// PackedVoxelData and the others a slot of the pool.
+	template<typename BrickType>
+	class SizedWorld
+	{
+	public:
+		using Voxel = typename BrickType::VoxelType;
+
+		explicit SizedWorld(const std::vector<glm::uint16_t>& voxels)
+			: m_sizeInBricks(kSizedWorldVoxels / BrickType::kSize)
+		{
+			m_brickTable.resize(static_cast<size_t>(m_sizeInBricks.x) * m_sizeInBricks.y * m_sizeInBricks.z);
+
+			for (uint32_t bz = 0; bz < m_sizeInBricks.z; bz++)
+				for (uint32_t by = 0; by < m_sizeInBricks.y; by++)
+					for (uint32_t bx = 0; bx < m_sizeInBricks.x; bx++)
+					{
+						const glm::uvec3 brickMin = glm::uvec3(bx, by, bz) * BrickType::kSize;
+						const Voxel first = static_cast<Voxel>(voxels[(static_cast<size_t>(brickMin.z) * kSizedWorldVoxels.y + brickMin.y) * kSizedWorldVoxels.x + brickMin.x]);
+
+						BrickType brick{};
+						bool uniform = true;
+						for (uint32_t z = 0; z < BrickType::kSize; z++)
+							for (uint32_t y = 0; y < BrickType::kSize; y++)
+								for (uint32_t x = 0; x < BrickType::kSize; x++)
+								{
+									const size_t index = (static_cast<size_t>(brickMin.z + z) * kSizedWorldVoxels.y + brickMin.y + y) * kSizedWorldVoxels.x + brickMin.x + x;
+									const Voxel voxel = static_cast<Voxel>(voxels[index]);
+
+									brick.At({ x, y, z }) = voxel;
+									uniform = uniform && voxel == first;
+								}
+
+						glm::uint32_t& entry = m_brickTable[GetBrickIndex({ bx, by, bz })];
+						if (uniform)
+						{
+							entry = kUniformBrickBit | first;
+							continue;
+						}
+
+						entry = static_cast<glm::uint32_t>(m_brickPool.size());
+						m_brickPool.push_back(brick);
+					}
+		}
+
+		inline size_t GetBytes() const { return m_brickTable.size() * sizeof(glm::uint32_t) + m_brickPool.size() * sizeof(BrickType); }
+
+		inline bool IsInside(const glm::ivec3& position) const
+		{
+			return position.x >= 0 && position.y >= 0 && position.z >= 0 &&
+				static_cast<uint32_t>(position.x) < kSizedWorldVoxels.x && static_cast<uint32_t>(position.y) < kSizedWorldVoxels.y && static_cast<uint32_t>(position.z) < kSizedWorldVoxels.z;
+		}
+
+		inline uint32_t GetBrickIndex(const glm::uvec3& brickPosition) const
+		{
+			return (brickPosition.z * m_sizeInBricks.y + brickPosition.y) * m_sizeInBricks.x + brickPosition.x;
+		}
+
+		glm::uvec3 m_sizeInBricks{};
+		std::vector<glm::uint32_t> m_brickTable{};
+		std::vector<BrickType> m_brickPool{};
+	};
+
+	// Converting the terrain. Items are voxels, bytes_per_item is what the world takes on the GPU per voxel.
+	template<typename BrickType>
+	static void BuildBench(BenchmarkState& state)
+	{
+		const std::vector<glm::uint16_t> voxels = CreateFlatTerrain();
+
+		size_t bytes = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			const SizedWorld<BrickType> world{ voxels };
+			bytes = world.GetBytes();
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(voxels.size());
+		state.SetBytesPerItem(static_cast<double>(bytes) / static_cast<double>(voxels.size()));
+		KeepAlive(bytes);
+	}
+
+	// The shader's march from random points above the terrain: uniform air bricks are skipped to their exit in one
+	// go, the others are stepped voxel by voxel. Items are rays.
+	template<typename BrickType>
+	static void TraversalBench(BenchmarkState& state)
+	{
+		const SizedWorld<BrickType> world{ CreateFlatTerrain() };
+		const glm::vec3 worldSize = glm::vec3(kSizedWorldVoxels);
+		const int32_t size = static_cast<int32_t>(BrickType::kSize);
+
+		constexpr uint32_t kRayCount = 1024;
+
+		BenchmarkRandom random{ 7 };
+		std::vector<glm::vec3> rayOrigins{};
+		std::vector<glm::vec3> rayDirs{};
+		for (uint32_t r = 0; r < kRayCount; r++)
+		{
+			rayOrigins.push_back(glm::vec3(random.NextFloat() * worldSize.x, worldSize.y * (0.6f + random.NextFloat() * 0.35f), random.NextFloat() * worldSize.z));
+			rayDirs.push_back(glm::normalize(glm::vec3(random.NextFloat() * 2.f - 1.f, -0.2f - random.NextFloat(), random.NextFloat() * 2.f - 1.f)));
+		}
+
+		uint64_t steps = 0;
+		uint64_t hits = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint32_t r = 0; r < kRayCount; r++)
+			{
+				const glm::vec3& rayOrigin = rayOrigins[r];
+				const glm::vec3& rayDir = rayDirs[r];
+
+				const glm::vec3 deltaDist = 1.f / glm::abs(rayDir);
+				glm::ivec3 voxelMap = glm::ivec3(glm::floor(rayOrigin));
+				const glm::ivec3 voxelStep = glm::ivec3(glm::sign(rayDir));
+
+				const auto getSideDist = [&](glm::vec3& sideDist)
+					{
+						for (uint8_t a = 0; a < 3; a++)
+						{
+							const float fraction = rayOrigin[a] - static_cast<float>(voxelMap[a]);
+							sideDist[a] = (rayDir[a] < 0 ? fraction : 1.f - fraction) * deltaDist[a];
+						}
+					};
+
+				glm::vec3 sideDist{};
+				getSideDist(sideDist);
+
+				while (world.IsInside(voxelMap))
+				{
+					steps++;
+
+					const glm::uvec3 brickPosition = glm::uvec3(voxelMap) >> BrickType::kSizeBits;
+					const glm::uint32_t entry = world.m_brickTable[world.GetBrickIndex(brickPosition)];
+
+					if ((entry & kUniformBrickBit) == 0)
+					{
+						const glm::uvec3 local = glm::uvec3(voxelMap) & (BrickType::kSize - 1u);
+						if (world.m_brickPool[entry].At(local) != 0)
+						{
+							hits++;
+							break;
+						}
+					}
+					else if ((entry & 0xFFFF) != 0)
+					{
+						hits++;
+						break;
+					}
+					else
+					{
+						// To the last voxel the ray crosses in the brick, the step below leaves it.
+						const glm::ivec3 brickMin = glm::ivec3(brickPosition) * size;
+
+						float exitDistance = 1e30f;
+						for (uint8_t a = 0; a < 3; a++)
+						{
+							const float exitPlane = static_cast<float>(brickMin[a] + (rayDir[a] > 0 ? size : 0));
+							if (rayDir[a] != 0) exitDistance = std::min(exitDistance, (exitPlane - rayOrigin[a]) / rayDir[a]);
+						}
+
+						const glm::vec3 exitPoint = rayOrigin + rayDir * exitDistance;
+						for (uint8_t a = 0; a < 3; a++)
+						{
+							const int32_t exitVoxel = std::clamp(static_cast<int32_t>(std::floor(exitPoint[a])), brickMin[a], brickMin[a] + size - 1);
+							voxelMap[a] = rayDir[a] > 0 ? std::max(exitVoxel, voxelMap[a]) : std::min(exitVoxel, voxelMap[a]);
+						}
+
+						getSideDist(sideDist);
+					}
+
+					uint8_t axis = 0;
+					if (sideDist.x < sideDist.y)
+					{
+						axis = sideDist.x < sideDist.z ? 0 : 2;
+					}
+					else
+					{
+						axis = sideDist.y < sideDist.z ? 1 : 2;
+					}
+
+					voxelMap[axis] += voxelStep[axis];
+					sideDist[axis] += deltaDist[axis];
+				}
+			}
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(kRayCount);
+		KeepAlive(steps + hits);
+	}
+
+	// Batches of single voxel edits at random points, every brick they touch copied whole to a staging buffer like
+	// the upload queue does. Items are edits, bytes_per_item is what gets uploaded per edit.
+	template<typename BrickType>
+	static void UploadBench(BenchmarkState& state)
+	{
+		SizedWorld<BrickType> world{ CreateFlatTerrain() };
+
+		constexpr uint32_t kEditCount = 256;
+
+		BenchmarkRandom random{ 13 };
+		std::vector<glm::uvec3> edits{};
+		for (uint32_t e = 0; e < kEditCount; e++) edits.push_back({ random.NextBelow(kSizedWorldVoxels.x), random.NextBelow(kSizedWorldVoxels.y), random.NextBelow(kSizedWorldVoxels.z) });
+
+		std::vector<glm::uint8_t> dirty(world.m_brickTable.size(), 0);
+		std::vector<uint32_t> dirtyBricks{};
+		std::vector<glm::uint8_t> staging(kEditCount * sizeof(BrickType));
+
+		uint64_t uploadedBytes = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			const typename BrickType::VoxelType voxel = static_cast<typename BrickType::VoxelType>(1 + (i & 1));
+
+			for (const glm::uvec3& position : edits)
+			{
+				const uint32_t brickIndex = world.GetBrickIndex(position >> BrickType::kSizeBits);
+				glm::uint32_t& entry = world.m_brickTable[brickIndex];
+
+				// A uniform brick gets a pool slot on its first edit.
+				if ((entry & kUniformBrickBit) != 0)
+				{
+					BrickType brick{};
+					std::fill(std::begin(brick.m_voxels), std::end(brick.m_voxels), static_cast<typename BrickType::VoxelType>(entry & 0xFFFF));
+
+					entry = static_cast<glm::uint32_t>(world.m_brickPool.size());
+					world.m_brickPool.push_back(brick);
+				}
+
+				world.m_brickPool[entry].At(position & (BrickType::kSize - 1u)) = voxel;
+
+				if (dirty[brickIndex]) continue;
+
+				dirty[brickIndex] = 1;
+				dirtyBricks.push_back(brickIndex);
+			}
+
+			size_t offset = 0;
+			for (const uint32_t brickIndex : dirtyBricks)
+			{
+				std::memcpy(staging.data() + offset, &world.m_brickPool[world.m_brickTable[brickIndex]], sizeof(BrickType));
+				offset += sizeof(BrickType);
+				dirty[brickIndex] = 0;
+			}
+
+			uploadedBytes += offset;
+			dirtyBricks.clear();
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(kEditCount);
+		state.SetBytesPerItem(static_cast<double>(uploadedBytes) / static_cast<double>(state.GetIterations() * kEditCount));
+		KeepAlive(staging[0]);
+	}
+
+	// Every size with both voxel types, 8 bit voxels only have room for 255 materials.
+	using Brick8U8 = BasicBrick<8, glm::uint8_t>;
+	using Brick8U16 = BasicBrick<8, glm::uint16_t>;
+	using Brick16U8 = BasicBrick<16, glm::uint8_t>;
+	using Brick16U16 = BasicBrick<16, glm::uint16_t>;
+	using Brick32U8 = BasicBrick<32, glm::uint8_t>;
+	using Brick32U16 = BasicBrick<32, glm::uint16_t>;
+
+	AFRE_BENCHMARK("brick_size/build_8_u8", BuildBench<Brick8U8>);
+	AFRE_BENCHMARK("brick_size/build_8_u16", BuildBench<Brick8U16>);
+	AFRE_BENCHMARK("brick_size/build_16_u8", BuildBench<Brick16U8>);
+	AFRE_BENCHMARK("brick_size/build_16_u16", BuildBench<Brick16U16>);
+	AFRE_BENCHMARK("brick_size/build_32_u8", BuildBench<Brick32U8>);
+	AFRE_BENCHMARK("brick_size/build_32_u16", BuildBench<Brick32U16>);
+
+	AFRE_BENCHMARK("brick_size/traversal_8_u8", TraversalBench<Brick8U8>);
+	AFRE_BENCHMARK("brick_size/traversal_8_u16", TraversalBench<Brick8U16>);
+	AFRE_BENCHMARK("brick_size/traversal_16_u8", TraversalBench<Brick16U8>);
+	AFRE_BENCHMARK("brick_size/traversal_16_u16", TraversalBench<Brick16U16>);
+	AFRE_BENCHMARK("brick_size/traversal_32_u8", TraversalBench<Brick32U8>);
+	AFRE_BENCHMARK("brick_size/traversal_32_u16", TraversalBench<Brick32U16>);
+
+	AFRE_BENCHMARK("brick_size/upload_8_u8", UploadBench<Brick8U8>);
+	AFRE_BENCHMARK("brick_size/upload_8_u16", UploadBench<Brick8U16>);
+	AFRE_BENCHMARK("brick_size/upload_16_u8", UploadBench<Brick16U8>);
+	AFRE_BENCHMARK("brick_size/upload_16_u16", UploadBench<Brick16U16>);
+	AFRE_BENCHMARK("brick_size/upload_32_u8", UploadBench<Brick32U8>);
+	AFRE_BENCHMARK("brick_size/upload_32_u16", UploadBench<Brick32U16>);
+}
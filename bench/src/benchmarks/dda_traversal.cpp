@@ -0,0 +1,53 @@
+#include <cmath>
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/dda.h"
+
+namespace afre
+{
+	static constexpr uint32_t kRayGridSize = 64;
+
+	// Casts a kRayGridSize^2 grid of rays through a 90 degree frustum, like FragMain does per pixel.
+	static void TraceRayGrid(BenchmarkState& state, const glm::uvec3& sizeInBricks, float pitch)
+	{
+		const VoxelWorld world = CreateTerrainWorld(sizeInBricks);
+		const glm::vec3 worldSize = glm::vec3(world.GetSizeInVoxels());
+
+		const glm::vec3 origin{ worldSize.x * 0.1f, worldSize.y * 0.9f, worldSize.z * 0.1f };
+		const glm::vec3 forward = glm::normalize(glm::vec3(1.f, pitch, 1.f));
+		const glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.f, 1.f, 0.f)));
+		const glm::vec3 up = glm::cross(right, forward);
+
+		std::vector<glm::vec3> rayDirs{};
+		for (uint32_t y = 0; y < kRayGridSize; y++)
+		{
+			for (uint32_t x = 0; x < kRayGridSize; x++)
+			{
+				const float u = (static_cast<float>(x) + 0.5f) / kRayGridSize * 2.f - 1.f;
+				const float v = (static_cast<float>(y) + 0.5f) / kRayGridSize * 2.f - 1.f;
+				rayDirs.push_back(glm::normalize(forward + right * u + up * v));
+			}
+		}
+
+		const float maxDistance = glm::length(worldSize);
+		state.SetItemsPerIteration(rayDirs.size());
+
+		uint64_t steps = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (const glm::vec3& rayDir : rayDirs)
+			{
+				steps += TraceRay(world, origin, rayDir, maxDistance).m_steps;
+			}
+		}
+		state.StopTimer();
+
+		KeepAlive(steps);
+	}
+
+	AFRE_BENCHMARK("dda_traversal/terrain_4x4x4_down", [](BenchmarkState& state) { TraceRayGrid(state, { 4, 4, 4 }, -0.6f); });
+	AFRE_BENCHMARK("dda_traversal/terrain_8x4x8_down", [](BenchmarkState& state) { TraceRayGrid(state, { 8, 4, 8 }, -0.6f); });
+	AFRE_BENCHMARK("dda_traversal/terrain_8x4x8_horizon", [](BenchmarkState& state) { TraceRayGrid(state, { 8, 4, 8 }, -0.1f); });
+	AFRE_BENCHMARK("dda_traversal/terrain_16x4x16_horizon", [](BenchmarkState& state) { TraceRayGrid(state, { 16, 4, 16 }, -0.1f); });
+}
@@ -0,0 +1,85 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/edit_replication.h"
+
+namespace afre
+{
+	// One server tick: snapshot, packets to the client, the client's acks back.
+	static void ReplicateTick(VoxelWorld& world, ReplicationServer& server, uint32_t clientId, ReplicationClient& client, LoopbackTransport& transport,
+		std::vector<std::vector<uint8_t>>& packets, std::vector<uint8_t>& packet, std::vector<uint8_t>& ack)
+	{
+		const std::shared_ptr<const WorldSnapshot> snapshot = world.TakeSnapshot();
+
+		packets.clear();
+		server.WritePackets(clientId, *snapshot, packets);
+		for (std::vector<uint8_t>& serverPacket : packets) transport.SendToClient(clientId, std::move(serverPacket));
+
+		while (transport.ReceiveOnClient(clientId, packet))
+		{
+			if (client.ReadPacket(packet.data(), packet.size(), ack)) transport.SendToServer(clientId, ack);
+		}
+
+		uint32_t ackClientId = 0;
+		while (transport.ReceiveOnServer(ackClientId, packet)) server.ReadAck(ackClientId, packet.data(), packet.size());
+
+		transport.Tick();
+	}
+
+	// A client that already has the world receives a tick's worth of edits, radius 0 being single voxels.
+	static void ReplicationBench(BenchmarkState& state, uint32_t editsPerTick, int32_t radius, const LoopbackTransportInfo& loopbackTransportInfo = {})
+	{
+		VoxelWorld world = CreateTerrainWorld({ 8, 4, 8 });
+		const glm::uvec3 size = world.GetSizeInVoxels();
+
+		ReplicationServer server{};
+		const uint32_t clientId = server.AddClient(ReplicationClientInfo{});
+		ReplicationClient client{ world.GetSizeInBricks() };
+		LoopbackTransport transport{ loopbackTransportInfo };
+
+		std::vector<std::vector<uint8_t>> packets{};
+		std::vector<uint8_t> packet{};
+		std::vector<uint8_t> ack{};
+
+		// Not measured, the initial download is a one off.
+		while (server.GetPendingBrickCount(clientId, *world.TakeSnapshot()) > 0)
+		{
+			ReplicateTick(world, server, clientId, client, transport, packets, packet, ack);
+		}
+
+		BenchmarkRandom random{ 11 };
+		const uint64_t syncedBytes = transport.GetBytesToClients();
+		state.SetItemsPerIteration(editsPerTick);
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint32_t e = 0; e < editsPerTick; e++)
+			{
+				const glm::ivec3 center = glm::ivec3(random.NextBelow(size.x), random.NextBelow(size.y), random.NextBelow(size.z));
+				const glm::uint16_t voxel = static_cast<glm::uint16_t>(random.NextBelow(3));
+
+				for (int32_t z = -radius; z <= radius; z++)
+				{
+					for (int32_t y = -radius; y <= radius; y++)
+					{
+						for (int32_t x = -radius; x <= radius; x++)
+						{
+							if (x * x + y * y + z * z <= radius * radius) world.SetVoxel(center + glm::ivec3(x, y, z), voxel);
+						}
+					}
+				}
+			}
+
+			ReplicateTick(world, server, clientId, client, transport, packets, packet, ack);
+		}
+		state.StopTimer();
+
+		state.SetBytesPerItem(static_cast<double>(transport.GetBytesToClients() - syncedBytes) / static_cast<double>(state.GetIterations() * editsPerTick));
+		KeepAlive(client.GetBrickVersion(0));
+	}
+
+	AFRE_BENCHMARK("edit_replication/single_voxel_64", [](BenchmarkState& state) { ReplicationBench(state, 64, 0); });
+	AFRE_BENCHMARK("edit_replication/sphere_r4_8", [](BenchmarkState& state) { ReplicationBench(state, 8, 4); });
+	AFRE_BENCHMARK("edit_replication/single_voxel_64_latency_3", [](BenchmarkState& state) { ReplicationBench(state, 64, 0, { 0.f, 3 }); });
+	AFRE_BENCHMARK("edit_replication/single_voxel_64_latency_3_loss_5", [](BenchmarkState& state) { ReplicationBench(state, 64, 0, { 0.05f, 3 }); });
+}
@@ -0,0 +1,157 @@
+#include "benchmark.h"
+#include "core/voxel/voxel_instance.h"
+
+namespace afre
+{
+	static constexpr float kFieldSize = 512.f;
+	static constexpr uint32_t kRayCount = 1024;
+
+	// A ball in a single brick, the model every instance shares.
+	static std::shared_ptr<const VoxelWorld> CreateBallModel()
+	{
+		std::shared_ptr<VoxelWorld> model = std::make_shared<VoxelWorld>(glm::uvec3(1));
+
+		for (int32_t z = 0; z < kBrickSize; z++)
+		{
+			for (int32_t y = 0; y < kBrickSize; y++)
+			{
+				for (int32_t x = 0; x < kBrickSize; x++)
+				{
+					const glm::vec3 offset = glm::vec3(x, y, z) + 0.5f - static_cast<float>(kBrickSize) * 0.5f;
+					if (glm::dot(offset, offset) < 49.f) model->SetVoxel({ x, y, z }, 1);
+				}
+			}
+		}
+
+		return model;
+	}
+
+	static std::vector<VoxelInstance> CreateInstances(uint32_t instanceCount, BenchmarkRandom& random)
+	{
+		const std::shared_ptr<const VoxelWorld> model = CreateBallModel();
+
+		std::vector<VoxelInstance> instances(instanceCount);
+		for (VoxelInstance& instance : instances)
+		{
+			instance.m_model = model;
+			instance.m_position = glm::vec3(random.NextFloat() * kFieldSize, random.NextFloat() * 64.f, random.NextFloat() * kFieldSize);
+			instance.m_rotation = glm::angleAxis(random.NextFloat() * 6.2831853f, glm::vec3(0.f, 1.f, 0.f));
+		}
+
+		return instances;
+	}
+
+	// Every instance moves a little each frame, the usual case the refit is for.
+	static void MoveBench(BenchmarkState& state, uint32_t instanceCount)
+	{
+		BenchmarkRandom random{ 3 };
+		std::vector<VoxelInstance> instances = CreateInstances(instanceCount, random);
+
+		std::vector<glm::vec3> velocities(instanceCount);
+		for (glm::vec3& velocity : velocities)
+		{
+			velocity = glm::vec3(random.NextFloat() - 0.5f, 0.f, random.NextFloat() - 0.5f);
+		}
+
+		InstanceBvh bvh{};
+		std::vector<Aabb> bounds(instanceCount);
+		for (uint32_t n = 0; n < instanceCount; n++) bounds[n] = GetInstanceBounds(instances[n]);
+		bvh.Build(bounds);
+
+		const uint32_t buildCount = bvh.GetBuildCount();
+		state.SetItemsPerIteration(instanceCount);
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint32_t n = 0; n < instanceCount; n++)
+			{
+				instances[n].m_position += velocities[n];
+				bounds[n] = GetInstanceBounds(instances[n]);
+			}
+
+			bvh.Update(bounds);
+		}
+		state.StopTimer();
+
+		KeepAlive(bvh.GetBuildCount() - buildCount);
+	}
+
+	static void BuildBench(BenchmarkState& state, uint32_t instanceCount)
+	{
+		BenchmarkRandom random{ 3 };
+		const std::vector<VoxelInstance> instances = CreateInstances(instanceCount, random);
+
+		std::vector<Aabb> bounds(instanceCount);
+		for (uint32_t n = 0; n < instanceCount; n++) bounds[n] = GetInstanceBounds(instances[n]);
+
+		InstanceBvh bvh{};
+		state.SetItemsPerIteration(instanceCount);
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			bvh.Build(bounds);
+		}
+		state.StopTimer();
+
+		KeepAlive(bvh.GetNodeCount());
+	}
+
+	// Rays from above the field going down at an angle, about half of them hit an instance.
+	static void TraceBench(BenchmarkState& state, uint32_t instanceCount, bool useBvh)
+	{
+		BenchmarkRandom random{ 5 };
+		const std::vector<VoxelInstance> instances = CreateInstances(instanceCount, random);
+
+		std::vector<Aabb> bounds(instanceCount);
+		for (uint32_t n = 0; n < instanceCount; n++) bounds[n] = GetInstanceBounds(instances[n]);
+
+		InstanceBvh bvh{};
+		bvh.Build(bounds);
+
+		std::vector<glm::vec3> rayOrigins{};
+		std::vector<glm::vec3> rayDirs{};
+		for (uint32_t r = 0; r < kRayCount; r++)
+		{
+			rayOrigins.push_back(glm::vec3(random.NextFloat() * kFieldSize, 96.f, random.NextFloat() * kFieldSize));
+			rayDirs.push_back(glm::normalize(glm::vec3(random.NextFloat() * 2.f - 1.f, -0.5f, random.NextFloat() * 2.f - 1.f)));
+		}
+
+		const float maxDistance = kFieldSize;
+		state.SetItemsPerIteration(kRayCount);
+
+		uint64_t hits = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (uint32_t r = 0; r < kRayCount; r++)
+			{
+				if (useBvh)
+				{
+					hits += TraceInstances(instances, bvh, rayOrigins[r], rayDirs[r], maxDistance).m_rayHit.m_hit ? 1 : 0;
+					continue;
+				}
+
+				float nearest = maxDistance;
+				for (const VoxelInstance& instance : instances)
+				{
+					const RayHit rayHit = TraceInstance(instance, rayOrigins[r], rayDirs[r], nearest);
+					if (rayHit.m_hit) nearest = rayHit.m_distance;
+				}
+				hits += nearest < maxDistance ? 1 : 0;
+			}
+		}
+		state.StopTimer();
+
+		KeepAlive(hits);
+	}
+
+	AFRE_BENCHMARK("instance_bvh/build_1024", [](BenchmarkState& state) { BuildBench(state, 1024); });
+	AFRE_BENCHMARK("instance_bvh/move_256", [](BenchmarkState& state) { MoveBench(state, 256); });
+	AFRE_BENCHMARK("instance_bvh/move_1024", [](BenchmarkState& state) { MoveBench(state, 1024); });
+	AFRE_BENCHMARK("instance_bvh/trace_bvh_256", [](BenchmarkState& state) { TraceBench(state, 256, true); });
+	AFRE_BENCHMARK("instance_bvh/trace_brute_force_256", [](BenchmarkState& state) { TraceBench(state, 256, false); });
+	AFRE_BENCHMARK("instance_bvh/trace_bvh_1024", [](BenchmarkState& state) { TraceBench(state, 1024, true); });
+	AFRE_BENCHMARK("instance_bvh/trace_brute_force_1024", [](BenchmarkState& state) { TraceBench(state, 1024, false); });
+}
@@ -0,0 +1,64 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+#include "core/voxel/light_propagation.h"
+
+namespace afre
+{
+	static constexpr glm::uint16_t kLampVoxel = 3;
+
+	static void LightRebuild(BenchmarkState& state, const glm::uvec3& sizeInBricks)
+	{
+		VoxelWorld world = CreateTerrainWorld(sizeInBricks);
+		state.SetItemsPerIteration(world.GetBrickCount());
+
+		LightPropagator lightPropagator{};
+		lightPropagator.SetVoxelLighting(kLampVoxel, { 14, true });
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			lightPropagator.Rebuild(world.TakeSnapshot());
+			lightPropagator.WaitIdle();
+		}
+		state.StopTimer();
+
+		KeepAlive(lightPropagator.GetLight({ 0, 0, 0 }));
+	}
+
+	// Toggles a voxel in the middle of the terrain surface, the cost of a single player edit.
+	static void LightIncrementalEdit(BenchmarkState& state, glm::uint16_t placedVoxel)
+	{
+		VoxelWorld world = CreateTerrainWorld({ 8, 4, 8 });
+
+		LightPropagator lightPropagator{};
+		lightPropagator.SetVoxelLighting(kLampVoxel, { 14, true });
+		lightPropagator.Rebuild(world.TakeSnapshot());
+		lightPropagator.WaitIdle();
+
+		glm::ivec3 position = glm::ivec3(world.GetSizeInVoxels() / 2u);
+		while (position.y > 0 && world.GetVoxel(position) == 0) position.y--;
+		position.y++;
+
+		std::vector<LitBrick> litBricks{};
+		uint64_t litBrickCount = 0;
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			lightPropagator.QueueVoxelEdit({ position, 0, placedVoxel });
+			lightPropagator.QueueVoxelEdit({ position, placedVoxel, 0 });
+			lightPropagator.WaitIdle();
+
+			lightPropagator.TakeLitBricks(litBricks);
+			litBrickCount += litBricks.size();
+		}
+		state.StopTimer();
+
+		KeepAlive(litBrickCount);
+	}
+
+	AFRE_BENCHMARK("light_propagation/rebuild_3x3x3", [](BenchmarkState& state) { LightRebuild(state, { 3, 3, 3 }); });
+	AFRE_BENCHMARK("light_propagation/rebuild_8x4x8", [](BenchmarkState& state) { LightRebuild(state, { 8, 4, 8 }); });
+	AFRE_BENCHMARK("light_propagation/edit_block", [](BenchmarkState& state) { LightIncrementalEdit(state, 1); });
+	AFRE_BENCHMARK("light_propagation/edit_lamp", [](BenchmarkState& state) { LightIncrementalEdit(state, kLampVoxel); });
+}
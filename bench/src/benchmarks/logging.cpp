@@ -0,0 +1,45 @@
+#include "benchmark.h"
+#include "log.h"
+
+namespace afre
+{
+	// An info call while the logger only lets warnings through, what a hot loop pays for leaving its logging in.
+	static void FilteredBench(BenchmarkState& state)
+	{
+		spdlog::logger& logger = *spdlog::default_logger_raw();
+		const spdlog::level::level_enum level = logger.level();
+		logger.set_level(spdlog::level::warn);
+
+		state.SetItemsPerIteration(1);
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			AFRE_INFO("Brick {} at {} {} {} was streamed in!", i, i & 15, i >> 4 & 15, i >> 8 & 15);
+		}
+		state.StopTimer();
+
+		logger.set_level(level);
+		KeepAlive(state.GetIterations());
+	}
+
+	// The part of every enabled call that runs on the caller's thread besides formatting.
+	static void FlightRecorderBench(BenchmarkState& state)
+	{
+		static constexpr std::string_view kMessage = "Voxel data packed (3 bricks, 0 light bricks)!";
+
+		state.SetItemsPerIteration(1);
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			RecordLog(spdlog::level::info, kMessage);
+		}
+		state.StopTimer();
+
+		KeepAlive(state.GetIterations());
+	}
+
+	AFRE_BENCHMARK("logging/filtered_info", FilteredBench);
+	AFRE_BENCHMARK("logging/flight_recorder", FlightRecorderBench);
+}
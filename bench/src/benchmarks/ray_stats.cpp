@@ -0,0 +1,35 @@
+#include "benchmark.h"
+#include "core/debug/ray_stats.h"
+
+namespace afre
+{
+	// The per frame readback cost of the AFRE_RAY_STATS build, one full 600x600 frame of counters.
+	static void SummarizeBench(BenchmarkState& state)
+	{
+		static RayStats pixels[kRayStatsWidth * kRayStatsHeight]{};
+
+		BenchmarkRandom random{ 5 };
+		for (RayStats& rayStats : pixels)
+		{
+			rayStats.m_steps = random.NextBelow(200);
+			rayStats.m_voxelLoads = random.NextBelow(rayStats.m_steps + 1);
+			rayStats.m_brickTransitions = random.NextBelow(12);
+		}
+
+		state.SetItemsPerIteration(kRayStatsWidth * kRayStatsHeight);
+
+		RayStatsSummary summary{};
+		uint64_t p95 = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			SummarizeRayStats(pixels, kRayStatsWidth * kRayStatsHeight, summary);
+			p95 += summary.m_steps.m_p95;
+		}
+		state.StopTimer();
+
+		KeepAlive(p95);
+	}
+
+	AFRE_BENCHMARK("ray_stats/summarize_600x600", SummarizeBench);
+}
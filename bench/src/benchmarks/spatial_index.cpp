@@ -0,0 +1,139 @@
+#include "benchmark.h"
+#include "core/system_scheduler.h"
+#include "core/voxel/spatial_index.h"
+
+namespace afre
+{
+	struct BenchWander
+	{
+		glm::vec3 m_velocity{};
+	};
+
+	static constexpr uint32_t kSpatialEntityCount = 50000;
+	// 16 x 4 x 16 bricks, about 50 entities per brick.
+	static const glm::vec3 kSpatialExtent{ 256.f, 64.f, 256.f };
+	static constexpr float kNeighbourRadius = 8.f;
+	// The linear scan only gets a slice of the queries, all of them would take minutes.
+	static constexpr uint32_t kLinearScanQueries = 500;
+
+	static void CreateSpatialEntities(entt::registry& registry)
+	{
+		BenchmarkRandom random{ 47 };
+		for (uint32_t e = 0; e < kSpatialEntityCount; e++)
+		{
+			const entt::entity entity = registry.create();
+			registry.emplace<Transform>(entity, Transform{ glm::vec3(random.NextFloat(), random.NextFloat(), random.NextFloat()) * kSpatialExtent });
+			registry.emplace<BenchWander>(entity, glm::vec3(random.NextFloat(), random.NextFloat(), random.NextFloat()) * 8.f - 4.f);
+		}
+	}
+
+	static std::vector<SpatialRadiusQuery> GetNeighbourQueries(entt::registry& registry, uint32_t count)
+	{
+		std::vector<SpatialRadiusQuery> queries{};
+		for (const auto [entity, transform] : registry.view<const Transform>().each())
+		{
+			if (queries.size() == count) break;
+			queries.push_back({ transform.m_position, kNeighbourRadius });
+		}
+		return queries;
+	}
+
+	// Every entity moves, wrapping around the extent, and the index follows. Items are entities.
+	static void UpdateBench(BenchmarkState& state, uint32_t workerCount)
+	{
+		entt::registry registry{};
+		SpatialIndex spatialIndex{};
+		spatialIndex.Connect(registry);
+		CreateSpatialEntities(registry);
+
+		SystemScheduler systemScheduler{ workerCount };
+		systemScheduler.AddSystem("wander", SystemAccess{}.Reads<BenchWander>().Writes<Transform>(), [](entt::registry& registry, SystemScheduler&, float deltaTime)
+			{
+				registry.view<Transform, const BenchWander>().each([&](Transform& transform, const BenchWander& wander)
+					{
+						transform.m_position = glm::mod(transform.m_position + wander.m_velocity * deltaTime, kSpatialExtent);
+					});
+			});
+		systemScheduler.AddSystem("spatial index", SystemAccess{}.Reads<Transform>().WritesResource<SpatialIndex>(), [&](entt::registry& registry, SystemScheduler& scheduler, float)
+			{
+				spatialIndex.Update(registry, scheduler);
+			});
+
+		uint64_t moved = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			systemScheduler.Run(registry, 1.f / 60.f);
+			moved += spatialIndex.GetStats().m_movedEntities;
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(kSpatialEntityCount);
+		KeepAlive(moved);
+	}
+
+	// A neighbour query around every entity in one batch. Items are queries.
+	static void RadiusQueriesBench(BenchmarkState& state, uint32_t workerCount)
+	{
+		entt::registry registry{};
+		SpatialIndex spatialIndex{};
+		spatialIndex.Connect(registry);
+		CreateSpatialEntities(registry);
+
+		const std::vector<SpatialRadiusQuery> queries = GetNeighbourQueries(registry, kSpatialEntityCount);
+		SpatialQueryResults results{};
+
+		SystemScheduler systemScheduler{ workerCount };
+		systemScheduler.AddSystem("neighbours", SystemAccess{}.ReadsResource<SpatialIndex>(), [&](entt::registry&, SystemScheduler& scheduler, float)
+			{
+				spatialIndex.QueryRadii(queries, scheduler, results);
+			});
+
+		uint64_t found = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			systemScheduler.Run(registry, 1.f / 60.f);
+			found += results.m_entities.size();
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(queries.size());
+		KeepAlive(found);
+	}
+
+	// The same queries as a scan over the view, what proximity checks did without the index. Items are queries.
+	static void LinearScanBench(BenchmarkState& state)
+	{
+		entt::registry registry{};
+		CreateSpatialEntities(registry);
+
+		const std::vector<SpatialRadiusQuery> queries = GetNeighbourQueries(registry, kLinearScanQueries);
+		const auto view = registry.view<const Transform>();
+
+		uint64_t found = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			for (const SpatialRadiusQuery& query : queries)
+			{
+				const float radiusSquared = query.m_radius * query.m_radius;
+				for (const auto [entity, transform] : view.each())
+				{
+					const glm::vec3 offset = transform.m_position - query.m_center;
+					if (glm::dot(offset, offset) <= radiusSquared) found++;
+				}
+			}
+		}
+		state.StopTimer();
+
+		state.SetItemsPerIteration(queries.size());
+		KeepAlive(found);
+	}
+
+	AFRE_BENCHMARK("spatial_index/update_50k_entities_serial", [](BenchmarkState& state) { UpdateBench(state, 0); });
+	AFRE_BENCHMARK("spatial_index/update_50k_entities_3_workers", [](BenchmarkState& state) { UpdateBench(state, 3); });
+	AFRE_BENCHMARK("spatial_index/radius_queries_50k_serial", [](BenchmarkState& state) { RadiusQueriesBench(state, 0); });
+	AFRE_BENCHMARK("spatial_index/radius_queries_50k_3_workers", [](BenchmarkState& state) { RadiusQueriesBench(state, 3); });
+	AFRE_BENCHMARK("spatial_index/radius_queries_linear_scan", [](BenchmarkState& state) { LinearScanBench(state); });
+}
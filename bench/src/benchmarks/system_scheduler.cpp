@@ -0,0 +1,87 @@
+#include "benchmark.h"
+#include "core/system_scheduler.h"
+#include <glm/glm.hpp>
+
+namespace afre
+{
+	struct BenchPosition
+	{
+		glm::vec3 m_value{};
+	};
+
+	struct BenchVelocity
+	{
+		glm::vec3 m_value{};
+	};
+
+	struct BenchHealth
+	{
+		float m_value = 100.f;
+	};
+
+	struct BenchCooldown
+	{
+		float m_value = 0.f;
+	};
+
+	static constexpr uint32_t kEntityCount = 100000;
+	static constexpr uint32_t kChunkSize = 4096;
+
+	// Four systems on 100k entities, velocity then position in order and the other two next to them.
+	// Items are entities times systems.
+	static void RunSystemsBench(BenchmarkState& state, uint32_t workerCount)
+	{
+		entt::registry registry{};
+		for (uint32_t e = 0; e < kEntityCount; e++)
+		{
+			const entt::entity entity = registry.create();
+			registry.emplace<BenchPosition>(entity);
+			registry.emplace<BenchVelocity>(entity, glm::vec3(static_cast<float>(e % 7), 1.f, static_cast<float>(e % 5)));
+			registry.emplace<BenchHealth>(entity);
+			registry.emplace<BenchCooldown>(entity, static_cast<float>(e % 3));
+		}
+
+		SystemScheduler systemScheduler{ workerCount };
+
+		systemScheduler.AddSystem("gravity", SystemAccess{}.Writes<BenchVelocity>(), [](entt::registry& registry, SystemScheduler& scheduler, float deltaTime)
+			{
+				// Split over the storage directly, the components are packed in it whatever order the entities are in.
+				auto& velocities = registry.storage<BenchVelocity>();
+				const auto first = velocities.begin();
+				scheduler.ParallelFor(static_cast<uint32_t>(velocities.size()), kChunkSize, [&](uint32_t begin, uint32_t end)
+					{
+						for (uint32_t i = begin; i < end; i++) first[i].m_value.y -= 9.81f * deltaTime;
+					});
+			});
+
+		systemScheduler.AddSystem("movement", SystemAccess{}.Reads<BenchVelocity>().Writes<BenchPosition>(), [](entt::registry& registry, SystemScheduler&, float deltaTime)
+			{
+				const auto view = registry.view<BenchPosition, const BenchVelocity>();
+				view.each([&](BenchPosition& position, const BenchVelocity& velocity) { position.m_value += velocity.m_value * deltaTime; });
+			});
+
+		systemScheduler.AddSystem("regeneration", SystemAccess{}.Writes<BenchHealth>(), [](entt::registry& registry, SystemScheduler&, float deltaTime)
+			{
+				registry.view<BenchHealth>().each([&](BenchHealth& health) { health.m_value = glm::min(health.m_value + deltaTime, 100.f); });
+			});
+
+		systemScheduler.AddSystem("cooldowns", SystemAccess{}.Writes<BenchCooldown>(), [](entt::registry& registry, SystemScheduler&, float deltaTime)
+			{
+				registry.view<BenchCooldown>().each([&](BenchCooldown& cooldown) { cooldown.m_value = glm::max(cooldown.m_value - deltaTime, 0.f); });
+			});
+
+		state.SetItemsPerIteration(kEntityCount * systemScheduler.GetSystemCount());
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			systemScheduler.Run(registry, 1.f / 60.f);
+		}
+		state.StopTimer();
+
+		KeepAlive(static_cast<uint64_t>(registry.get<BenchPosition>(registry.view<BenchPosition>().front()).m_value.y));
+	}
+
+	AFRE_BENCHMARK("system_scheduler/4_systems_100k_entities_serial", [](BenchmarkState& state) { RunSystemsBench(state, 0); });
+	AFRE_BENCHMARK("system_scheduler/4_systems_100k_entities_3_workers", [](BenchmarkState& state) { RunSystemsBench(state, 3); });
+}
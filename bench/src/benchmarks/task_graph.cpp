@@ -0,0 +1,42 @@
+#include "benchmark.h"
+#include "core/task_graph.h"
+#include <atomic>
+
+namespace afre
+{
+	static constexpr uint32_t kTaskCount = 64;
+	static constexpr uint32_t kWorkerCount = 3;
+
+	// Empty tasks, so only the scheduling and the worker threads Run starts are measured.
+	static void RunBench(BenchmarkState& state, bool chained)
+	{
+		TaskGraph taskGraph{};
+		std::atomic<uint64_t> ranCount{ 0 };
+
+		for (uint32_t t = 0; t < kTaskCount; t++)
+		{
+			const std::function<bool()> task = [&ranCount]()
+			{
+				ranCount.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			};
+
+			if (chained && t > 0) taskGraph.AddTask("task", task, { t - 1 });
+			else taskGraph.AddTask("task", task);
+		}
+
+		state.SetItemsPerIteration(kTaskCount);
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			taskGraph.Run(kWorkerCount);
+		}
+		state.StopTimer();
+
+		KeepAlive(ranCount.load());
+	}
+
+	AFRE_BENCHMARK("task_graph/chain_64", [](BenchmarkState& state) { RunBench(state, true); });
+	AFRE_BENCHMARK("task_graph/independent_64", [](BenchmarkState& state) { RunBench(state, false); });
+}
@@ -0,0 +1,72 @@
+#include "bench_worlds.h"
+#include "benchmark.h"
+
+namespace afre
+{
+	static void VoxelEditsRandom(BenchmarkState& state)
+	{
+		VoxelWorld world = CreateTerrainWorld({ 8, 4, 8 });
+		const glm::uvec3 size = world.GetSizeInVoxels();
+
+		BenchmarkRandom random{ 7 };
+		std::vector<glm::ivec3> positions(4096);
+		for (glm::ivec3& position : positions)
+		{
+			position = glm::ivec3(random.NextBelow(size.x), random.NextBelow(size.y), random.NextBelow(size.z));
+		}
+
+		state.SetItemsPerIteration(positions.size());
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			const glm::uint16_t voxel = static_cast<glm::uint16_t>(i & 1) + 1;
+			for (const glm::ivec3& position : positions)
+			{
+				world.SetVoxel(position, voxel);
+			}
+		}
+		state.StopTimer();
+
+		KeepAlive(world.GetVoxel(positions[0]));
+	}
+
+	// Digging a sphere of the given radius, the typical gameplay edit.
+	static void VoxelEditsSphere(BenchmarkState& state, int32_t radius)
+	{
+		VoxelWorld world = CreateTerrainWorld({ 8, 4, 8 });
+		const glm::ivec3 center = glm::ivec3(world.GetSizeInVoxels() / 2u);
+
+		uint64_t editedVoxels = 0;
+		for (int32_t z = -radius; z <= radius; z++)
+			for (int32_t y = -radius; y <= radius; y++)
+				for (int32_t x = -radius; x <= radius; x++)
+					editedVoxels += x * x + y * y + z * z <= radius * radius;
+
+		state.SetItemsPerIteration(editedVoxels);
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			const glm::uint16_t voxel = static_cast<glm::uint16_t>(i & 1);
+			for (int32_t z = -radius; z <= radius; z++)
+			{
+				for (int32_t y = -radius; y <= radius; y++)
+				{
+					for (int32_t x = -radius; x <= radius; x++)
+					{
+						if (x * x + y * y + z * z > radius * radius) continue;
+						world.SetVoxel(center + glm::ivec3(x, y, z), voxel);
+					}
+				}
+			}
+		}
+		state.StopTimer();
+
+		KeepAlive(world.GetVoxel(center));
+	}
+
+	AFRE_BENCHMARK("voxel_edits/random", VoxelEditsRandom);
+	AFRE_BENCHMARK("voxel_edits/sphere_r4", [](BenchmarkState& state) { VoxelEditsSphere(state, 4); });
+	AFRE_BENCHMARK("voxel_edits/sphere_r12", [](BenchmarkState& state) { VoxelEditsSphere(state, 12); });
+}
@@ -0,0 +1,150 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "benchmark.h"
+#include "core/voxel/voxel_import.h"
+
+namespace afre
+{
+	// Rolling terrain with noise in the ground, so there are empty, uniform and mixed bricks.
+	static glm::uint8_t GetBenchVoxel(uint32_t x, uint32_t y, uint32_t z, BenchmarkRandom& random)
+	{
+		const uint32_t height = 48 + (x * 7 + z * 3) % 32;
+		if (y > height) return 0;
+		if (y > height - 4) return 2;
+
+		// Caves in the upper ground, solid below.
+		return y > 24 && random.Next() % 8 == 0 ? 0 : 1;
+	}
+
+	static std::string WriteRawVolume(const glm::uvec3& size)
+	{
+		const std::string path = (std::filesystem::temp_directory_path() / "afr_bench_volume.raw").string();
+		std::ofstream file{ path, std::ios::binary };
+		BenchmarkRandom random{ 7 };
+
+		std::vector<glm::uint8_t> row(size.x);
+		for (uint32_t z = 0; z < size.z; z++)
+		{
+			for (uint32_t y = 0; y < size.y; y++)
+			{
+				for (uint32_t x = 0; x < size.x; x++) row[x] = GetBenchVoxel(x, y, z, random);
+				file.write(reinterpret_cast<const char*>(row.data()), row.size());
+			}
+		}
+
+		return path;
+	}
+
+	static void WriteVoxChunk(std::ofstream& file, const char* id, const void* content, int32_t contentBytes, int32_t childrenBytes)
+	{
+		file.write(id, 4);
+		file.write(reinterpret_cast<const char*>(&contentBytes), sizeof(contentBytes));
+		file.write(reinterpret_cast<const char*>(&childrenBytes), sizeof(childrenBytes));
+		file.write(reinterpret_cast<const char*>(content), contentBytes);
+	}
+
+	// One model as big as .vox allows, z up like MagicaVoxel writes it.
+	static std::string WriteVoxFile(const glm::uvec3& size)
+	{
+		BenchmarkRandom random{ 7 };
+
+		std::vector<glm::uint8_t> voxels{};
+		for (uint32_t z = 0; z < size.z; z++)
+			for (uint32_t y = 0; y < size.y; y++)
+				for (uint32_t x = 0; x < size.x; x++)
+				{
+					const glm::uint8_t voxel = GetBenchVoxel(x, z, y, random);
+					if (voxel != 0) voxels.insert(voxels.end(), { static_cast<glm::uint8_t>(x), static_cast<glm::uint8_t>(y), static_cast<glm::uint8_t>(z), voxel });
+				}
+
+		const int32_t voxelCount = static_cast<int32_t>(voxels.size() / 4);
+		const int32_t sizeContent[3] = { static_cast<int32_t>(size.x), static_cast<int32_t>(size.y), static_cast<int32_t>(size.z) };
+
+		uint32_t palette[256]{};
+		for (uint32_t i = 0; i < 256; i++) palette[i] = 0xFF000000u | (i * 0x010203u);
+
+		const int32_t xyziBytes = 4 + static_cast<int32_t>(voxels.size());
+		const int32_t childrenBytes = (12 + sizeof(sizeContent)) + (12 + xyziBytes) + (12 + sizeof(palette));
+
+		const std::string path = (std::filesystem::temp_directory_path() / "afr_bench_model.vox").string();
+		std::ofstream file{ path, std::ios::binary };
+
+		const int32_t version = 150;
+		file.write("VOX ", 4);
+		file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+
+		WriteVoxChunk(file, "MAIN", nullptr, 0, childrenBytes);
+		WriteVoxChunk(file, "SIZE", sizeContent, sizeof(sizeContent), 0);
+
+		std::vector<glm::uint8_t> xyzi(xyziBytes);
+		std::memcpy(xyzi.data(), &voxelCount, sizeof(voxelCount));
+		std::memcpy(xyzi.data() + 4, voxels.data(), voxels.size());
+		WriteVoxChunk(file, "XYZI", xyzi.data(), xyziBytes, 0);
+
+		WriteVoxChunk(file, "RGBA", palette, sizeof(palette), 0);
+
+		return path;
+	}
+
+	// Items are voxels read, solid ones for .vox and all of them for raw, bytes_per_item is what the world keeps per voxel.
+	static void ImportRawBench(BenchmarkState& state, const glm::uvec3& size, uint32_t workerCount)
+	{
+		const std::string path = WriteRawVolume(size);
+
+		RawVolumeInfo rawVolumeInfo{};
+		rawVolumeInfo.m_size = size;
+
+		VoxelImportInfo importInfo{};
+		importInfo.m_workerCount = workerCount;
+
+		VoxelImportStats stats{};
+		uint64_t checksum = 0;
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			state.StartTimer();
+			VoxelWorld world{};
+			ImportRawVolume(path, rawVolumeInfo, importInfo, world, stats);
+			state.StopTimer();
+
+			checksum += world.GetVoxel({ 0, 0, 0 });
+		}
+
+		state.SetItemsPerIteration(stats.m_voxelCount);
+		state.SetBytesPerItem(static_cast<double>(stats.m_storedBricks) * sizeof(Brick) / static_cast<double>(stats.m_voxelCount));
+		KeepAlive(checksum);
+
+		std::filesystem::remove(path);
+	}
+
+	static void ImportVoxBench(BenchmarkState& state, uint32_t workerCount)
+	{
+		const std::string path = WriteVoxFile({ 256, 256, 128 });
+
+		VoxelImportInfo importInfo{};
+		importInfo.m_workerCount = workerCount;
+
+		VoxelImportStats stats{};
+		uint64_t checksum = 0;
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			state.StartTimer();
+			VoxelWorld world{};
+			ImportVox(path, importInfo, world, stats);
+			state.StopTimer();
+
+			checksum += world.GetVoxel({ 0, 0, 0 });
+		}
+
+		state.SetItemsPerIteration(stats.m_voxelCount);
+		state.SetBytesPerItem(static_cast<double>(stats.m_storedBricks) * sizeof(Brick) / static_cast<double>(stats.m_voxelCount));
+		KeepAlive(checksum);
+
+		std::filesystem::remove(path);
+	}
+
+	AFRE_BENCHMARK("voxel_import/raw_512x128x512_serial", [](BenchmarkState& state) { ImportRawBench(state, { 512, 128, 512 }, 0); });
+	AFRE_BENCHMARK("voxel_import/raw_512x128x512_3_workers", [](BenchmarkState& state) { ImportRawBench(state, { 512, 128, 512 }, 3); });
+	AFRE_BENCHMARK("voxel_import/vox_256x256x128_serial", [](BenchmarkState& state) { ImportVoxBench(state, 0); });
+	AFRE_BENCHMARK("voxel_import/vox_256x256x128_3_workers", [](BenchmarkState& state) { ImportVoxBench(state, 3); });
+}
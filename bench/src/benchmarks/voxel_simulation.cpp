@@ -0,0 +1,77 @@
+#include "benchmark.h"
+#include "core/system_scheduler.h"
+#include "core/voxel/voxel_simulation.h"
+
+namespace afre
+{
+	static constexpr glm::uint16_t kSandVoxel = 2;
+	static constexpr glm::uint16_t kWaterVoxel = 3;
+	static constexpr uint32_t kSimulationSteps = 64;
+
+	// A stone floor with a block of mixed sand and water over it in the middle, the same pile whatever the size.
+	static VoxelWorld CreatePileWorld(const glm::uvec3& sizeInBricks, std::vector<glm::ivec3>& pileVoxels)
+	{
+		VoxelWorld world{ sizeInBricks };
+		const glm::ivec3 sizeInVoxels = glm::ivec3(world.GetSizeInVoxels());
+
+		for (int32_t z = 0; z < sizeInVoxels.z; z++)
+		{
+			for (int32_t x = 0; x < sizeInVoxels.x; x++) world.SetVoxel({ x, 0, z }, 1);
+		}
+
+		const glm::ivec3 pileMin{ sizeInVoxels.x / 2 - 16, 16, sizeInVoxels.z / 2 - 16 };
+		BenchmarkRandom random{ 50 };
+
+		pileVoxels.clear();
+		for (int32_t z = 0; z < 32; z++)
+		{
+			for (int32_t y = 0; y < 24; y++)
+			{
+				for (int32_t x = 0; x < 32; x++)
+				{
+					const glm::ivec3 position = pileMin + glm::ivec3(x, y, z);
+					world.SetVoxel(position, random.NextBelow(3) == 0 ? kSandVoxel : kWaterVoxel);
+					pileVoxels.push_back(position);
+				}
+			}
+		}
+
+		return world;
+	}
+
+	// The first steps of the pile falling apart. Items are steps.
+	static void PileBench(BenchmarkState& state, const glm::uvec3& sizeInBricks, bool wakeAll)
+	{
+		SystemScheduler scheduler{ 0 };
+		std::vector<glm::ivec3> pileVoxels{};
+		uint64_t movedVoxels = 0;
+
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			VoxelWorld world = CreatePileWorld(sizeInBricks, pileVoxels);
+
+			VoxelSimulation simulation{ world };
+			simulation.SetVoxelInfo(kSandVoxel, { VOXEL_BEHAVIOR_POWDER, 1 });
+			simulation.SetVoxelInfo(kWaterVoxel, { VOXEL_BEHAVIOR_LIQUID, 1 });
+			for (const glm::ivec3& position : pileVoxels) simulation.Wake(position);
+
+			state.StartTimer();
+			for (uint32_t s = 0; s < kSimulationSteps; s++)
+			{
+				// Every brick stepped every time, what the active set saves.
+				if (wakeAll) simulation.WakeAll();
+
+				simulation.Step(scheduler);
+				movedVoxels += simulation.GetStats().m_movedVoxels;
+			}
+			state.StopTimer();
+		}
+
+		state.SetItemsPerIteration(kSimulationSteps);
+		KeepAlive(movedVoxels);
+	}
+
+	AFRE_BENCHMARK("voxel_simulation/pile_4x3x4", [](BenchmarkState& state) { PileBench(state, { 4, 3, 4 }, false); });
+	AFRE_BENCHMARK("voxel_simulation/pile_16x3x16", [](BenchmarkState& state) { PileBench(state, { 16, 3, 16 }, false); });
+	AFRE_BENCHMARK("voxel_simulation/pile_16x3x16_every_brick", [](BenchmarkState& state) { PileBench(state, { 16, 3, 16 }, true); });
+}
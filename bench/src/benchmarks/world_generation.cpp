@@ -0,0 +1,33 @@
+#include "benchmark.h"
+#include "core/voxel/world_generator.h"
+
+namespace afre
+{
+	static void GenerateWorldBench(BenchmarkState& state, const glm::uvec3& sizeInBricks)
+	{
+		const glm::uvec3 sizeInVoxels = sizeInBricks * static_cast<uint32_t>(kBrickSize);
+		state.SetItemsPerIteration(static_cast<uint64_t>(sizeInVoxels.x) * sizeInVoxels.y * sizeInVoxels.z);
+
+		WorldGeneratorInfo worldGeneratorInfo{};
+
+		uint64_t checksum = 0;
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			// Allocation is part of loading a world, so it stays inside the timed region.
+			state.StartTimer();
+			VoxelWorld world{ sizeInBricks };
+			worldGeneratorInfo.m_seed = static_cast<uint32_t>(i);
+			GenerateWorld(world, worldGeneratorInfo);
+			state.StopTimer();
+
+			checksum += world.GetVoxel({ 0, 0, 0 });
+		}
+
+		KeepAlive(checksum);
+	}
+
+	AFRE_BENCHMARK("world_generation/3x3x3", [](BenchmarkState& state) { GenerateWorldBench(state, { 3, 3, 3 }); });
+	AFRE_BENCHMARK("world_generation/8x4x8", [](BenchmarkState& state) { GenerateWorldBench(state, { 8, 4, 8 }); });
+	AFRE_BENCHMARK("world_generation/16x8x16", [](BenchmarkState& state) { GenerateWorldBench(state, { 16, 8, 16 }); });
+	AFRE_BENCHMARK("world_generation/32x8x32", [](BenchmarkState& state) { GenerateWorldBench(state, { 32, 8, 32 }); });
+}
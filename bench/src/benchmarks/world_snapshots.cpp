@@ -0,0 +1,101 @@
+#include <atomic>
+#include <thread>
+#include "bench_worlds.h"
+#include "benchmark.h"
+
+namespace afre
+{
+	static void SnapshotTake(BenchmarkState& state, const glm::uvec3& sizeInBricks)
+	{
+		VoxelWorld world = CreateTerrainWorld(sizeInBricks);
+		state.SetItemsPerIteration(world.GetBrickCount());
+
+		uint64_t versions = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			versions += world.TakeSnapshot()->GetVersion();
+		}
+		state.StopTimer();
+
+		KeepAlive(versions);
+	}
+
+	// One edit per brick right after a snapshot, so every edit pays for copying its brick.
+	static void SnapshotEditAfter(BenchmarkState& state)
+	{
+		VoxelWorld world = CreateTerrainWorld({ 8, 4, 8 });
+		const glm::uvec3 sizeInBricks = world.GetSizeInBricks();
+		state.SetItemsPerIteration(world.GetBrickCount());
+
+		uint64_t versions = 0;
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			const std::shared_ptr<const WorldSnapshot> snapshot = world.TakeSnapshot();
+
+			for (uint32_t z = 0; z < sizeInBricks.z; z++)
+				for (uint32_t y = 0; y < sizeInBricks.y; y++)
+					for (uint32_t x = 0; x < sizeInBricks.x; x++)
+						world.SetVoxel(glm::ivec3(x, y, z) * static_cast<int32_t>(kBrickSize), static_cast<glm::uint16_t>(i & 1));
+
+			versions += snapshot->GetVersion();
+		}
+		state.StopTimer();
+
+		KeepAlive(versions);
+	}
+
+	// Random edits while another thread keeps scanning the latest snapshot.
+	static void SnapshotEditWithReader(BenchmarkState& state)
+	{
+		VoxelWorld world = CreateTerrainWorld({ 8, 4, 8 });
+		const glm::uvec3 size = world.GetSizeInVoxels();
+
+		BenchmarkRandom random{ 11 };
+		std::vector<glm::ivec3> positions(4096);
+		for (glm::ivec3& position : positions)
+		{
+			position = glm::ivec3(random.NextBelow(size.x), random.NextBelow(size.y), random.NextBelow(size.z));
+		}
+
+		state.SetItemsPerIteration(positions.size());
+
+		std::shared_ptr<const WorldSnapshot> published = world.TakeSnapshot();
+		std::atomic<bool> stop{ false };
+		std::thread reader{ [&]()
+			{
+				uint64_t sum = 0;
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					const std::shared_ptr<const WorldSnapshot> snapshot = std::atomic_load(&published);
+					for (uint32_t b = 0; b < snapshot->GetBrickCount(); b++)
+					{
+						sum += snapshot->GetBrick(b).At(glm::uvec3(kBrickSize / 2));
+					}
+				}
+				KeepAlive(sum);
+			} };
+
+		state.StartTimer();
+		for (uint64_t i = 0; i < state.GetIterations(); i++)
+		{
+			const glm::uint16_t voxel = static_cast<glm::uint16_t>(i & 1) + 1;
+			for (const glm::ivec3& position : positions)
+			{
+				world.SetVoxel(position, voxel);
+			}
+
+			std::atomic_store(&published, world.TakeSnapshot());
+		}
+		state.StopTimer();
+
+		stop = true;
+		reader.join();
+	}
+
+	AFRE_BENCHMARK("world_snapshots/take_8x4x8", [](BenchmarkState& state) { SnapshotTake(state, { 8, 4, 8 }); });
+	AFRE_BENCHMARK("world_snapshots/take_32x8x32", [](BenchmarkState& state) { SnapshotTake(state, { 32, 8, 32 }); });
+	AFRE_BENCHMARK("world_snapshots/edit_after_snapshot", SnapshotEditAfter);
+	AFRE_BENCHMARK("world_snapshots/edit_with_reader", SnapshotEditWithReader);
+}
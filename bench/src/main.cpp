@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "baseline.h"
+#include "log.h"
+#include "verify.h"
+
+namespace
+{
+	void PrintUsage()
+	{
+		AFRE_INFO("Usage: afr-bench [options]");
+		AFRE_INFO("  --list                    Lists the benchmarks and exits.");
+		AFRE_INFO("  --filter <text>           Only runs benchmarks whose name contains <text>.");
+		AFRE_INFO("  --out <path>              Where to write the results JSON (default: bench_results.json).");
+		AFRE_INFO("  --baseline <path>         Baseline JSON to compare the results against.");
+		AFRE_INFO("  --threshold <fraction>    Allowed slowdown for entries without their own threshold (default: 0.2).");
+		AFRE_INFO("  --update-baseline         Writes the results over --baseline instead of comparing.");
+		AFRE_INFO("  --min-time <ms>           Minimum measured time per repetition (default: 100).");
+		AFRE_INFO("  --repetitions <count>     Repetitions per benchmark, the median is kept (default: 5).");
+		AFRE_INFO("  --verify-kernels          Checks every brick kernel the CPU supports against the scalar ones and exits.");
+		AFRE_INFO("  --verify-dda              Checks the DDA skipping empty bricks against stepping every voxel and exits.");
+		AFRE_INFO("  --verify-replication      Checks edit replication converges with late acks and lost packets and exits.");
+		AFRE_INFO("  --verify-nav              Checks the brick navigator's paths against a search over every voxel and exits.");
+		AFRE_INFO("  --verify-light            Checks voxel edits relight their neighbours like relighting the world does and exits.");
+		AFRE_INFO("  --verify-culling          Checks brick culling keeps every brick inside square and wide views and exits.");
+		AFRE_INFO("  --verify-simulation       Checks simulated voxels move once a step across brick borders and exits.");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	spdlog::set_pattern("%^[%l] %v%$");
+
+	afre::BenchmarkRunInfo benchmarkRunInfo{};
+	std::string outPath = "bench_results.json";
+	std::string baselinePath{};
+	double defaultThreshold = 0.2;
+	bool updateBaseline = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--list") == 0)
+		{
+			for (const afre::Benchmark& benchmark : afre::GetBenchmarks())
+			{
+				AFRE_INFO(benchmark.m_name);
+			}
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--verify-kernels") == 0) return afre::VerifyBrickKernels() ? 0 : 1;
+		else if (std::strcmp(argv[i], "--verify-dda") == 0) return afre::VerifyTraceRay() ? 0 : 1;
+		else if (std::strcmp(argv[i], "--verify-replication") == 0) return afre::VerifyEditReplication() ? 0 : 1;
+		else if (std::strcmp(argv[i], "--verify-nav") == 0) return afre::VerifyBrickNavigation() ? 0 : 1;
+		else if (std::strcmp(argv[i], "--verify-light") == 0) return afre::VerifyLightPropagation() ? 0 : 1;
+		else if (std::strcmp(argv[i], "--verify-culling") == 0) return afre::VerifyBrickCulling() ? 0 : 1;
+		else if (std::strcmp(argv[i], "--verify-simulation") == 0) return afre::VerifyVoxelSimulation() ? 0 : 1;
+		else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) benchmarkRunInfo.m_filter = argv[++i];
+		else if (std::strcmp(argv[i], "--out") == 0 && hasValue) outPath = argv[++i];
+		else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) baselinePath = argv[++i];
+		else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue) defaultThreshold = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--update-baseline") == 0) updateBaseline = true;
+		else if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) benchmarkRunInfo.m_minTimeMs = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) benchmarkRunInfo.m_repetitions = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+		else
+		{
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (updateBaseline && baselinePath.empty())
+	{
+		AFRE_ERROR("--update-baseline needs a --baseline path!");
+		return 2;
+	}
+
+	std::vector<afre::BaselineEntry> baseline{};
+	if (!baselinePath.empty() && !afre::ReadBaselineJson(baselinePath, baseline) && !updateBaseline) return 2;
+
+	const std::vector<afre::BenchmarkResult> results = afre::RunBenchmarks(benchmarkRunInfo);
+
+	if (!afre::WriteResultsJson(updateBaseline ? baselinePath : outPath, results, baseline)) return 2;
+
+	if (updateBaseline || baselinePath.empty()) return 0;
+
+	const uint32_t regressionCount = afre::CompareWithBaseline(results, baseline, defaultThreshold);
+	if (regressionCount > 0)
+	{
+		AFRE_ERROR("{} benchmark(s) regressed past their threshold!", regressionCount);
+		return 1;
+	}
+
+	AFRE_INFO("No regressions against the baseline.");
+
+	return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+namespace afre
+{
+	// Correctness checks run by afr-bench instead of the benchmarks. Each logs its mismatches and returns false if
+	// there were any.
+
+	// Runs every supported brick kernel table against the scalar one on every single voxel position, edge values,
+	// random bricks and every fill box along x, for --verify-kernels.
+	bool VerifyBrickKernels();
+
+	// Checks that the DDA skipping uniform bricks hits the same voxel and face as stepping every voxel, for rays from
+	// inside, above and outside a terrain world, for --verify-dda.
+	bool VerifyTraceRay();
+
+	// Replicates random edits through a loopback transport with late acks and with lost packets, and checks the
+	// client ends up with the server's bricks. Deltas only fall back to full bricks when something was lost. Logs
+	// the bytes a tick each case took, for --verify-replication.
+	bool VerifyEditReplication();
+
+	// Checks the brick navigator's paths through a terrain world with walls, over several rounds of edits, against a
+	// breadth first search over every voxel with the same moves, for --verify-nav.
+	bool VerifyBrickNavigation();
+
+	// Places a lamp through LightPropagator::QueueBrickEdits and checks the air next to it lights up, then writes random
+	// boxes over whole bricks and compares every voxel's light with relighting the world, for --verify-light.
+	bool VerifyLightPropagation();
+
+	// Culls a row of bricks in front of the camera with a square, a wide and a late latch widened view and checks
+	// no brick inside the view's horizontal angle is dropped, for --verify-culling.
+	bool VerifyBrickCulling();
+
+	// Steps sand falling across brick borders and checks each grain moved one voxel, then steps sand and water over
+	// a terrain world and checks no voxel was made or lost, for --verify-simulation.
+	bool VerifyVoxelSimulation();
+}
@@ -0,0 +1,110 @@
+#include "verify.h"
+#include <cmath>
+#include "log.h"
+#include "core/voxel/brick_culling.h"
+
+namespace afre
+{
+	static constexpr float kBrickEdge = static_cast<float>(kBrickSize);
+	// A row of bricks in front of the camera, from straight ahead to far past the sides of a wide view.
+	static constexpr uint32_t kRowBricks = 32;
+	static constexpr float kRowDepth = 2.f * kBrickEdge;
+
+	// The grid's min corner, the row is centered on the view axis.
+	static glm::vec3 GetRowOrigin()
+	{
+		return { -0.5f * kRowBricks * kBrickEdge, -0.5f * kBrickEdge, -kRowDepth - kBrickEdge };
+	}
+
+	// Smallest horizontal slope, x over depth, of any point of the brick. The row straddles y = 0, so a brick can
+	// be seen whenever this is inside the view's horizontal half angle.
+	static float GetMinHorizontalSlope(uint32_t brickIndex)
+	{
+		const float minX = GetRowOrigin().x + brickIndex * kBrickEdge;
+		const float maxX = minX + kBrickEdge;
+		if (minX <= 0.f && maxX >= 0.f) return 0.f;
+
+		return std::min(std::abs(minX), std::abs(maxX)) / (kRowDepth + kBrickEdge);
+	}
+
+	// Bricks the culler dropped although a ray of the camera reaches them. Bricks right at the edge are skipped,
+	// the culler may go either way on those.
+	static uint32_t CountFalselyCulled(const BrickCullingCamera& camera, const BrickVisibility& visibility)
+	{
+		const float tanHalfX = std::tan(glm::radians(camera.m_fov) * 0.5f) * camera.m_aspectRatio;
+
+		uint32_t falselyCulled = 0;
+		for (uint32_t b = 0; b < kRowBricks; b++)
+		{
+			const bool visible = (visibility.m_visibleMask[b >> 5] & (1u << (b & 31))) != 0;
+			if (GetMinHorizontalSlope(b) < tanHalfX * 0.99f && !visible) falselyCulled++;
+		}
+
+		return falselyCulled;
+	}
+
+	bool VerifyBrickCulling()
+	{
+		BrickCullingGrid grid{};
+		grid.m_sizeInBricks = { kRowBricks, 1, 1 };
+		grid.m_origin = GetRowOrigin();
+		grid.m_occluders.assign(kRowBricks, 0);
+
+		// Looking down -Z from the origin, like the engine's camera space.
+		BrickCullingCamera squareCamera{};
+		squareCamera.m_fov = 90.f;
+		squareCamera.m_maxDistance = 1000.f;
+
+		BrickCullingCamera wideCamera = squareCamera;
+		wideCamera.m_aspectRatio = 21.f / 9.f;
+
+		BrickCullingCamera widenedCamera = wideCamera;
+		WidenCullingCamera(widenedCamera, 20.f);
+
+		BrickCuller brickCuller{};
+		BrickVisibility squareVisibility{};
+		BrickVisibility wideVisibility{};
+		BrickVisibility widenedVisibility{};
+		brickCuller.Cull(squareCamera, grid, squareVisibility);
+		brickCuller.Cull(wideCamera, grid, wideVisibility);
+		brickCuller.Cull(widenedCamera, grid, widenedVisibility);
+
+		bool verified = true;
+
+		// Makes sure the row reaches past a square view, otherwise a culler ignoring the aspect ratio would pass.
+		if (CountFalselyCulled(wideCamera, squareVisibility) == 0)
+		{
+			AFRE_ERROR("Culling with a square view keeps every brick a wide one sees, the row is too short to tell them apart!");
+			verified = false;
+		}
+
+		const BrickCullingCamera* cameras[3] = { &squareCamera, &wideCamera, &widenedCamera };
+		const BrickVisibility* visibilities[3] = { &squareVisibility, &wideVisibility, &widenedVisibility };
+		const char* names[3] = { "square", "21:9", "21:9 widened" };
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			const uint32_t falselyCulled = CountFalselyCulled(*cameras[c], *visibilities[c]);
+			if (falselyCulled == 0) continue;
+
+			AFRE_ERROR("The {} view culled {} bricks inside its horizontal angle!", names[c], falselyCulled);
+			verified = false;
+		}
+
+		// The late latch margin has to widen the sides by its full angle, not just by the vertical angle's share.
+		const float wideHorizontalFov = glm::degrees(2.f * std::atan(wideCamera.m_aspectRatio));
+		const float widenedHorizontalFov = glm::degrees(2.f * std::atan(std::tan(glm::radians(widenedCamera.m_fov) * 0.5f) * widenedCamera.m_aspectRatio));
+		if (std::abs(widenedHorizontalFov - wideHorizontalFov - 20.f) > 1e-2f)
+		{
+			AFRE_ERROR("Widening a {:.1f} degree wide view by 20 degrees gave {:.1f} degrees!", wideHorizontalFov, widenedHorizontalFov);
+			verified = false;
+		}
+
+		if (verified)
+		{
+			AFRE_INFO("Square, wide and widened views keep every brick inside their horizontal angle, {} / {} / {} of {} visible.",
+				squareVisibility.m_visibleBricks.size(), wideVisibility.m_visibleBricks.size(), widenedVisibility.m_visibleBricks.size(), kRowBricks);
+		}
+
+		return verified;
+	}
+}
@@ -0,0 +1,146 @@
+#include "verify.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "bench_worlds.h"
+#include "log.h"
+#include "core/voxel/brick_kernels.h"
+
+namespace afre
+{
+	// Mismatches of one table, per kernel.
+	struct KernelMismatches
+	{
+		uint32_t m_countNonAir = 0;
+		uint32_t m_isUniform = 0;
+		uint32_t m_buildOccupancy = 0;
+		uint32_t m_equal = 0;
+		uint32_t m_diff = 0;
+		uint32_t m_downsample = 0;
+		uint32_t m_fillBox = 0;
+	};
+
+	static void VerifyBrick(const BrickKernels& scalar, const BrickKernels& kernels, const Brick& brick, const Brick& other, KernelMismatches& mismatches)
+	{
+		const glm::uint16_t* voxels = brick.m_voxels;
+
+		mismatches.m_countNonAir += kernels.m_countNonAir(voxels) != scalar.m_countNonAir(voxels) ? 1 : 0;
+		mismatches.m_isUniform += kernels.m_isUniform(voxels) != scalar.m_isUniform(voxels) ? 1 : 0;
+		mismatches.m_equal += kernels.m_equal(voxels, other.m_voxels) != scalar.m_equal(voxels, other.m_voxels) ? 1 : 0;
+		mismatches.m_equal += kernels.m_equal(voxels, voxels) != scalar.m_equal(voxels, voxels) ? 1 : 0;
+
+		glm::uint64_t expected[kBrickOccupancyWords]{};
+		glm::uint64_t result[kBrickOccupancyWords]{};
+		scalar.m_buildOccupancy(voxels, expected);
+		kernels.m_buildOccupancy(voxels, result);
+		mismatches.m_buildOccupancy += std::memcmp(expected, result, sizeof(expected)) != 0 ? 1 : 0;
+
+		const glm::uint32_t expectedCount = scalar.m_diff(voxels, other.m_voxels, expected);
+		const glm::uint32_t resultCount = kernels.m_diff(voxels, other.m_voxels, result);
+		mismatches.m_diff += expectedCount != resultCount || std::memcmp(expected, result, sizeof(expected)) != 0 ? 1 : 0;
+
+		glm::uint16_t expectedMip[kBrickMipVoxelCount]{};
+		glm::uint16_t resultMip[kBrickMipVoxelCount]{};
+		scalar.m_downsample(voxels, expectedMip);
+		kernels.m_downsample(voxels, resultMip);
+		mismatches.m_downsample += std::memcmp(expectedMip, resultMip, sizeof(expectedMip)) != 0 ? 1 : 0;
+	}
+
+	static void VerifyFillBox(const BrickKernels& scalar, const BrickKernels& kernels, const Brick& brick, const glm::uvec3& min, const glm::uvec3& max, KernelMismatches& mismatches)
+	{
+		Brick expected = brick;
+		Brick result = brick;
+		scalar.m_fillBox(expected.m_voxels, min, max, 0xBEEF);
+		kernels.m_fillBox(result.m_voxels, min, max, 0xBEEF);
+
+		mismatches.m_fillBox += std::memcmp(&expected, &result, sizeof(Brick)) != 0 ? 1 : 0;
+	}
+
+	bool VerifyBrickKernels()
+	{
+		BenchmarkRandom random = CreateVerifyRandom();
+
+		// Values around the signed and unsigned edges, vector compares get those wrong first.
+		const glm::uint16_t edgeValues[] = { 0, 1, 2, 0x7FFF, 0x8000, 0x8001, 0xFFFE, 0xFFFF };
+
+		std::vector<Brick> bricks{};
+		bricks.push_back({});
+		for (const glm::uint16_t value : edgeValues)
+		{
+			Brick uniform{};
+			std::fill(uniform.m_voxels, uniform.m_voxels + kBrickVoxelCount, value);
+			bricks.push_back(uniform);
+		}
+
+		for (uint32_t b = 0; b < 64; b++)
+		{
+			Brick noise{};
+			for (glm::uint16_t& voxel : noise.m_voxels)
+			{
+				const uint64_t value = random.Next();
+				// Mostly air for some bricks, mostly solid for others.
+				voxel = (value % 64) < b ? edgeValues[(value >> 8) % 8] : static_cast<glm::uint16_t>(value >> 16) & (b & 1 ? 0xFFFF : 0);
+			}
+			bricks.push_back(noise);
+		}
+
+		const BrickKernels& scalar = *GetBrickKernels(SIMD_SCALAR);
+		bool verified = true;
+
+		for (uint32_t level = SIMD_SSE42; level <= GetSupportedSimdLevel(); level++)
+		{
+			const BrickKernels& kernels = *GetBrickKernels(static_cast<SimdLevel>(level));
+			KernelMismatches mismatches{};
+
+			for (const Brick& brick : bricks)
+			{
+				for (const Brick& other : bricks) VerifyBrick(scalar, kernels, brick, other, mismatches);
+			}
+
+			// Every voxel position alone, in an empty and in a full brick, against every edge value.
+			for (uint32_t i = 0; i < kBrickVoxelCount; i++)
+			{
+				for (uint32_t v = 1; v < 8; v++)
+				{
+					Brick single{};
+					single.m_voxels[i] = edgeValues[v];
+					VerifyBrick(scalar, kernels, single, bricks[0], mismatches);
+
+					Brick hole = bricks[v];
+					hole.m_voxels[i] = edgeValues[v - 1];
+					VerifyBrick(scalar, kernels, hole, bricks[v], mismatches);
+				}
+			}
+
+			// Every box along each axis with a few ranges on the other two.
+			const glm::uvec2 someRanges[] = { { 0, kBrickSize }, { 0, 0 }, { 3, 4 }, { 5, kBrickSize - 4 }, { kBrickSize - 1, kBrickSize }, { 0, kBrickSize / 2 + 1 } };
+			for (uint32_t axis = 0; axis < 3; axis++)
+				for (uint32_t first = 0; first <= kBrickSize; first++)
+					for (uint32_t end = first; end <= kBrickSize; end++)
+						for (const glm::uvec2& a : someRanges)
+							for (const glm::uvec2& b : someRanges)
+							{
+								glm::uvec3 min{ a.x, b.x, a.x };
+								glm::uvec3 max{ a.y, b.y, a.y };
+								min[axis] = first;
+								max[axis] = end;
+
+								VerifyFillBox(scalar, kernels, bricks[bricks.size() - 1 - axis], min, max, mismatches);
+							}
+
+			const uint32_t counts[] = { mismatches.m_countNonAir, mismatches.m_isUniform, mismatches.m_buildOccupancy, mismatches.m_equal, mismatches.m_diff, mismatches.m_downsample, mismatches.m_fillBox };
+			const char* names[] = { "count non air", "is uniform", "build occupancy", "equal", "diff", "downsample", "fill box" };
+			for (uint32_t k = 0; k < 7; k++)
+			{
+				if (counts[k] == 0) continue;
+
+				AFRE_ERROR("The {} {} kernel differs from the scalar one in {} cases!", kernels.m_name, names[k], counts[k]);
+				verified = false;
+			}
+
+			if (counts[0] + counts[1] + counts[2] + counts[3] + counts[4] + counts[5] + counts[6] == 0) AFRE_INFO("The {} brick kernels match the scalar ones!", kernels.m_name);
+		}
+
+		return verified;
+	}
+}
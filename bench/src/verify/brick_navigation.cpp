@@ -0,0 +1,206 @@
+#include "verify.h"
+#include <algorithm>
+#include "bench_worlds.h"
+#include "log.h"
+#include "core/voxel/brick_navigation.h"
+#include "core/voxel/world_generator.h"
+
+namespace afre
+{
+	// The moves BrickNavigator allows: one voxel sideways, flat or a step up or down.
+	static const glm::ivec2 kMoveDirections[4] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+	static const int32_t kMoveSteps[3] = { 0, 1, -1 };
+
+	bool VerifyBrickNavigation()
+	{
+		VoxelWorld world{ glm::uvec3(6, 3, 6) };
+
+		WorldGeneratorInfo worldGeneratorInfo{};
+		worldGeneratorInfo.m_seed = 3;
+		worldGeneratorInfo.m_heightScale = 0.25f;
+		GenerateWorld(world, worldGeneratorInfo);
+
+		const glm::ivec3 size = glm::ivec3(world.GetSizeInVoxels());
+
+		BenchmarkRandom random = CreateVerifyRandom();
+		const auto nextBelow = [&](int32_t bound) { return static_cast<int32_t>(random.NextBelow(static_cast<uint32_t>(bound))); };
+
+		// Walls three voxels high with gaps, so paths go around them or step up ledges.
+		for (int32_t z = 0; z < size.z; z++)
+		{
+			for (int32_t x = 0; x < size.x; x++)
+			{
+				if (!((x % 20 == 7 && z % 30 != 3) || (z % 25 == 12 && x % 17 > 2))) continue;
+
+				int32_t ground = size.y;
+				while (ground > 0 && world.GetVoxel({ x, ground - 1, z }) == 0) ground--;
+				for (int32_t y = ground; y < std::min(ground + 3, size.y); y++) world.SetVoxel({ x, y, z }, 1);
+			}
+		}
+
+		NavAgentInfo agentInfo{};
+		agentInfo.m_height = 2;
+		const int32_t height = static_cast<int32_t>(agentInfo.m_height);
+
+		BrickNavigator navigator{ 2, agentInfo };
+
+		// Breadth first over every voxel of the world with the rules NavAgentInfo describes, the reference.
+		std::vector<glm::uint8_t> standable{};
+		std::vector<int32_t> distances{};
+		std::vector<uint32_t> queue{};
+
+		const auto getIndex = [&](const glm::ivec3& position) { return static_cast<uint32_t>((position.z * size.y + position.y) * size.x + position.x); };
+		const auto isStandable = [&](const glm::ivec3& position) { return world.IsInside(position) && (standable[getIndex(position)] & 1) != 0; };
+		const auto isSteppable = [&](const glm::ivec3& position) { return world.IsInside(position) && (standable[getIndex(position)] & 2) != 0; };
+		const auto canMove = [&](const glm::ivec3& from, const glm::ivec3& to)
+		{
+			const glm::ivec3 offset = to - from;
+			if (std::abs(offset.x) + std::abs(offset.z) != 1 || std::abs(offset.y) > 1 || !isStandable(to)) return false;
+
+			return offset.y == 0 || isSteppable(offset.y > 0 ? from : to);
+		};
+
+		const auto buildStandable = [&]()
+		{
+			const auto isSolid = [&](const glm::ivec3& position) { return world.IsInside(position) && world.GetVoxel(position) != 0; };
+
+			standable.assign(static_cast<size_t>(size.x) * size.y * size.z, 0);
+			for (int32_t z = 0; z < size.z; z++)
+			{
+				for (int32_t y = 0; y < size.y; y++)
+				{
+					for (int32_t x = 0; x < size.x; x++)
+					{
+						const glm::ivec3 position{ x, y, z };
+						if (isSolid(position) || !isSolid(position - glm::ivec3(0, 1, 0))) continue;
+
+						bool room = true;
+						for (int32_t i = 1; i < height; i++) room &= !isSolid(position + glm::ivec3(0, i, 0));
+						if (!room) continue;
+
+						standable[getIndex(position)] = isSolid(position + glm::ivec3(0, height, 0)) ? 1 : 3;
+					}
+				}
+			}
+		};
+
+		const auto findDistance = [&](const glm::ivec3& start, const glm::ivec3& goal)
+		{
+			if (!isStandable(start) || !isStandable(goal)) return -1;
+
+			distances.assign(standable.size(), -1);
+			queue.clear();
+
+			distances[getIndex(start)] = 0;
+			queue.push_back(getIndex(start));
+			for (size_t head = 0; head < queue.size(); head++)
+			{
+				const uint32_t index = queue[head];
+				const glm::ivec3 position{ static_cast<int32_t>(index % size.x), static_cast<int32_t>(index / size.x % size.y), static_cast<int32_t>(index / (size.x * size.y)) };
+				if (position == goal) return distances[index];
+
+				for (const glm::ivec2& direction : kMoveDirections)
+				{
+					for (const int32_t step : kMoveSteps)
+					{
+						const glm::ivec3 next = position + glm::ivec3(direction.x, step, direction.y);
+						if (!canMove(position, next) || distances[getIndex(next)] >= 0) continue;
+
+						distances[getIndex(next)] = distances[index] + 1;
+						queue.push_back(getIndex(next));
+					}
+				}
+			}
+
+			return -1;
+		};
+
+		const auto findSurface = [&](int32_t x, int32_t z)
+		{
+			for (int32_t y = size.y - 1; y >= 0; y--)
+			{
+				if (isStandable({ x, y, z })) return glm::ivec3(x, y, z);
+			}
+			return glm::ivec3(-1);
+		};
+
+		// Rounds of paths between random surface voxels, with edits in between that the graph picks up incrementally.
+		constexpr uint32_t kRounds = 4;
+		constexpr uint32_t kPathsPerRound = 150;
+
+		uint32_t mismatches = 0;
+		uint32_t foundCount = 0;
+		double lengthRatio = 0.0;
+		for (uint32_t round = 0; round < kRounds; round++)
+		{
+			navigator.SetSnapshot(world.TakeSnapshot());
+			buildStandable();
+
+			std::vector<NavPathRequest> requests(kPathsPerRound);
+			for (uint32_t i = 0; i < kPathsPerRound; i++)
+			{
+				requests[i].m_start = findSurface(nextBelow(size.x), nextBelow(size.z));
+				requests[i].m_goal = findSurface(nextBelow(size.x), nextBelow(size.z));
+				requests[i].m_id = i;
+			}
+
+			navigator.RequestPaths(requests);
+			navigator.WaitIdle();
+
+			std::vector<NavPath> paths{};
+			navigator.TakeFinishedPaths(paths);
+			if (paths.size() != requests.size())
+			{
+				AFRE_ERROR("Asked for {} paths but got {}!", requests.size(), paths.size());
+				return false;
+			}
+
+			for (const NavPath& path : paths)
+			{
+				const NavPathRequest& request = requests[path.m_id];
+				const int32_t distance = findDistance(request.m_start, request.m_goal);
+
+				bool valid = path.m_found == (distance >= 0);
+				if (path.m_found)
+				{
+					valid &= !path.m_voxels.empty() && path.m_voxels.front() == request.m_start && path.m_voxels.back() == request.m_goal;
+					for (size_t i = 1; i < path.m_voxels.size() && valid; i++) valid &= canMove(path.m_voxels[i - 1], path.m_voxels[i]);
+
+					foundCount++;
+					lengthRatio += static_cast<double>(path.m_voxels.size() - 1) / std::max(distance, 1);
+				}
+
+				if (valid) continue;
+
+				if (mismatches < 8)
+				{
+					AFRE_ERROR("Path {} of round {} from ({}, {}, {}) to ({}, {}, {}) is {} but the reference finds {} moves!", path.m_id, round,
+						request.m_start.x, request.m_start.y, request.m_start.z, request.m_goal.x, request.m_goal.y, request.m_goal.z,
+						path.m_found ? "invalid or found" : "not found", distance);
+				}
+				mismatches++;
+			}
+
+			// Pillars with a tunnel through their neighbour, which changes bricks across several brick layers.
+			for (uint32_t e = 0; e < 30; e++)
+			{
+				const int32_t x = nextBelow(size.x);
+				const int32_t z = nextBelow(size.z);
+				for (int32_t y = 0; y < size.y * 5 / 8; y++) world.SetVoxel({ x, y, z }, y < size.y * 5 / 12 ? 1 : 0);
+				for (int32_t y = size.y / 6; y < size.y * 5 / 12; y++) world.SetVoxel({ (x + 1) % size.x, y, z }, 0);
+			}
+		}
+
+		const uint32_t pathCount = kRounds * kPathsPerRound;
+		if (mismatches > 0)
+		{
+			AFRE_ERROR("{} of {} paths differ from a breadth first search over every voxel!", mismatches, pathCount);
+			return false;
+		}
+
+		AFRE_INFO("The navigator agrees with a breadth first search over every voxel on {} paths, {} found, {:.3f} times as long on average.",
+			pathCount, foundCount, lengthRatio / std::max(foundCount, 1u));
+
+		return true;
+	}
+}
@@ -0,0 +1,131 @@
+#include "verify.h"
+#include "bench_worlds.h"
+#include "log.h"
+#include "core/voxel/dda.h"
+#include "core/voxel/world_generator.h"
+
+namespace afre
+{
+	static constexpr int32_t kBrickEdge = static_cast<int32_t>(kBrickSize);
+
+	// TraceRay without the uniform brick skip.
+	static RayHit TraceRayPerVoxel(const VoxelWorld& world, const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance)
+	{
+		RayHit rayHit{};
+
+		const glm::vec3 deltaDist = 1.f / glm::abs(rayDir);
+		glm::ivec3 voxelMap = glm::ivec3(glm::floor(rayOrigin));
+		const glm::ivec3 voxelStep = glm::ivec3(glm::sign(rayDir));
+
+		glm::vec3 sideDist{};
+		for (uint8_t i = 0; i < 3; i++)
+		{
+			const float fraction = rayOrigin[i] - static_cast<float>(voxelMap[i]);
+			sideDist[i] = (rayDir[i] < 0 ? fraction : 1.f - fraction) * deltaDist[i];
+		}
+
+		float currentDistance = 0.f;
+		while (currentDistance < maxDistance)
+		{
+			uint8_t axis = 0;
+			if (sideDist.x < sideDist.y)
+			{
+				axis = sideDist.x < sideDist.z ? 0 : 2;
+			}
+			else
+			{
+				axis = sideDist.y < sideDist.z ? 1 : 2;
+			}
+
+			voxelMap[axis] += voxelStep[axis];
+			currentDistance = sideDist[axis];
+			sideDist[axis] += deltaDist[axis];
+
+			rayHit.m_steps++;
+
+			const glm::uint16_t voxel = world.GetVoxel(voxelMap);
+			if (voxel > 0)
+			{
+				rayHit.m_hit = true;
+				rayHit.m_voxelPosition = voxelMap;
+				rayHit.m_faceNormal = glm::ivec3(0);
+				rayHit.m_faceNormal[axis] = -voxelStep[axis];
+				rayHit.m_voxel = voxel;
+				rayHit.m_distance = currentDistance;
+
+				return rayHit;
+			}
+		}
+
+		rayHit.m_distance = currentDistance;
+
+		return rayHit;
+	}
+
+	bool VerifyTraceRay()
+	{
+		VoxelWorld world{ glm::uvec3(8, 4, 8) };
+
+		WorldGeneratorInfo worldGeneratorInfo{};
+		worldGeneratorInfo.m_seed = 1337;
+		GenerateWorld(world, worldGeneratorInfo);
+
+		// A cave of air bricks inside the ground, rays starting in there skip them before hitting anything.
+		for (int32_t z = 0; z < kBrickEdge * 2; z++)
+		{
+			for (int32_t y = 0; y < kBrickEdge; y++)
+			{
+				for (int32_t x = 0; x < kBrickEdge * 2; x++) world.SetVoxel({ kBrickEdge * 3 + x, y, kBrickEdge * 3 + z }, 0);
+			}
+		}
+		world.DeduplicateBricks();
+
+		BenchmarkRandom random = CreateVerifyRandom();
+		const auto nextFloat = [&]() { return random.NextFloat(); };
+
+		const glm::vec3 worldSize = glm::vec3(world.GetSizeInVoxels());
+		const float maxDistance = glm::length(worldSize) * 2.f;
+
+		// Rays from inside the world, from above it and from outside its sides, in every direction. Some are snapped to
+		// brick corners and axes, where rounding puts the exit point in the wrong voxel first.
+		constexpr uint32_t kRayCount = 120000;
+		uint32_t mismatches = 0;
+		for (uint32_t r = 0; r < kRayCount; r++)
+		{
+			glm::vec3 rayOrigin = glm::vec3(nextFloat(), nextFloat(), nextFloat()) * worldSize;
+			if (r % 3 == 1) rayOrigin.y = worldSize.y + nextFloat() * worldSize.y;
+			if (r % 3 == 2) rayOrigin = (glm::vec3(nextFloat(), nextFloat(), nextFloat()) * 3.f - 1.f) * worldSize;
+			if (r % 7 == 0) rayOrigin = glm::floor(rayOrigin / static_cast<float>(kBrickEdge)) * static_cast<float>(kBrickEdge);
+
+			glm::vec3 rayDir = glm::vec3(nextFloat(), nextFloat(), nextFloat()) * 2.f - 1.f;
+			if (r % 11 == 0) rayDir[r % 3] = 0.f;
+			if (r % 13 == 0) rayDir = glm::sign(rayDir);
+			if (glm::length(rayDir) < 0.01f) continue;
+			rayDir = glm::normalize(rayDir);
+
+			const RayHit skipped = TraceRay(world, rayOrigin, rayDir, maxDistance);
+			const RayHit stepped = TraceRayPerVoxel(world, rayOrigin, rayDir, maxDistance);
+
+			if (skipped.m_hit == stepped.m_hit && (!skipped.m_hit || (skipped.m_voxelPosition == stepped.m_voxelPosition && skipped.m_faceNormal == stepped.m_faceNormal))) continue;
+
+			if (mismatches < 8)
+			{
+				AFRE_ERROR("Ray {} from ({}, {}, {}) along ({}, {}, {}) hits ({}, {}, {}) skipping but ({}, {}, {}) stepping!", r,
+					rayOrigin.x, rayOrigin.y, rayOrigin.z, rayDir.x, rayDir.y, rayDir.z,
+					skipped.m_voxelPosition.x, skipped.m_voxelPosition.y, skipped.m_voxelPosition.z,
+					stepped.m_voxelPosition.x, stepped.m_voxelPosition.y, stepped.m_voxelPosition.z);
+			}
+			mismatches++;
+		}
+
+		if (mismatches > 0)
+		{
+			AFRE_ERROR("{} of {} rays differ between the skipping and the per voxel DDA!", mismatches, kRayCount);
+			return false;
+		}
+
+		AFRE_INFO("The skipping DDA matches the per voxel one on {} rays.", kRayCount);
+
+		return true;
+	}
+}
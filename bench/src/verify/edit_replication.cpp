@@ -0,0 +1,133 @@
+#include "verify.h"
+#include <cstring>
+#include "bench_worlds.h"
+#include "log.h"
+#include "core/voxel/edit_replication.h"
+#include "core/voxel/world_generator.h"
+
+namespace afre
+{
+	// One tick of the server, the transport and a client, as a game loop would run them.
+	static void ReplicateTick(const WorldSnapshot& snapshot, ReplicationServer& server, uint32_t clientId, ReplicationClient& client, LoopbackTransport& transport)
+	{
+		std::vector<std::vector<uint8_t>> packets{};
+		server.WritePackets(clientId, snapshot, packets);
+		for (std::vector<uint8_t>& packet : packets) transport.SendToClient(clientId, std::move(packet));
+
+		std::vector<uint8_t> packet{};
+		std::vector<uint8_t> ack{};
+		while (transport.ReceiveOnClient(clientId, packet))
+		{
+			if (client.ReadPacket(packet.data(), packet.size(), ack)) transport.SendToServer(clientId, ack);
+		}
+
+		uint32_t ackClientId = 0;
+		while (transport.ReceiveOnServer(ackClientId, packet)) server.ReadAck(ackClientId, packet.data(), packet.size());
+
+		transport.Tick();
+	}
+
+	static bool IsReplicaEqual(const WorldSnapshot& snapshot, const ReplicationClient& client)
+	{
+		const glm::uvec3 sizeInBricks = snapshot.GetSizeInBricks();
+
+		for (uint32_t brickIndex = 0; brickIndex < snapshot.GetBrickCount(); brickIndex++)
+		{
+			const glm::uvec3 brickPosition{ brickIndex % sizeInBricks.x, brickIndex / sizeInBricks.x % sizeInBricks.y, brickIndex / (sizeInBricks.x * sizeInBricks.y) };
+			if (std::memcmp(snapshot.GetBrick(brickIndex).m_voxels, client.GetWorld().GetBrick(brickPosition).m_voxels, sizeof(Brick::m_voxels)) != 0) return false;
+		}
+
+		return true;
+	}
+
+	bool VerifyEditReplication()
+	{
+		struct ReplicationCase
+		{
+			uint32_t m_latencyTicks = 0;
+			float m_lossRate = 0.f;
+		};
+
+		constexpr ReplicationCase kCases[] = { { 0, 0.f }, { 1, 0.f }, { 3, 0.f }, { 3, 0.1f } };
+		constexpr uint32_t kEditTicks = 200;
+		constexpr uint32_t kEditsPerTick = 64;
+		constexpr uint32_t kMaxSettleTicks = 1000;
+
+		bool verified = true;
+		for (const ReplicationCase& replicationCase : kCases)
+		{
+			VoxelWorld world{ glm::uvec3(8, 4, 8) };
+
+			WorldGeneratorInfo worldGeneratorInfo{};
+			worldGeneratorInfo.m_seed = 7;
+			GenerateWorld(world, worldGeneratorInfo);
+
+			// Lost packets are given up on a few round trips in, so the lossy case settles quickly.
+			ReplicationClientInfo replicationClientInfo{};
+			replicationClientInfo.m_resendTicks = replicationCase.m_latencyTicks * 2 + 4;
+
+			ReplicationServer server{};
+			const uint32_t clientId = server.AddClient(replicationClientInfo);
+			ReplicationClient client{ world.GetSizeInBricks() };
+
+			LoopbackTransportInfo loopbackTransportInfo{};
+			loopbackTransportInfo.m_lossRate = replicationCase.m_lossRate;
+			loopbackTransportInfo.m_latencyTicks = replicationCase.m_latencyTicks;
+			LoopbackTransport transport{ loopbackTransportInfo };
+
+			// Ticks without edits until the client has every brick, false if it never gets there.
+			const auto settle = [&]()
+			{
+				for (uint32_t tick = 0; tick < kMaxSettleTicks; tick++)
+				{
+					const std::shared_ptr<const WorldSnapshot> snapshot = world.TakeSnapshot();
+					if (server.GetPendingBrickCount(clientId, *snapshot) == 0 && IsReplicaEqual(*snapshot, client)) return true;
+
+					ReplicateTick(*snapshot, server, clientId, client, transport);
+				}
+
+				return false;
+			};
+
+			const bool synced = settle();
+			const uint64_t syncedBytes = transport.GetBytesToClients();
+			const uint64_t syncedResent = server.GetStats(clientId).m_bricksResent;
+
+			BenchmarkRandom random = CreateVerifyRandom();
+
+			const glm::uvec3 size = world.GetSizeInVoxels();
+			for (uint32_t tick = 0; tick < kEditTicks; tick++)
+			{
+				for (uint32_t e = 0; e < kEditsPerTick; e++)
+				{
+					const glm::ivec3 position = glm::ivec3(random.NextBelow(size.x), random.NextBelow(size.y), random.NextBelow(size.z));
+					world.SetVoxel(position, static_cast<glm::uint16_t>(random.NextBelow(3)));
+				}
+
+				ReplicateTick(*world.TakeSnapshot(), server, clientId, client, transport);
+			}
+
+			const double bytesPerTick = static_cast<double>(transport.GetBytesToClients() - syncedBytes) / kEditTicks;
+			const uint64_t resent = server.GetStats(clientId).m_bricksResent - syncedResent;
+			const bool settled = settle();
+
+			AFRE_INFO("Replication with {} ticks of latency and {}% loss: {:.0f} bytes a tick for {} edits, {} bricks resent.",
+				replicationCase.m_latencyTicks, replicationCase.m_lossRate * 100.f, bytesPerTick, kEditsPerTick, resent);
+
+			if (!synced || !settled)
+			{
+				AFRE_ERROR("The client's bricks don't match the server's after {} ticks without edits!", kMaxSettleTicks);
+				verified = false;
+			}
+
+			// Nothing was lost, so every delta had the version it was against on the client.
+			if (replicationCase.m_lossRate == 0.f && resent > 0)
+			{
+				AFRE_ERROR("{} bricks were resent although no packet was lost!", resent);
+				verified = false;
+			}
+		}
+
+		return verified;
+	}
+}
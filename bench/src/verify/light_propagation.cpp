@@ -0,0 +1,129 @@
+#include "verify.h"
+#include "bench_worlds.h"
+#include "log.h"
+#include "core/voxel/light_propagation.h"
+
+namespace afre
+{
+	static constexpr glm::uint16_t kLampVoxel = 3;
+
+	static const glm::ivec3 kNeighborOffsets[6] =
+	{
+		{ 1, 0, 0 }, { -1, 0, 0 },
+		{ 0, 1, 0 }, { 0, -1, 0 },
+		{ 0, 0, 1 }, { 0, 0, -1 }
+	};
+
+	// Writes the brick into the world and hands the voxels it changed to the propagator, the way the scene does.
+	static void ReplaceBrick(VoxelWorld& world, LightPropagator& lightPropagator, const glm::uvec3& brickPosition, const Brick& brick)
+	{
+		const Brick oldBrick = world.GetBrick(brickPosition);
+		world.SetBrick(brickPosition, brick);
+		lightPropagator.QueueBrickEdits(brickPosition, oldBrick, brick);
+	}
+
+	// Voxels whose light differs from relighting the whole world from scratch.
+	static uint32_t CountLightMismatches(VoxelWorld& world, const LightPropagator& lightPropagator)
+	{
+		LightPropagator rebuilt{};
+		rebuilt.SetVoxelLighting(kLampVoxel, { 14, true });
+		rebuilt.Rebuild(world.TakeSnapshot());
+		rebuilt.WaitIdle();
+
+		const glm::ivec3 size = glm::ivec3(world.GetSizeInVoxels());
+		uint32_t mismatches = 0;
+		for (int32_t z = 0; z < size.z; z++)
+		{
+			for (int32_t y = 0; y < size.y; y++)
+			{
+				for (int32_t x = 0; x < size.x; x++) mismatches += lightPropagator.GetLight({ x, y, z }) != rebuilt.GetLight({ x, y, z }) ? 1 : 0;
+			}
+		}
+
+		return mismatches;
+	}
+
+	bool VerifyLightPropagation()
+	{
+		VoxelWorld world = CreateTerrainWorld({ 4, 3, 4 });
+
+		LightPropagator lightPropagator{};
+		lightPropagator.SetVoxelLighting(kLampVoxel, { 14, true });
+		lightPropagator.Rebuild(world.TakeSnapshot());
+		lightPropagator.WaitIdle();
+
+		// A lamp on the surface in the middle, the air around it has to light up.
+		glm::ivec3 position = glm::ivec3(world.GetSizeInVoxels() / 2u);
+		while (position.y > 0 && world.GetVoxel(position) == 0) position.y--;
+		position.y++;
+
+		glm::uint8_t lightBefore[6]{};
+		for (uint32_t n = 0; n < 6; n++) lightBefore[n] = lightPropagator.GetLight(position + kNeighborOffsets[n]);
+
+		const glm::uvec3 brickPosition = glm::uvec3(position) / static_cast<uint32_t>(kBrickSize);
+		Brick brick = world.GetBrick(brickPosition);
+		brick.At(glm::uvec3(position) % static_cast<uint32_t>(kBrickSize)) = kLampVoxel;
+		ReplaceBrick(world, lightPropagator, brickPosition, brick);
+		lightPropagator.WaitIdle();
+
+		bool verified = true;
+		for (uint32_t n = 0; n < 6; n++)
+		{
+			const glm::ivec3 neighbor = position + kNeighborOffsets[n];
+			if (world.GetVoxel(neighbor) != 0) continue;
+
+			const glm::uint8_t light = lightPropagator.GetLight(neighbor);
+			if ((light & 0xF) == 13 && light != lightBefore[n]) continue;
+
+			AFRE_ERROR("The air at ({}, {}, {}) next to a placed lamp has light {:#x}, it was {:#x} before!", neighbor.x, neighbor.y, neighbor.z, light, lightBefore[n]);
+			verified = false;
+		}
+
+		// Random boxes of air, stone and lamps written as whole bricks, the way a new VoxelData reaches the lighting.
+		BenchmarkRandom random = CreateVerifyRandom();
+		const glm::uvec3 sizeInBricks = world.GetSizeInBricks();
+		constexpr uint32_t kBrickEdits = 32;
+		for (uint32_t e = 0; e < kBrickEdits; e++)
+		{
+			const glm::uvec3 editBrick{ random.NextBelow(sizeInBricks.x), random.NextBelow(sizeInBricks.y), random.NextBelow(sizeInBricks.z) };
+			const glm::uvec3 min{ random.NextBelow(kBrickSize), random.NextBelow(kBrickSize), random.NextBelow(kBrickSize) };
+			const glm::uvec3 max = glm::min(min + glm::uvec3(1 + random.NextBelow(6)), glm::uvec3(kBrickSize));
+			const glm::uint16_t voxel = static_cast<glm::uint16_t>(random.NextBelow(4));
+
+			Brick edited = world.GetBrick(editBrick);
+			for (uint32_t z = min.z; z < max.z; z++)
+			{
+				for (uint32_t y = min.y; y < max.y; y++)
+				{
+					for (uint32_t x = min.x; x < max.x; x++) edited.At({ x, y, z }) = voxel;
+				}
+			}
+
+			ReplaceBrick(world, lightPropagator, editBrick, edited);
+		}
+		lightPropagator.WaitIdle();
+
+		const uint32_t mismatches = CountLightMismatches(world, lightPropagator);
+		if (mismatches > 0)
+		{
+			AFRE_ERROR("{} voxels are lit differently after {} brick edits than after relighting the world!", mismatches, kBrickEdits + 1);
+			verified = false;
+		}
+
+		// A brick whose upload failed comes back on the next take.
+		std::vector<LitBrick> litBricks{};
+		lightPropagator.TakeLitBricks(litBricks);
+		const LitBrick requeuedBrick{ 0, {} };
+		lightPropagator.RequeueLitBrick(requeuedBrick);
+		lightPropagator.TakeLitBricks(litBricks);
+		if (litBricks.size() != 1 || litBricks[0].m_brickIndex != requeuedBrick.m_brickIndex)
+		{
+			AFRE_ERROR("A requeued lit brick came back as {} bricks!", litBricks.size());
+			verified = false;
+		}
+
+		if (verified) AFRE_INFO("Brick edits light the voxels next to them and match relighting the world after {} edits.", kBrickEdits + 1);
+
+		return verified;
+	}
+}
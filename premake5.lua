@@ -1,6 +1,111 @@
 projectName = _ARGS[1]
 projectDir = _ARGS[2]
 
+newoption
+{
+	trigger = "brick-layout",
+	value = "LAYOUT",
+	description = "Voxel order inside a brick, written to src/core/brick_config.h for the engine and the shaders",
+	allowed =
+	{
+		{ "linear", "Rows of x, then y, then z" },
+		{ "morton", "Z-order curve" },
+		{ "tiled", "4x4x4 tiles" }
+	},
+	default = "linear"
+}
+
+newoption
+{
+	trigger = "brick-size",
+	value = "SIZE",
+	description = "Voxels along a brick's edge, written to src/core/brick_config.h for the engine and the shaders",
+	allowed =
+	{
+		{ "8", "Finer culling and streaming, more bricks to manage" },
+		{ "16", "The default" },
+		{ "32", "Fewer, bigger bricks, longer empty space skips" }
+	},
+	default = "16"
+}
+
+newoption
+{
+	trigger = "log-level",
+	value = "LEVEL",
+	description = "Log calls below this level are compiled out",
+	allowed =
+	{
+		{ "info", "Everything" },
+		{ "warn", "Warnings and worse" },
+		{ "error", "Errors and critical errors" },
+		{ "crit", "Critical errors only" },
+		{ "off", "Nothing, the flight recorder is still dumped on critical errors" }
+	},
+	default = "info"
+}
+
+newoption
+{
+	trigger = "present-mode",
+	value = "MODE",
+	description = "How finished frames are shown, the swapchain falls back to fifo when the mode isn't supported",
+	allowed =
+	{
+		{ "fifo", "Waits for vblank, no tearing, the most latency" },
+		{ "mailbox", "Replaces the queued frame with a newer one, no tearing, paced to the refresh rate" },
+		{ "immediate", "Shows frames right away and can tear, paced to the refresh rate" }
+	},
+	default = "fifo"
+}
+
+newoption
+{
+	trigger = "ray-stats",
+	description = "Loads the instrumented shader and reads back per ray traversal statistics"
+}
+
+-- The scene's world is 3x3x3 bricks. The GPU brick pool is a budget below that, bricks past it wait for a slot
+-- and the shader draws them coarse until then.
+local worldBrickCount = 3 * 3 * 3
+local brickPoolSlots = 16
+
+-- Regenerated on every run, but only written when it changed so nothing rebuilds for nothing.
+local function WriteBrickConfig(brickSize, brickLayout)
+	local sizeBits = ({ ["8"] = 3, ["16"] = 4, ["32"] = 5 })[brickSize]
+	local configPath = path.join(_MAIN_SCRIPT_DIR, "src/core/brick_config.h")
+	local config = table.concat(
+	{
+		"#pragma once",
+		"",
+		"// Generated by premake5.lua from --brick-size and --brick-layout, rerun premake instead of editing it. Shared between",
+		"// the engine and the shaders, so both always agree on the brick size and layout and the sizes of the arrays the brick",
+		"// table is used with.",
+		"",
+		"#define AFRE_BRICK_LAYOUT AFRE_BRICK_LAYOUT_" .. string.upper(brickLayout),
+		"",
+		"#define AFRE_BRICK_SIZE_BITS " .. sizeBits,
+		"#define AFRE_BRICK_SIZE (1 << AFRE_BRICK_SIZE_BITS)",
+		"#define AFRE_BRICK_VOXEL_COUNT (1 << (AFRE_BRICK_SIZE_BITS * 3))",
+		"",
+		"#define AFRE_WORLD_BRICK_COUNT " .. worldBrickCount,
+		"// Words of the masks with a bit per brick of the world.",
+		"#define AFRE_WORLD_BRICK_MASK_WORDS " .. math.floor((worldBrickCount + 31) / 32),
+		"#define AFRE_BRICK_POOL_SLOTS " .. brickPoolSlots,
+		"// Words of the masks with a bit per pool slot.",
+		"#define AFRE_BRICK_POOL_MASK_WORDS " .. math.floor((brickPoolSlots + 31) / 32),
+		""
+	}, "\n")
+
+	if io.readfile(configPath) ~= config then
+		io.writefile(configPath, config)
+	end
+end
+
+if _ACTION then
+	WriteBrickConfig(_OPTIONS["brick-size"] or "16", _OPTIONS["brick-layout"] or "linear")
+end
+
 workspace (projectName)
 	location (projectDir)
 	configurations { "debug", "release" }
@@ -10,6 +115,12 @@ workspace (projectName)
 	staticruntime "Off"
 	systemversion "latest"
 	defaultplatform "windows"
+	defines ("AFRE_LOG_LEVEL=AFRE_LOG_LEVEL_" .. string.upper(_OPTIONS["log-level"] or "info"))
+	defines ("AFRE_PRESENT_MODE=AFRE_PRESENT_MODE_" .. string.upper(_OPTIONS["present-mode"] or "fifo"))
+
+	if _OPTIONS["ray-stats"] then
+		defines "AFRE_RAY_STATS"
+	end
 	
 	filter "configurations:debug"
 		defines "AFRE_DEBUG"
@@ -141,6 +252,57 @@ project "afr-engine"
 	filter "platforms:linux"
 		defines "AFRE_LINUX"
 
+-- CPU only, doesn't link Vulkan so it runs on machines without a GPU.
+project "afr-bench"
+	location (_WORKING_DIR)
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+
+	targetdir ("binaries/" .. outputDir .. "/%{prj.name}")
+	objdir ("intermediate/" .. outputDir .. "/%{prj.name}")
+
+	files
+	{
+		"bench/src/**.h",
+		"bench/src/**.cpp",
+		"src/log.h",
+		"src/log.cpp",
+		"src/core/brick_config.h",
+		"src/core/brick_layout.h",
+		"src/core/buffer_data_types.h",
+		"src/core/task_graph.h",
+		"src/core/task_graph.cpp",
+		"src/core/system_scheduler.h",
+		"src/core/system_scheduler.cpp",
+		"src/core/transform.h",
+		"src/core/debug/**.h",
+		"src/core/debug/**.cpp",
+		"src/core/voxel/**.h",
+		"src/core/voxel/**.cpp"
+	}
+
+	includedirs
+	{
+		"src",
+		"bench/src",
+		"%{dirs.log}/include",
+		"%{dirs.glm}",
+		"%{dirs.dense}/include",
+		"%{dirs.entt}"
+	}
+
+	filter "platforms:windows"
+		buildoptions "/utf-8"
+		defines "AFRE_WINDOWS"
+
+	filter "platforms:mac"
+		defines "AFRE_MAC"
+
+	filter "platforms:linux"
+		defines "AFRE_LINUX"
+		links "pthread"
+
 project "glfw"
 	location "%{dirs.glfw}"
 	kind "StaticLib"
@@ -2,50 +2,96 @@
 #include "log.h"
 #include <fstream>
 #include "core/events.h"
+#include "core/task_graph.h"
 #include "scene.h"
 
 namespace afre
 {
 	Application::Application(char* appTitle, uint16_t windowWidth, uint16_t windowHeight, uint32_t appVersion)
 	{
-		const Result<vkb::Instance> instanceResult = InitInstance(appTitle, appVersion);
-		if (!instanceResult.m_success) return;
-		const vkb::Instance instance = instanceResult.m_returnVal;
+		vkb::Instance instance{};
+		vkb::PhysicalDevice physicalDevice{};
+		vkb::Device device{};
 
-		if (!InitWindow(appTitle, windowWidth, windowHeight)) return;
+		TaskGraph startup{};
 
-		const Result<vkb::PhysicalDevice> physicalDeviceResult = InitPhysicalDevice(instance);
-		if (!physicalDeviceResult.m_success) return;
-		const vkb::PhysicalDevice physicalDevice = physicalDeviceResult.m_returnVal;
+		const TaskId instanceTask = startup.AddTask("instance", [&]()
+			{
+				const Result<vkb::Instance> instanceResult = InitInstance(appTitle, appVersion);
+				instance = instanceResult.m_returnVal;
+				return instanceResult.m_success;
+			});
 
-		const Result<vkb::Device> deviceResult = InitDevice(physicalDevice);
-		if (!deviceResult.m_success) return;
-		const vkb::Device device = deviceResult.m_returnVal;
+		// GLFW windows can only be created on the main thread.
+		const TaskId windowTask = startup.AddTask("window", [&]() { return InitWindow(appTitle, windowWidth, windowHeight); }, {}, true);
 
-		if (!GetQueue(device)) return;
+		const TaskId surfaceTask = startup.AddTask("surface", [&]() { return CreateSurface(); }, { instanceTask, windowTask });
 
-		if (!InitSwapchain(device)) return;
+		const TaskId physicalDeviceTask = startup.AddTask("physical device", [&]()
+			{
+				const Result<vkb::PhysicalDevice> physicalDeviceResult = InitPhysicalDevice(instance);
+				physicalDevice = physicalDeviceResult.m_returnVal;
+				return physicalDeviceResult.m_success;
+			}, { surfaceTask });
 
-		if (!SetupDescriptorManager(physicalDevice.physical_device)) return;
+		const TaskId deviceTask = startup.AddTask("device", [&]()
+			{
+				const Result<vkb::Device> deviceResult = InitDevice(physicalDevice);
+				device = deviceResult.m_returnVal;
+				return deviceResult.m_success;
+			}, { physicalDeviceTask });
 
-		if (!InitPipeline()) return;
+		const TaskId queueTask = startup.AddTask("queue", [&]() { return GetQueue(device); }, { deviceTask });
+		startup.AddTask("upload queue", [&]() { return SetupUploadQueue(device, physicalDevice.physical_device); }, { queueTask });
 
-		if (!CreateCommandPool()) return;
+		const TaskId swapchainTask = startup.AddTask("swapchain", [&]() { return InitSwapchain(device); }, { deviceTask });
+		startup.AddTask("semaphores", [&]() { return CreateSemaphores(); }, { swapchainTask });
 
-		if (!AllocateCommandBuffer()) return;
+		const TaskId descriptorsTask = startup.AddTask("descriptors", [&]() { return SetupDescriptorManager(physicalDevice.physical_device); }, { deviceTask });
+		const TaskId shaderTask = startup.AddTask("shader file", [&]() { return LoadShader(); });
+		startup.AddTask("pipeline", [&]() { return InitPipeline(); }, { descriptorsTask, shaderTask });
+		startup.AddTask("render graph", [&]() { return BuildRenderGraph(physicalDevice.physical_device); }, { descriptorsTask });
 
-		if (!CreateFence()) return;
+		const TaskId commandPoolTask = startup.AddTask("command pool", [&]() { return CreateCommandPool(); }, { deviceTask });
+		startup.AddTask("command buffer", [&]() { return AllocateCommandBuffer(); }, { commandPoolTask });
+		startup.AddTask("fence", [&]() { return CreateFence(); }, { deviceTask });
+
+		startup.AddTask("scene", [&]()
+			{
+				g_scene.Load();
+				return true;
+			});
+
+		const bool started = startup.Run(kStartupWorkerCount);
+		startup.LogReport();
+
+		if (!started) return;
+
+		// The rays and the brick culling follow the swapchain's shape, which can differ from the window asked for.
+		g_scene.m_registry.get<Camera>(g_scene.m_registry.view<Camera>().front()).m_viewportSize = { m_swapchainExtent.width, m_swapchainExtent.height };
 
 		SetupCallbacks();
 
 		glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+		// FIFO already blocks on vblank, the others would render as fast as they can.
+		if (m_presentMode != VK_PRESENT_MODE_FIFO_KHR)
+		{
+			const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+			if (videoMode && videoMode->refreshRate > 0) m_framePacer.SetTargetFrameMs(1000.0 / videoMode->refreshRate);
+		}
+
 		Run();
 	}
 
 	Application::~Application()
 	{
-		vkWaitForFences(m_device, 1, &m_fence, true, 1000000000);
+		// Startup can fail before the device, the fence or the upload queue exist.
+		if (m_device != VK_NULL_HANDLE)
+		{
+			if (m_fence != VK_NULL_HANDLE) vkWaitForFences(m_device, 1, &m_fence, true, 1000000000);
+			m_uploadQueue.WaitIdle();
+		}
 
 		m_cleanupStack.StartCleanup();
 	}
@@ -136,7 +182,11 @@ namespace afre
 			return false;
 		}
 
-		// Window surface creation
+		return true;
+	}
+
+	bool Application::CreateSurface()
+	{
 		const VkResult surfaceResult = glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface);
 
 		m_cleanupStack.PushCleanup([=]()
@@ -191,6 +241,11 @@ namespace afre
 		VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{};
 		physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 		physicalDeviceVulkan12Features.uniformBufferStandardLayout = true;
+		physicalDeviceVulkan12Features.storageBuffer8BitAccess = true;
+		physicalDeviceVulkan12Features.shaderInt8 = true;
+		physicalDeviceVulkan12Features.timelineSemaphore = true;
+		// The mesh pass and the render graph use the depth only attachment layout.
+		physicalDeviceVulkan12Features.separateDepthStencilLayouts = true;
 		deviceBuilder = deviceBuilder.add_pNext(&physicalDeviceVulkan12Features);
 
 		VkPhysicalDevice16BitStorageFeatures physicalDevice16BitStorageFeatures{};
@@ -201,6 +256,8 @@ namespace afre
 
 		VkPhysicalDeviceFeatures physicalDeviceFeatures{};
 		physicalDeviceFeatures.shaderInt16 = true;
+		// FragMain writes the brick feedback, and the ray stats counters when they're built in, with atomics.
+		physicalDeviceFeatures.fragmentStoresAndAtomics = true;
 		VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
 		physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
 		physicalDeviceFeatures2.features = physicalDeviceFeatures;
@@ -246,6 +303,7 @@ namespace afre
 			AFRE_INFO("Successfully received a queue!");
 
 			m_queue = queueResult.value();
+			m_queueFamily = device.get_queue_index(vkb::QueueType::graphics).value();
 		}
 		else
 		{
@@ -256,15 +314,52 @@ namespace afre
 		return true;
 	}
 
+	bool Application::SetupUploadQueue(const vkb::Device& device, const VkPhysicalDevice& physicalDevice)
+	{
+		bool success = false;
+
+		UploadQueueCreateInfo uploadQueueCreateInfo{};
+		uploadQueueCreateInfo.m_graphicsQueue = m_queue;
+		uploadQueueCreateInfo.m_graphicsQueueFamily = m_queueFamily;
+		uploadQueueCreateInfo.m_transferQueue = m_queue;
+		uploadQueueCreateInfo.m_transferQueueFamily = m_queueFamily;
+		// A frame uploads at most all of the voxel, brick pool, light, instance and mesh data.
+		uploadQueueCreateInfo.m_stagingSize = sizeof(PackedVoxelData) + kBrickPoolSlots * sizeof(Brick) + sizeof(LightData) + sizeof(VoxelInstanceData) + sizeof(MeshQuadData);
+
+		const vkb::Result<VkQueue> transferQueueResult = device.get_dedicated_queue(vkb::QueueType::transfer);
+		if (transferQueueResult.has_value())
+		{
+			uploadQueueCreateInfo.m_transferQueue = transferQueueResult.value();
+			uploadQueueCreateInfo.m_transferQueueFamily = device.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+		}
+
+		m_uploadQueue = UploadQueue{ m_cleanupStack, m_device, physicalDevice, uploadQueueCreateInfo, success };
+
+		return success;
+	}
+
 	bool Application::InitSwapchain(const vkb::Device& device)
 	{
+		#if AFRE_PRESENT_MODE == AFRE_PRESENT_MODE_MAILBOX
+			// One shown, one queued and one being rendered, otherwise mailbox has nothing to replace.
+			const VkPresentModeKHR desiredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			const uint32_t minImageCount = 3;
+		#elif AFRE_PRESENT_MODE == AFRE_PRESENT_MODE_IMMEDIATE
+			const VkPresentModeKHR desiredPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			const uint32_t minImageCount = 2;
+		#else
+			const VkPresentModeKHR desiredPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+			const uint32_t minImageCount = 2;
+		#endif
+
 		const vkb::Result<vkb::Swapchain> swapchainResult{
 			vkb::SwapchainBuilder{device}
-			.set_desired_min_image_count(1)
+			.set_desired_min_image_count(minImageCount)
 			.set_image_usage_flags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
 			.set_desired_extent(m_windowWidth, m_windowHeight)
 			.set_composite_alpha_flags(VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR)
-			.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
+			.set_desired_present_mode(desiredPresentMode)
+			.add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR)
 			.build()
 		};
 
@@ -274,6 +369,13 @@ namespace afre
 
 			vkb::Swapchain swapchain = swapchainResult.value();
 			m_swapchain = swapchain.swapchain;
+			m_presentMode = swapchain.present_mode;
+			m_swapchainExtent = swapchain.extent;
+
+			if (m_presentMode != desiredPresentMode)
+			{
+				AFRE_WARN("The present mode isn't supported, falling back to FIFO!");
+			}
 
 			m_cleanupStack.PushCleanup([=]()
 				{
@@ -293,6 +395,16 @@ namespace afre
 
 	bool Application::GetImageViews(vkb::Swapchain& swapchain)
 	{
+		const vkb::Result<std::vector<VkImage>> imagesResult = swapchain.get_images();
+		if (!imagesResult.has_value())
+		{
+			AFRE_CRIT("Failed to get the swapchain images!");
+			return false;
+		}
+
+		// Owned by the swapchain, only the views are destroyed.
+		m_images = imagesResult.value();
+
 		const vkb::Result<std::vector<VkImageView>> imageViewsResult = swapchain.get_image_views();
 
 		if (imageViewsResult.has_value())
@@ -311,7 +423,7 @@ namespace afre
 		}
 		else
 		{
-			AFRE_CRIT("Failed to get the image views!", false);
+			AFRE_CRIT("Failed to get the image views!");
 			return false;
 		}
 
@@ -328,26 +440,93 @@ namespace afre
 
 		DescriptorBindingInfo storageBinding{};
 		storageBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		storageBinding.m_bufferSizes = { sizeof(VoxelData) };
+		storageBinding.m_bufferSizes = { sizeof(PackedVoxelData) };
+		storageBinding.m_deviceLocal = true;
+
+		DescriptorBindingInfo lightBinding{};
+		lightBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		lightBinding.m_bufferSizes = { sizeof(LightData) };
+		lightBinding.m_deviceLocal = true;
+
+		DescriptorBindingInfo materialBinding{};
+		materialBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		materialBinding.m_bufferSizes = { sizeof(MaterialData) * kMaxMaterials };
+
+		DescriptorBindingInfo instanceBinding{};
+		instanceBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		instanceBinding.m_bufferSizes = { sizeof(VoxelInstanceData) };
+		instanceBinding.m_deviceLocal = true;
+
+		DescriptorBindingInfo meshQuadBinding{};
+		meshQuadBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		meshQuadBinding.m_bufferSizes = { sizeof(MeshQuadData) };
+		meshQuadBinding.m_deviceLocal = true;
+
+		// Written once CreateRasterTargets made the images.
+		DescriptorBindingInfo rasterDepthBinding{};
+		rasterDepthBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		rasterDepthBinding.m_imageCount = 1;
+
+		DescriptorBindingInfo rasterHitBinding{};
+		rasterHitBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		rasterHitBinding.m_imageCount = 1;
+
+		// Host visible, the CPU reads it back every frame.
+		DescriptorBindingInfo brickFeedbackBinding{};
+		brickFeedbackBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		brickFeedbackBinding.m_bufferSizes = { sizeof(BrickFeedbackData) };
+
+		// Resized with BrickResidency's capacity, a brick until the world is known.
+		DescriptorBindingInfo brickPoolBinding{};
+		brickPoolBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		brickPoolBinding.m_bufferSizes = { sizeof(Brick) };
+		brickPoolBinding.m_deviceLocal = true;
+		brickPoolBinding.m_resizable = true;
 
 		DescriptorManagerCreateInfo descriptorManagerCreateInfo{};
-		descriptorManagerCreateInfo.m_bindings = { uniformBinding, storageBinding };
+		descriptorManagerCreateInfo.m_bindings = { uniformBinding, storageBinding, lightBinding, materialBinding, instanceBinding, meshQuadBinding, rasterDepthBinding, rasterHitBinding, brickFeedbackBinding, brickPoolBinding };
+
+		#ifdef AFRE_RAY_STATS
+			DescriptorBindingInfo rayStatsBinding{};
+			rayStatsBinding.m_descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			rayStatsBinding.m_bufferSizes = { sizeof(RayStatsData) };
+			descriptorManagerCreateInfo.m_bindings.push_back(rayStatsBinding);
+		#endif
 
 		m_descriptorManager = DescriptorManager{ m_cleanupStack, m_device, physicalDevice, descriptorManagerCreateInfo, success };
+		m_descriptorManager.m_uploadQueue = &m_uploadQueue;
+
+		m_cleanupStack.PushCleanup([=]()
+			{
+				m_descriptorManager.DestroyResizableBuffers();
+			});
 
 		// The order of the calls bufferIndex arg must match the m_bufferSizes added order.
 		m_descriptorManager.RegisterBufferUpdater<CameraData>(0);
-		m_descriptorManager.RegisterVoxelDataBufferUpdater(1);
+		m_descriptorManager.RegisterLateBufferUpdater<CameraData>(0);
+		m_descriptorManager.RegisterBrickFeedbackBufferUpdater(6);
+		m_descriptorManager.RegisterVoxelDataBufferUpdater(1, 7);
+		m_descriptorManager.RegisterLightDataBufferUpdater(2);
+		m_descriptorManager.RegisterMaterialTableBufferUpdater(3);
+		m_descriptorManager.RegisterVoxelInstanceBufferUpdater(4);
+		m_descriptorManager.RegisterMeshQuadBufferUpdater(5, 1);
+		#ifdef AFRE_RAY_STATS
+			m_descriptorManager.RegisterRayStatsBufferUpdater(8);
+		#endif
 
 		return success;
 	}
 
-	bool Application::InitPipeline()
+	bool Application::LoadShader()
 	{
-		VkGraphicsPipelineCreateInfo pipelineInfo{};
-		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		// The instrumented variant is shader.slang compiled with -DAFRE_RAY_STATS.
+		#ifdef AFRE_RAY_STATS
+			const char* shaderName = "slang_ray_stats.spv";
+		#else
+			const char* shaderName = "slang.spv";
+		#endif
 
-		std::ifstream shader{ fmt::format("{}/assets/build/shaders/slang.spv", std::getenv("AFR_ENGINE_PATH")), std::ios::binary | std::ios::ate };
+		std::ifstream shader{ fmt::format("{}/assets/build/shaders/{}", std::getenv("AFR_ENGINE_PATH"), shaderName), std::ios::binary | std::ios::ate };
 
 		if (!shader.is_open())
 		{
@@ -355,16 +534,26 @@ namespace afre
 			return false;
 		}
 
-		std::vector<char> shaderBuffer(shader.tellg());
+		m_shaderCode.resize(shader.tellg());
 		shader.seekg(std::ios::beg);
-		shader.read(shaderBuffer.data(), static_cast<std::streamsize>(shaderBuffer.size()));
+		shader.read(m_shaderCode.data(), static_cast<std::streamsize>(m_shaderCode.size()));
 
 		shader.close();
 
+		AFRE_INFO("Read the shader file!");
+
+		return true;
+	}
+
+	bool Application::InitPipeline()
+	{
+		VkGraphicsPipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+
 		VkShaderModuleCreateInfo shaderModuleInfo{};
 		shaderModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		shaderModuleInfo.codeSize = shaderBuffer.size();
-		shaderModuleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderBuffer.data());
+		shaderModuleInfo.codeSize = m_shaderCode.size();
+		shaderModuleInfo.pCode = reinterpret_cast<const uint32_t*>(m_shaderCode.data());
 
 		VkShaderModule shaderModule;
 		const VkResult shaderResult = vkCreateShaderModule(m_device, &shaderModuleInfo, nullptr, &shaderModule);
@@ -440,7 +629,166 @@ namespace afre
 			return false;
 		}
 
+		if (!InitMeshPipeline(shaderModule)) return false;
+
 		vkDestroyShaderModule(m_device, shaderModule, nullptr);
+		m_shaderCode = {};
+
+		return true;
+	}
+
+	bool Application::InitMeshPipeline(VkShaderModule shaderModule)
+	{
+		VkGraphicsPipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+
+		VkPipelineRenderingCreateInfo renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachmentFormats = &kRasterHitFormat;
+		renderingInfo.depthAttachmentFormat = kRasterDepthFormat;
+		pipelineInfo.pNext = &renderingInfo;
+
+		VkPipelineShaderStageCreateInfo vertexShaderInfo{};
+		vertexShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		vertexShaderInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+		vertexShaderInfo.pName = "VertMeshMain";
+		vertexShaderInfo.module = shaderModule;
+
+		VkPipelineShaderStageCreateInfo fragShaderInfo{};
+		fragShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		fragShaderInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		fragShaderInfo.pName = "FragMeshMain";
+		fragShaderInfo.module = shaderModule;
+
+		const VkPipelineShaderStageCreateInfo stagesInfo[] = { vertexShaderInfo, fragShaderInfo };
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = stagesInfo;
+
+		// Quads are pulled from the quad buffer by vertex index, there are no vertex buffers.
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+
+		VkPipelineInputAssemblyStateCreateInfo pipelineInputAssemblyInfo{};
+		pipelineInputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		pipelineInputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		pipelineInfo.pInputAssemblyState = &pipelineInputAssemblyInfo;
+
+		VkPipelineViewportStateCreateInfo viewportInfo{};
+		viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportInfo.viewportCount = 1;
+		viewportInfo.scissorCount = 1;
+
+		VkViewport viewport{};
+		viewport.width = m_windowWidth;
+		viewport.height = m_windowHeight;
+		viewport.maxDepth = 1.f;
+		viewportInfo.pViewports = &viewport;
+
+		VkRect2D scissor{};
+		scissor.extent = { m_windowWidth, m_windowHeight };
+		viewportInfo.pScissors = &scissor;
+		pipelineInfo.pViewportState = &viewportInfo;
+
+		// Both sides of a face are drawn, the mesher doesn't wind them.
+		VkPipelineRasterizationStateCreateInfo rasterizationInfo{};
+		rasterizationInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizationInfo.lineWidth = 1.f;
+		rasterizationInfo.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+		pipelineInfo.pRasterizationState = &rasterizationInfo;
+
+		VkPipelineMultisampleStateCreateInfo multisampleInfo{};
+		multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		pipelineInfo.pMultisampleState = &multisampleInfo;
+
+		// Reversed depth, nearer is greater.
+		VkPipelineDepthStencilStateCreateInfo depthStencilInfo{};
+		depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencilInfo.depthTestEnable = true;
+		depthStencilInfo.depthWriteEnable = true;
+		depthStencilInfo.depthCompareOp = VK_COMPARE_OP_GREATER;
+		pipelineInfo.pDepthStencilState = &depthStencilInfo;
+
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+
+		VkPipelineColorBlendStateCreateInfo colorBlendInfo{};
+		colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlendInfo.attachmentCount = 1;
+		colorBlendInfo.pAttachments = &colorBlendAttachment;
+		pipelineInfo.pColorBlendState = &colorBlendInfo;
+
+		pipelineInfo.layout = m_descriptorManager.m_pipelineLayout;
+
+		const VkResult pipelineResult = vkCreateGraphicsPipelines(m_device, nullptr, 1, &pipelineInfo, nullptr, &m_meshPipeline);
+
+		m_cleanupStack.PushCleanup([=]()
+			{
+				vkDestroyPipeline(m_device, m_meshPipeline, nullptr);
+			});
+
+		if (pipelineResult == VK_SUCCESS)
+		{
+			AFRE_INFO("Mesh pipeline was created!");
+		}
+		else
+		{
+			AFRE_CRIT("Mesh pipeline failed to create!");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Application::BuildRenderGraph(const VkPhysicalDevice& physicalDevice)
+	{
+		TransientImageInfo depthInfo{};
+		depthInfo.m_format = kRasterDepthFormat;
+		depthInfo.m_extent = { m_windowWidth, m_windowHeight };
+		depthInfo.m_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		m_rasterDepth = m_renderGraph.CreateTransientImage("raster depth", depthInfo);
+
+		TransientImageInfo hitInfo{};
+		hitInfo.m_format = kRasterHitFormat;
+		hitInfo.m_extent = { m_windowWidth, m_windowHeight };
+		m_rasterHit = m_renderGraph.CreateTransientImage("raster hit", hitInfo);
+
+		// Same stage the acquire semaphore is waited on, so the first transition happens after the presentation engine let go.
+		ImportedImageInfo swapchainInfo{};
+		swapchainInfo.m_initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		swapchainInfo.m_initialStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		swapchainInfo.m_finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		swapchainInfo.m_finalStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		swapchainInfo.m_output = true;
+		m_swapchainTarget = m_renderGraph.ImportImage("swapchain", swapchainInfo);
+
+		const RenderPassId meshPass = m_renderGraph.AddPass("mesh", [this](VkCommandBuffer commandBuffer) { RecordMeshPass(commandBuffer); });
+		m_renderGraph.UseImage(meshPass, m_rasterDepth, RENDER_IMAGE_DEPTH_ATTACHMENT);
+		m_renderGraph.UseImage(meshPass, m_rasterHit, RENDER_IMAGE_COLOR_ATTACHMENT);
+
+		const RenderPassId marchPass = m_renderGraph.AddPass("march", [this](VkCommandBuffer commandBuffer) { RecordMarchPass(commandBuffer); });
+		m_renderGraph.UseImage(marchPass, m_rasterDepth, RENDER_IMAGE_FRAGMENT_SAMPLED);
+		m_renderGraph.UseImage(marchPass, m_rasterHit, RENDER_IMAGE_FRAGMENT_SAMPLED);
+		m_renderGraph.UseImage(marchPass, m_swapchainTarget, RENDER_IMAGE_COLOR_ATTACHMENT);
+
+		const bool compiled = m_renderGraph.Compile(m_device, physicalDevice);
+
+		m_cleanupStack.PushCleanup([=]()
+			{
+				m_renderGraph.Destroy(m_device);
+			});
+
+		if (!compiled)
+		{
+			AFRE_CRIT("Render graph failed to compile!");
+			return false;
+		}
+
+		m_descriptorManager.WriteSampledImage(m_device, kRasterDepthBinding, m_renderGraph.GetImageView(m_rasterDepth), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		m_descriptorManager.WriteSampledImage(m_device, kRasterHitBinding, m_renderGraph.GetImageView(m_rasterHit), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		return true;
 	}
@@ -520,6 +868,42 @@ namespace afre
 		return true;
 	}
 
+	bool Application::CreateSemaphores()
+	{
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		VkResult semaphoreResult = vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_imageAvailableSemaphore);
+
+		m_renderFinishedSemaphores.resize(m_images.size(), VK_NULL_HANDLE);
+		for (uint32_t i = 0; i < m_renderFinishedSemaphores.size() && semaphoreResult == VK_SUCCESS; i++)
+		{
+			semaphoreResult = vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]);
+		}
+
+		m_cleanupStack.PushCleanup([=]()
+			{
+				vkDestroySemaphore(m_device, m_imageAvailableSemaphore, nullptr);
+
+				for (const VkSemaphore semaphore : m_renderFinishedSemaphores)
+				{
+					vkDestroySemaphore(m_device, semaphore, nullptr);
+				}
+			});
+
+		if (semaphoreResult == VK_SUCCESS)
+		{
+			AFRE_INFO("Created the swapchain semaphores!");
+		}
+		else
+		{
+			AFRE_CRIT("Failed to create the swapchain semaphores!");
+			return false;
+		}
+
+		return true;
+	}
+
 	void Application::SetupCallbacks()
 	{
 		glfwSetKeyCallback(m_window, KeyCallback);
@@ -530,31 +914,57 @@ namespace afre
 	{
 		while (!glfwWindowShouldClose(m_window))
 		{
+			// Input is sampled after the wait, not before it.
+			m_framePacer.WaitForFrameStart();
+
 			glfwPollEvents();
 			g_scene.Update();
 			Draw();
 		}
 	}
 
-	void Application::Draw()
+	void Application::RecordMeshPass(VkCommandBuffer commandBuffer)
 	{
-		vkWaitForFences(m_device, 1, &m_fence, true, 1000000000);
-		vkResetFences(m_device, 1, &m_fence);
+		// The graph moved both targets into attachment layouts, last frame's contents are cleared anyway.
+		VkRenderingAttachmentInfo hitAttachmentInfo{};
+		hitAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		hitAttachmentInfo.clearValue.color.uint32[0] = 0;
+		hitAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		hitAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		hitAttachmentInfo.imageView = m_renderGraph.GetImageView(m_rasterHit);
+		hitAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkRenderingAttachmentInfo depthAttachmentInfo{};
+		depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachmentInfo.clearValue.depthStencil.depth = 0.f;
+		depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depthAttachmentInfo.imageView = m_renderGraph.GetImageView(m_rasterDepth);
+		depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
 
-		VkCommandBufferBeginInfo cmdBufferBeginInfo{};
-		cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VkRenderingInfo renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachments = &hitAttachmentInfo;
+		renderingInfo.pDepthAttachment = &depthAttachmentInfo;
+		renderingInfo.layerCount = 1;
+		renderingInfo.renderArea.extent = { m_windowWidth, m_windowHeight };
 
-		for (uint16_t i = 0; i < static_cast<uint16_t>(m_descriptorManager.m_bufferUpdaters.size()); i++)
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+		// Nothing to draw still clears, the march reads no hit anywhere then.
+		if (g_scene.m_uploadedMeshQuadCount > 0)
 		{
-			m_descriptorManager.m_bufferUpdaters[i]();
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_meshPipeline);
+			vkCmdDraw(commandBuffer, g_scene.m_uploadedMeshQuadCount * 6, 1, 0, 0);
 		}
 
-		vkBeginCommandBuffer(m_commandBuffer, &cmdBufferBeginInfo);
-
-		vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+		vkCmdEndRendering(commandBuffer);
+	}
 
-		vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_descriptorManager.m_pipelineLayout, 0, 1, &m_descriptorManager.m_descriptorSet, 0, nullptr);
+	void Application::RecordMarchPass(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
 
 		VkRenderingInfo renderingInfo{};
 		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
@@ -567,16 +977,71 @@ namespace afre
 		renderAttachmentInfo.clearValue = VkClearValue{ VkClearColorValue{0.f, 0.f, 0.f, 1.f} };
 		renderAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		renderAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		renderAttachmentInfo.imageView = m_imageViews[0];
-		renderAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		renderAttachmentInfo.imageView = m_renderGraph.GetImageView(m_swapchainTarget);
+		renderAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 		renderingInfo.pColorAttachments = &renderAttachmentInfo;
 
-		vkCmdBeginRendering(m_commandBuffer, &renderingInfo);
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+		vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+
+		vkCmdEndRendering(commandBuffer);
+	}
+
+	void Application::LatchCamera()
+	{
+		glfwPollEvents();
+
+		for (uint16_t i = 0; i < static_cast<uint16_t>(m_descriptorManager.m_lateBufferUpdaters.size()); i++)
+		{
+			m_descriptorManager.m_lateBufferUpdaters[i]();
+		}
+
+		std::chrono::steady_clock::time_point inputTime{};
+		if (TakeOldestInputTime(inputTime)) m_frameLatency.OnLatch(inputTime, std::chrono::steady_clock::now());
+	}
+
+	void Application::Draw()
+	{
+		const VkResult fenceResult = vkWaitForFences(m_device, 1, &m_fence, true, 1000000000);
+		if (fenceResult != VK_SUCCESS)
+		{
+			AFRE_CRIT("Waiting for the frame fence failed ({})!", static_cast<int32_t>(fenceResult));
+			return;
+		}
+
+		uint32_t imageIndex = 0;
+		const VkResult acquireResult = vkAcquireNextImageKHR(m_device, m_swapchain, 1000000000, m_imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+		if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR)
+		{
+			// The window can't be resized, out of date only happens while it's minimized.
+			if (acquireResult != VK_ERROR_OUT_OF_DATE_KHR) AFRE_CRIT("Acquiring a swapchain image failed ({})!", static_cast<int32_t>(acquireResult));
+			return;
+		}
+
+		// Only once there's a frame to submit, an unsignaled fence would block the next wait forever.
+		vkResetFences(m_device, 1, &m_fence);
+
+		VkCommandBufferBeginInfo cmdBufferBeginInfo{};
+		cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		vkCmdDraw(m_commandBuffer, 6, 1, 0, 0);
+		for (uint16_t i = 0; i < static_cast<uint16_t>(m_descriptorManager.m_bufferUpdaters.size()); i++)
+		{
+			m_descriptorManager.m_bufferUpdaters[i]();
+		}
 
-		vkCmdEndRendering(m_commandBuffer);
+		m_uploadQueue.Submit();
+
+		vkBeginCommandBuffer(m_commandBuffer, &cmdBufferBeginInfo);
+
+		m_uploadQueue.RecordAcquires(m_commandBuffer);
+
+		vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_descriptorManager.m_pipelineLayout, 0, 1, &m_descriptorManager.m_descriptorSet, 0, nullptr);
+
+		m_renderGraph.SetImportedImage(m_swapchainTarget, m_images[imageIndex], m_imageViews[imageIndex]);
+		m_renderGraph.Execute(m_commandBuffer);
 
 		vkEndCommandBuffer(m_commandBuffer);
 
@@ -584,18 +1049,57 @@ namespace afre
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &m_commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &m_renderFinishedSemaphores[imageIndex];
+
+		// The acquired image, then this frame's uploads if there are any. The GPU waits for them, the CPU doesn't.
+		VkSemaphore waitSemaphores[2] = { m_imageAvailableSemaphore, VK_NULL_HANDLE };
+		// The binary semaphore's value is ignored.
+		uint64_t waitValues[2] = { 0, 0 };
+		const VkPipelineStageFlags waitStages[2] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = waitSemaphores;
+		submitInfo.pWaitDstStageMask = waitStages;
 
-		vkQueueSubmit(m_queue, 1, &submitInfo, m_fence);
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+
+		if (m_uploadQueue.GetFrameWait(waitSemaphores[1], waitValues[1]))
+		{
+			submitInfo.waitSemaphoreCount = 2;
+
+			timelineInfo.waitSemaphoreValueCount = 2;
+			timelineInfo.pWaitSemaphoreValues = waitValues;
+
+			submitInfo.pNext = &timelineInfo;
+		}
+
+		// The GPU reads the camera when it runs the frame, so it can still change after recording.
+		LatchCamera();
+
+		const VkResult submitResult = vkQueueSubmit(m_queue, 1, &submitInfo, m_fence);
+		if (submitResult != VK_SUCCESS)
+		{
+			AFRE_CRIT("Frame submit failed ({})!", static_cast<int32_t>(submitResult));
+			return;
+		}
 
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.pSwapchains = &m_swapchain;
 		presentInfo.swapchainCount = 1;
-
-		const uint32_t imageIndex = 0;
-
 		presentInfo.pImageIndices = &imageIndex;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &m_renderFinishedSemaphores[imageIndex];
+
+		const VkResult presentResult = vkQueuePresentKHR(m_queue, &presentInfo);
+		if (presentResult < VK_SUCCESS && presentResult != VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			AFRE_CRIT("Present failed ({})!", static_cast<int32_t>(presentResult));
+		}
 
-		vkQueuePresentKHR(m_queue, &presentInfo);
+		m_frameLatency.OnPresent(std::chrono::steady_clock::now());
+		m_framePacer.OnFramePresented();
 	}
 }
\ No newline at end of file
@@ -5,8 +5,20 @@
 #include <GLFW/glfw3.h>
 
 #include "core/descriptor_manager.h"
+#include "core/frame_pacer.h"
+#include "core/render_graph.h"
+#include "core/debug/frame_latency.h"
 #include <VkBootstrap.h>
 
+#define AFRE_PRESENT_MODE_FIFO 0
+#define AFRE_PRESENT_MODE_MAILBOX 1
+#define AFRE_PRESENT_MODE_IMMEDIATE 2
+
+// Set with premake's --present-mode.
+#ifndef AFRE_PRESENT_MODE
+	#define AFRE_PRESENT_MODE AFRE_PRESENT_MODE_FIFO
+#endif
+
 namespace afre
 {
 	#define ENGINE_VERSION VK_MAKE_VERSION(1, 0, 0)
@@ -32,6 +44,7 @@ namespace afre
 		Result<vkb::Instance> InitInstance(char* appTitle, uint32_t appVersion);
 
 		bool InitWindow(char* appTitle, uint16_t windowWidth, uint16_t windowHeight);
+		bool CreateSurface();
 
 		Result<vkb::PhysicalDevice> InitPhysicalDevice(const vkb::Instance& instance);
 
@@ -40,24 +53,46 @@ namespace afre
 		
 		bool GetQueue(const vkb::Device& device);
 
+		bool SetupUploadQueue(const vkb::Device& device, const VkPhysicalDevice& physicalDevice);
+
 		bool InitSwapchain(const vkb::Device& device);
 		bool GetImageViews(vkb::Swapchain& swapchain);
 
 		bool SetupDescriptorManager(const VkPhysicalDevice& physicalDevice);
 
+		bool LoadShader();
 		bool InitPipeline();
+		bool InitMeshPipeline(VkShaderModule shaderModule);
+
+		// The mesh pass and the ray march, with the raster targets between them as transient images.
+		bool BuildRenderGraph(const VkPhysicalDevice& physicalDevice);
 
 		bool CreateCommandPool();
 		bool AllocateCommandBuffer();
 
 		bool CreateFence();
+		bool CreateSemaphores();
 
 		void SetupCallbacks();
 
 		void Run();
 
+		// Draws the meshed near bricks into the raster targets the ray march starts from.
+		void RecordMeshPass(VkCommandBuffer commandBuffer);
+		void RecordMarchPass(VkCommandBuffer commandBuffer);
+		// Polls input once more and rewrites the late buffers, the last thing before the frame is submitted.
+		void LatchCamera();
 		void Draw();
 
+		// Threads running startup tasks besides the main one. More would sit idle, the graph is never wider.
+		static constexpr uint32_t kStartupWorkerCount = 3;
+
+		// What the mesh pass leaves for the ray march: reversed depth (1 / view depth) and the voxel and face it drew.
+		static constexpr VkFormat kRasterDepthFormat = VK_FORMAT_D32_SFLOAT;
+		static constexpr VkFormat kRasterHitFormat = VK_FORMAT_R32_UINT;
+		static constexpr uint32_t kRasterDepthBinding = 6;
+		static constexpr uint32_t kRasterHitBinding = 7;
+
 		CleanupStack m_cleanupStack;
 
 		GLFWwindow* m_window = nullptr;
@@ -76,20 +111,41 @@ namespace afre
 
 		VkSurfaceKHR m_surface;
 
-		VkDevice m_device;
+		VkDevice m_device = VK_NULL_HANDLE;
 
 		VkQueue m_queue;
+		uint32_t m_queueFamily = 0;
+
+		UploadQueue m_uploadQueue;
 
 		VkSwapchainKHR m_swapchain;
+		VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+		VkExtent2D m_swapchainExtent{};
+		std::vector<VkImage> m_images;
 		std::vector<VkImageView> m_imageViews;
 
 		DescriptorManager m_descriptorManager;
 
+		// SPIR-V read by the shader file task, freed once the pipeline is created.
+		std::vector<char> m_shaderCode;
 		VkPipeline m_pipeline;
+		VkPipeline m_meshPipeline;
+
+		RenderGraph m_renderGraph;
+		RenderResourceId m_rasterDepth = 0;
+		RenderResourceId m_rasterHit = 0;
+		// The acquired swapchain image, set every frame.
+		RenderResourceId m_swapchainTarget = 0;
 
 		VkCommandPool m_commandPool;
 		VkCommandBuffer m_commandBuffer;
 
-		VkFence m_fence;
+		VkFence m_fence = VK_NULL_HANDLE;
+		VkSemaphore m_imageAvailableSemaphore;
+		// One per swapchain image, the present of an image can still be waiting on its last one.
+		std::vector<VkSemaphore> m_renderFinishedSemaphores;
+
+		FramePacer m_framePacer;
+		FrameLatencyTracker m_frameLatency;
 	};
 }
\ No newline at end of file
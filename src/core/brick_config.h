@@ -0,0 +1,18 @@
+#pragma once
+
+// Generated by premake5.lua from --brick-size and --brick-layout, rerun premake instead of editing it. Shared between
+// the engine and the shaders, so both always agree on the brick size and layout and the sizes of the arrays the brick
+// table is used with.
+
+#define AFRE_BRICK_LAYOUT AFRE_BRICK_LAYOUT_LINEAR
+
+#define AFRE_BRICK_SIZE_BITS 4
+#define AFRE_BRICK_SIZE (1 << AFRE_BRICK_SIZE_BITS)
+#define AFRE_BRICK_VOXEL_COUNT (1 << (AFRE_BRICK_SIZE_BITS * 3))
+
+#define AFRE_WORLD_BRICK_COUNT 27
+// Words of the masks with a bit per brick of the world.
+#define AFRE_WORLD_BRICK_MASK_WORDS 1
+#define AFRE_BRICK_POOL_SLOTS 16
+// Words of the masks with a bit per pool slot.
+#define AFRE_BRICK_POOL_MASK_WORDS 1
@@ -0,0 +1,94 @@
+#pragma once
+
+// Shared between the engine and the shaders (shader.slang includes it), so keep it to plain integer math.
+// The layout and the brick size come from brick_config.h, pick them with premake's --brick-layout and --brick-size.
+
+#include "brick_config.h"
+
+#define AFRE_BRICK_LAYOUT_LINEAR 0
+#define AFRE_BRICK_LAYOUT_MORTON 1
+#define AFRE_BRICK_LAYOUT_TILED 2
+
+// No default, a build that guessed could order the voxels differently from the shader.
+#ifndef AFRE_BRICK_LAYOUT
+#error "AFRE_BRICK_LAYOUT isn't defined, rerun premake to generate brick_config.h"
+#endif
+
+#ifdef __cplusplus
+#include <cstdint>
+#define AFRE_LAYOUT_FN inline constexpr
+#define AFRE_LAYOUT_UINT uint32_t
+namespace afre
+{
+#else
+#define AFRE_LAYOUT_FN
+#define AFRE_LAYOUT_UINT uint
+#endif
+
+	// The ...OfSize versions take log2 of the brick's edge, for bricks of another size than the configured one.
+
+	// Rows of x, then y, then z, the same order as a [size][size][size] array.
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT GetLinearBrickVoxelIndexOfSize(AFRE_LAYOUT_UINT x, AFRE_LAYOUT_UINT y, AFRE_LAYOUT_UINT z, AFRE_LAYOUT_UINT sizeBits)
+	{
+		return (z << (sizeBits * 2)) | (y << sizeBits) | x;
+	}
+
+	// Moves the low bits of v, up to 5 of them, to bits 0, 3, 6, 9 and 12.
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT SpreadBrickCoordBits(AFRE_LAYOUT_UINT v, AFRE_LAYOUT_UINT bitCount)
+	{
+		v &= (1u << bitCount) - 1u;
+		v = (v | (v << 8)) & 0x100Fu;
+		v = (v | (v << 4)) & 0x10C3u;
+		v = (v | (v << 2)) & 0x1249u;
+		return v;
+	}
+
+	// Z-order curve, neighbours on every axis are close in memory. The same for every size up to 32 voxels, a smaller
+	// brick is the start of a bigger one's curve.
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT GetMortonBrickVoxelIndexOfSize(AFRE_LAYOUT_UINT x, AFRE_LAYOUT_UINT y, AFRE_LAYOUT_UINT z, AFRE_LAYOUT_UINT sizeBits)
+	{
+		return SpreadBrickCoordBits(x, sizeBits) | (SpreadBrickCoordBits(y, sizeBits) << 1) | (SpreadBrickCoordBits(z, sizeBits) << 2);
+	}
+
+	// 4x4x4 tiles of 64 voxels, tiles and the voxels in them are both linear.
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT GetTiledBrickVoxelIndexOfSize(AFRE_LAYOUT_UINT x, AFRE_LAYOUT_UINT y, AFRE_LAYOUT_UINT z, AFRE_LAYOUT_UINT sizeBits)
+	{
+		const AFRE_LAYOUT_UINT tileBits = sizeBits - 2u;
+		const AFRE_LAYOUT_UINT tile = ((z >> 2) << (tileBits * 2)) | ((y >> 2) << tileBits) | (x >> 2);
+		return (tile << 6) | ((z & 3u) << 4) | ((y & 3u) << 2) | (x & 3u);
+	}
+
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT GetBrickVoxelIndexOfSize(AFRE_LAYOUT_UINT x, AFRE_LAYOUT_UINT y, AFRE_LAYOUT_UINT z, AFRE_LAYOUT_UINT sizeBits)
+	{
+#if AFRE_BRICK_LAYOUT == AFRE_BRICK_LAYOUT_MORTON
+		return GetMortonBrickVoxelIndexOfSize(x, y, z, sizeBits);
+#elif AFRE_BRICK_LAYOUT == AFRE_BRICK_LAYOUT_TILED
+		return GetTiledBrickVoxelIndexOfSize(x, y, z, sizeBits);
+#else
+		return GetLinearBrickVoxelIndexOfSize(x, y, z, sizeBits);
+#endif
+	}
+
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT GetLinearBrickVoxelIndex(AFRE_LAYOUT_UINT x, AFRE_LAYOUT_UINT y, AFRE_LAYOUT_UINT z)
+	{
+		return GetLinearBrickVoxelIndexOfSize(x, y, z, AFRE_BRICK_SIZE_BITS);
+	}
+
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT GetMortonBrickVoxelIndex(AFRE_LAYOUT_UINT x, AFRE_LAYOUT_UINT y, AFRE_LAYOUT_UINT z)
+	{
+		return GetMortonBrickVoxelIndexOfSize(x, y, z, AFRE_BRICK_SIZE_BITS);
+	}
+
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT GetTiledBrickVoxelIndex(AFRE_LAYOUT_UINT x, AFRE_LAYOUT_UINT y, AFRE_LAYOUT_UINT z)
+	{
+		return GetTiledBrickVoxelIndexOfSize(x, y, z, AFRE_BRICK_SIZE_BITS);
+	}
+
+	AFRE_LAYOUT_FN AFRE_LAYOUT_UINT GetBrickVoxelIndex(AFRE_LAYOUT_UINT x, AFRE_LAYOUT_UINT y, AFRE_LAYOUT_UINT z)
+	{
+		return GetBrickVoxelIndexOfSize(x, y, z, AFRE_BRICK_SIZE_BITS);
+	}
+
+#ifdef __cplusplus
+}
+#endif
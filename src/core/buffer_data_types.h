@@ -1,17 +1,47 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include "brick_layout.h"
 
 namespace afre
 {
-	struct CameraData
+	// Edge and voxel type are parameters so tools and benchmarks can keep bricks of other configurations next to the
+	// engine's Brick, whose size premake's --brick-size picks.
+	template<glm::uint32_t Size, typename Voxel>
+	struct BasicBrick
 	{
-		glm::mat4 m_CTWMat{};
+		static_assert(Size == 8 || Size == 16 || Size == 32, "Bricks are 8, 16 or 32 voxels along an edge");
+
+		using VoxelType = Voxel;
+
+		static constexpr glm::uint32_t kSize = Size;
+		static constexpr glm::uint32_t kSizeBits = Size == 8 ? 3 : (Size == 16 ? 4 : 5);
+		static constexpr glm::uint32_t kVoxelCount = Size * Size * Size;
+		// Between neighbouring voxels along y and z in the linear layout, x is 1.
+		static constexpr glm::uint32_t kStrideY = Size;
+		static constexpr glm::uint32_t kStrideZ = Size * Size;
+
+		// Ordered by GetBrickVoxelIndex, which depends on AFRE_BRICK_LAYOUT, so index through At.
+		Voxel m_voxels[kVoxelCount]{};
+
+		inline Voxel& At(const glm::uvec3& position) { return m_voxels[GetBrickVoxelIndexOfSize(position.x, position.y, position.z, kSizeBits)]; }
+		inline Voxel At(const glm::uvec3& position) const { return m_voxels[GetBrickVoxelIndexOfSize(position.x, position.y, position.z, kSizeBits)]; }
 	};
 
-	struct Brick
+	// Materials are 16 bit, so the engine's voxels are too whatever the size.
+	using Brick = BasicBrick<AFRE_BRICK_SIZE, glm::uint16_t>;
+
+	constexpr glm::uint16_t kBrickSize = Brick::kSize;
+	constexpr glm::uint32_t kBrickSizeBits = Brick::kSizeBits;
+	constexpr glm::uint32_t kBrickVoxelCount = Brick::kVoxelCount;
+
+	static_assert(kBrickSizeBits == AFRE_BRICK_SIZE_BITS && kBrickVoxelCount == AFRE_BRICK_VOXEL_COUNT, "brick_config.h doesn't match the Brick");
+
+	struct CameraData
 	{
-		glm::uint16_t m_voxels[16][16][16]{};
+		glm::mat4 m_CTWMat{};
+		glm::vec2 m_viewportSize{};
+		glm::uint32_t m_padding[2]{};
 	};
 
 	struct VoxelData
@@ -21,4 +51,152 @@ namespace afre
 
 		bool SetVoxelData();
 	};
+
+	// Set in a brick table entry when the whole brick is one voxel value, kept in the low 16 bits instead of a pool slot.
+	constexpr glm::uint32_t kUniformBrickBit = 1u << 31;
+	// Set in a brick table entry when the brick has no pool slot right now. The low 16 bits hold the brick's dominant
+	// voxel, which the shader draws it as until it has one, the bits above the unique brick it asks for through
+	// BrickFeedbackData.
+	constexpr glm::uint32_t kNonResidentBrickBit = 1u << 30;
+
+	constexpr glm::uint32_t kVisibleBrickMaskWords = AFRE_WORLD_BRICK_MASK_WORDS;
+
+	static_assert(AFRE_WORLD_BRICK_COUNT == 3 * 3 * 3 && kVisibleBrickMaskWords == (AFRE_WORLD_BRICK_COUNT + 31) / 32, "brick_config.h doesn't match the world");
+	static_assert(AFRE_WORLD_BRICK_COUNT <= (kNonResidentBrickBit >> 16), "Non resident table entries have no room for the unique brick");
+
+	// The most brick memory the world takes on the GPU, however many unique bricks it has. The pool buffer is only
+	// as large as the slots BrickResidency currently hands out.
+	constexpr glm::uint32_t kBrickPoolSlots = AFRE_BRICK_POOL_SLOTS;
+	constexpr glm::uint32_t kBrickPoolMaskWords = AFRE_BRICK_POOL_MASK_WORDS;
+
+	static_assert(kBrickPoolMaskWords == (kBrickPoolSlots + 31) / 32, "brick_config.h's pool masks don't match its slots");
+
+	// What the shader gets instead of VoxelData: a brick table into the brick pool buffer of resident bricks,
+	// where identical bricks share a slot.
+	struct PackedVoxelData
+	{
+		glm::uint32_t m_brickTable[3][3][3]{};
+		glm::uint32_t m_bricksPerDim{};
+		// Slots BrickResidency currently hands out, the rest of the pool is unused.
+		glm::uint32_t m_poolCapacity{};
+		// Bit per brick table entry, rewritten every frame by the CPU culling. Cleared bricks are crossed like empty ones.
+		glm::uint32_t m_visibleBricks[kVisibleBrickMaskWords]{};
+		// Bit per brick table entry, set for bricks the mesh pass draws. The march crosses them like empty ones.
+		glm::uint32_t m_rasterBricks[kVisibleBrickMaskWords]{};
+	};
+
+	// Requests past this many in a frame are dropped, the shader asks again next frame.
+	constexpr glm::uint32_t kMaxBrickRequests = 256;
+
+	// Written by the shader, read and cleared by the CPU after the frame's fence.
+	struct BrickFeedbackData
+	{
+		glm::uint32_t m_requestCount = 0;
+		// Bit per pool slot the march read a voxel from.
+		glm::uint32_t m_usedSlots[kBrickPoolMaskWords]{};
+		// Bit per unique brick already in m_requests, so each is written once.
+		glm::uint32_t m_requestedBricks[kVisibleBrickMaskWords]{};
+		// Unique bricks the march crossed without a pool slot.
+		glm::uint32_t m_requests[kMaxBrickRequests]{};
+	};
+
+	constexpr glm::uint32_t kMaxVoxelInstances = 1024;
+	// Bricks of every instanced model together, each model is uploaded once however many instances use it.
+	constexpr glm::uint32_t kMaxModelBricks = 256;
+
+	// Leaves have m_count > 0 and their instances from m_leftOrFirst, inner nodes their children at m_leftOrFirst and m_leftOrFirst + 1.
+	struct BvhNode
+	{
+		glm::vec3 m_min{};
+		glm::uint32_t m_leftOrFirst = 0;
+		glm::vec3 m_max{};
+		glm::uint32_t m_count = 0;
+	};
+
+	struct GpuVoxelInstance
+	{
+		glm::mat4 m_worldToModel{};
+		glm::uvec3 m_sizeInBricks{};
+		glm::uint32_t m_firstBrick = 0;
+	};
+
+	// Instances are stored in the order the BVH leaves refer to them.
+	struct VoxelInstanceData
+	{
+		glm::uint32_t m_instanceCount = 0;
+		glm::uint32_t m_nodeCount = 0;
+		glm::uint32_t m_padding[2]{};
+		GpuVoxelInstance m_instances[kMaxVoxelInstances]{};
+		BvhNode m_nodes[kMaxVoxelInstances * 2]{};
+		Brick m_modelBricks[kMaxModelBricks]{};
+	};
+
+	// Enough for the near bands of the 3x3x3 world, bricks that don't fit anymore stay with the ray march.
+	constexpr glm::uint32_t kMaxMeshQuads = 65536;
+
+	// A BrickQuad moved to world voxels. m_packed holds the voxel in the low 16 bits, then the face in 3 bits,
+	// then width - 1 and height - 1 in kBrickSizeBits each.
+	struct GpuMeshQuad
+	{
+		glm::ivec3 m_min{};
+		glm::uint32_t m_packed = 0;
+	};
+
+	struct MeshQuadData
+	{
+		glm::uint32_t m_quadCount = 0;
+		glm::uint32_t m_padding[3]{};
+		GpuMeshQuad m_quads[kMaxMeshQuads]{};
+	};
+
+	// Traversal counters the instrumented shader (AFRE_RAY_STATS) writes for every pixel.
+	struct RayStats
+	{
+		glm::uint32_t m_steps = 0;
+		glm::uint32_t m_voxelLoads = 0;
+		glm::uint32_t m_brickTransitions = 0;
+	};
+
+	// Matches the resolution FragMain assumes.
+	constexpr glm::uint32_t kRayStatsWidth = 600;
+	constexpr glm::uint32_t kRayStatsHeight = 600;
+
+	struct RayStatsData
+	{
+		// Written by the CPU. Non zero replaces the shaded image with a heatmap of the steps per ray.
+		glm::uint32_t m_heatmap = 0;
+		// Step count drawn at the hot end of the heatmap.
+		glm::uint32_t m_heatmapMaxSteps = 0;
+		glm::uint32_t m_padding[2]{};
+		RayStats m_pixels[kRayStatsWidth * kRayStatsHeight]{};
+	};
+
+	// Sky light in the high nibble, block light in the low one.
+	struct BrickLight
+	{
+		glm::uint8_t m_light[kBrickSize][kBrickSize][kBrickSize]{};
+	};
+
+	struct LightData
+	{
+		BrickLight m_bricks[3][3][3]{};
+	};
+
+	// One entry per possible voxel value, so the shader indexes the table with the voxel directly.
+	constexpr glm::uint32_t kMaxMaterials = 65536;
+
+	enum MaterialFlags
+	{
+		// Rays stop at the voxel instead of being tinted by it.
+		MATERIAL_OPAQUE = 1 << 0,
+		// Light propagates through the voxel, e.g. glass, water or leaves.
+		MATERIAL_TRANSPARENT = 1 << 1
+	};
+
+	struct MaterialData
+	{
+		glm::vec4 m_albedo{};
+		glm::vec3 m_emissive{};
+		glm::uint32_t m_flags = 0;
+	};
 }
\ No newline at end of file
@@ -13,16 +13,19 @@ namespace afre
 		{
 			static glm::vec3 oldCamOrigin{};
 			static glm::vec3 oldCamTarget{};
+			static glm::uvec2 oldViewportSize{};
 
-			if (camera->m_camOrigin != oldCamOrigin || camera->m_camTarget != oldCamTarget)
+			if (camera->m_camOrigin != oldCamOrigin || camera->m_camTarget != oldCamTarget || camera->m_viewportSize != oldViewportSize)
 			{
 				oldCamOrigin = camera->m_camOrigin;
 				oldCamTarget = camera->m_camTarget;
+				oldViewportSize = camera->m_viewportSize;
 
 				CameraData buf{};
 
 				camera->m_CTWMat = glm::inverse(glm::lookAt(camera->m_camOrigin, camera->m_camTarget, camera->m_camUp));
 				buf.m_CTWMat = camera->m_CTWMat;
+				buf.m_viewportSize = glm::vec2(camera->m_viewportSize);
 
 				m_data = buf;
 				m_shouldCopy = true;
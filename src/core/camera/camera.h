@@ -18,6 +18,16 @@ namespace afre
 
 		glm::mat4 m_CTWMat{};
 
+		// Pixels of the image the rays go through, set once the swapchain exists.
+		glm::uvec2 m_viewportSize{ 1, 1 };
+
+		// Vertical, in degrees. FragMain assumes it, the CPU culling has to match. The horizontal angle follows the
+		// viewport's aspect ratio.
+		static constexpr float kFov = 90.f;
+		// The camera is latched again right before submit and can turn a bit after the bricks were culled,
+		// culling widens both angles by this much so bricks turning into view are still there.
+		static constexpr float kLateLatchFovMargin = 20.f;
+
 		static void Rotate(float yawIntent, float pitchIntent);
 	};
 }
\ No newline at end of file
@@ -2,14 +2,18 @@
 
 #include <vector>
 #include <functional>
+#include <mutex>
 
 namespace afre
 {
 	class CleanupStack
 	{
 	public:
+		// Safe to call from the startup tasks running in parallel. A task only starts after its dependencies, so
+		// what it creates is still cleaned up before them.
 		inline void PushCleanup(std::function<void()> functionToPush)
 		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
 			m_cleanupStack.push_back(functionToPush);
 		}
 
@@ -17,5 +21,6 @@ namespace afre
 
 	private:
 		std::vector<std::function<void()>> m_cleanupStack{};
+		std::mutex m_mutex{};
 	};
 }
\ No newline at end of file
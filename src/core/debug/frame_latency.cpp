@@ -0,0 +1,68 @@
+#include "frame_latency.h"
+#include <algorithm>
+#include "log.h"
+
+namespace afre
+{
+	static double GetMs(std::chrono::steady_clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	void FrameLatencyTracker::OnLatch(std::chrono::steady_clock::time_point inputTime, std::chrono::steady_clock::time_point latchTime)
+	{
+		m_inputTime = inputTime;
+		m_latchMs = GetMs(latchTime - inputTime);
+		m_latched = true;
+	}
+
+	void FrameLatencyTracker::OnPresent(std::chrono::steady_clock::time_point presentTime)
+	{
+		// Frames without input have nothing to measure.
+		if (!m_latched) return;
+		m_latched = false;
+
+		Sample sample{};
+		sample.m_latchMs = m_latchMs;
+		sample.m_presentMs = GetMs(presentTime - m_inputTime);
+
+		if (m_samples.size() < kFrameLatencyWindow) m_samples.push_back(sample);
+		else m_samples[m_nextSample] = sample;
+		m_nextSample = (m_nextSample + 1) % kFrameLatencyWindow;
+
+		m_frame++;
+		Summarize();
+
+		if (m_logInterval > 0 && m_frame % m_logInterval == 0)
+		{
+			AFRE_INFO("Input latency ({} frames): latch mean {:.2f} ms, present mean {:.2f} ms p95 {:.2f} ms max {:.2f} ms",
+				m_summary.m_sampleCount, m_summary.m_meanLatchMs, m_summary.m_meanPresentMs, m_summary.m_p95PresentMs, m_summary.m_maxPresentMs);
+		}
+	}
+
+	void FrameLatencyTracker::Summarize()
+	{
+		m_summary = {};
+		m_summary.m_frame = m_frame;
+		m_summary.m_sampleCount = static_cast<uint32_t>(m_samples.size());
+		if (m_samples.empty()) return;
+
+		static std::vector<double> presentMs{};
+		presentMs.clear();
+
+		for (const Sample& sample : m_samples)
+		{
+			m_summary.m_meanLatchMs += sample.m_latchMs;
+			m_summary.m_meanPresentMs += sample.m_presentMs;
+			presentMs.push_back(sample.m_presentMs);
+		}
+
+		m_summary.m_meanLatchMs /= m_samples.size();
+		m_summary.m_meanPresentMs /= m_samples.size();
+
+		const size_t p95Index = (presentMs.size() * 95 + 99) / 100 - 1;
+		std::nth_element(presentMs.begin(), presentMs.begin() + p95Index, presentMs.end());
+		m_summary.m_p95PresentMs = presentMs[p95Index];
+		m_summary.m_maxPresentMs = *std::max_element(presentMs.begin(), presentMs.end());
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+namespace afre
+{
+	struct FrameLatencySummary
+	{
+		uint64_t m_frame = 0;
+		// Frames that consumed input, only those are measured.
+		uint32_t m_sampleCount = 0;
+
+		// From the oldest input a frame used to the camera being written for the GPU.
+		double m_meanLatchMs = 0.0;
+		// From the same input to vkQueuePresentKHR returning. Scanout after that isn't seen from here.
+		double m_meanPresentMs = 0.0;
+		double m_p95PresentMs = 0.0;
+		double m_maxPresentMs = 0.0;
+	};
+
+	// Input to present latency over the last kFrameLatencyWindow frames that had input.
+	class FrameLatencyTracker
+	{
+	public:
+		static constexpr uint32_t kFrameLatencyWindow = 240;
+
+		// inputTime is the oldest input the frame latched, from TakeOldestInputTime.
+		void OnLatch(std::chrono::steady_clock::time_point inputTime, std::chrono::steady_clock::time_point latchTime);
+		void OnPresent(std::chrono::steady_clock::time_point presentTime);
+
+		inline const FrameLatencySummary& GetSummary() const { return m_summary; }
+
+		// Logs the summary every that many measured frames, 0 turns logging off.
+		inline void SetLogInterval(uint32_t frames) { m_logInterval = frames; }
+
+	private:
+		struct Sample
+		{
+			double m_latchMs = 0.0;
+			double m_presentMs = 0.0;
+		};
+
+		void Summarize();
+
+		std::chrono::steady_clock::time_point m_inputTime{};
+		double m_latchMs = 0.0;
+		bool m_latched = false;
+
+		std::vector<Sample> m_samples{};
+		uint32_t m_nextSample = 0;
+		uint64_t m_frame = 0;
+
+		FrameLatencySummary m_summary{};
+		uint32_t m_logInterval = 240;
+	};
+}
@@ -0,0 +1,92 @@
+#include "ray_stats.h"
+#include <algorithm>
+#include "log.h"
+
+namespace afre
+{
+	static RayStatsChannel SummarizeChannel(const std::vector<uint32_t>& counts, uint64_t sum, uint32_t max, uint32_t rayCount)
+	{
+		RayStatsChannel channel{};
+		if (rayCount == 0) return channel;
+
+		channel.m_mean = static_cast<float>(static_cast<double>(sum) / rayCount);
+		channel.m_max = max;
+
+		const uint64_t p95Rank = (static_cast<uint64_t>(rayCount) * 95 + 99) / 100;
+		uint64_t seen = 0;
+		for (uint32_t c = 0; c < static_cast<uint32_t>(counts.size()); c++)
+		{
+			seen += counts[c];
+			if (seen >= p95Rank)
+			{
+				channel.m_p95 = c;
+				break;
+			}
+		}
+
+		return channel;
+	}
+
+	void SummarizeRayStats(const RayStats* pixels, uint32_t pixelCount, RayStatsSummary& summary)
+	{
+		static std::vector<uint32_t> stepCounts(kRayStatsMaxTrackedCount + 1);
+		static std::vector<uint32_t> voxelLoadCounts(kRayStatsMaxTrackedCount + 1);
+		static std::vector<uint32_t> brickTransitionCounts(kRayStatsMaxTrackedCount + 1);
+
+		std::fill(stepCounts.begin(), stepCounts.end(), 0);
+		std::fill(voxelLoadCounts.begin(), voxelLoadCounts.end(), 0);
+		std::fill(brickTransitionCounts.begin(), brickTransitionCounts.end(), 0);
+		std::fill(std::begin(summary.m_stepHistogram), std::end(summary.m_stepHistogram), 0);
+
+		uint64_t stepSum = 0, voxelLoadSum = 0, brickTransitionSum = 0;
+		uint32_t stepMax = 0, voxelLoadMax = 0, brickTransitionMax = 0;
+
+		for (uint32_t p = 0; p < pixelCount; p++)
+		{
+			const RayStats& rayStats = pixels[p];
+
+			stepCounts[std::min(rayStats.m_steps, kRayStatsMaxTrackedCount)]++;
+			voxelLoadCounts[std::min(rayStats.m_voxelLoads, kRayStatsMaxTrackedCount)]++;
+			brickTransitionCounts[std::min(rayStats.m_brickTransitions, kRayStatsMaxTrackedCount)]++;
+
+			stepSum += rayStats.m_steps;
+			voxelLoadSum += rayStats.m_voxelLoads;
+			brickTransitionSum += rayStats.m_brickTransitions;
+
+			stepMax = std::max(stepMax, rayStats.m_steps);
+			voxelLoadMax = std::max(voxelLoadMax, rayStats.m_voxelLoads);
+			brickTransitionMax = std::max(brickTransitionMax, rayStats.m_brickTransitions);
+
+			summary.m_stepHistogram[std::min(rayStats.m_steps / kRayStatsStepBucketSize, kRayStatsStepBucketCount - 1)]++;
+		}
+
+		summary.m_rayCount = pixelCount;
+		summary.m_steps = SummarizeChannel(stepCounts, stepSum, stepMax, pixelCount);
+		summary.m_voxelLoads = SummarizeChannel(voxelLoadCounts, voxelLoadSum, voxelLoadMax, pixelCount);
+		summary.m_brickTransitions = SummarizeChannel(brickTransitionCounts, brickTransitionSum, brickTransitionMax, pixelCount);
+	}
+
+	void RayStatsReadback::Update(RayStatsData& rayStatsData)
+	{
+		// The buffer holds whatever the memory had before the first frame was drawn.
+		if (m_frame > 0)
+		{
+			SummarizeRayStats(rayStatsData.m_pixels, kRayStatsWidth * kRayStatsHeight, m_summary);
+			m_summary.m_frame = m_frame;
+
+			if (m_logInterval > 0 && m_frame % m_logInterval == 0)
+			{
+				AFRE_INFO("Ray stats (frame {}): steps mean {:.1f} p95 {} max {}, voxel loads mean {:.1f} p95 {} max {}, brick transitions mean {:.1f} p95 {} max {}",
+					m_frame,
+					m_summary.m_steps.m_mean, m_summary.m_steps.m_p95, m_summary.m_steps.m_max,
+					m_summary.m_voxelLoads.m_mean, m_summary.m_voxelLoads.m_p95, m_summary.m_voxelLoads.m_max,
+					m_summary.m_brickTransitions.m_mean, m_summary.m_brickTransitions.m_p95, m_summary.m_brickTransitions.m_max);
+			}
+		}
+
+		rayStatsData.m_heatmap = m_heatmap ? 1 : 0;
+		rayStatsData.m_heatmapMaxSteps = std::max(m_heatmapMaxSteps, 1u);
+
+		m_frame++;
+	}
+}
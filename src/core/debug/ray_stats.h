@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	// Counts up to this value are exact, higher ones are clamped into the last slot.
+	constexpr uint32_t kRayStatsMaxTrackedCount = 1024;
+
+	constexpr uint32_t kRayStatsStepBucketSize = 8;
+	constexpr uint32_t kRayStatsStepBucketCount = 32;
+
+	struct RayStatsChannel
+	{
+		float m_mean = 0.f;
+		uint32_t m_p95 = 0;
+		uint32_t m_max = 0;
+	};
+
+	struct RayStatsSummary
+	{
+		uint64_t m_frame = 0;
+		uint32_t m_rayCount = 0;
+
+		RayStatsChannel m_steps{};
+		RayStatsChannel m_voxelLoads{};
+		RayStatsChannel m_brickTransitions{};
+
+		// Bucket i counts the rays with i * kRayStatsStepBucketSize steps up to the next bucket, the last one takes everything above.
+		uint32_t m_stepHistogram[kRayStatsStepBucketCount]{};
+	};
+
+	void SummarizeRayStats(const RayStats* pixels, uint32_t pixelCount, RayStatsSummary& summary);
+
+	// Reads back the counters the AFRE_RAY_STATS shader wrote for the last frame.
+	class RayStatsReadback
+	{
+	public:
+		// Call once the GPU is done with the frame. Also writes the heatmap settings for the next one.
+		void Update(RayStatsData& rayStatsData);
+
+		inline const RayStatsSummary& GetSummary() const { return m_summary; }
+
+		inline void SetHeatmapEnabled(bool enabled) { m_heatmap = enabled; }
+		inline bool IsHeatmapEnabled() const { return m_heatmap; }
+		inline void SetHeatmapMaxSteps(uint32_t maxSteps) { m_heatmapMaxSteps = maxSteps; }
+
+		// Logs the summary every that many frames, 0 turns logging off.
+		inline void SetLogInterval(uint32_t frames) { m_logInterval = frames; }
+
+	private:
+		RayStatsSummary m_summary{};
+		uint64_t m_frame = 0;
+
+		bool m_heatmap = false;
+		uint32_t m_heatmapMaxSteps = 128;
+		uint32_t m_logInterval = 120;
+	};
+}
@@ -1,5 +1,12 @@
 #include "descriptor_manager.h"
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include "core/camera/camera.h"
+#include "core/voxel/brick_deduplication.h"
+#include "core/voxel/brick_kernels.h"
 #include "log.h"
+#include "memory_utils.h"
 #include "scene.h"
 
 namespace afre
@@ -28,9 +35,10 @@ namespace afre
 		{
 			VkDescriptorSetLayoutBinding descriptorSetLayoutBinding{};
 			descriptorSetLayoutBinding.binding = i;
-			descriptorSetLayoutBinding.descriptorCount = static_cast<uint32_t>(descriptorManagerCreateInfo.m_bindings[i].m_bufferSizes.size());
+			descriptorSetLayoutBinding.descriptorCount = static_cast<uint32_t>(descriptorManagerCreateInfo.m_bindings[i].m_bufferSizes.size()) + descriptorManagerCreateInfo.m_bindings[i].m_imageCount;
 			descriptorSetLayoutBinding.descriptorType = descriptorManagerCreateInfo.m_bindings[i].m_descriptorType;
-			descriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+			// The mesh pass reads the camera and its quads in the vertex stage.
+			descriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
 			descriptorSetLayoutBindings[i] = descriptorSetLayoutBinding;
 		}
@@ -53,86 +61,40 @@ namespace afre
 			AFRE_CRIT("Descriptor's set layout failed to create!");
 		}
 
+		m_device = device;
+		m_physicalDevice = physicalDevice;
+
 		// Buffer creation
 		for (uint32_t b = 0; b < bindingCount; b++)
 		{
-			for (uint16_t bs = 0; bs < static_cast<uint16_t>(descriptorManagerCreateInfo.m_bindings[b].m_bufferSizes.size()); bs++)
+			const DescriptorBindingInfo& bindingInfo = descriptorManagerCreateInfo.m_bindings[b];
+
+			for (uint16_t bs = 0; bs < static_cast<uint16_t>(bindingInfo.m_bufferSizes.size()); bs++)
 			{
 				DescriptorBuffer descriptorBuffer{};
+				descriptorBuffer.m_binding = b;
+				descriptorBuffer.m_arrayElement = bs;
+				descriptorBuffer.m_descriptorType = bindingInfo.m_descriptorType;
+				descriptorBuffer.m_resizable = bindingInfo.m_resizable;
 
-				VkBufferCreateInfo bufferInfo{};
-				bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-				bufferInfo.sharingMode = VkSharingMode::VK_SHARING_MODE_EXCLUSIVE;
-				bufferInfo.usage = GetBufferUsage(descriptorManagerCreateInfo.m_bindings[b].m_descriptorType);
-				bufferInfo.size = descriptorManagerCreateInfo.m_bindings[b].m_bufferSizes[bs];
-
-				const VkResult bufferResult = vkCreateBuffer(device, &bufferInfo, nullptr, &descriptorBuffer.m_buffer);
-
-				cleanupStack.PushCleanup([=]()
-					{
-						vkDestroyBuffer(device, descriptorBuffer.m_buffer, nullptr);
-					});
+				const bool created = CreateBuffer(bindingInfo.m_bufferSizes[bs], bindingInfo.m_deviceLocal || bindingInfo.m_resizable, descriptorBuffer);
 
-				if (bufferResult == VK_SUCCESS)
+				if (!bindingInfo.m_resizable)
 				{
-					AFRE_INFO(fmt::format("A buffer was created for (binding: {}, buffer: {})!", b, bs));
+					cleanupStack.PushCleanup([=]()
+						{
+							vkDestroyBuffer(device, descriptorBuffer.m_buffer, nullptr);
+							vkFreeMemory(device, descriptorBuffer.m_bufferMemory, nullptr);
+						});
 				}
-				else
-				{
-					AFRE_CRIT(fmt::format("A buffer has failed to create for (binding: {}, buffer: {})!", b, bs));
-				}
-
-				VkMemoryRequirements bufferRequirements{};
-				vkGetBufferMemoryRequirements(device, descriptorBuffer.m_buffer, &bufferRequirements);
 
-				VkMemoryAllocateInfo memoryAllocateInfo{};
-				memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-				memoryAllocateInfo.allocationSize = bufferRequirements.size;
-
-				VkPhysicalDeviceMemoryProperties memoryProperties{};
-				vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
-
-				const VkMemoryPropertyFlags requiredMemoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-				for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+				if (created)
 				{
-					if ((memoryProperties.memoryTypes[i].propertyFlags & requiredMemoryProperties) == requiredMemoryProperties)
-					{
-						memoryAllocateInfo.memoryTypeIndex = i;
-					}
-				}
-
-				const VkResult allocateMemoryResult = vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &descriptorBuffer.m_bufferMemory);
-
-				cleanupStack.PushCleanup([=]()
-					{
-						vkFreeMemory(device, descriptorBuffer.m_bufferMemory, nullptr);
-					});
-
-				if (allocateMemoryResult == VK_SUCCESS)
-				{
-					AFRE_INFO(fmt::format("Successfully allocated memory for (binding: {}, buffer: {})!", b, bs));
-				}
-				else
-				{
-					AFRE_CRIT(fmt::format("Failed to allocate memory for (binding: {}, buffer: {})!", b, bs));
-				}
-
-				if (vkBindBufferMemory(device, descriptorBuffer.m_buffer, descriptorBuffer.m_bufferMemory, 0) == VK_SUCCESS)
-				{
-					AFRE_INFO(fmt::format("Successfully bound buffer memory for (binding: {}, buffer: {})!", b, bs));
+					AFRE_INFO("A buffer was created for (binding: {}, buffer: {})!", b, bs);
 				}
 				else
 				{
-					AFRE_CRIT(fmt::format("Failed to bind buffer memory for (binding: {}, buffer: {})!", b, bs));
-				}
-
-				if (vkMapMemory(device, descriptorBuffer.m_bufferMemory, 0, descriptorManagerCreateInfo.m_bindings[b].m_bufferSizes[bs], 0, &descriptorBuffer.m_mappedBuffer) == VK_SUCCESS)
-				{
-					AFRE_INFO(fmt::format("Mapped buffer memory for (binding: {}, buffer: {})!", b, bs));
-				}
-				else
-				{
-					AFRE_CRIT(fmt::format("Failed to map buffer memory for (binding: {}, buffer: {})!", b, bs));
+					AFRE_CRIT("A buffer has failed to create for (binding: {}, buffer: {})!", b, bs);
 				}
 
 				m_buffers.push_back(descriptorBuffer);
@@ -150,7 +112,7 @@ namespace afre
 		for (uint32_t b = 0; b < bindingCount; b++)
 		{
 			VkDescriptorPoolSize descriptorPoolSize{};
-			descriptorPoolSize.descriptorCount = static_cast<uint32_t>(descriptorManagerCreateInfo.m_bindings[b].m_bufferSizes.size());
+			descriptorPoolSize.descriptorCount = static_cast<uint32_t>(descriptorManagerCreateInfo.m_bindings[b].m_bufferSizes.size()) + descriptorManagerCreateInfo.m_bindings[b].m_imageCount;
 			descriptorPoolSize.type = descriptorManagerCreateInfo.m_bindings[b].m_descriptorType;
 
 			descriptorPoolSizes[b] = descriptorPoolSize;
@@ -195,6 +157,7 @@ namespace afre
 		for (uint32_t b = 0; b < bindingCount; b++)
 		{
 			const uint16_t bufferSizeCount = static_cast<uint16_t>(descriptorManagerCreateInfo.m_bindings[b].m_bufferSizes.size());
+			if (bufferSizeCount == 0) continue;
 
 			std::vector<VkDescriptorBufferInfo> descriptorBufferInfos(bufferSizeCount);
 
@@ -247,20 +210,613 @@ namespace afre
 		success = true;
 	}
 
-	void DescriptorManager::RegisterVoxelDataBufferUpdater(uint16_t bufferIndex)
+	void DescriptorManager::WriteSampledImage(const VkDevice& device, uint32_t binding, VkImageView imageView, VkImageLayout imageLayout)
+	{
+		VkDescriptorImageInfo descriptorImageInfo{};
+		descriptorImageInfo.imageView = imageView;
+		descriptorImageInfo.imageLayout = imageLayout;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = m_descriptorSet;
+		descriptorWrite.dstBinding = binding;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		descriptorWrite.pImageInfo = &descriptorImageInfo;
+
+		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, {});
+	}
+
+	void DescriptorManager::RegisterVoxelDataBufferUpdater(uint16_t bufferIndex, uint16_t brickPoolBufferIndex)
 	{
 		m_bufferUpdaters.push_back([=]()
 		{
-			const auto& voxelDataView = g_scene.m_registry.view<VoxelData>();
+			const bool voxelDataChanged = RepackVoxelData();
+			if (!m_voxelDataPacked) return;
+
+			const glm::vec3 cameraPosition = CullVoxelBricks();
+			UpdateBrickResidency(brickPoolBufferIndex, voxelDataChanged);
+			UpdateRasterBricks(cameraPosition, voxelDataChanged);
+			UploadVoxelData(bufferIndex, brickPoolBufferIndex);
+		});
+	}
+
+	bool DescriptorManager::RepackVoxelData()
+	{
+		const auto& voxelDataView = g_scene.m_registry.view<VoxelData>();
+
+		// The bricks the scene's systems wrote into the VoxelData this frame, already relit.
+		VoxelData* voxelData = &g_scene.m_registry.get<VoxelData>(voxelDataView.front());
+		const bool voxelDataChanged = !g_scene.m_changedBricks.empty();
+		g_scene.m_changedBricks.clear();
+		m_staleBricks.clear();
+		if (!voxelDataChanged) return false;
+
+		BrickDeduplicationStats stats{};
+
+		m_uniqueBricks.resize(AFRE_WORLD_BRICK_COUNT);
+		m_previousUniqueBricks.resize(AFRE_WORLD_BRICK_COUNT);
+		m_dominantVoxels.resize(AFRE_WORLD_BRICK_COUNT);
+
+		const uint32_t previousCount = m_uniqueBrickCount;
+		std::copy(m_uniqueBricks.begin(), m_uniqueBricks.begin() + previousCount, m_previousUniqueBricks.begin());
+
+		m_packedVoxelData.m_bricksPerDim = voxelData->m_bricksPerDim;
+		m_uniqueBrickCount = PackBricks(&voxelData->m_bricks[0][0][0], AFRE_WORLD_BRICK_COUNT, m_uniqueBrickTable, m_uniqueBricks.data(), stats);
+		m_voxelDataPacked = true;
+
+		// Unique bricks are numbered in brick order, a changed brick can shift the ones after it. Every number
+		// keeps its slot and only the slots whose brick now has other contents are copied again.
+		BrickResidency& brickResidency = g_scene.m_brickResidency;
+		brickResidency.Resize(m_uniqueBrickCount);
+		for (uint32_t brick = 0; brick < m_uniqueBrickCount; brick++)
+		{
+			if (brick < previousCount && AreBricksEqual(m_previousUniqueBricks[brick], m_uniqueBricks[brick])) continue;
+
+			m_dominantVoxels[brick] = GetDominantVoxel(m_uniqueBricks[brick]);
+
+			const uint32_t slot = brickResidency.GetSlot(brick);
+			if (slot != BrickResidency::kNoSlot) m_staleBricks.push_back({ brick, slot });
+		}
+
+		return true;
+	}
+
+	glm::vec3 DescriptorManager::CullVoxelBricks()
+	{
+		const uint32_t bricksPerDim = m_packedVoxelData.m_bricksPerDim;
+		const uint32_t brickCount = bricksPerDim * bricksPerDim * bricksPerDim;
+
+		m_cullingGrid.m_sizeInBricks = glm::uvec3(bricksPerDim);
+		m_cullingGrid.m_origin = glm::vec3(-static_cast<float>(((bricksPerDim + 1) / 2 - 1) * kBrickSize));
+		m_cullingGrid.m_occluders.resize(brickCount);
+		for (uint32_t b = 0; b < brickCount; b++)
+		{
+			const glm::uint32_t brickEntry = m_uniqueBrickTable[b];
+			const glm::uint16_t voxel = static_cast<glm::uint16_t>(brickEntry & 0xFFFF);
+
+			m_cullingGrid.m_occluders[b] = (brickEntry & kUniformBrickBit) != 0 && voxel > 0 && (g_scene.m_materialRegistry.GetMaterial(voxel).m_flags & MATERIAL_OPAQUE) != 0;
+		}
+
+		// Culled against the camera the CameraData updater just uploaded.
+		const auto& cameraView = g_scene.m_registry.view<Camera>();
+		const Camera& camera = g_scene.m_registry.get<Camera>(cameraView.front());
+
+		BrickCullingCamera cullingCamera{};
+		cullingCamera.m_cameraToWorld = camera.m_CTWMat;
+		cullingCamera.m_fov = Camera::kFov;
+		cullingCamera.m_aspectRatio = static_cast<float>(camera.m_viewportSize.x) / static_cast<float>(camera.m_viewportSize.y);
+		WidenCullingCamera(cullingCamera, Camera::kLateLatchFovMargin);
+
+		g_scene.m_brickCuller.Cull(cullingCamera, m_cullingGrid, g_scene.m_brickVisibility);
+
+		return glm::vec3(cullingCamera.m_cameraToWorld[3]);
+	}
+
+	void DescriptorManager::UpdateBrickResidency(uint16_t brickPoolBufferIndex, bool voxelDataChanged)
+	{
+		// A new world has nothing resident yet, the bricks the CPU sees are asked for before the shader gets to.
+		BrickResidency& brickResidency = g_scene.m_brickResidency;
+		if (voxelDataChanged)
+		{
+			for (const uint32_t brickIndex : g_scene.m_brickVisibility.m_visibleBricks)
+			{
+				if ((m_uniqueBrickTable[brickIndex] & kUniformBrickBit) == 0) brickResidency.Request(m_uniqueBrickTable[brickIndex]);
+			}
+		}
+
+		BrickResidencyStats residencyStats{};
+		m_brickUploads.clear();
+
+		bool residencyChanged = brickResidency.Update(m_brickUploads, residencyStats);
+
+		// A brick that was evicted or moved by the update is either gone or already copied to its new slot. The same
+		// goes for the copies the staging memory had no room for last frame.
+		for (const std::vector<BrickUpload>* earlierUploads : { &m_staleBricks, &m_pendingBrickUploads })
+		{
+			for (const BrickUpload& brickUpload : *earlierUploads)
+			{
+				if (brickResidency.GetSlot(brickUpload.m_brick) == brickUpload.m_slot) m_brickUploads.push_back(brickUpload);
+			}
+		}
+
+		// The pool buffer only holds the slots handed out. A new one starts out empty, every resident brick goes in again.
+		const VkDeviceSize poolSize = brickResidency.GetCapacity() * sizeof(Brick);
+		if (m_buffers[brickPoolBufferIndex].m_size != poolSize && ResizeBuffer(brickPoolBufferIndex, poolSize))
+		{
+			m_brickUploads.clear();
+			for (uint32_t brick = 0; brick < m_uniqueBrickCount; brick++)
+			{
+				const uint32_t slot = brickResidency.GetSlot(brick);
+				if (slot != BrickResidency::kNoSlot) m_brickUploads.push_back({ brick, slot });
+			}
+
+			residencyChanged = true;
+		}
+
+		// Bricks that were pending until now get their slots back in the table.
+		m_brickTableDirty |= voxelDataChanged || residencyChanged || !m_pendingBrickUploads.empty() || !m_brickUploads.empty();
+		m_pendingBrickUploads.clear();
+
+		if (residencyStats.m_deferredRequests > 0)
+		{
+			AFRE_WARN("Brick pool full, {} bricks wait for a slot!", residencyStats.m_deferredRequests);
+		}
+	}
+
+	void DescriptorManager::FillBrickTable(uint16_t brickPoolBufferIndex)
+	{
+		const BrickResidency& brickResidency = g_scene.m_brickResidency;
+		const uint32_t bricksPerDim = m_packedVoxelData.m_bricksPerDim;
+		const uint32_t brickCount = bricksPerDim * bricksPerDim * bricksPerDim;
+		for (uint32_t b = 0; b < brickCount; b++)
+		{
+			const glm::uint32_t brickEntry = m_uniqueBrickTable[b];
+			glm::uint32_t& gpuBrickEntry = (&m_packedVoxelData.m_brickTable[0][0][0])[b];
+
+			if ((brickEntry & kUniformBrickBit) != 0)
+			{
+				gpuBrickEntry = brickEntry;
+				continue;
+			}
+
+			// Slots past a pool buffer that failed to grow, or whose copy is still pending, read as non resident
+			// until the brick is in.
+			const uint32_t slot = brickResidency.GetSlot(brickEntry);
+			const bool pending = std::any_of(m_pendingBrickUploads.begin(), m_pendingBrickUploads.end(), [&](const BrickUpload& brickUpload) { return brickUpload.m_brick == brickEntry; });
+			const bool resident = slot != BrickResidency::kNoSlot && !pending && (slot + 1) * sizeof(Brick) <= m_buffers[brickPoolBufferIndex].m_size;
+			gpuBrickEntry = resident ? slot : kNonResidentBrickBit | (brickEntry << 16) | m_dominantVoxels[brickEntry];
+		}
+
+		m_packedVoxelData.m_poolCapacity = brickResidency.GetCapacity();
+	}
+
+	void DescriptorManager::UpdateRasterBricks(const glm::vec3& cameraPosition, bool voxelDataChanged)
+	{
+		// Visible bricks in a rasterized band go to the mesh pass once their mesh is ready, the march has them until then.
+		BrickMeshCache& brickMeshCache = g_scene.m_brickMeshCache;
+		// The scene's snapshot is versioned per brick, only the bricks written since the last one are meshed again.
+		if (voxelDataChanged) brickMeshCache.SetSnapshot(g_scene.m_voxelWorldSnapshot);
+		if (g_scene.m_materialRegistry.HasOpacityChanged()) g_scene.m_materialRegistry.ApplyToBrickMeshCache(brickMeshCache);
+
+		const bool meshesFinished = brickMeshCache.TakeFinishedMeshes();
+
+		SelectRasterBricks(g_scene.m_hybridRenderBands, cameraPosition, m_cullingGrid.m_sizeInBricks, m_cullingGrid.m_origin, g_scene.m_brickVisibility.m_visibleBricks, m_bandBricks);
+		brickMeshCache.RequestMeshes(m_bandBricks);
+
+		uint32_t quadCount = 0;
+		m_rasterBricks.clear();
+		for (const uint32_t brickIndex : m_bandBricks)
+		{
+			const BrickMesh* brickMesh = brickMeshCache.GetMesh(brickIndex);
+			if (!brickMesh || brickMesh->m_hasClearVoxels || quadCount + brickMesh->m_quads.size() > kMaxMeshQuads) continue;
+
+			quadCount += static_cast<uint32_t>(brickMesh->m_quads.size());
+			m_rasterBricks.push_back(brickIndex);
+		}
+
+		if (!meshesFinished && m_rasterBricks == g_scene.m_rasterBricks) return;
+
+		g_scene.m_rasterBricks = m_rasterBricks;
+		g_scene.m_meshQuads.clear();
+
+		const uint32_t bricksPerDim = m_packedVoxelData.m_bricksPerDim;
+		for (const uint32_t brickIndex : m_rasterBricks)
+		{
+			const glm::ivec3 brickPosition = glm::ivec3(brickIndex % bricksPerDim, (brickIndex / bricksPerDim) % bricksPerDim, brickIndex / (bricksPerDim * bricksPerDim));
+			const glm::ivec3 brickMin = glm::ivec3(m_cullingGrid.m_origin) + brickPosition * static_cast<int32_t>(kBrickSize);
 
-			VoxelData* voxelData = &g_scene.m_registry.get<VoxelData>(voxelDataView.front());
-			if (voxelData->SetVoxelData())
+			for (const BrickQuad& brickQuad : brickMeshCache.GetMesh(brickIndex)->m_quads) g_scene.m_meshQuads.push_back(ToGpuMeshQuad(brickQuad, brickMin));
+		}
+
+		g_scene.m_meshQuadsChanged = true;
+	}
+
+	void DescriptorManager::UploadVoxelData(uint16_t bufferIndex, uint16_t brickPoolBufferIndex)
+	{
+		const BrickVisibility& visibility = g_scene.m_brickVisibility;
+		m_visibilityDirty |= memcmp(m_packedVoxelData.m_visibleBricks, visibility.m_visibleMask.data(), sizeof(m_packedVoxelData.m_visibleBricks)) != 0;
+		memcpy(m_packedVoxelData.m_visibleBricks, visibility.m_visibleMask.data(), sizeof(m_packedVoxelData.m_visibleBricks));
+
+		// Everything up to the raster mask, which is left to the mesh quad updater.
+		constexpr VkDeviceSize kTableUploadSize = offsetof(PackedVoxelData, m_rasterBricks);
+		const VkBuffer voxelDataBuffer = m_buffers[bufferIndex].m_buffer;
+		const DescriptorBuffer& brickPoolBuffer = m_buffers[brickPoolBufferIndex];
+
+		// A brick copied into a slot the GPU's table still gives another brick would show up in its place, so the
+		// table has to land in the same submit. Room for it is kept while the bricks are copied, the ones past that
+		// wait for next frame and read as non resident until then.
+		const bool tableFits = !m_brickTableDirty || m_uploadQueue->HasStagingFor(kTableUploadSize, 1);
+		for (const BrickUpload& brickUpload : m_brickUploads)
+		{
+			if ((brickUpload.m_slot + 1) * sizeof(Brick) > brickPoolBuffer.m_size) continue;
+
+			const bool uploaded = tableFits && m_uploadQueue->HasStagingFor(sizeof(Brick) + kTableUploadSize, 2) &&
+				m_uploadQueue->QueueBufferUpload(brickPoolBuffer.m_buffer, brickUpload.m_slot * sizeof(Brick), &m_uniqueBricks[brickUpload.m_brick], sizeof(Brick));
+			if (!uploaded) m_pendingBrickUploads.push_back(brickUpload);
+		}
+
+		if (!m_pendingBrickUploads.empty())
+		{
+			AFRE_WARN("Out of staging memory, {} bricks wait for next frame!", m_pendingBrickUploads.size());
+		}
+
+		// Tried again next frame when the staging memory ran out, the table and the mask stay dirty until then.
+		if (m_brickTableDirty && tableFits)
+		{
+			FillBrickTable(brickPoolBufferIndex);
+			if (m_uploadQueue->QueueBufferUpload(voxelDataBuffer, 0, &m_packedVoxelData, kTableUploadSize))
 			{
-				memcpy(m_buffers[bufferIndex].m_mappedBuffer, voxelData, sizeof(VoxelData));
+				m_brickTableDirty = false;
+				m_visibilityDirty = false;
 			}
+		}
+		else if (m_visibilityDirty && !m_brickTableDirty)
+		{
+			m_visibilityDirty = !m_uploadQueue->QueueBufferUpload(voxelDataBuffer, offsetof(PackedVoxelData, m_visibleBricks), m_packedVoxelData.m_visibleBricks, sizeof(m_packedVoxelData.m_visibleBricks));
+		}
+	}
+
+	void DescriptorManager::RegisterLightDataBufferUpdater(uint16_t bufferIndex)
+	{
+		m_bufferUpdaters.push_back([=]()
+		{
+			g_scene.m_lightPropagator.TakeLitBricks(m_litBricks);
+
+			// Only the bricks the propagator touched get copied, the ones the staging memory had no room for next frame.
+			for (const LitBrick& litBrick : m_litBricks)
+			{
+				if (litBrick.m_brickIndex >= AFRE_WORLD_BRICK_COUNT) continue;
+
+				if (!m_uploadQueue->QueueBufferUpload(m_buffers[bufferIndex].m_buffer, litBrick.m_brickIndex * sizeof(BrickLight), &litBrick.m_light, sizeof(BrickLight)))
+				{
+					g_scene.m_lightPropagator.RequeueLitBrick(litBrick);
+				}
+			}
+		});
+	}
+
+	void DescriptorManager::RegisterMaterialTableBufferUpdater(uint16_t bufferIndex)
+	{
+		m_bufferUpdaters.push_back([=]()
+		{
+			MaterialRegistry& materialRegistry = g_scene.m_materialRegistry;
+
+			uint32_t firstMaterial = 0;
+			uint32_t materialCount = 0;
+			if (materialRegistry.TakeDirtyRange(firstMaterial, materialCount))
+			{
+				memcpy(static_cast<MaterialData*>(m_buffers[bufferIndex].m_mappedBuffer) + firstMaterial, &materialRegistry.GetMaterial(static_cast<glm::uint16_t>(firstMaterial)), materialCount * sizeof(MaterialData));
+			}
+
+			// A material that started or stopped letting light through or emitting it relights the world.
+			if (materialRegistry.HasLightingChanged() && g_scene.m_lightPropagator.IsInitialized())
+			{
+				const auto& voxelDataView = g_scene.m_registry.view<VoxelData>();
+				const VoxelData& voxelData = g_scene.m_registry.get<VoxelData>(voxelDataView.front());
+
+				materialRegistry.ApplyToLightPropagator(g_scene.m_lightPropagator);
+				g_scene.m_lightPropagator.Rebuild(&voxelData.m_bricks[0][0][0], glm::uvec3(3));
+			}
+		});
+	}
+
+	void DescriptorManager::RegisterVoxelInstanceBufferUpdater(uint16_t bufferIndex)
+	{
+		m_bufferUpdaters.push_back([=]()
+		{
+			const VkBuffer buffer = m_buffers[bufferIndex].m_buffer;
+			std::vector<VoxelInstance>& voxelInstances = g_scene.m_voxelInstances;
+
+			voxelInstances.clear();
+			m_instanceBounds.clear();
+
+			for (auto& [model, uploadedModel] : m_uploadedModels) uploadedModel.m_used = false;
+
+			g_scene.m_registry.view<VoxelInstance>().each([&](const VoxelInstance& voxelInstance)
+			{
+				if (!voxelInstance.m_model || voxelInstances.size() >= kMaxVoxelInstances) return;
+
+				auto uploadedModel = m_uploadedModels.find(voxelInstance.m_model);
+				if (uploadedModel == m_uploadedModels.end())
+				{
+					const VoxelWorld& model = *voxelInstance.m_model;
+					const glm::uvec3 sizeInBricks = model.GetSizeInBricks();
+
+					const uint32_t firstBrick = m_modelBrickAllocator.Allocate(model.GetBrickCount());
+					if (firstBrick == ModelBrickAllocator::kNoBricks)
+					{
+						AFRE_WARN("Out of model bricks, voxel instance skipped!");
+						return;
+					}
+
+					// Same order as VoxelWorld's brick index, which the shader uses too.
+					bool uploaded = true;
+					for (uint32_t z = 0; z < sizeInBricks.z; z++)
+					{
+						for (uint32_t y = 0; y < sizeInBricks.y; y++)
+						{
+							for (uint32_t x = 0; x < sizeInBricks.x; x++)
+							{
+								const uint32_t brickIndex = firstBrick + (z * sizeInBricks.y + y) * sizeInBricks.x + x;
+								uploaded &= m_uploadQueue->QueueBufferUpload(buffer, offsetof(VoxelInstanceData, m_modelBricks) + brickIndex * sizeof(Brick), &model.GetBrick({ x, y, z }), sizeof(Brick));
+							}
+						}
+					}
+
+					// Tried again next frame when the staging memory ran out.
+					if (!uploaded)
+					{
+						m_modelBrickAllocator.Free(firstBrick, model.GetBrickCount());
+						return;
+					}
+
+					uploadedModel = m_uploadedModels.insert({ voxelInstance.m_model, { firstBrick, model.GetBrickCount() } }).first;
+				}
+
+				uploadedModel->second.m_used = true;
+
+				voxelInstances.push_back(voxelInstance);
+				m_instanceBounds.push_back(GetInstanceBounds(voxelInstance));
+			});
+
+			// The frame that last read them is done, nothing refers to them in this one.
+			for (auto uploadedModel = m_uploadedModels.begin(); uploadedModel != m_uploadedModels.end();)
+			{
+				if (uploadedModel->second.m_used)
+				{
+					uploadedModel++;
+					continue;
+				}
+
+				m_modelBrickAllocator.Free(uploadedModel->second.m_firstBrick, uploadedModel->second.m_brickCount);
+				uploadedModel = m_uploadedModels.erase(uploadedModel);
+			}
+
+			g_scene.m_instanceBvh.Update(m_instanceBounds);
+
+			const std::vector<uint32_t>& instanceIndices = g_scene.m_instanceBvh.GetInstanceIndices();
+			m_gpuInstances.resize(instanceIndices.size());
+			for (uint32_t i = 0; i < static_cast<uint32_t>(instanceIndices.size()); i++)
+			{
+				const VoxelInstance& voxelInstance = voxelInstances[instanceIndices[i]];
+
+				GpuVoxelInstance& gpuVoxelInstance = m_gpuInstances[i];
+				gpuVoxelInstance.m_worldToModel = GetWorldToModel(voxelInstance);
+				gpuVoxelInstance.m_sizeInBricks = voxelInstance.m_model->GetSizeInBricks();
+				gpuVoxelInstance.m_firstBrick = m_uploadedModels[voxelInstance.m_model].m_firstBrick;
+			}
+
+			// The GPU gets the leaves pointing straight at the reordered instances.
+			const uint32_t nodeCount = g_scene.m_instanceBvh.GetNodeCount();
+			m_gpuNodes.assign(g_scene.m_instanceBvh.GetNodes().begin(), g_scene.m_instanceBvh.GetNodes().begin() + nodeCount);
+
+			const bool instancesChanged = m_gpuInstances.size() != m_uploadedInstances.size() || memcmp(m_gpuInstances.data(), m_uploadedInstances.data(), m_gpuInstances.size() * sizeof(GpuVoxelInstance)) != 0;
+			const bool nodesChanged = m_gpuNodes.size() != m_uploadedNodes.size() || memcmp(m_gpuNodes.data(), m_uploadedNodes.data(), m_gpuNodes.size() * sizeof(BvhNode)) != 0;
+			if (m_instancesUploaded && !instancesChanged && !nodesChanged) return;
+
+			// The counts go in front of the instances, one copy.
+			const glm::uint32_t counts[4] = { static_cast<glm::uint32_t>(m_gpuInstances.size()), nodeCount, 0, 0 };
+			static_assert(sizeof(counts) == offsetof(VoxelInstanceData, m_instances), "The counts have to fill the space in front of the instances");
+
+			m_instanceUpload.resize(sizeof(counts) + m_gpuInstances.size() * sizeof(GpuVoxelInstance));
+			memcpy(m_instanceUpload.data(), counts, sizeof(counts));
+			memcpy(m_instanceUpload.data() + sizeof(counts), m_gpuInstances.data(), m_gpuInstances.size() * sizeof(GpuVoxelInstance));
+
+			bool uploaded = m_uploadQueue->QueueBufferUpload(buffer, 0, m_instanceUpload.data(), m_instanceUpload.size());
+			if (nodeCount > 0)
+			{
+				uploaded &= m_uploadQueue->QueueBufferUpload(buffer, offsetof(VoxelInstanceData, m_nodes), m_gpuNodes.data(), nodeCount * sizeof(BvhNode));
+			}
+
+			// Tried again next frame when the staging memory ran out.
+			m_instancesUploaded = uploaded;
+			m_uploadedInstances = m_gpuInstances;
+			m_uploadedNodes = m_gpuNodes;
 		});
 	}
 
+	void DescriptorManager::RegisterMeshQuadBufferUpdater(uint16_t bufferIndex, uint16_t voxelDataBufferIndex)
+	{
+		m_bufferUpdaters.push_back([=]()
+		{
+			if (!g_scene.m_meshQuadsChanged) return;
+
+			const VkBuffer buffer = m_buffers[bufferIndex].m_buffer;
+			const std::vector<GpuMeshQuad>& meshQuads = g_scene.m_meshQuads;
+			const glm::uint32_t quadCount = static_cast<glm::uint32_t>(meshQuads.size());
+
+			// The march skips the bricks in the raster mask, a brick in it without its quads would vanish. Both land in
+			// the same submit or neither does, until then the last ones stay in place.
+			glm::uint32_t rasterMask[kVisibleBrickMaskWords]{};
+			for (const uint32_t brickIndex : g_scene.m_rasterBricks) rasterMask[brickIndex >> 5] |= 1u << (brickIndex & 31);
+
+			if (!m_uploadQueue->HasStagingFor(sizeof(quadCount) + quadCount * sizeof(GpuMeshQuad) + sizeof(rasterMask), 3)) return;
+
+			// Each upload only goes out if the one before it did, a failed one leaves the count and the mask as they
+			// were and the whole set is retried next frame.
+			const bool uploaded =
+				m_uploadQueue->QueueBufferUpload(buffer, offsetof(MeshQuadData, m_quads), meshQuads.data(), quadCount * sizeof(GpuMeshQuad)) &&
+				m_uploadQueue->QueueBufferUpload(m_buffers[voxelDataBufferIndex].m_buffer, offsetof(PackedVoxelData, m_rasterBricks), rasterMask, sizeof(rasterMask)) &&
+				m_uploadQueue->QueueBufferUpload(buffer, offsetof(MeshQuadData, m_quadCount), &quadCount, sizeof(quadCount));
+			if (!uploaded) return;
+
+			g_scene.m_meshQuadsChanged = false;
+			g_scene.m_uploadedMeshQuadCount = quadCount;
+		});
+	}
+
+	void DescriptorManager::RegisterBrickFeedbackBufferUpdater(uint16_t bufferIndex)
+	{
+		m_bufferUpdaters.push_back([=]()
+		{
+			// Updaters run after the fence wait, so the GPU is done writing last frame's feedback.
+			BrickFeedbackData& brickFeedback = *static_cast<BrickFeedbackData*>(m_buffers[bufferIndex].m_mappedBuffer);
+			BrickResidency& brickResidency = g_scene.m_brickResidency;
+
+			brickResidency.MarkSlotsUsed(brickFeedback.m_usedSlots);
+
+			const uint32_t requestCount = std::min(brickFeedback.m_requestCount, kMaxBrickRequests);
+			for (uint32_t r = 0; r < requestCount; r++) brickResidency.Request(brickFeedback.m_requests[r]);
+
+			// The requests themselves don't need clearing, nothing past the count is read.
+			brickFeedback.m_requestCount = 0;
+			memset(brickFeedback.m_usedSlots, 0, sizeof(brickFeedback.m_usedSlots));
+			memset(brickFeedback.m_requestedBricks, 0, sizeof(brickFeedback.m_requestedBricks));
+		});
+	}
+
+	#ifdef AFRE_RAY_STATS
+		void DescriptorManager::RegisterRayStatsBufferUpdater(uint16_t bufferIndex)
+		{
+			m_bufferUpdaters.push_back([=]()
+			{
+				// Updaters run after the fence wait, so the GPU is done writing last frame's counters.
+				g_scene.m_rayStats.Update(*static_cast<RayStatsData*>(m_buffers[bufferIndex].m_mappedBuffer));
+			});
+		}
+	#endif
+
+	bool DescriptorManager::ResizeBuffer(uint16_t bufferIndex, VkDeviceSize size)
+	{
+		DescriptorBuffer& descriptorBuffer = m_buffers[bufferIndex];
+		if (!descriptorBuffer.m_resizable) return false;
+		if (descriptorBuffer.m_size == size) return true;
+
+		DescriptorBuffer resizedBuffer{};
+		resizedBuffer.m_binding = descriptorBuffer.m_binding;
+		resizedBuffer.m_arrayElement = descriptorBuffer.m_arrayElement;
+		resizedBuffer.m_descriptorType = descriptorBuffer.m_descriptorType;
+		resizedBuffer.m_resizable = true;
+
+		if (!CreateBuffer(size, true, resizedBuffer))
+		{
+			vkDestroyBuffer(m_device, resizedBuffer.m_buffer, nullptr);
+			vkFreeMemory(m_device, resizedBuffer.m_bufferMemory, nullptr);
+
+			AFRE_ERROR("Failed to resize buffer {} to {} bytes!", bufferIndex, size);
+			return false;
+		}
+
+		// The handle can come back for another buffer, its ownership must not carry over.
+		if (m_uploadQueue) m_uploadQueue->ForgetBuffer(descriptorBuffer.m_buffer);
+
+		vkDestroyBuffer(m_device, descriptorBuffer.m_buffer, nullptr);
+		vkFreeMemory(m_device, descriptorBuffer.m_bufferMemory, nullptr);
+		descriptorBuffer = resizedBuffer;
+
+		VkDescriptorBufferInfo descriptorBufferInfo{};
+		descriptorBufferInfo.buffer = descriptorBuffer.m_buffer;
+		descriptorBufferInfo.offset = 0;
+		descriptorBufferInfo.range = size;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = m_descriptorSet;
+		descriptorWrite.dstBinding = descriptorBuffer.m_binding;
+		descriptorWrite.dstArrayElement = descriptorBuffer.m_arrayElement;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.descriptorType = descriptorBuffer.m_descriptorType;
+		descriptorWrite.pBufferInfo = &descriptorBufferInfo;
+
+		vkUpdateDescriptorSets(m_device, 1, &descriptorWrite, 0, {});
+
+		return true;
+	}
+
+	void DescriptorManager::DestroyResizableBuffers()
+	{
+		for (DescriptorBuffer& descriptorBuffer : m_buffers)
+		{
+			if (!descriptorBuffer.m_resizable) continue;
+
+			vkDestroyBuffer(m_device, descriptorBuffer.m_buffer, nullptr);
+			vkFreeMemory(m_device, descriptorBuffer.m_bufferMemory, nullptr);
+
+			descriptorBuffer.m_buffer = VK_NULL_HANDLE;
+			descriptorBuffer.m_bufferMemory = VK_NULL_HANDLE;
+		}
+	}
+
+	bool DescriptorManager::CreateBuffer(VkDeviceSize size, bool deviceLocal, DescriptorBuffer& descriptorBuffer)
+	{
+		descriptorBuffer.m_size = size;
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.sharingMode = VkSharingMode::VK_SHARING_MODE_EXCLUSIVE;
+		bufferInfo.usage = GetBufferUsage(descriptorBuffer.m_descriptorType);
+		if (deviceLocal) bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.size = size;
+
+		if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &descriptorBuffer.m_buffer) != VK_SUCCESS)
+		{
+			AFRE_CRIT("Failed to create a buffer of {} bytes!", size);
+			return false;
+		}
+
+		VkMemoryRequirements bufferRequirements{};
+		vkGetBufferMemoryRequirements(m_device, descriptorBuffer.m_buffer, &bufferRequirements);
+
+		VkMemoryAllocateInfo memoryAllocateInfo{};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = bufferRequirements.size;
+
+		const VkMemoryPropertyFlags requiredMemoryProperties = deviceLocal
+			? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			: VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		if (!FindMemoryTypeIndex(m_physicalDevice, bufferRequirements.memoryTypeBits, requiredMemoryProperties, memoryAllocateInfo.memoryTypeIndex))
+		{
+			AFRE_CRIT("No suitable memory type for a buffer of {} bytes!", size);
+			return false;
+		}
+
+		if (vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &descriptorBuffer.m_bufferMemory) != VK_SUCCESS)
+		{
+			AFRE_CRIT("Failed to allocate memory for a buffer of {} bytes!", size);
+			return false;
+		}
+
+		if (vkBindBufferMemory(m_device, descriptorBuffer.m_buffer, descriptorBuffer.m_bufferMemory, 0) != VK_SUCCESS)
+		{
+			AFRE_CRIT("Failed to bind buffer memory for a buffer of {} bytes!", size);
+			return false;
+		}
+
+		// Device local buffers are only written through the UploadQueue.
+		if (deviceLocal) return true;
+
+		if (vkMapMemory(m_device, descriptorBuffer.m_bufferMemory, 0, size, 0, &descriptorBuffer.m_mappedBuffer) != VK_SUCCESS)
+		{
+			AFRE_CRIT("Failed to map memory for a buffer of {} bytes!", size);
+			return false;
+		}
+
+		return true;
+	}
+
 	VkBufferUsageFlagBits DescriptorManager::GetBufferUsage(VkDescriptorType descriptorType)
 	{
 		switch (descriptorType)
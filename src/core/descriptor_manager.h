@@ -1,8 +1,14 @@
 #pragma once
 
 #include <vulkan/vulkan_core.h>
+#include <unordered_map>
 #include "cleanup_stack.h"
+#include "upload_queue.h"
 #include "buffer_data_types.h"
+#include "core/voxel/brick_culling.h"
+#include "core/voxel/brick_residency.h"
+#include "core/voxel/light_propagation.h"
+#include "core/voxel/voxel_instance.h"
 
 namespace afre
 {
@@ -10,6 +16,13 @@ namespace afre
 	{
 		VkDescriptorType m_descriptorType{};
 		std::vector<VkDeviceSize> m_bufferSizes{};
+		// Not mapped, filled through the UploadQueue instead of memcpy.
+		bool m_deviceLocal = false;
+		// Image bindings have no buffers, their views are written with WriteSampledImage once the images exist.
+		uint32_t m_imageCount = 0;
+		// Device local only. Replaced by ResizeBuffer at runtime, so DestroyResizableBuffers cleans them up
+		// instead of the CleanupStack.
+		bool m_resizable = false;
 	};
 
 	struct DescriptorManagerCreateInfo
@@ -23,6 +36,13 @@ namespace afre
 		VkBuffer m_buffer{};
 		VkDeviceMemory m_bufferMemory{};
 		void* m_mappedBuffer{};
+
+		VkDeviceSize m_size = 0;
+		// Where the descriptor points at it, for ResizeBuffer.
+		uint32_t m_binding = 0;
+		uint32_t m_arrayElement = 0;
+		VkDescriptorType m_descriptorType{};
+		bool m_resizable = false;
 	};
 
 	template<typename T>
@@ -53,25 +73,123 @@ namespace afre
 		std::vector<DescriptorBuffer> m_buffers{};
 
 		std::vector<std::function<void()>> m_bufferUpdaters;
+		// Run again right before the frame is submitted, for mapped buffers that should hold the latest input.
+		std::vector<std::function<void()>> m_lateBufferUpdaters;
+
+		// Used by the updaters of device local buffers.
+		UploadQueue* m_uploadQueue = nullptr;
 
 		template<typename T>
 		void RegisterBufferUpdater(uint16_t bufferIndex)
 		{
-			m_bufferUpdaters.push_back([=]()
+			m_bufferUpdaters.push_back(GetMappedBufferUpdater<T>(bufferIndex));
+		}
+
+		// Only for mapped buffers, the GPU reads them when it runs the frame, not when it was recorded.
+		template<typename T>
+		void RegisterLateBufferUpdater(uint16_t bufferIndex)
+		{
+			m_lateBufferUpdaters.push_back(GetMappedBufferUpdater<T>(bufferIndex));
+		}
+
+		// Replaces a resizable buffer with one of the new size and points the descriptor at it, the contents are
+		// lost. Only between the frame fence and recording, when nothing uses the old buffer anymore.
+		bool ResizeBuffer(uint16_t bufferIndex, VkDeviceSize size);
+		void DestroyResizableBuffers();
+
+		// Sampled without a sampler, through Load in the shader.
+		void WriteSampledImage(const VkDevice& device, uint32_t binding, VkImageView imageView, VkImageLayout imageLayout);
+
+		// Exclusive buffer updater registers
+		void RegisterVoxelDataBufferUpdater(uint16_t bufferIndex, uint16_t brickPoolBufferIndex);
+		void RegisterLightDataBufferUpdater(uint16_t bufferIndex);
+		void RegisterMaterialTableBufferUpdater(uint16_t bufferIndex);
+		void RegisterVoxelInstanceBufferUpdater(uint16_t bufferIndex);
+		// Also owns the voxel data's raster mask, which has to name exactly the bricks whose quads are in the buffer.
+		void RegisterMeshQuadBufferUpdater(uint16_t bufferIndex, uint16_t voxelDataBufferIndex);
+		// Has to run before the voxel data updater, which hands out the slots the feedback asked for.
+		void RegisterBrickFeedbackBufferUpdater(uint16_t bufferIndex);
+
+		#ifdef AFRE_RAY_STATS
+			void RegisterRayStatsBufferUpdater(uint16_t bufferIndex);
+		#endif
+
+	private:
+		template<typename T>
+		std::function<void()> GetMappedBufferUpdater(uint16_t bufferIndex)
+		{
+			return [=]()
 			{
 				const BufferData<T> bufferData{};
 				if (bufferData.m_shouldCopy)
 				{
 					memcpy(m_buffers[bufferIndex].m_mappedBuffer, &bufferData.m_data, sizeof(T));
 				}
-			});
+			};
 		}
 
-		// Exclusive buffer updater registers
-		void RegisterVoxelDataBufferUpdater(uint16_t bufferIndex);
+		// The voxel data updater's steps, in the order it runs them. Repacking returns whether the scene changed any
+		// bricks, culling the position of the camera it culled from.
+		bool RepackVoxelData();
+		glm::vec3 CullVoxelBricks();
+		void UpdateBrickResidency(uint16_t brickPoolBufferIndex, bool voxelDataChanged);
+		void UpdateRasterBricks(const glm::vec3& cameraPosition, bool voxelDataChanged);
+		void UploadVoxelData(uint16_t bufferIndex, uint16_t brickPoolBufferIndex);
+		// Points the GPU's brick table at the slots of the resident bricks whose copy went out.
+		void FillBrickTable(uint16_t brickPoolBufferIndex);
 
-	private:
 		VkBufferUsageFlagBits GetBufferUsage(VkDescriptorType descriptorType);
+		bool CreateBuffer(VkDeviceSize size, bool deviceLocal, DescriptorBuffer& descriptorBuffer);
+
+		VkDevice m_device{};
+		VkPhysicalDevice m_physicalDevice{};
+
+		PackedVoxelData m_packedVoxelData{};
+		bool m_voxelDataPacked = false;
+		// Changed since the GPU got them, uploaded again until the staging memory has room.
+		bool m_brickTableDirty = false;
+		bool m_visibilityDirty = false;
+		// What PackBricks leaves: the table into the unique bricks, which BrickResidency pages into the GPU pool.
+		glm::uint32_t m_uniqueBrickTable[AFRE_WORLD_BRICK_COUNT]{};
+		std::vector<Brick> m_uniqueBricks{};
+		uint32_t m_uniqueBrickCount = 0;
+		// The unique bricks before the last repack, to tell which resident ones got new contents.
+		std::vector<Brick> m_previousUniqueBricks{};
+		// Per unique brick, what the table gives the shader to draw while the brick has no slot.
+		std::vector<glm::uint16_t> m_dominantVoxels{};
+		// Resident bricks whose slot holds old contents since the repack.
+		std::vector<BrickUpload> m_staleBricks{};
+		// Pool slots to copy a unique brick into this frame, and the copies the staging memory had no room for.
+		std::vector<BrickUpload> m_brickUploads{};
+		std::vector<BrickUpload> m_pendingBrickUploads{};
+		BrickCullingGrid m_cullingGrid{};
+		// The visible bricks in a rasterized band, and the ones of them whose meshes the mesh pass draws.
+		std::vector<uint32_t> m_bandBricks{};
+		std::vector<uint32_t> m_rasterBricks{};
+
+		struct UploadedModel
+		{
+			uint32_t m_firstBrick = 0;
+			uint32_t m_brickCount = 0;
+			// Whether an instance pointed at it this frame, the bricks are freed once none does.
+			bool m_used = false;
+		};
+
+		// Held so a freed model's address isn't mistaken for an uploaded one.
+		std::unordered_map<std::shared_ptr<const VoxelWorld>, UploadedModel> m_uploadedModels{};
+		ModelBrickAllocator m_modelBrickAllocator{ kMaxModelBricks };
+		// What the GPU holds, the instance updater uploads nothing while the new frame's data is the same.
+		std::vector<GpuVoxelInstance> m_uploadedInstances{};
+		std::vector<BvhNode> m_uploadedNodes{};
+		bool m_instancesUploaded = false;
+		// Built again every frame, kept only to reuse their memory.
+		std::vector<Aabb> m_instanceBounds{};
+		std::vector<GpuVoxelInstance> m_gpuInstances{};
+		std::vector<BvhNode> m_gpuNodes{};
+		std::vector<glm::uint8_t> m_instanceUpload{};
+
+		// Taken from the light propagator every frame, the ones that fail to upload go back to it.
+		std::vector<LitBrick> m_litBricks{};
 
 		VkDescriptorSetLayout m_descriptorSetLayout;
 		VkDescriptorPool m_descriptorPool{};
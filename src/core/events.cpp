@@ -1,13 +1,36 @@
 #include "events.h"
 
 namespace afre {
+	static std::chrono::steady_clock::time_point s_oldestInputTime{};
+	static bool s_hasInput = false;
+
+	static void RecordInputTime()
+	{
+		if (s_hasInput) return;
+
+		s_oldestInputTime = std::chrono::steady_clock::now();
+		s_hasInput = true;
+	}
+
 	void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 	{
+		RecordInputTime();
 		OnKey((Keys)key, (KeyActions)action);
 	}
 
 	void CursorPositionCallback(GLFWwindow* window, double xPos, double yPos)
 	{
+		RecordInputTime();
 		OnCursorMove(xPos, yPos);
 	}
+
+	bool TakeOldestInputTime(std::chrono::steady_clock::time_point& time)
+	{
+		if (!s_hasInput) return false;
+
+		time = s_oldestInputTime;
+		s_hasInput = false;
+
+		return true;
+	}
 }
\ No newline at end of file
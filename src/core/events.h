@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 struct GLFWwindow;
 
 namespace afre {
@@ -31,4 +33,8 @@ namespace afre {
 	// Define this in your application to get a call with X and Y intent.
 	void OnCursorMove(double xPos, double yPos);
 	void CursorPositionCallback(GLFWwindow* window, double xPos, double yPos);
+
+	// When the oldest key or cursor event since the last call came in, false if there was none. What the
+	// input to present latency is measured from.
+	bool TakeOldestInputTime(std::chrono::steady_clock::time_point& time);
 }
\ No newline at end of file
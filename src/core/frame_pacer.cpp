@@ -0,0 +1,51 @@
+#include "frame_pacer.h"
+#include <algorithm>
+#include <thread>
+
+namespace afre
+{
+	void FramePacer::SetTargetFrameMs(double targetFrameMs)
+	{
+		m_targetFrameMs = std::max(targetFrameMs, 0.0);
+		m_started = false;
+	}
+
+	void FramePacer::WaitForFrameStart()
+	{
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		if (m_targetFrameMs <= 0.0 || !m_started)
+		{
+			m_intervalStart = now;
+			m_frameStart = now;
+			m_started = true;
+			return;
+		}
+
+		const std::chrono::steady_clock::duration interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(m_targetFrameMs));
+
+		// A frame that ran over skips the intervals it missed instead of trying to catch up.
+		std::chrono::steady_clock::time_point intervalEnd = m_intervalStart + interval;
+		while (intervalEnd <= now) intervalEnd += interval;
+
+		const std::chrono::steady_clock::time_point startAt = intervalEnd - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(m_predictedWorkMs + kSafetyMarginMs));
+		if (startAt > now)
+		{
+			// Sleeps wake late by up to a scheduler tick, the last stretch is spent yielding.
+			const std::chrono::steady_clock::time_point sleepUntil = startAt - std::chrono::milliseconds(2);
+			if (sleepUntil > now) std::this_thread::sleep_until(sleepUntil);
+
+			while (std::chrono::steady_clock::now() < startAt) std::this_thread::yield();
+		}
+
+		m_intervalStart = intervalEnd;
+		m_frameStart = std::chrono::steady_clock::now();
+	}
+
+	void FramePacer::OnFramePresented()
+	{
+		const double workMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_frameStart).count();
+
+		m_predictedWorkMs = workMs > m_predictedWorkMs ? workMs : m_predictedWorkMs * 0.95 + workMs * 0.05;
+	}
+}
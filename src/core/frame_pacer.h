@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+
+namespace afre
+{
+	// Delays the start of each frame so it finishes right as the next interval begins, instead of rendering
+	// early and waiting with stale input. Only needed for present modes that don't block, FIFO paces itself.
+	class FramePacer
+	{
+	public:
+		// 0 runs frames back to back.
+		void SetTargetFrameMs(double targetFrameMs);
+
+		// Sleeps until the predicted work of the next frame just fits before its interval ends. Sample input after it.
+		void WaitForFrameStart();
+		// Call once the frame was handed to present, its duration predicts the next one.
+		void OnFramePresented();
+
+		inline double GetTargetFrameMs() const { return m_targetFrameMs; }
+		inline double GetPredictedWorkMs() const { return m_predictedWorkMs; }
+
+	private:
+		// Kept free in front of the interval, for the prediction being short and the sleep waking late.
+		static constexpr double kSafetyMarginMs = 1.0;
+
+		double m_targetFrameMs = 0.0;
+		// Smoothed, rises at once on a slower frame and falls slowly after.
+		double m_predictedWorkMs = 0.0;
+
+		std::chrono::steady_clock::time_point m_intervalStart{};
+		std::chrono::steady_clock::time_point m_frameStart{};
+		bool m_started = false;
+	};
+}
@@ -0,0 +1,23 @@
+#include "memory_utils.h"
+
+namespace afre
+{
+	bool FindMemoryTypeIndex(const VkPhysicalDevice& physicalDevice, uint32_t memoryTypeBits, VkMemoryPropertyFlags properties, uint32_t& memoryTypeIndex)
+	{
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if ((memoryTypeBits & (1u << i)) == 0) continue;
+
+			if ((memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			{
+				memoryTypeIndex = i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
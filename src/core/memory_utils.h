@@ -0,0 +1,9 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+namespace afre
+{
+	// First memory type allowed by memoryTypeBits that has all the requested properties.
+	bool FindMemoryTypeIndex(const VkPhysicalDevice& physicalDevice, uint32_t memoryTypeBits, VkMemoryPropertyFlags properties, uint32_t& memoryTypeIndex);
+}
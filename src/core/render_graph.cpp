@@ -0,0 +1,463 @@
+#include "render_graph.h"
+#include <algorithm>
+#include "log.h"
+#include "memory_utils.h"
+
+namespace afre
+{
+	struct RenderImageUsageInfo
+	{
+		VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags m_stages = 0;
+		VkAccessFlags m_access = 0;
+		VkImageUsageFlags m_imageUsage = 0;
+		bool m_write = false;
+	};
+
+	static const RenderImageUsageInfo s_usageInfos[RENDER_IMAGE_USAGE_COUNT] = {
+		{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true },
+		{ VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true },
+		{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, false },
+		{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, false },
+		{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_STORAGE_BIT, false },
+		{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT, true }
+	};
+
+	// Only writes have to be made available, reads in a source access mask do nothing.
+	static constexpr VkAccessFlags kWriteAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	RenderResourceId RenderGraph::CreateTransientImage(const std::string& name, const TransientImageInfo& info)
+	{
+		Resource resource{};
+		resource.m_name = name;
+		resource.m_transient = true;
+		resource.m_transientInfo = info;
+		m_resources.push_back(resource);
+
+		return static_cast<RenderResourceId>(m_resources.size() - 1);
+	}
+
+	RenderResourceId RenderGraph::ImportImage(const std::string& name, const ImportedImageInfo& info)
+	{
+		Resource resource{};
+		resource.m_name = name;
+		resource.m_importedInfo = info;
+		m_resources.push_back(resource);
+
+		return static_cast<RenderResourceId>(m_resources.size() - 1);
+	}
+
+	void RenderGraph::SetImportedImage(RenderResourceId resource, VkImage image, VkImageView imageView)
+	{
+		m_resources[resource].m_image = image;
+		m_resources[resource].m_imageView = imageView;
+	}
+
+	RenderPassId RenderGraph::AddPass(const std::string& name, const RecordFunction& record)
+	{
+		Pass pass{};
+		pass.m_name = name;
+		pass.m_record = record;
+		m_passes.push_back(pass);
+
+		return static_cast<RenderPassId>(m_passes.size() - 1);
+	}
+
+	void RenderGraph::UseImage(RenderPassId pass, RenderResourceId resource, RenderImageUsage usage)
+	{
+		for (const ImageUse& use : m_passes[pass].m_uses)
+		{
+			if (use.m_resource == resource)
+			{
+				AFRE_ERROR("Render pass {} uses {} twice, only the first use counts!", m_passes[pass].m_name, m_resources[resource].m_name);
+				return;
+			}
+		}
+
+		m_passes[pass].m_uses.push_back({ resource, usage });
+	}
+
+	void RenderGraph::SetPassSideEffects(RenderPassId pass)
+	{
+		m_passes[pass].m_sideEffects = true;
+	}
+
+	bool RenderGraph::Compile(VkDevice device, VkPhysicalDevice physicalDevice)
+	{
+		m_stats = RenderGraphStats{};
+		m_stats.m_passCount = static_cast<uint32_t>(m_passes.size());
+
+		CullPasses();
+
+		for (uint32_t p = 0; p < static_cast<uint32_t>(m_passes.size()); p++)
+		{
+			if (m_passes[p].m_culled)
+			{
+				m_stats.m_culledPassCount++;
+				continue;
+			}
+
+			for (const ImageUse& use : m_passes[p].m_uses)
+			{
+				Resource& resource = m_resources[use.m_resource];
+				if (resource.m_firstPass == kNoPass) resource.m_firstPass = p;
+				resource.m_lastPass = p;
+				resource.m_usage |= s_usageInfos[use.m_usage].m_imageUsage;
+			}
+		}
+
+		std::vector<ResourceState> states(m_resources.size());
+		for (uint32_t r = 0; r < static_cast<uint32_t>(m_resources.size()); r++)
+		{
+			if (m_resources[r].m_transient) continue;
+
+			states[r].m_layout = m_resources[r].m_importedInfo.m_initialLayout;
+			states[r].m_readStages = m_resources[r].m_importedInfo.m_initialStage;
+		}
+
+		if (!CreateTransientImages(device, physicalDevice, states)) return false;
+
+		PlanBarriers(states);
+
+		AFRE_INFO("Compiled the render graph: {} passes ({} culled), {} barrier batches with {} image barriers, {:.1f} MB of transient images in {:.1f} MB of memory!",
+			m_stats.m_passCount, m_stats.m_culledPassCount, m_stats.m_barrierBatchCount, m_stats.m_imageBarrierCount,
+			static_cast<double>(m_stats.m_transientImageBytes) / (1024.0 * 1024.0), static_cast<double>(m_stats.m_transientMemoryBytes) / (1024.0 * 1024.0));
+
+		return true;
+	}
+
+	void RenderGraph::Execute(VkCommandBuffer commandBuffer)
+	{
+		for (const Pass& pass : m_passes)
+		{
+			if (pass.m_culled) continue;
+
+			RecordBarriers(commandBuffer, pass.m_barriers);
+			pass.m_record(commandBuffer);
+		}
+
+		RecordBarriers(commandBuffer, m_finalBarriers);
+	}
+
+	void RenderGraph::Destroy(VkDevice device)
+	{
+		for (Resource& resource : m_resources)
+		{
+			if (!resource.m_transient) continue;
+
+			if (resource.m_imageView != VK_NULL_HANDLE) vkDestroyImageView(device, resource.m_imageView, nullptr);
+			if (resource.m_image != VK_NULL_HANDLE) vkDestroyImage(device, resource.m_image, nullptr);
+
+			resource.m_imageView = VK_NULL_HANDLE;
+			resource.m_image = VK_NULL_HANDLE;
+		}
+
+		for (VkDeviceMemory memory : m_memoryBlocks) vkFreeMemory(device, memory, nullptr);
+		m_memoryBlocks.clear();
+	}
+
+	void RenderGraph::CullPasses()
+	{
+		// Backwards from the outputs: a pass is needed when it writes something needed, then so is everything it reads.
+		std::vector<bool> needed(m_resources.size(), false);
+		for (uint32_t r = 0; r < static_cast<uint32_t>(m_resources.size()); r++)
+		{
+			needed[r] = !m_resources[r].m_transient && m_resources[r].m_importedInfo.m_output;
+		}
+
+		for (uint32_t p = static_cast<uint32_t>(m_passes.size()); p > 0; p--)
+		{
+			Pass& pass = m_passes[p - 1];
+
+			pass.m_culled = !pass.m_sideEffects;
+			for (const ImageUse& use : pass.m_uses)
+			{
+				if (s_usageInfos[use.m_usage].m_write && needed[use.m_resource]) pass.m_culled = false;
+			}
+
+			if (pass.m_culled) continue;
+
+			for (const ImageUse& use : pass.m_uses)
+			{
+				if (!s_usageInfos[use.m_usage].m_write) needed[use.m_resource] = true;
+			}
+		}
+	}
+
+	bool RenderGraph::CreateTransientImages(VkDevice device, VkPhysicalDevice physicalDevice, std::vector<ResourceState>& states)
+	{
+		std::vector<RenderResourceId> transients{};
+		for (uint32_t r = 0; r < static_cast<uint32_t>(m_resources.size()); r++)
+		{
+			if (m_resources[r].m_transient && m_resources[r].m_firstPass != kNoPass) transients.push_back(r);
+		}
+
+		std::stable_sort(transients.begin(), transients.end(), [&](RenderResourceId a, RenderResourceId b) { return m_resources[a].m_firstPass < m_resources[b].m_firstPass; });
+
+		// Images share a block when the passes using one all come after those using the other.
+		struct MemoryBlock
+		{
+			uint32_t m_lastPass = 0;
+			uint32_t m_memoryTypeBits = 0;
+			VkDeviceSize m_size = 0;
+			std::vector<RenderResourceId> m_resources{};
+		};
+
+		std::vector<MemoryBlock> blocks{};
+		for (RenderResourceId r : transients)
+		{
+			Resource& resource = m_resources[r];
+
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = resource.m_transientInfo.m_format;
+			imageInfo.extent = { resource.m_transientInfo.m_extent.width, resource.m_transientInfo.m_extent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = resource.m_usage;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			if (vkCreateImage(device, &imageInfo, nullptr, &resource.m_image) != VK_SUCCESS)
+			{
+				AFRE_CRIT("Failed to create the transient image {}!", resource.m_name);
+				return false;
+			}
+
+			VkMemoryRequirements requirements{};
+			vkGetImageMemoryRequirements(device, resource.m_image, &requirements);
+			m_stats.m_transientImageBytes += requirements.size;
+
+			MemoryBlock* block = nullptr;
+			for (MemoryBlock& candidate : blocks)
+			{
+				if (candidate.m_lastPass < resource.m_firstPass && (candidate.m_memoryTypeBits & requirements.memoryTypeBits) != 0)
+				{
+					block = &candidate;
+					break;
+				}
+			}
+
+			if (!block)
+			{
+				blocks.push_back({ 0, requirements.memoryTypeBits, 0, {} });
+				block = &blocks.back();
+			}
+
+			// Every image in a block starts at offset 0, so the block's alignment is whatever each image needs.
+			block->m_lastPass = resource.m_lastPass;
+			block->m_memoryTypeBits &= requirements.memoryTypeBits;
+			block->m_size = std::max(block->m_size, requirements.size);
+			block->m_resources.push_back(r);
+		}
+
+		for (const MemoryBlock& block : blocks)
+		{
+			VkMemoryAllocateInfo memoryAllocateInfo{};
+			memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			memoryAllocateInfo.allocationSize = block.m_size;
+
+			if (!FindMemoryTypeIndex(physicalDevice, block.m_memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryAllocateInfo.memoryTypeIndex))
+			{
+				AFRE_CRIT("No suitable memory type for the transient images!");
+				return false;
+			}
+
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &memory) != VK_SUCCESS)
+			{
+				AFRE_CRIT("Failed to allocate {:.1f} MB for transient images!", static_cast<double>(block.m_size) / (1024.0 * 1024.0));
+				return false;
+			}
+
+			m_memoryBlocks.push_back(memory);
+			m_stats.m_transientMemoryBytes += block.m_size;
+
+			// Whatever last used the block, this frame or the last, has to be done with it before anything starts over it.
+			// The contents never survive, so only execution has to be ordered, plus the writes for the sake of aliasing.
+			VkPipelineStageFlags lastWriteStages = 0;
+			VkAccessFlags lastWriteAccess = 0;
+			VkPipelineStageFlags lastReadStages = 0;
+			for (RenderResourceId r : block.m_resources)
+			{
+				for (const ImageUse& use : m_passes[m_resources[r].m_lastPass].m_uses)
+				{
+					if (use.m_resource != r) continue;
+
+					const RenderImageUsageInfo& info = s_usageInfos[use.m_usage];
+					if (info.m_write)
+					{
+						lastWriteStages |= info.m_stages;
+						lastWriteAccess |= info.m_access & kWriteAccessMask;
+					}
+					else lastReadStages |= info.m_stages;
+				}
+			}
+
+			for (RenderResourceId r : block.m_resources)
+			{
+				Resource& resource = m_resources[r];
+
+				if (vkBindImageMemory(device, resource.m_image, memory, 0) != VK_SUCCESS)
+				{
+					AFRE_CRIT("Failed to bind the transient image {}!", resource.m_name);
+					return false;
+				}
+
+				VkImageViewCreateInfo imageViewInfo{};
+				imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+				imageViewInfo.image = resource.m_image;
+				imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				imageViewInfo.format = resource.m_transientInfo.m_format;
+				imageViewInfo.subresourceRange.aspectMask = resource.m_transientInfo.m_aspect;
+				imageViewInfo.subresourceRange.levelCount = 1;
+				imageViewInfo.subresourceRange.layerCount = 1;
+
+				if (vkCreateImageView(device, &imageViewInfo, nullptr, &resource.m_imageView) != VK_SUCCESS)
+				{
+					AFRE_CRIT("Failed to create the transient image view {}!", resource.m_name);
+					return false;
+				}
+
+				states[r].m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				states[r].m_writeStages = lastWriteStages;
+				states[r].m_writeAccess = lastWriteAccess;
+				states[r].m_readStages = lastReadStages;
+			}
+		}
+
+		return true;
+	}
+
+	void RenderGraph::PlanBarriers(std::vector<ResourceState>& states)
+	{
+		m_plannedBarriers.clear();
+
+		for (Pass& pass : m_passes)
+		{
+			pass.m_barriers = BarrierBatch{};
+			if (pass.m_culled) continue;
+
+			pass.m_barriers.m_firstBarrier = static_cast<uint32_t>(m_plannedBarriers.size());
+			for (const ImageUse& use : pass.m_uses)
+			{
+				const RenderImageUsageInfo& info = s_usageInfos[use.m_usage];
+				ResourceState& state = states[use.m_resource];
+
+				AddBarrier(pass.m_barriers, use.m_resource, state, info.m_layout, info.m_stages, info.m_access);
+
+				if (info.m_write)
+				{
+					state.m_writeStages = info.m_stages;
+					state.m_writeAccess = info.m_access & kWriteAccessMask;
+					state.m_readStages = 0;
+					state.m_visibleStages = 0;
+					state.m_visibleAccess = 0;
+				}
+				else state.m_readStages |= info.m_stages;
+			}
+			pass.m_barriers.m_barrierCount = static_cast<uint32_t>(m_plannedBarriers.size()) - pass.m_barriers.m_firstBarrier;
+
+			if (!pass.m_barriers.IsEmpty()) m_stats.m_barrierBatchCount++;
+		}
+
+		m_finalBarriers = BarrierBatch{};
+		m_finalBarriers.m_firstBarrier = static_cast<uint32_t>(m_plannedBarriers.size());
+		for (uint32_t r = 0; r < static_cast<uint32_t>(m_resources.size()); r++)
+		{
+			const ImportedImageInfo& info = m_resources[r].m_importedInfo;
+			if (m_resources[r].m_transient || info.m_finalLayout == VK_IMAGE_LAYOUT_UNDEFINED) continue;
+
+			AddBarrier(m_finalBarriers, r, states[r], info.m_finalLayout, info.m_finalStage, info.m_finalAccess);
+		}
+		m_finalBarriers.m_barrierCount = static_cast<uint32_t>(m_plannedBarriers.size()) - m_finalBarriers.m_firstBarrier;
+
+		if (!m_finalBarriers.IsEmpty()) m_stats.m_barrierBatchCount++;
+		m_stats.m_imageBarrierCount = static_cast<uint32_t>(m_plannedBarriers.size());
+	}
+
+	void RenderGraph::AddBarrier(BarrierBatch& batch, RenderResourceId resource, ResourceState& state, VkImageLayout layout, VkPipelineStageFlags stages, VkAccessFlags access)
+	{
+		const bool write = (access & kWriteAccessMask) != 0;
+		const bool transition = state.m_layout != layout;
+
+		VkPipelineStageFlags srcStages = 0;
+		VkAccessFlags srcAccess = 0;
+		bool imageBarrier = transition;
+
+		if (write || transition)
+		{
+			// Waits for everything since the last write too, a write after reads only has to order execution.
+			srcStages = state.m_writeStages | state.m_readStages;
+			srcAccess = state.m_writeAccess;
+			imageBarrier = imageBarrier || srcAccess != 0;
+		}
+		else if (state.m_writeStages != 0 && ((stages & ~state.m_visibleStages) != 0 || (access & ~state.m_visibleAccess) != 0))
+		{
+			// A read of a write it hasn't seen yet. Reads after reads need nothing.
+			srcStages = state.m_writeStages;
+			srcAccess = state.m_writeAccess;
+			imageBarrier = true;
+		}
+
+		if (imageBarrier)
+		{
+			PlannedBarrier barrier{};
+			barrier.m_resource = resource;
+			barrier.m_oldLayout = state.m_layout;
+			barrier.m_newLayout = layout;
+			barrier.m_srcAccess = srcAccess;
+			barrier.m_dstAccess = access;
+			m_plannedBarriers.push_back(barrier);
+		}
+
+		if (imageBarrier || srcStages != 0)
+		{
+			batch.m_srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			batch.m_dstStages |= stages;
+		}
+
+		if (imageBarrier && !write)
+		{
+			state.m_visibleStages |= stages;
+			state.m_visibleAccess |= access;
+		}
+
+		// A transition writes the image, later reads in other stages have to come after it like after any write.
+		if (transition && !write) state.m_writeStages |= stages;
+
+		state.m_layout = layout;
+	}
+
+	void RenderGraph::RecordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch)
+	{
+		if (batch.IsEmpty()) return;
+
+		m_imageBarriers.resize(batch.m_barrierCount);
+		for (uint32_t i = 0; i < batch.m_barrierCount; i++)
+		{
+			const PlannedBarrier& planned = m_plannedBarriers[batch.m_firstBarrier + i];
+			const Resource& resource = m_resources[planned.m_resource];
+
+			VkImageMemoryBarrier& imageBarrier = m_imageBarriers[i];
+			imageBarrier = VkImageMemoryBarrier{};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = resource.m_image;
+			imageBarrier.subresourceRange.aspectMask = resource.m_transient ? resource.m_transientInfo.m_aspect : resource.m_importedInfo.m_aspect;
+			imageBarrier.subresourceRange.levelCount = 1;
+			imageBarrier.subresourceRange.layerCount = 1;
+			imageBarrier.oldLayout = planned.m_oldLayout;
+			imageBarrier.newLayout = planned.m_newLayout;
+			imageBarrier.srcAccessMask = planned.m_srcAccess;
+			imageBarrier.dstAccessMask = planned.m_dstAccess;
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, batch.m_srcStages, batch.m_dstStages, 0, 0, nullptr, 0, nullptr, batch.m_barrierCount, m_imageBarriers.data());
+	}
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace afre
+{
+	// How a pass uses an image. Each one is a single layout, stage and access, the ones marked write also write it.
+	enum RenderImageUsage
+	{
+		// Write.
+		RENDER_IMAGE_COLOR_ATTACHMENT = 0,
+		// Write, tested and written.
+		RENDER_IMAGE_DEPTH_ATTACHMENT = 1,
+		RENDER_IMAGE_FRAGMENT_SAMPLED = 2,
+		RENDER_IMAGE_COMPUTE_SAMPLED = 3,
+		RENDER_IMAGE_COMPUTE_STORAGE_READ = 4,
+		// Write.
+		RENDER_IMAGE_COMPUTE_STORAGE_WRITE = 5,
+		RENDER_IMAGE_USAGE_COUNT = 6
+	};
+
+	using RenderResourceId = uint32_t;
+	using RenderPassId = uint32_t;
+
+	// Created by the graph and only valid during the frame, the contents are lost between frames.
+	struct TransientImageInfo
+	{
+		VkFormat m_format = VK_FORMAT_UNDEFINED;
+		VkExtent2D m_extent{};
+		VkImageAspectFlags m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	};
+
+	// An image the graph doesn't own, like the swapchain's. Says where it is before the frame and where it has to be after.
+	struct ImportedImageInfo
+	{
+		VkImageAspectFlags m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+
+		VkImageLayout m_initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// The stage whatever used it before waits at, like the acquire semaphore's wait stage.
+		VkPipelineStageFlags m_initialStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+		// Undefined leaves it as the last pass did.
+		VkImageLayout m_finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags m_finalStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		VkAccessFlags m_finalAccess = 0;
+
+		// What the frame is for. Passes that lead to no output and have no side effects are culled.
+		bool m_output = false;
+	};
+
+	struct RenderGraphStats
+	{
+		uint32_t m_passCount = 0;
+		uint32_t m_culledPassCount = 0;
+		// One vkCmdPipelineBarrier each.
+		uint32_t m_barrierBatchCount = 0;
+		uint32_t m_imageBarrierCount = 0;
+
+		VkDeviceSize m_transientMemoryBytes = 0;
+		// What the transient images would take without aliasing.
+		VkDeviceSize m_transientImageBytes = 0;
+	};
+
+	// A frame as passes that declare which images they use and how. Compile culls the passes nothing needs, works out
+	// the layout transitions and the fewest, narrowest barriers between passes and places transient images whose
+	// passes don't overlap in the same memory. Built once, executed every frame.
+	class RenderGraph
+	{
+	public:
+		using RecordFunction = std::function<void(VkCommandBuffer commandBuffer)>;
+
+		RenderResourceId CreateTransientImage(const std::string& name, const TransientImageInfo& info);
+		RenderResourceId ImportImage(const std::string& name, const ImportedImageInfo& info);
+		// Imported images can change every frame, like the acquired swapchain image.
+		void SetImportedImage(RenderResourceId resource, VkImage image, VkImageView imageView);
+
+		// Passes run in the order they're added.
+		RenderPassId AddPass(const std::string& name, const RecordFunction& record);
+		// One use per image per pass.
+		void UseImage(RenderPassId pass, RenderResourceId resource, RenderImageUsage usage);
+		// Never culled, for passes that write things the graph doesn't track.
+		void SetPassSideEffects(RenderPassId pass);
+
+		bool Compile(VkDevice device, VkPhysicalDevice physicalDevice);
+		void Execute(VkCommandBuffer commandBuffer);
+		void Destroy(VkDevice device);
+
+		inline VkImage GetImage(RenderResourceId resource) const { return m_resources[resource].m_image; }
+		inline VkImageView GetImageView(RenderResourceId resource) const { return m_resources[resource].m_imageView; }
+		inline const RenderGraphStats& GetStats() const { return m_stats; }
+
+	private:
+		static constexpr uint32_t kNoPass = 0xFFFFFFFFu;
+
+		struct ImageUse
+		{
+			RenderResourceId m_resource = 0;
+			RenderImageUsage m_usage = RENDER_IMAGE_COLOR_ATTACHMENT;
+		};
+
+		struct PlannedBarrier
+		{
+			RenderResourceId m_resource = 0;
+			VkImageLayout m_oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImageLayout m_newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkAccessFlags m_srcAccess = 0;
+			VkAccessFlags m_dstAccess = 0;
+		};
+
+		// The barriers recorded together before a pass. Stages only with no barriers is an execution dependency.
+		struct BarrierBatch
+		{
+			VkPipelineStageFlags m_srcStages = 0;
+			VkPipelineStageFlags m_dstStages = 0;
+			uint32_t m_firstBarrier = 0;
+			uint32_t m_barrierCount = 0;
+
+			inline bool IsEmpty() const { return m_dstStages == 0; }
+		};
+
+		struct Pass
+		{
+			std::string m_name{};
+			RecordFunction m_record{};
+			std::vector<ImageUse> m_uses{};
+			bool m_sideEffects = false;
+			bool m_culled = false;
+			BarrierBatch m_barriers{};
+		};
+
+		struct Resource
+		{
+			std::string m_name{};
+			bool m_transient = false;
+			TransientImageInfo m_transientInfo{};
+			ImportedImageInfo m_importedInfo{};
+
+			VkImage m_image = VK_NULL_HANDLE;
+			VkImageView m_imageView = VK_NULL_HANDLE;
+
+			// Over the passes that weren't culled.
+			uint32_t m_firstPass = kNoPass;
+			uint32_t m_lastPass = kNoPass;
+			VkImageUsageFlags m_usage = 0;
+		};
+
+		// What the passes so far left an image in, while the barriers are planned.
+		struct ResourceState
+		{
+			VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags m_writeStages = 0;
+			VkAccessFlags m_writeAccess = 0;
+			// Stages that read it since the last write, a write has to wait for them.
+			VkPipelineStageFlags m_readStages = 0;
+			// Stages and accesses the last write was already made visible to.
+			VkPipelineStageFlags m_visibleStages = 0;
+			VkAccessFlags m_visibleAccess = 0;
+		};
+
+		void CullPasses();
+		bool CreateTransientImages(VkDevice device, VkPhysicalDevice physicalDevice, std::vector<ResourceState>& states);
+		void PlanBarriers(std::vector<ResourceState>& states);
+		void AddBarrier(BarrierBatch& batch, RenderResourceId resource, ResourceState& state, VkImageLayout layout, VkPipelineStageFlags stages, VkAccessFlags access);
+		void RecordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+
+		std::vector<Pass> m_passes{};
+		std::vector<Resource> m_resources{};
+
+		std::vector<PlannedBarrier> m_plannedBarriers{};
+		// Into the final layouts of imported images, after the last pass.
+		BarrierBatch m_finalBarriers{};
+
+		std::vector<VkDeviceMemory> m_memoryBlocks{};
+		std::vector<VkImageMemoryBarrier> m_imageBarriers{};
+
+		RenderGraphStats m_stats{};
+	};
+}
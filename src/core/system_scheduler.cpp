@@ -0,0 +1,264 @@
+#include "system_scheduler.h"
+#include "log.h"
+#include <algorithm>
+
+namespace afre
+{
+	static double GetElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	static bool Intersects(const std::vector<entt::id_type>& a, const std::vector<entt::id_type>& b)
+	{
+		// Systems declare a handful of types, a sort or a set would cost more than it saves.
+		for (const entt::id_type type : a)
+		{
+			if (std::find(b.begin(), b.end(), type) != b.end()) return true;
+		}
+
+		return false;
+	}
+
+	bool SystemAccess::ConflictsWith(const SystemAccess& other) const
+	{
+		return Intersects(m_writes, other.m_reads) || Intersects(m_writes, other.m_writes) || Intersects(m_reads, other.m_writes)
+			|| Intersects(m_resourceWrites, other.m_resourceReads) || Intersects(m_resourceWrites, other.m_resourceWrites) || Intersects(m_resourceReads, other.m_resourceWrites);
+	}
+
+	SystemScheduler::SystemScheduler(uint32_t workerCount) : m_workerCount(workerCount)
+	{
+	}
+
+	SystemScheduler::~SystemScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_stop = true;
+		}
+		m_condition.notify_all();
+
+		for (std::thread& worker : m_workers) worker.join();
+	}
+
+	uint32_t SystemScheduler::GetDefaultWorkerCount()
+	{
+		const uint32_t threadCount = std::thread::hardware_concurrency();
+		return threadCount > 1 ? threadCount - 1 : 0;
+	}
+
+	SystemId SystemScheduler::AddSystem(const char* name, const SystemAccess& access, const SystemFunction& function)
+	{
+		System system{};
+		system.m_name = name;
+		system.m_access = access;
+		system.m_function = function;
+
+		m_systems.push_back(std::move(system));
+		m_graphDirty = true;
+
+		return static_cast<SystemId>(m_systems.size() - 1);
+	}
+
+	void SystemScheduler::BuildGraph()
+	{
+		uint32_t edgeCount = 0;
+		for (SystemId systemId = 0; systemId < m_systems.size(); systemId++)
+		{
+			System& system = m_systems[systemId];
+			system.m_dependencies.clear();
+			system.m_dependents.clear();
+
+			for (SystemId earlierId = 0; earlierId < systemId; earlierId++)
+			{
+				if (!system.m_access.ConflictsWith(m_systems[earlierId].m_access)) continue;
+
+				system.m_dependencies.push_back(earlierId);
+				m_systems[earlierId].m_dependents.push_back(systemId);
+				edgeCount++;
+			}
+		}
+
+		m_graphDirty = false;
+
+		AFRE_INFO("System graph built ({} systems, {} conflicts)!", m_systems.size(), edgeCount);
+	}
+
+	void SystemScheduler::Run(entt::registry& registry, float deltaTime)
+	{
+		if (m_systems.empty()) return;
+
+		if (m_graphDirty) BuildGraph();
+
+		for (const System& system : m_systems)
+		{
+			for (void(*createStorage)(entt::registry&) : system.m_access.m_storages) createStorage(registry);
+		}
+
+		if (m_workers.size() < m_workerCount)
+		{
+			for (uint32_t thread = static_cast<uint32_t>(m_workers.size()) + 1; thread <= m_workerCount; thread++) m_workers.emplace_back(&SystemScheduler::WorkerLoop, this, thread);
+		}
+
+		std::unique_lock<std::mutex> lock{ m_mutex };
+
+		m_start = std::chrono::steady_clock::now();
+		m_registry = &registry;
+		m_deltaTime = deltaTime;
+		m_finishedCount = 0;
+		m_readySystems.clear();
+
+		for (SystemId systemId = 0; systemId < m_systems.size(); systemId++)
+		{
+			System& system = m_systems[systemId];
+			system.m_waitingOn = static_cast<uint32_t>(system.m_dependencies.size());
+
+			if (system.m_waitingOn == 0) m_readySystems.push_back(systemId);
+		}
+
+		m_condition.notify_all();
+
+		while (m_finishedCount < m_systems.size())
+		{
+			if (!RunNext(lock, 0)) m_condition.wait(lock);
+		}
+
+		m_registry = nullptr;
+		m_totalMs = GetElapsedMs(m_start);
+	}
+
+	void SystemScheduler::WorkerLoop(uint32_t thread)
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+
+		while (!m_stop)
+		{
+			if (!RunNext(lock, thread)) m_condition.wait(lock);
+		}
+	}
+
+	bool SystemScheduler::RunNext(std::unique_lock<std::mutex>& lock, uint32_t thread)
+	{
+		// Chunks first, a system waiting in ParallelFor holds up everything depending on it.
+		if (!m_forJobs.empty())
+		{
+			ForJob* forJob = m_forJobs.back();
+			if (forJob->m_next.load() >= forJob->m_count)
+			{
+				m_forJobs.pop_back();
+				return true;
+			}
+
+			forJob->m_helpers++;
+			lock.unlock();
+			RunChunks(*forJob);
+			lock.lock();
+			forJob->m_helpers--;
+
+			m_doneCondition.notify_all();
+			return true;
+		}
+
+		if (m_readySystems.empty()) return false;
+
+		// Lowest id first, so ready systems start in the order they were added.
+		const std::vector<SystemId>::iterator next = std::min_element(m_readySystems.begin(), m_readySystems.end());
+		const SystemId systemId = *next;
+		m_readySystems.erase(next);
+
+		System& system = m_systems[systemId];
+		entt::registry& registry = *m_registry;
+		const float deltaTime = m_deltaTime;
+
+		lock.unlock();
+		const double startMs = GetElapsedMs(m_start);
+		system.m_function(registry, *this, deltaTime);
+		const double durationMs = GetElapsedMs(m_start) - startMs;
+		lock.lock();
+
+		SystemTiming& timing = system.m_timing;
+		timing.m_startMs = startMs;
+		timing.m_durationMs = durationMs;
+		timing.m_averageMs = timing.m_averageMs == 0.0 ? durationMs : timing.m_averageMs * 0.9 + durationMs * 0.1;
+		timing.m_thread = thread;
+
+		for (const SystemId dependentId : system.m_dependents)
+		{
+			if (--m_systems[dependentId].m_waitingOn == 0) m_readySystems.push_back(dependentId);
+		}
+
+		m_finishedCount++;
+		m_condition.notify_all();
+
+		return true;
+	}
+
+	void SystemScheduler::RunChunks(ForJob& forJob)
+	{
+		uint32_t begin = 0;
+		while ((begin = forJob.m_next.fetch_add(forJob.m_chunkSize)) < forJob.m_count)
+		{
+			(*forJob.m_function)(begin, std::min(begin + forJob.m_chunkSize, forJob.m_count));
+		}
+	}
+
+	void SystemScheduler::ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& function)
+	{
+		if (count == 0) return;
+
+		ForJob forJob{};
+		forJob.m_function = &function;
+		forJob.m_count = count;
+		forJob.m_chunkSize = std::max(chunkSize, 1u);
+
+		// Not worth waking anyone for a single chunk.
+		if (count <= forJob.m_chunkSize || m_workers.empty())
+		{
+			RunChunks(forJob);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_forJobs.push_back(&forJob);
+		}
+		m_condition.notify_all();
+
+		RunChunks(forJob);
+
+		// Nobody can join once it's out of the list, then it's only the helpers already in it.
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		const std::vector<ForJob*>::iterator listed = std::find(m_forJobs.begin(), m_forJobs.end(), &forJob);
+		if (listed != m_forJobs.end()) m_forJobs.erase(listed);
+
+		m_doneCondition.wait(lock, [&]() { return forJob.m_helpers == 0; });
+	}
+
+	void SystemScheduler::LogReport() const
+	{
+		double systemMs = 0.0;
+		for (const System& system : m_systems) systemMs += system.m_timing.m_durationMs;
+
+		AFRE_INFO("Systems ran in {:.3f} ms ({:.3f} ms of systems on {} threads)!", m_totalMs, systemMs, m_workers.size() + 1);
+
+		for (const System& system : m_systems)
+		{
+			const SystemTiming& timing = system.m_timing;
+			AFRE_INFO("  {:<20} {:>8.3f} ms (avg {:>8.3f} ms), started at {:>8.3f} ms on thread {}", system.m_name, timing.m_durationMs, timing.m_averageMs, timing.m_startMs, timing.m_thread);
+		}
+
+		// Longest chain of conflicting systems by duration, the least Run can take with any number of threads.
+		std::vector<double> chainMs(m_systems.size(), 0.0);
+		double longestChainMs = 0.0;
+		for (SystemId systemId = 0; systemId < m_systems.size(); systemId++)
+		{
+			double dependencyMs = 0.0;
+			for (const SystemId dependencyId : m_systems[systemId].m_dependencies) dependencyMs = std::max(dependencyMs, chainMs[dependencyId]);
+
+			chainMs[systemId] = dependencyMs + m_systems[systemId].m_timing.m_durationMs;
+			longestChainMs = std::max(longestChainMs, chainMs[systemId]);
+		}
+
+		AFRE_INFO("Longest conflicting chain: {:.3f} ms", longestChainMs);
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <entt.hpp>
+
+namespace afre
+{
+	using SystemId = uint32_t;
+
+	// The component types and other shared state a system touches. Two systems conflict when either writes a type or
+	// resource the other reads or writes, conflicting systems run in the order they were added and the others in
+	// parallel.
+	struct SystemAccess
+	{
+		std::vector<entt::id_type> m_reads{};
+		std::vector<entt::id_type> m_writes{};
+		// State outside the registry, like Scene::m_spatialIndex, named by a tag type. Never gets a storage.
+		std::vector<entt::id_type> m_resourceReads{};
+		std::vector<entt::id_type> m_resourceWrites{};
+		// Create the registry's storage for every declared type, entt would otherwise do it on first use
+		// from inside a system, which isn't thread safe.
+		std::vector<void(*)(entt::registry&)> m_storages{};
+
+		template<typename... Components>
+		SystemAccess& Reads()
+		{
+			(m_reads.push_back(entt::type_hash<Components>::value()), ...);
+			(m_storages.push_back([](entt::registry& registry) { registry.storage<Components>(); }), ...);
+			return *this;
+		}
+
+		template<typename... Components>
+		SystemAccess& Writes()
+		{
+			(m_writes.push_back(entt::type_hash<Components>::value()), ...);
+			(m_storages.push_back([](entt::registry& registry) { registry.storage<Components>(); }), ...);
+			return *this;
+		}
+
+		template<typename... Resources>
+		SystemAccess& ReadsResource()
+		{
+			(m_resourceReads.push_back(entt::type_hash<Resources>::value()), ...);
+			return *this;
+		}
+
+		template<typename... Resources>
+		SystemAccess& WritesResource()
+		{
+			(m_resourceWrites.push_back(entt::type_hash<Resources>::value()), ...);
+			return *this;
+		}
+
+		bool ConflictsWith(const SystemAccess& other) const;
+	};
+
+	struct SystemTiming
+	{
+		// Of the last Run, from its start, in milliseconds.
+		double m_startMs = 0.0;
+		double m_durationMs = 0.0;
+		// Smoothed over the last frames, what the report shows.
+		double m_averageMs = 0.0;
+		// 0 is the thread that called Run.
+		uint32_t m_thread = 0;
+	};
+
+	class SystemScheduler;
+
+	using SystemFunction = std::function<void(entt::registry& registry, SystemScheduler& scheduler, float deltaTime)>;
+
+	// Runs the registered systems once per Run on worker threads, every system as soon as the systems added
+	// before it that it conflicts with are done. Systems only touch the components they declared and never
+	// create or destroy entities, that happens outside Run.
+	class SystemScheduler
+	{
+	public:
+		// The workers start on the first Run.
+		explicit SystemScheduler(uint32_t workerCount = 0);
+		~SystemScheduler();
+
+		SystemScheduler(const SystemScheduler&) = delete;
+		SystemScheduler& operator=(const SystemScheduler&) = delete;
+
+		SystemId AddSystem(const char* name, const SystemAccess& access, const SystemFunction& function);
+
+		// Blocks until every system ran. The calling thread runs systems too.
+		void Run(entt::registry& registry, float deltaTime);
+
+		// For systems with enough entities to split: calls function on chunks of [0, count) on every thread
+		// that has nothing else to do, the calling one included, and returns once all are done.
+		void ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+		// Per system timings of the last Run and how long the longest chain of conflicting systems took.
+		void LogReport() const;
+
+		inline const SystemTiming& GetTiming(SystemId system) const { return m_systems[system].m_timing; }
+		inline double GetTotalMs() const { return m_totalMs; }
+		inline uint32_t GetSystemCount() const { return static_cast<uint32_t>(m_systems.size()); }
+		inline uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+		// Every hardware thread but the calling one.
+		static uint32_t GetDefaultWorkerCount();
+
+	private:
+		struct System
+		{
+			const char* m_name = nullptr;
+			SystemAccess m_access{};
+			SystemFunction m_function{};
+			// Earlier systems it conflicts with.
+			std::vector<SystemId> m_dependencies{};
+			std::vector<SystemId> m_dependents{};
+
+			uint32_t m_waitingOn = 0;
+			SystemTiming m_timing{};
+		};
+
+		struct ForJob
+		{
+			const std::function<void(uint32_t, uint32_t)>* m_function = nullptr;
+			uint32_t m_count = 0;
+			uint32_t m_chunkSize = 0;
+			std::atomic<uint32_t> m_next{ 0 };
+			// Threads inside the job, it can't go out of scope before they left.
+			uint32_t m_helpers = 0;
+		};
+
+		void BuildGraph();
+		void WorkerLoop(uint32_t thread);
+		// Called with the mutex held, returns with it held. False if there was nothing to do.
+		bool RunNext(std::unique_lock<std::mutex>& lock, uint32_t thread);
+		static void RunChunks(ForJob& forJob);
+
+		uint32_t m_workerCount = 0;
+
+		std::vector<System> m_systems{};
+		bool m_graphDirty = true;
+
+		std::mutex m_mutex{};
+		std::condition_variable m_condition{};
+		std::condition_variable m_doneCondition{};
+
+		// Set for the duration of Run.
+		entt::registry* m_registry = nullptr;
+		float m_deltaTime = 0.f;
+		std::vector<SystemId> m_readySystems{};
+		uint32_t m_finishedCount = 0;
+		std::vector<ForJob*> m_forJobs{};
+		bool m_stop = false;
+
+		std::chrono::steady_clock::time_point m_start{};
+		double m_totalMs = 0.0;
+
+		std::vector<std::thread> m_workers{};
+	};
+}
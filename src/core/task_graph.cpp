@@ -0,0 +1,202 @@
+#include "task_graph.h"
+#include "log.h"
+#include <algorithm>
+#include <thread>
+
+namespace afre
+{
+	static double GetElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	TaskId TaskGraph::AddTask(const char* name, const std::function<bool()>& function, std::initializer_list<TaskId> dependencies, bool mainThread)
+	{
+		const TaskId taskId = static_cast<TaskId>(m_tasks.size());
+
+		Task task{};
+		task.m_name = name;
+		task.m_function = function;
+		task.m_mainThread = mainThread;
+
+		for (const TaskId dependency : dependencies)
+		{
+			if (dependency >= taskId)
+			{
+				AFRE_ERROR("Task {} depends on a task added after it!", name);
+				continue;
+			}
+
+			task.m_dependencies.push_back(dependency);
+			m_tasks[dependency].m_dependents.push_back(taskId);
+		}
+
+		m_tasks.push_back(std::move(task));
+
+		return taskId;
+	}
+
+	bool TaskGraph::Run(uint32_t workerCount)
+	{
+		m_start = std::chrono::steady_clock::now();
+		m_readyTasks.clear();
+		m_readyMainTasks.clear();
+		m_finishedCount = 0;
+
+		for (TaskId taskId = 0; taskId < m_tasks.size(); taskId++)
+		{
+			Task& task = m_tasks[taskId];
+			task.m_waitingOn = static_cast<uint32_t>(task.m_dependencies.size());
+			task.m_timing = TaskTiming{};
+
+			if (task.m_waitingOn == 0) (task.m_mainThread ? m_readyMainTasks : m_readyTasks).push_back(taskId);
+		}
+
+		std::vector<std::thread> workers{};
+		for (uint32_t thread = 1; thread <= workerCount; thread++) workers.emplace_back(&TaskGraph::RunTasks, this, thread, false);
+
+		RunTasks(0, true);
+
+		for (std::thread& worker : workers) worker.join();
+
+		m_totalMs = GetElapsedMs(m_start);
+
+		return std::all_of(m_tasks.begin(), m_tasks.end(), [](const Task& task) { return task.m_timing.m_state == TASK_SUCCEEDED; });
+	}
+
+	void TaskGraph::RunTasks(uint32_t thread, bool mainThread)
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+
+		while (true)
+		{
+			m_condition.wait(lock, [&]()
+				{
+					return m_finishedCount == m_tasks.size() || !m_readyTasks.empty() || (mainThread && !m_readyMainTasks.empty());
+				});
+
+			if (m_finishedCount == m_tasks.size()) return;
+
+			// Lowest id first, so ready tasks start in the order they were added.
+			std::vector<TaskId>& readyTasks = mainThread && !m_readyMainTasks.empty() ? m_readyMainTasks : m_readyTasks;
+			const std::vector<TaskId>::iterator next = std::min_element(readyTasks.begin(), readyTasks.end());
+			const TaskId taskId = *next;
+			readyTasks.erase(next);
+
+			Task& task = m_tasks[taskId];
+			task.m_timing.m_state = TASK_RUNNING;
+			task.m_timing.m_thread = thread;
+			task.m_timing.m_startMs = GetElapsedMs(m_start);
+
+			lock.unlock();
+			const bool success = task.m_function();
+			lock.lock();
+
+			task.m_timing.m_durationMs = GetElapsedMs(m_start) - task.m_timing.m_startMs;
+			FinishTask(taskId, success ? TASK_SUCCEEDED : TASK_FAILED);
+
+			m_condition.notify_all();
+		}
+	}
+
+	void TaskGraph::FinishTask(TaskId taskId, TaskState state)
+	{
+		Task& task = m_tasks[taskId];
+		task.m_timing.m_state = state;
+		m_finishedCount++;
+
+		if (state != TASK_SUCCEEDED)
+		{
+			SkipDependents(taskId);
+			return;
+		}
+
+		for (const TaskId dependentId : task.m_dependents)
+		{
+			Task& dependent = m_tasks[dependentId];
+
+			// Already skipped when another of its dependencies failed.
+			if (dependent.m_timing.m_state != TASK_WAITING) continue;
+
+			if (--dependent.m_waitingOn == 0) (dependent.m_mainThread ? m_readyMainTasks : m_readyTasks).push_back(dependentId);
+		}
+	}
+
+	void TaskGraph::SkipDependents(TaskId taskId)
+	{
+		for (const TaskId dependentId : m_tasks[taskId].m_dependents)
+		{
+			Task& dependent = m_tasks[dependentId];
+			if (dependent.m_timing.m_state != TASK_WAITING) continue;
+
+			dependent.m_timing.m_state = TASK_SKIPPED;
+			m_finishedCount++;
+
+			SkipDependents(dependentId);
+		}
+	}
+
+	void TaskGraph::LogReport() const
+	{
+		double taskMs = 0.0;
+		std::vector<TaskId> order{};
+		for (TaskId taskId = 0; taskId < m_tasks.size(); taskId++)
+		{
+			order.push_back(taskId);
+			taskMs += m_tasks[taskId].m_timing.m_durationMs;
+		}
+
+		AFRE_INFO("Task graph finished in {:.2f} ms ({:.2f} ms of tasks)!", m_totalMs, taskMs);
+
+		// Skipped tasks never started, they go last.
+		std::stable_sort(order.begin(), order.end(), [&](TaskId a, TaskId b)
+			{
+				const TaskTiming& timingA = m_tasks[a].m_timing;
+				const TaskTiming& timingB = m_tasks[b].m_timing;
+				if ((timingA.m_state == TASK_SKIPPED) != (timingB.m_state == TASK_SKIPPED)) return timingB.m_state == TASK_SKIPPED;
+				return timingA.m_startMs < timingB.m_startMs;
+			});
+
+		for (const TaskId taskId : order)
+		{
+			const Task& task = m_tasks[taskId];
+			const TaskTiming& timing = task.m_timing;
+
+			if (timing.m_state == TASK_SKIPPED)
+			{
+				AFRE_INFO("  {:<20} skipped", task.m_name);
+				continue;
+			}
+
+			AFRE_INFO("  {:<20} {:>8.2f} ms, started at {:>8.2f} ms on thread {}{}", task.m_name, timing.m_durationMs, timing.m_startMs, timing.m_thread,
+				timing.m_state == TASK_FAILED ? " (failed)" : "");
+		}
+
+		// Back from the task that finished last through whichever dependency finished last.
+		const auto getEndMs = [&](TaskId taskId) { return m_tasks[taskId].m_timing.m_startMs + m_tasks[taskId].m_timing.m_durationMs; };
+		const auto hasRun = [&](TaskId taskId) { return m_tasks[taskId].m_timing.m_state == TASK_SUCCEEDED || m_tasks[taskId].m_timing.m_state == TASK_FAILED; };
+
+		std::vector<TaskId> criticalPath{};
+		for (TaskId taskId = 0; taskId < m_tasks.size(); taskId++)
+		{
+			if (hasRun(taskId) && (criticalPath.empty() || getEndMs(taskId) > getEndMs(criticalPath[0]))) criticalPath.assign(1, taskId);
+		}
+
+		while (!criticalPath.empty())
+		{
+			const std::vector<TaskId>& dependencies = m_tasks[criticalPath.back()].m_dependencies;
+			if (dependencies.empty()) break;
+
+			criticalPath.push_back(*std::max_element(dependencies.begin(), dependencies.end(), [&](TaskId a, TaskId b) { return getEndMs(a) < getEndMs(b); }));
+		}
+
+		std::string path{};
+		for (std::vector<TaskId>::const_reverse_iterator it = criticalPath.rbegin(); it != criticalPath.rend(); it++)
+		{
+			if (!path.empty()) path += " > ";
+			path += m_tasks[*it].m_name;
+		}
+
+		if (!path.empty()) AFRE_INFO("Critical path: {}", path);
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+namespace afre
+{
+	using TaskId = uint32_t;
+
+	enum TaskState
+	{
+		TASK_WAITING = 0,
+		TASK_RUNNING = 1,
+		TASK_SUCCEEDED = 2,
+		TASK_FAILED = 3,
+		// Not run because a task it depends on failed.
+		TASK_SKIPPED = 4
+	};
+
+	struct TaskTiming
+	{
+		// From the start of Run, in milliseconds.
+		double m_startMs = 0.0;
+		double m_durationMs = 0.0;
+		// 0 is the thread that called Run.
+		uint32_t m_thread = 0;
+		TaskState m_state = TASK_WAITING;
+	};
+
+	// Runs tasks in parallel as soon as everything they depend on has finished. A task returning false
+	// skips the tasks depending on it, the others still run.
+	class TaskGraph
+	{
+	public:
+		// Dependencies have to be added before the tasks depending on them. Main thread tasks only ever run
+		// on the thread calling Run, for APIs like GLFW that need it.
+		TaskId AddTask(const char* name, const std::function<bool()>& function, std::initializer_list<TaskId> dependencies = {}, bool mainThread = false);
+
+		// Blocks until every task has finished or been skipped, false if any failed. The calling thread runs
+		// tasks too, so workerCount 0 runs everything in order on it.
+		bool Run(uint32_t workerCount);
+
+		// Per task timings and the chain of tasks that decided the total time.
+		void LogReport() const;
+
+		inline const TaskTiming& GetTiming(TaskId task) const { return m_tasks[task].m_timing; }
+		inline double GetTotalMs() const { return m_totalMs; }
+		inline uint32_t GetTaskCount() const { return static_cast<uint32_t>(m_tasks.size()); }
+
+	private:
+		struct Task
+		{
+			const char* m_name = nullptr;
+			std::function<bool()> m_function{};
+			std::vector<TaskId> m_dependencies{};
+			std::vector<TaskId> m_dependents{};
+			bool m_mainThread = false;
+
+			uint32_t m_waitingOn = 0;
+			TaskTiming m_timing{};
+		};
+
+		void RunTasks(uint32_t thread, bool mainThread);
+		// Called with the mutex held.
+		void FinishTask(TaskId task, TaskState state);
+		void SkipDependents(TaskId task);
+
+		std::vector<Task> m_tasks{};
+
+		std::mutex m_mutex{};
+		std::condition_variable m_condition{};
+		std::vector<TaskId> m_readyTasks{};
+		std::vector<TaskId> m_readyMainTasks{};
+		uint32_t m_finishedCount = 0;
+
+		std::chrono::steady_clock::time_point m_start{};
+		double m_totalMs = 0.0;
+	};
+}
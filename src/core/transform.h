@@ -0,0 +1,14 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace afre
+{
+	// Where an entity is in the world, in voxels. Entities with one are kept in Scene::m_spatialIndex.
+	struct Transform
+	{
+		glm::vec3 m_position{};
+		glm::quat m_rotation{ 1.f, 0.f, 0.f, 0.f };
+	};
+}
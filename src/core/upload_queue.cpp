@@ -0,0 +1,427 @@
+#include "upload_queue.h"
+#include <algorithm>
+#include <cstring>
+#include "log.h"
+#include "memory_utils.h"
+
+namespace afre
+{
+	// Two slots let the CPU fill one while the transfer queue still copies out of the other.
+	static constexpr uint32_t kUploadSlotCount = 2;
+
+	UploadQueue::UploadQueue
+	(
+		CleanupStack& cleanupStack,
+		const VkDevice& device,
+		const VkPhysicalDevice& physicalDevice,
+		const UploadQueueCreateInfo& uploadQueueCreateInfo,
+		bool& success
+	)
+	{
+		success = false;
+
+		m_device = device;
+		m_graphicsQueue = uploadQueueCreateInfo.m_graphicsQueue;
+		m_graphicsQueueFamily = uploadQueueCreateInfo.m_graphicsQueueFamily;
+		m_transferQueue = uploadQueueCreateInfo.m_transferQueue;
+		m_transferQueueFamily = uploadQueueCreateInfo.m_transferQueueFamily;
+		m_stagingSize = uploadQueueCreateInfo.m_stagingSize;
+
+		// Command pools, one per queue family
+		VkCommandPoolCreateInfo commandPoolInfo{};
+		commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		commandPoolInfo.queueFamilyIndex = m_transferQueueFamily;
+		if (vkCreateCommandPool(device, &commandPoolInfo, nullptr, &m_transferCommandPool) != VK_SUCCESS)
+		{
+			AFRE_CRIT("Failed to create the upload command pool!");
+			return;
+		}
+
+		const VkCommandPool transferCommandPool = m_transferCommandPool;
+		cleanupStack.PushCleanup([=]()
+			{
+				vkDestroyCommandPool(device, transferCommandPool, nullptr);
+			});
+
+		commandPoolInfo.queueFamilyIndex = m_graphicsQueueFamily;
+		if (vkCreateCommandPool(device, &commandPoolInfo, nullptr, &m_graphicsCommandPool) != VK_SUCCESS)
+		{
+			AFRE_CRIT("Failed to create the upload release command pool!");
+			return;
+		}
+
+		const VkCommandPool graphicsCommandPool = m_graphicsCommandPool;
+		cleanupStack.PushCleanup([=]()
+			{
+				vkDestroyCommandPool(device, graphicsCommandPool, nullptr);
+			});
+
+		// Timeline semaphore
+		VkSemaphoreTypeCreateInfo semaphoreTypeInfo{};
+		semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		semaphoreTypeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &semaphoreTypeInfo;
+
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_timelineSemaphore) != VK_SUCCESS)
+		{
+			AFRE_CRIT("Failed to create the upload timeline semaphore!");
+			return;
+		}
+
+		const VkSemaphore timelineSemaphore = m_timelineSemaphore;
+		cleanupStack.PushCleanup([=]()
+			{
+				vkDestroySemaphore(device, timelineSemaphore, nullptr);
+			});
+
+		// Upload slots
+		m_slots.resize(kUploadSlotCount);
+		for (uint32_t s = 0; s < kUploadSlotCount; s++)
+		{
+			UploadSlot& slot = m_slots[s];
+
+			VkBufferCreateInfo bufferInfo{};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			bufferInfo.size = m_stagingSize;
+
+			if (vkCreateBuffer(device, &bufferInfo, nullptr, &slot.m_stagingBuffer) != VK_SUCCESS)
+			{
+				AFRE_CRIT("Failed to create the staging buffer for upload slot {}!", s);
+				return;
+			}
+
+			const VkBuffer stagingBuffer = slot.m_stagingBuffer;
+			cleanupStack.PushCleanup([=]()
+				{
+					vkDestroyBuffer(device, stagingBuffer, nullptr);
+				});
+
+			VkMemoryRequirements bufferRequirements{};
+			vkGetBufferMemoryRequirements(device, slot.m_stagingBuffer, &bufferRequirements);
+
+			VkMemoryAllocateInfo memoryAllocateInfo{};
+			memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			memoryAllocateInfo.allocationSize = bufferRequirements.size;
+
+			if (!FindMemoryTypeIndex(physicalDevice, bufferRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memoryAllocateInfo.memoryTypeIndex) ||
+				vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &slot.m_stagingMemory) != VK_SUCCESS)
+			{
+				AFRE_CRIT("Failed to allocate staging memory for upload slot {}!", s);
+				return;
+			}
+
+			const VkDeviceMemory stagingMemory = slot.m_stagingMemory;
+			cleanupStack.PushCleanup([=]()
+				{
+					vkFreeMemory(device, stagingMemory, nullptr);
+				});
+
+			if (vkBindBufferMemory(device, slot.m_stagingBuffer, slot.m_stagingMemory, 0) != VK_SUCCESS ||
+				vkMapMemory(device, slot.m_stagingMemory, 0, m_stagingSize, 0, &slot.m_mappedStaging) != VK_SUCCESS)
+			{
+				AFRE_CRIT("Failed to map the staging memory for upload slot {}!", s);
+				return;
+			}
+
+			VkCommandBufferAllocateInfo commandBufferInfo{};
+			commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			commandBufferInfo.commandBufferCount = 1;
+			commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+			commandBufferInfo.commandPool = m_transferCommandPool;
+			const VkResult transferCommandBufferResult = vkAllocateCommandBuffers(device, &commandBufferInfo, &slot.m_transferCommandBuffer);
+
+			commandBufferInfo.commandPool = m_graphicsCommandPool;
+			const VkResult releaseCommandBufferResult = vkAllocateCommandBuffers(device, &commandBufferInfo, &slot.m_releaseCommandBuffer);
+
+			if (transferCommandBufferResult != VK_SUCCESS || releaseCommandBufferResult != VK_SUCCESS)
+			{
+				AFRE_CRIT("Failed to allocate the command buffers for upload slot {}!", s);
+				return;
+			}
+		}
+
+		if (HasDedicatedTransferQueue())
+		{
+			AFRE_INFO("Uploads go through the dedicated transfer queue family {}!", m_transferQueueFamily);
+		}
+		else
+		{
+			AFRE_INFO("No dedicated transfer queue, uploads share the graphics queue!");
+		}
+
+		success = true;
+	}
+
+	bool UploadQueue::QueueBufferUpload(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size)
+	{
+		if (size == 0) return true;
+
+		// Keeps every copy source 16 byte aligned.
+		const VkDeviceSize alignedSize = (size + 15) & ~static_cast<VkDeviceSize>(15);
+		if (m_stagingUsed + alignedSize > m_stagingSize)
+		{
+			AFRE_ERROR("Upload of {} bytes doesn't fit in the staging buffer ({} of {} bytes used)!", size, m_stagingUsed, m_stagingSize);
+			return false;
+		}
+
+		UploadSlot& slot = m_slots[m_currentSlot];
+
+		// The slot was last submitted kUploadSlotCount submits ago, so this rarely has to wait.
+		if (m_copies.empty() && slot.m_value > 0)
+		{
+			VkSemaphoreWaitInfo waitInfo{};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &m_timelineSemaphore;
+			waitInfo.pValues = &slot.m_value;
+
+			vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX);
+		}
+
+		memcpy(static_cast<uint8_t*>(slot.m_mappedStaging) + m_stagingUsed, data, static_cast<size_t>(size));
+
+		BufferCopy bufferCopy{};
+		bufferCopy.m_buffer = buffer;
+		bufferCopy.m_region.srcOffset = m_stagingUsed;
+		bufferCopy.m_region.dstOffset = offset;
+		bufferCopy.m_region.size = size;
+		m_copies.push_back(bufferCopy);
+
+		m_stagingUsed += alignedSize;
+
+		return true;
+	}
+
+	bool UploadQueue::HasStagingFor(VkDeviceSize size, uint32_t uploadCount) const
+	{
+		// Each upload pads to 16 bytes at most.
+		return m_stagingUsed + size + uploadCount * 15 <= m_stagingSize;
+	}
+
+	void UploadQueue::ForgetBuffer(VkBuffer buffer)
+	{
+		m_copies.erase(std::remove_if(m_copies.begin(), m_copies.end(), [&](const BufferCopy& bufferCopy) { return bufferCopy.m_buffer == buffer; }), m_copies.end());
+		m_pendingAcquires.erase(std::remove(m_pendingAcquires.begin(), m_pendingAcquires.end(), buffer), m_pendingAcquires.end());
+		m_bufferOwners.erase(buffer);
+	}
+
+	void UploadQueue::Submit()
+	{
+		if (m_copies.empty()) return;
+
+		UploadSlot& slot = m_slots[m_currentSlot];
+		const bool dedicated = HasDedicatedTransferQueue();
+
+		std::vector<VkBuffer> buffers{};
+		for (const BufferCopy& bufferCopy : m_copies)
+		{
+			if (std::find(buffers.begin(), buffers.end(), bufferCopy.m_buffer) == buffers.end()) buffers.push_back(bufferCopy.m_buffer);
+		}
+
+		// Writing a buffer the graphics queue owns needs it released over first, or the parts not copied over are lost.
+		std::vector<VkBuffer> graphicsOwnedBuffers{};
+		if (dedicated)
+		{
+			for (const VkBuffer buffer : buffers)
+			{
+				if (m_bufferOwners[buffer] == OWNER_GRAPHICS) graphicsOwnedBuffers.push_back(buffer);
+			}
+		}
+
+		const uint64_t releaseValue = graphicsOwnedBuffers.empty() ? 0 : SubmitGraphicsReleases(slot, graphicsOwnedBuffers);
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo{};
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(slot.m_transferCommandBuffer, &commandBufferBeginInfo);
+
+		std::vector<VkBufferMemoryBarrier> barriers{};
+		for (const VkBuffer buffer : graphicsOwnedBuffers)
+		{
+			barriers.push_back(GetOwnershipBarrier(buffer, m_graphicsQueueFamily, m_transferQueueFamily, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+		}
+
+		if (!barriers.empty())
+		{
+			vkCmdPipelineBarrier(slot.m_transferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+		}
+
+		std::vector<VkBufferCopy> regions{};
+		for (const VkBuffer buffer : buffers)
+		{
+			regions.clear();
+			for (const BufferCopy& bufferCopy : m_copies)
+			{
+				if (bufferCopy.m_buffer == buffer) regions.push_back(bufferCopy.m_region);
+			}
+
+			vkCmdCopyBuffer(slot.m_transferCommandBuffer, slot.m_stagingBuffer, buffer, static_cast<uint32_t>(regions.size()), regions.data());
+		}
+
+		// On a shared queue the semaphore alone makes the writes visible to the frame.
+		if (dedicated)
+		{
+			barriers.clear();
+			for (const VkBuffer buffer : buffers)
+			{
+				barriers.push_back(GetOwnershipBarrier(buffer, m_transferQueueFamily, m_graphicsQueueFamily, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+
+				m_bufferOwners[buffer] = OWNER_TRANSFER;
+				if (std::find(m_pendingAcquires.begin(), m_pendingAcquires.end(), buffer) == m_pendingAcquires.end()) m_pendingAcquires.push_back(buffer);
+			}
+
+			vkCmdPipelineBarrier(slot.m_transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+		}
+
+		vkEndCommandBuffer(slot.m_transferCommandBuffer);
+
+		const uint64_t signalValue = ++m_timelineValue;
+		const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &slot.m_transferCommandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &m_timelineSemaphore;
+
+		if (releaseValue > 0)
+		{
+			timelineInfo.waitSemaphoreValueCount = 1;
+			timelineInfo.pWaitSemaphoreValues = &releaseValue;
+
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = &m_timelineSemaphore;
+			submitInfo.pWaitDstStageMask = &waitStage;
+		}
+
+		if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			AFRE_ERROR("Failed to submit the uploads!");
+		}
+
+		slot.m_value = signalValue;
+		m_frameWaitValue = signalValue;
+
+		m_copies.clear();
+		m_stagingUsed = 0;
+		m_currentSlot = (m_currentSlot + 1) % static_cast<uint32_t>(m_slots.size());
+	}
+
+	void UploadQueue::RecordAcquires(VkCommandBuffer commandBuffer)
+	{
+		if (m_pendingAcquires.empty()) return;
+
+		std::vector<VkBufferMemoryBarrier> barriers{};
+		for (const VkBuffer buffer : m_pendingAcquires)
+		{
+			barriers.push_back(GetOwnershipBarrier(buffer, m_transferQueueFamily, m_graphicsQueueFamily, 0, VK_ACCESS_SHADER_READ_BIT));
+			m_bufferOwners[buffer] = OWNER_GRAPHICS;
+		}
+
+		// The mesh pass reads its quads in the vertex stage.
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+
+		m_pendingAcquires.clear();
+	}
+
+	bool UploadQueue::GetFrameWait(VkSemaphore& semaphore, uint64_t& value) const
+	{
+		if (m_frameWaitValue == 0) return false;
+
+		semaphore = m_timelineSemaphore;
+		value = m_frameWaitValue;
+
+		return true;
+	}
+
+	void UploadQueue::WaitIdle()
+	{
+		if (m_timelineSemaphore == VK_NULL_HANDLE || m_timelineValue == 0) return;
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_timelineSemaphore;
+		waitInfo.pValues = &m_timelineValue;
+
+		vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX);
+	}
+
+	VkBufferMemoryBarrier UploadQueue::GetOwnershipBarrier(VkBuffer buffer, uint32_t srcQueueFamily, uint32_t dstQueueFamily, VkAccessFlags srcAccess, VkAccessFlags dstAccess) const
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.srcQueueFamilyIndex = srcQueueFamily;
+		barrier.dstQueueFamilyIndex = dstQueueFamily;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		return barrier;
+	}
+
+	uint64_t UploadQueue::SubmitGraphicsReleases(UploadSlot& slot, const std::vector<VkBuffer>& buffers)
+	{
+		VkCommandBufferBeginInfo commandBufferBeginInfo{};
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(slot.m_releaseCommandBuffer, &commandBufferBeginInfo);
+
+		std::vector<VkBufferMemoryBarrier> barriers{};
+		for (const VkBuffer buffer : buffers)
+		{
+			barriers.push_back(GetOwnershipBarrier(buffer, m_graphicsQueueFamily, m_transferQueueFamily, 0, 0));
+		}
+
+		// The frames reading the buffers were waited on with the frame fence already.
+		vkCmdPipelineBarrier(slot.m_releaseCommandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+
+		vkEndCommandBuffer(slot.m_releaseCommandBuffer);
+
+		const uint64_t signalValue = ++m_timelineValue;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &slot.m_releaseCommandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &m_timelineSemaphore;
+
+		if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			AFRE_ERROR("Failed to submit the upload buffer releases!");
+		}
+
+		return signalValue;
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <unordered_map>
+#include <vector>
+#include "cleanup_stack.h"
+
+namespace afre
+{
+	struct UploadQueueCreateInfo
+	{
+		VkQueue m_graphicsQueue{};
+		uint32_t m_graphicsQueueFamily = 0;
+
+		// Same as the graphics queue when the device has no dedicated transfer queue.
+		VkQueue m_transferQueue{};
+		uint32_t m_transferQueueFamily = 0;
+
+		// Per slot, everything queued between two Submit calls has to fit.
+		VkDeviceSize m_stagingSize = 0;
+	};
+
+	// Copies data into device local buffers through staging memory on the transfer queue.
+	// Completion is tracked on a timeline semaphore the frame waits on, so the CPU never blocks on an upload.
+	class UploadQueue
+	{
+	public:
+		UploadQueue() = default;
+		UploadQueue
+		(
+			CleanupStack& cleanupStack,
+			const VkDevice& device,
+			const VkPhysicalDevice& physicalDevice,
+			const UploadQueueCreateInfo& uploadQueueCreateInfo,
+			bool& success
+		);
+
+		// The buffer has to be created with VK_BUFFER_USAGE_TRANSFER_DST_BIT. Data is copied into staging memory before returning.
+		bool QueueBufferUpload(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+		// Whether that many uploads of size bytes in total still fit before the next Submit, for uploads that have to land together.
+		bool HasStagingFor(VkDeviceSize size, uint32_t uploadCount) const;
+		// Before a buffer uploads went to is destroyed, drops what was queued for it and its ownership, a later
+		// buffer can get the same handle.
+		void ForgetBuffer(VkBuffer buffer);
+
+		// Submits everything queued since the last call without waiting for it.
+		void Submit();
+
+		// Takes the buffers the last Submit wrote over to the graphics queue. Record before the commands reading them.
+		void RecordAcquires(VkCommandBuffer commandBuffer);
+		// The semaphore value the next graphics submit has to wait on, false if nothing was uploaded yet.
+		bool GetFrameWait(VkSemaphore& semaphore, uint64_t& value) const;
+
+		void WaitIdle();
+
+		inline bool HasDedicatedTransferQueue() const { return m_graphicsQueueFamily != m_transferQueueFamily; }
+
+	private:
+		enum BufferOwner
+		{
+			OWNER_NONE = 0,
+			OWNER_TRANSFER = 1,
+			OWNER_GRAPHICS = 2
+		};
+
+		struct UploadSlot
+		{
+			VkBuffer m_stagingBuffer{};
+			VkDeviceMemory m_stagingMemory{};
+			void* m_mappedStaging = nullptr;
+
+			VkCommandBuffer m_transferCommandBuffer{};
+			// Releases buffers from the graphics queue before the transfer queue writes them.
+			VkCommandBuffer m_releaseCommandBuffer{};
+
+			// Timeline value signalled once the slot's copies are done.
+			uint64_t m_value = 0;
+		};
+
+		struct BufferCopy
+		{
+			VkBuffer m_buffer{};
+			VkBufferCopy m_region{};
+		};
+
+		VkBufferMemoryBarrier GetOwnershipBarrier(VkBuffer buffer, uint32_t srcQueueFamily, uint32_t dstQueueFamily, VkAccessFlags srcAccess, VkAccessFlags dstAccess) const;
+		uint64_t SubmitGraphicsReleases(UploadSlot& slot, const std::vector<VkBuffer>& buffers);
+
+		VkDevice m_device{};
+
+		VkQueue m_graphicsQueue{};
+		uint32_t m_graphicsQueueFamily = 0;
+		VkQueue m_transferQueue{};
+		uint32_t m_transferQueueFamily = 0;
+
+		VkCommandPool m_transferCommandPool{};
+		VkCommandPool m_graphicsCommandPool{};
+
+		VkSemaphore m_timelineSemaphore{};
+		uint64_t m_timelineValue = 0;
+		uint64_t m_frameWaitValue = 0;
+
+		std::vector<UploadSlot> m_slots{};
+		uint32_t m_currentSlot = 0;
+		VkDeviceSize m_stagingSize = 0;
+		VkDeviceSize m_stagingUsed = 0;
+
+		std::vector<BufferCopy> m_copies{};
+		std::unordered_map<VkBuffer, BufferOwner> m_bufferOwners{};
+		std::vector<VkBuffer> m_pendingAcquires{};
+	};
+}
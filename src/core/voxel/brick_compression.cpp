@@ -0,0 +1,52 @@
+#include "brick_compression.h"
+#include <algorithm>
+
+namespace afre
+{
+	void CompressBrick(const Brick& brick, std::vector<glm::uint16_t>& compressed)
+	{
+		compressed.clear();
+
+		const glm::uint16_t* voxels = brick.m_voxels;
+
+		glm::uint16_t runVoxel = voxels[0];
+		glm::uint16_t runLength = 0;
+		for (uint32_t i = 0; i < kBrickVoxelCount; i++)
+		{
+			if (voxels[i] != runVoxel)
+			{
+				compressed.push_back(runLength);
+				compressed.push_back(runVoxel);
+
+				runVoxel = voxels[i];
+				runLength = 0;
+			}
+
+			runLength++;
+		}
+
+		compressed.push_back(runLength);
+		compressed.push_back(runVoxel);
+	}
+
+	bool DecompressBrick(const glm::uint16_t* compressed, size_t compressedCount, Brick& brick)
+	{
+		if (compressedCount % 2 != 0) return false;
+
+		glm::uint16_t* voxels = brick.m_voxels;
+
+		uint32_t voxelIndex = 0;
+		for (size_t i = 0; i < compressedCount; i += 2)
+		{
+			const glm::uint16_t runLength = compressed[i];
+			const glm::uint16_t runVoxel = compressed[i + 1];
+
+			if (runLength == 0 || voxelIndex + runLength > kBrickVoxelCount) return false;
+
+			std::fill(voxels + voxelIndex, voxels + voxelIndex + runLength, runVoxel);
+			voxelIndex += runLength;
+		}
+
+		return voxelIndex == kBrickVoxelCount;
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	// Run-length encodes a brick as (run length, voxel) pairs in linear voxel order.
+	void CompressBrick(const Brick& brick, std::vector<glm::uint16_t>& compressed);
+
+	// Returns false if the data doesn't decode to exactly one brick.
+	bool DecompressBrick(const glm::uint16_t* compressed, size_t compressedCount, Brick& brick);
+}
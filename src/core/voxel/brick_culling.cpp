@@ -0,0 +1,206 @@
+#include "brick_culling.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace afre
+{
+	static constexpr float kBrickEdge = static_cast<float>(kBrickSize);
+	// FragMain's rays start on the near plane at depth 1 and test the voxel after it, so occluders closer than this could be stepped out of.
+	static constexpr float kMinOccluderDepth = 2.f;
+	// Keeps bricks touching a plane or an occluder's back face from being culled by rounding.
+	static constexpr float kCullingMargin = 1e-2f;
+
+	// Distance along dir to where the ray enters the box, infinity if it misses. Zero direction components are handled
+	// explicitly, so a ray grazing a face never produces a false hit through NaNs.
+	static float GetEntryDepth(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& rayOrigin, const glm::vec3& rayDir)
+	{
+		float tEnter = 0.f;
+		float tExit = std::numeric_limits<float>::max();
+
+		for (uint8_t i = 0; i < 3; i++)
+		{
+			if (rayDir[i] == 0.f)
+			{
+				if (rayOrigin[i] < boxMin[i] || rayOrigin[i] > boxMax[i]) return std::numeric_limits<float>::infinity();
+				continue;
+			}
+
+			const float t0 = (boxMin[i] - rayOrigin[i]) / rayDir[i];
+			const float t1 = (boxMax[i] - rayOrigin[i]) / rayDir[i];
+			tEnter = std::max(tEnter, std::min(t0, t1));
+			tExit = std::min(tExit, std::max(t0, t1));
+		}
+
+		return tEnter <= tExit ? tEnter : std::numeric_limits<float>::infinity();
+	}
+
+	void WidenCullingCamera(BrickCullingCamera& camera, float fovMargin)
+	{
+		// Both stay below 180 degrees, where the tangent blows up.
+		constexpr float kMaxFov = 179.f;
+
+		const float horizontalFov = glm::degrees(2.f * std::atan(std::tan(glm::radians(camera.m_fov) * 0.5f) * camera.m_aspectRatio));
+		const float widenedHorizontalFov = std::min(horizontalFov + fovMargin, kMaxFov);
+
+		camera.m_fov = std::min(camera.m_fov + fovMargin, kMaxFov);
+		camera.m_aspectRatio = std::tan(glm::radians(widenedHorizontalFov) * 0.5f) / std::tan(glm::radians(camera.m_fov) * 0.5f);
+	}
+
+	void BrickCuller::Cull(const BrickCullingCamera& camera, const BrickCullingGrid& grid, BrickVisibility& visibility)
+	{
+		const glm::uvec3& sizeInBricks = grid.m_sizeInBricks;
+		const uint32_t brickCount = sizeInBricks.x * sizeInBricks.y * sizeInBricks.z;
+
+		visibility.m_visibleBricks.clear();
+		visibility.m_visibleMask.assign((brickCount + 31) / 32, 0);
+		visibility.m_frustumCulled = 0;
+		visibility.m_occluded = 0;
+
+		m_origin = glm::vec3(camera.m_cameraToWorld[3]);
+		m_right = glm::normalize(glm::vec3(camera.m_cameraToWorld[0]));
+		m_up = glm::normalize(glm::vec3(camera.m_cameraToWorld[1]));
+		m_forward = -glm::normalize(glm::vec3(camera.m_cameraToWorld[2]));
+
+		m_tanHalfY = std::tan(glm::radians(camera.m_fov) * 0.5f);
+		m_tanHalfX = m_tanHalfY * camera.m_aspectRatio;
+
+		// Rays start at depth 1 and a ray's depth never exceeds its distance.
+		const float farDepth = camera.m_maxDistance + 1.f;
+
+		m_depth.assign(kDepthResolution * kDepthResolution, std::numeric_limits<float>::max());
+		m_candidates.clear();
+
+		for (uint32_t z = 0; z < sizeInBricks.z; z++)
+		{
+			for (uint32_t y = 0; y < sizeInBricks.y; y++)
+			{
+				for (uint32_t x = 0; x < sizeInBricks.x; x++)
+				{
+					CandidateBrick brick{};
+					brick.m_index = (z * sizeInBricks.y + y) * sizeInBricks.x + x;
+					brick.m_min = grid.m_origin + glm::vec3(x, y, z) * kBrickEdge;
+
+					// Right, left, top, bottom, near and far planes, culled when all corners are outside one of them.
+					bool outside[6] = { true, true, true, true, true, true };
+					brick.m_minDepth = std::numeric_limits<float>::max();
+					glm::vec2 screenMin{ std::numeric_limits<float>::max() };
+					glm::vec2 screenMax{ -std::numeric_limits<float>::max() };
+
+					for (uint8_t c = 0; c < 8; c++)
+					{
+						const glm::vec3 corner = brick.m_min + glm::vec3(c & 1 ? kBrickEdge : 0.f, c & 2 ? kBrickEdge : 0.f, c & 4 ? kBrickEdge : 0.f);
+						const glm::vec3 offset = corner - m_origin;
+						const float viewX = glm::dot(offset, m_right);
+						const float viewY = glm::dot(offset, m_up);
+						const float depth = glm::dot(offset, m_forward);
+
+						outside[0] &= viewX > m_tanHalfX * depth + kCullingMargin;
+						outside[1] &= viewX < -m_tanHalfX * depth - kCullingMargin;
+						outside[2] &= viewY > m_tanHalfY * depth + kCullingMargin;
+						outside[3] &= viewY < -m_tanHalfY * depth - kCullingMargin;
+						outside[4] &= depth < 0.f;
+						outside[5] &= depth > farDepth;
+
+						brick.m_minDepth = std::min(brick.m_minDepth, depth);
+						if (depth > 0.f)
+						{
+							const glm::vec2 screen{ viewX / (depth * m_tanHalfX), viewY / (depth * m_tanHalfY) };
+							screenMin = glm::min(screenMin, screen);
+							screenMax = glm::max(screenMax, screen);
+						}
+					}
+
+					if (outside[0] || outside[1] || outside[2] || outside[3] || outside[4] || outside[5])
+					{
+						visibility.m_frustumCulled++;
+						continue;
+					}
+
+					// Only bricks fully in front of the camera project to a bounded rectangle.
+					brick.m_projected = brick.m_minDepth > 0.f;
+					if (brick.m_projected)
+					{
+						const float tileScale = 0.5f * kDepthResolution;
+						const int32_t maxTile = static_cast<int32_t>(kDepthResolution) - 1;
+
+						brick.m_tileMin = glm::clamp(glm::ivec2(glm::floor((screenMin + 1.f) * tileScale)), glm::ivec2(0), glm::ivec2(maxTile));
+						brick.m_tileMax = glm::clamp(glm::ivec2(glm::floor((screenMax + 1.f) * tileScale)), glm::ivec2(0), glm::ivec2(maxTile));
+					}
+
+					m_candidates.push_back(brick);
+				}
+			}
+		}
+
+		std::sort(m_candidates.begin(), m_candidates.end(), [](const CandidateBrick& a, const CandidateBrick& b) { return a.m_minDepth < b.m_minDepth; });
+
+		for (const CandidateBrick& brick : m_candidates)
+		{
+			if (grid.m_occluders[brick.m_index] != 0 && brick.m_projected && brick.m_minDepth >= kMinOccluderDepth) DrawOccluder(brick);
+		}
+
+		for (const CandidateBrick& brick : m_candidates)
+		{
+			if (IsOccluded(brick))
+			{
+				visibility.m_occluded++;
+				continue;
+			}
+
+			visibility.m_visibleBricks.push_back(brick.m_index);
+			visibility.m_visibleMask[brick.m_index >> 5] |= 1u << (brick.m_index & 31);
+		}
+	}
+
+	void BrickCuller::DrawOccluder(const CandidateBrick& brick)
+	{
+		const glm::vec3 brickMax = brick.m_min + kBrickEdge;
+		const glm::ivec2 tileCount = brick.m_tileMax - brick.m_tileMin + 1;
+
+		// Entry depths at the tile corners. The projection of a box is convex, so a tile whose four corners
+		// all hit it is covered, and the box's front depth over the tile is largest at one of the corners.
+		m_cornerDepth.resize(static_cast<size_t>(tileCount.x + 1) * (tileCount.y + 1));
+		for (int32_t j = 0; j <= tileCount.y; j++)
+		{
+			for (int32_t i = 0; i <= tileCount.x; i++)
+			{
+				const float u = static_cast<float>(brick.m_tileMin.x + i) / kDepthResolution * 2.f - 1.f;
+				const float v = static_cast<float>(brick.m_tileMin.y + j) / kDepthResolution * 2.f - 1.f;
+
+				// Unit depth along the direction, so the entry distance is the entry depth.
+				const glm::vec3 rayDir = m_forward + m_right * (u * m_tanHalfX) + m_up * (v * m_tanHalfY);
+				m_cornerDepth[j * (tileCount.x + 1) + i] = GetEntryDepth(brick.m_min, brickMax, m_origin, rayDir);
+			}
+		}
+
+		for (int32_t j = 0; j < tileCount.y; j++)
+		{
+			for (int32_t i = 0; i < tileCount.x; i++)
+			{
+				const uint32_t rowStride = tileCount.x + 1;
+				const float depth = std::max(
+					std::max(m_cornerDepth[j * rowStride + i], m_cornerDepth[j * rowStride + i + 1]),
+					std::max(m_cornerDepth[(j + 1) * rowStride + i], m_cornerDepth[(j + 1) * rowStride + i + 1]));
+
+				float& tileDepth = m_depth[(brick.m_tileMin.y + j) * kDepthResolution + brick.m_tileMin.x + i];
+				tileDepth = std::min(tileDepth, depth);
+			}
+		}
+	}
+
+	bool BrickCuller::IsOccluded(const CandidateBrick& brick) const
+	{
+		if (!brick.m_projected) return false;
+
+		for (int32_t y = brick.m_tileMin.y; y <= brick.m_tileMax.y; y++)
+		{
+			for (int32_t x = brick.m_tileMin.x; x <= brick.m_tileMax.x; x++)
+			{
+				if (m_depth[y * kDepthResolution + x] >= brick.m_minDepth - kCullingMargin) return false;
+			}
+		}
+
+		return true;
+	}
+}
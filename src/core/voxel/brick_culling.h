@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	struct BrickCullingCamera
+	{
+		// Camera space looks down -Z, like FragMain.
+		glm::mat4 m_cameraToWorld{ 1.f };
+		// Vertical, in degrees.
+		float m_fov = 90.f;
+		float m_aspectRatio = 1.f;
+		float m_maxDistance = 70.f;
+	};
+
+	// Widens the vertical and the horizontal angle by the margin, in degrees. Widening only the vertical one would
+	// add less than the margin on the sides of a wide view.
+	void WidenCullingCamera(BrickCullingCamera& camera, float fovMargin);
+
+	struct BrickCullingGrid
+	{
+		glm::uvec3 m_sizeInBricks{};
+		// World position of the min corner of brick 0.
+		glm::vec3 m_origin{};
+		// Non zero for bricks that are solid and opaque all the way through. Indexed like VoxelWorld's bricks.
+		std::vector<glm::uint8_t> m_occluders{};
+	};
+
+	struct BrickVisibility
+	{
+		// Visible brick indices, nearest first so streaming can go down the list in order.
+		std::vector<uint32_t> m_visibleBricks{};
+		// One bit per brick, what the shader reads.
+		std::vector<uint32_t> m_visibleMask{};
+
+		uint32_t m_frustumCulled = 0;
+		uint32_t m_occluded = 0;
+	};
+
+	// Frustum culls a brick grid and occludes bricks hidden behind solid ones. Conservative: a brick
+	// is only culled when no ray of the camera can reach it.
+	class BrickCuller
+	{
+	public:
+		// Tiles per side of the coarse depth buffer the occluders are drawn into.
+		static constexpr uint32_t kDepthResolution = 32;
+
+		void Cull(const BrickCullingCamera& camera, const BrickCullingGrid& grid, BrickVisibility& visibility);
+
+	private:
+		struct CandidateBrick
+		{
+			uint32_t m_index = 0;
+			glm::vec3 m_min{};
+			// View space depth of the nearest corner.
+			float m_minDepth = 0.f;
+			// Tiles the brick's projection overlaps, empty when it reaches behind the camera.
+			glm::ivec2 m_tileMin{};
+			glm::ivec2 m_tileMax{};
+			bool m_projected = false;
+		};
+
+		void DrawOccluder(const CandidateBrick& brick);
+		bool IsOccluded(const CandidateBrick& brick) const;
+
+		// Farthest depth an occluder is known to cover each tile at.
+		std::vector<float> m_depth{};
+		std::vector<CandidateBrick> m_candidates{};
+		std::vector<float> m_cornerDepth{};
+
+		glm::vec3 m_origin{};
+		glm::vec3 m_right{};
+		glm::vec3 m_up{};
+		glm::vec3 m_forward{};
+		float m_tanHalfX = 1.f;
+		float m_tanHalfY = 1.f;
+	};
+}
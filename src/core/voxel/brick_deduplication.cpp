@@ -0,0 +1,111 @@
+#include "brick_deduplication.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "brick_kernels.h"
+#include "brick_pool.h"
+
+namespace afre
+{
+	bool IsBrickUniform(const Brick& brick, glm::uint16_t& voxel)
+	{
+		voxel = brick.m_voxels[0];
+		return GetBrickKernels().m_isUniform(brick.m_voxels);
+	}
+
+	glm::uint16_t GetDominantVoxel(const Brick& brick)
+	{
+		std::vector<glm::uint16_t> voxels(brick.m_voxels, brick.m_voxels + kBrickVoxelCount);
+		std::sort(voxels.begin(), voxels.end());
+
+		glm::uint16_t dominantVoxel = 0;
+		size_t dominantCount = 0;
+		for (size_t run = 0; run < voxels.size();)
+		{
+			const size_t runEnd = std::upper_bound(voxels.begin() + run, voxels.end(), voxels[run]) - voxels.begin();
+			if (voxels[run] != 0 && runEnd - run > dominantCount)
+			{
+				dominantVoxel = voxels[run];
+				dominantCount = runEnd - run;
+			}
+
+			run = runEnd;
+		}
+
+		return dominantVoxel;
+	}
+
+	uint64_t HashBrick(const Brick& brick)
+	{
+		// FNV-1a over 64 bit words, plenty to bucket bricks before the full compare.
+		uint64_t hash = 0xcbf29ce484222325ull;
+
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(brick.m_voxels);
+		for (size_t i = 0; i < sizeof(Brick); i += sizeof(uint64_t))
+		{
+			uint64_t word = 0;
+			std::memcpy(&word, bytes + i, sizeof(uint64_t));
+
+			hash ^= word;
+			hash *= 0x100000001b3ull;
+		}
+
+		return hash;
+	}
+
+	std::shared_ptr<Brick> GetUniformBrick(glm::uint16_t voxel)
+	{
+		static std::mutex mutex{};
+		static std::unordered_map<glm::uint16_t, std::shared_ptr<Brick>> uniformBricks{};
+
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		std::shared_ptr<Brick>& uniformBrick = uniformBricks[voxel];
+		if (!uniformBrick)
+		{
+			uniformBrick = MakePooledBrick(BRICK_POOL_UNIFORM);
+			std::fill(uniformBrick->m_voxels, uniformBrick->m_voxels + kBrickVoxelCount, voxel);
+		}
+
+		return uniformBrick;
+	}
+
+	uint32_t PackBricks(const Brick* bricks, uint32_t brickCount, glm::uint32_t* brickTable, Brick* brickPool, BrickDeduplicationStats& stats)
+	{
+		stats = {};
+
+		std::unordered_map<uint64_t, uint32_t> poolSlots{};
+		uint32_t poolCount = 0;
+
+		for (uint32_t b = 0; b < brickCount; b++)
+		{
+			glm::uint16_t uniformVoxel = 0;
+			if (IsBrickUniform(bricks[b], uniformVoxel))
+			{
+				brickTable[b] = kUniformBrickBit | uniformVoxel;
+				stats.m_uniformBricks++;
+				continue;
+			}
+
+			const uint64_t hash = HashBrick(bricks[b]);
+			const auto poolSlot = poolSlots.find(hash);
+			if (poolSlot != poolSlots.end() && AreBricksEqual(brickPool[poolSlot->second], bricks[b]))
+			{
+				brickTable[b] = poolSlot->second;
+				stats.m_duplicateBricks++;
+				continue;
+			}
+
+			std::memcpy(&brickPool[poolCount], &bricks[b], sizeof(Brick));
+			brickTable[b] = poolCount;
+			poolSlots.emplace(hash, poolCount);
+
+			poolCount++;
+			stats.m_uniqueBricks++;
+		}
+
+		return poolCount;
+	}
+}
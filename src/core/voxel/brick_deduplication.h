@@ -0,0 +1,26 @@
+#pragma once
+
+#include <memory>
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	struct BrickDeduplicationStats
+	{
+		uint32_t m_uniformBricks = 0;
+		uint32_t m_duplicateBricks = 0;
+		uint32_t m_uniqueBricks = 0;
+	};
+
+	bool IsBrickUniform(const Brick& brick, glm::uint16_t& voxel);
+	// The most common voxel other than air, air only for an empty brick. What the GPU draws a brick as while it isn't resident.
+	glm::uint16_t GetDominantVoxel(const Brick& brick);
+	uint64_t HashBrick(const Brick& brick);
+
+	// One shared, never written brick per uniform value. Anything pointing at it copies it before writing.
+	std::shared_ptr<Brick> GetUniformBrick(glm::uint16_t voxel);
+
+	// Fills the GPU brick table: uniform bricks are stored in the table entry alone,
+	// identical bricks point at the same pool slot. Returns how many pool slots were used.
+	uint32_t PackBricks(const Brick* bricks, uint32_t brickCount, glm::uint32_t* brickTable, Brick* brickPool, BrickDeduplicationStats& stats);
+}
@@ -0,0 +1,213 @@
+#include "brick_kernels_simd.h"
+#include <algorithm>
+#include <cstring>
+#include "log.h"
+
+#ifdef AFRE_SIMD_X86
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+namespace afre
+{
+	static glm::uint32_t CountNonAirScalar(const glm::uint16_t* voxels)
+	{
+		glm::uint32_t count = 0;
+		for (uint32_t i = 0; i < kBrickVoxelCount; i++) count += voxels[i] != 0 ? 1 : 0;
+
+		return count;
+	}
+
+	static bool IsUniformScalar(const glm::uint16_t* voxels)
+	{
+		for (uint32_t i = 1; i < kBrickVoxelCount; i++)
+		{
+			if (voxels[i] != voxels[0]) return false;
+		}
+
+		return true;
+	}
+
+	static void BuildOccupancyScalar(const glm::uint16_t* voxels, glm::uint64_t* occupancy)
+	{
+		std::fill(occupancy, occupancy + kBrickOccupancyWords, 0ull);
+		for (uint32_t i = 0; i < kBrickVoxelCount; i++)
+		{
+			if (voxels[i] != 0) occupancy[i / 64] |= 1ull << (i % 64);
+		}
+	}
+
+	static bool EqualScalar(const glm::uint16_t* a, const glm::uint16_t* b)
+	{
+		for (uint32_t i = 0; i < kBrickVoxelCount; i++)
+		{
+			if (a[i] != b[i]) return false;
+		}
+
+		return true;
+	}
+
+	static glm::uint32_t DiffScalar(const glm::uint16_t* a, const glm::uint16_t* b, glm::uint64_t* changed)
+	{
+		std::fill(changed, changed + kBrickOccupancyWords, 0ull);
+
+		glm::uint32_t count = 0;
+		for (uint32_t i = 0; i < kBrickVoxelCount; i++)
+		{
+			if (a[i] == b[i]) continue;
+
+			changed[i / 64] |= 1ull << (i % 64);
+			count++;
+		}
+
+		return count;
+	}
+
+	static void DownsampleScalar(const glm::uint16_t* voxels, glm::uint16_t* mip)
+	{
+		for (uint32_t z = 0; z < kBrickMipSize; z++)
+			for (uint32_t y = 0; y < kBrickMipSize; y++)
+				for (uint32_t x = 0; x < kBrickMipSize; x++)
+				{
+					glm::uint16_t voxel = 0;
+					for (uint32_t corner = 0; corner < 8; corner++)
+					{
+						voxel = std::max(voxel, voxels[GetBrickVoxelIndex(x * 2 + (corner & 1), y * 2 + ((corner >> 1) & 1), z * 2 + (corner >> 2))]);
+					}
+
+					mip[(z * kBrickMipSize + y) * kBrickMipSize + x] = voxel;
+				}
+	}
+
+	static void FillBoxScalar(glm::uint16_t* voxels, const glm::uvec3& min, const glm::uvec3& max, glm::uint16_t voxel)
+	{
+		for (uint32_t z = min.z; z < max.z; z++)
+			for (uint32_t y = min.y; y < max.y; y++)
+				for (uint32_t x = min.x; x < max.x; x++) voxels[GetBrickVoxelIndex(x, y, z)] = voxel;
+	}
+
+	BrickKernels GetScalarBrickKernels()
+	{
+		BrickKernels kernels{};
+		kernels.m_name = "scalar";
+		kernels.m_countNonAir = CountNonAirScalar;
+		kernels.m_isUniform = IsUniformScalar;
+		kernels.m_buildOccupancy = BuildOccupancyScalar;
+		kernels.m_equal = EqualScalar;
+		kernels.m_diff = DiffScalar;
+		kernels.m_downsample = DownsampleScalar;
+		kernels.m_fillBox = FillBoxScalar;
+
+		return kernels;
+	}
+
+	#ifdef AFRE_SIMD_X86
+		static void GetCpuid(uint32_t leaf, uint32_t registers[4])
+		{
+			#if defined(_MSC_VER)
+				int values[4]{};
+				__cpuidex(values, static_cast<int>(leaf), 0);
+				std::memcpy(registers, values, sizeof(values));
+			#else
+				__cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+			#endif
+		}
+
+		// Which register states the OS saves on a context switch, the CPU having the instructions isn't enough.
+		static uint64_t GetEnabledXsaveFeatures()
+		{
+			#if defined(_MSC_VER)
+				return _xgetbv(0);
+			#else
+				uint32_t low = 0;
+				uint32_t high = 0;
+				__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+				return (static_cast<uint64_t>(high) << 32) | low;
+			#endif
+		}
+	#endif
+
+	static SimdLevel DetectSimdLevel()
+	{
+		#ifdef AFRE_SIMD_X86
+			uint32_t registers[4]{};
+			GetCpuid(0, registers);
+			const uint32_t maxLeaf = registers[0];
+
+			GetCpuid(1, registers);
+			const uint32_t features = registers[2];
+
+			// SSE4.1, SSE4.2 and POPCNT.
+			const bool sse42 = (features & (1u << 19)) && (features & (1u << 20)) && (features & (1u << 23));
+			if (!sse42) return SIMD_SCALAR;
+
+			const bool osxsave = (features & (1u << 27)) && (features & (1u << 28));
+			if (!osxsave || maxLeaf < 7) return SIMD_SSE42;
+
+			const uint64_t xsaveFeatures = GetEnabledXsaveFeatures();
+
+			GetCpuid(7, registers);
+			const uint32_t extendedFeatures = registers[1];
+
+			// XMM and YMM state.
+			const bool avx2 = (xsaveFeatures & 0x6) == 0x6 && (extendedFeatures & (1u << 5));
+			if (!avx2) return SIMD_SSE42;
+
+			// Opmask and both halves of the ZMM state as well.
+			const bool avx512 = (xsaveFeatures & 0xE6) == 0xE6 && (extendedFeatures & (1u << 16)) && (extendedFeatures & (1u << 30));
+
+			return avx512 ? SIMD_AVX512 : SIMD_AVX2;
+		#else
+			return SIMD_SCALAR;
+		#endif
+	}
+
+	struct BrickKernelTables
+	{
+		BrickKernels m_tables[SIMD_LEVEL_COUNT]{};
+		SimdLevel m_supportedLevel = SIMD_SCALAR;
+	};
+
+	static BrickKernelTables CreateBrickKernelTables()
+	{
+		BrickKernelTables tables{};
+		tables.m_supportedLevel = DetectSimdLevel();
+		tables.m_tables[SIMD_SCALAR] = GetScalarBrickKernels();
+
+		#ifdef AFRE_SIMD_X86
+			if (tables.m_supportedLevel >= SIMD_SSE42) tables.m_tables[SIMD_SSE42] = GetSse42BrickKernels();
+			if (tables.m_supportedLevel >= SIMD_AVX2) tables.m_tables[SIMD_AVX2] = GetAvx2BrickKernels();
+			if (tables.m_supportedLevel >= SIMD_AVX512) tables.m_tables[SIMD_AVX512] = GetAvx512BrickKernels();
+		#endif
+
+		AFRE_INFO("Brick kernels use {}!", tables.m_tables[tables.m_supportedLevel].m_name);
+
+		return tables;
+	}
+
+	static const BrickKernelTables& GetBrickKernelTables()
+	{
+		static const BrickKernelTables tables = CreateBrickKernelTables();
+		return tables;
+	}
+
+	const BrickKernels& GetBrickKernels()
+	{
+		const BrickKernelTables& tables = GetBrickKernelTables();
+		return tables.m_tables[tables.m_supportedLevel];
+	}
+
+	const BrickKernels* GetBrickKernels(SimdLevel level)
+	{
+		const BrickKernelTables& tables = GetBrickKernelTables();
+		return level <= tables.m_supportedLevel ? &tables.m_tables[level] : nullptr;
+	}
+
+	SimdLevel GetSupportedSimdLevel()
+	{
+		return GetBrickKernelTables().m_supportedLevel;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	// Bit per voxel in storage order, set for everything but air.
+	constexpr glm::uint32_t kBrickOccupancyWords = kBrickVoxelCount / 64;
+
+	constexpr glm::uint32_t kBrickMipSize = kBrickSize / 2;
+	constexpr glm::uint32_t kBrickMipVoxelCount = kBrickMipSize * kBrickMipSize * kBrickMipSize;
+
+	enum SimdLevel
+	{
+		SIMD_SCALAR = 0,
+		SIMD_SSE42 = 1,
+		SIMD_AVX2 = 2,
+		// F and BW, the 16 bit compares need BW.
+		SIMD_AVX512 = 3,
+		SIMD_LEVEL_COUNT = 4
+	};
+
+	// Passes over a brick's voxels in storage order. Every table computes exactly what the scalar one does.
+	struct BrickKernels
+	{
+		const char* m_name = nullptr;
+
+		glm::uint32_t (*m_countNonAir)(const glm::uint16_t* voxels) = nullptr;
+		bool (*m_isUniform)(const glm::uint16_t* voxels) = nullptr;
+		void (*m_buildOccupancy)(const glm::uint16_t* voxels, glm::uint64_t* occupancy) = nullptr;
+		bool (*m_equal)(const glm::uint16_t* a, const glm::uint16_t* b) = nullptr;
+		// Bit per voxel that differs, returns how many do.
+		glm::uint32_t (*m_diff)(const glm::uint16_t* a, const glm::uint16_t* b, glm::uint64_t* changed) = nullptr;
+
+		// Every mip voxel is the highest of its 2x2x2 voxels, so anything solid keeps it solid. The mip is linear
+		// [z][y][x] whatever the brick layout. Only the linear layout has vector versions of these two.
+		void (*m_downsample)(const glm::uint16_t* voxels, glm::uint16_t* mip) = nullptr;
+		// [min, max) in brick coordinates.
+		void (*m_fillBox)(glm::uint16_t* voxels, const glm::uvec3& min, const glm::uvec3& max, glm::uint16_t voxel) = nullptr;
+	};
+
+	// The best table the CPU supports, picked with CPUID on the first call.
+	const BrickKernels& GetBrickKernels();
+	// Null when the CPU or the build doesn't have the level.
+	const BrickKernels* GetBrickKernels(SimdLevel level);
+	SimdLevel GetSupportedSimdLevel();
+
+	inline glm::uint32_t CountNonAirVoxels(const Brick& brick) { return GetBrickKernels().m_countNonAir(brick.m_voxels); }
+	inline bool AreBricksEqual(const Brick& a, const Brick& b) { return GetBrickKernels().m_equal(a.m_voxels, b.m_voxels); }
+	inline void BuildBrickOccupancy(const Brick& brick, glm::uint64_t* occupancy) { GetBrickKernels().m_buildOccupancy(brick.m_voxels, occupancy); }
+	inline glm::uint32_t DiffBricks(const Brick& a, const Brick& b, glm::uint64_t* changed) { return GetBrickKernels().m_diff(a.m_voxels, b.m_voxels, changed); }
+	inline void DownsampleBrick(const Brick& brick, glm::uint16_t* mip) { GetBrickKernels().m_downsample(brick.m_voxels, mip); }
+	inline void FillBrickBox(Brick& brick, const glm::uvec3& min, const glm::uvec3& max, glm::uint16_t voxel) { GetBrickKernels().m_fillBox(brick.m_voxels, min, max, voxel); }
+}
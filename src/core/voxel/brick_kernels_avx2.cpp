@@ -0,0 +1,153 @@
+#include "brick_kernels_simd.h"
+
+#ifdef AFRE_SIMD_X86
+
+#include <immintrin.h>
+
+#define AFRE_AVX2 AFRE_SIMD_TARGET("avx2,popcnt")
+
+namespace afre
+{
+	static AFRE_AVX2 inline __m256i Load(const glm::uint16_t* voxels)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(voxels));
+	}
+
+	static AFRE_AVX2 glm::uint32_t CountNonAirAvx2(const glm::uint16_t* voxels)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+
+		// Compares give -1 for air, subtracting them counts it per lane, 256 at most.
+		__m256i airCounts = _mm256_setzero_si256();
+		for (uint32_t i = 0; i < kBrickVoxelCount; i += 16) airCounts = _mm256_sub_epi16(airCounts, _mm256_cmpeq_epi16(Load(voxels + i), zero));
+
+		const __m256i sums = _mm256_madd_epi16(airCounts, _mm256_set1_epi16(1));
+		__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		return kBrickVoxelCount - static_cast<glm::uint32_t>(_mm_cvtsi128_si32(sum));
+	}
+
+	static AFRE_AVX2 bool IsUniformAvx2(const glm::uint16_t* voxels)
+	{
+		const __m256i first = _mm256_set1_epi16(static_cast<short>(voxels[0]));
+
+		for (uint32_t block = 0; block < kBrickVoxelCount; block += 128)
+		{
+			__m256i differences = _mm256_setzero_si256();
+			for (uint32_t i = block; i < block + 128; i += 16) differences = _mm256_or_si256(differences, _mm256_xor_si256(Load(voxels + i), first));
+
+			if (!_mm256_testz_si256(differences, differences)) return false;
+		}
+
+		return true;
+	}
+
+	// Bit per lane where the compare was true, for 32 voxels. The pack interleaves the 128 bit halves, the permute undoes it.
+	static AFRE_AVX2 glm::uint32_t GetMask32(__m256i low, __m256i high)
+	{
+		return static_cast<glm::uint32_t>(_mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), _MM_SHUFFLE(3, 1, 2, 0))));
+	}
+
+	static AFRE_AVX2 void BuildOccupancyAvx2(const glm::uint16_t* voxels, glm::uint64_t* occupancy)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+
+		for (uint32_t word = 0; word < kBrickOccupancyWords; word++)
+		{
+			const glm::uint16_t* wordVoxels = voxels + word * 64;
+			const glm::uint64_t low = GetMask32(_mm256_cmpeq_epi16(Load(wordVoxels), zero), _mm256_cmpeq_epi16(Load(wordVoxels + 16), zero));
+			const glm::uint64_t high = GetMask32(_mm256_cmpeq_epi16(Load(wordVoxels + 32), zero), _mm256_cmpeq_epi16(Load(wordVoxels + 48), zero));
+
+			occupancy[word] = ~(low | (high << 32));
+		}
+	}
+
+	static AFRE_AVX2 bool EqualAvx2(const glm::uint16_t* a, const glm::uint16_t* b)
+	{
+		for (uint32_t block = 0; block < kBrickVoxelCount; block += 128)
+		{
+			__m256i differences = _mm256_setzero_si256();
+			for (uint32_t i = block; i < block + 128; i += 16) differences = _mm256_or_si256(differences, _mm256_xor_si256(Load(a + i), Load(b + i)));
+
+			if (!_mm256_testz_si256(differences, differences)) return false;
+		}
+
+		return true;
+	}
+
+	static AFRE_AVX2 glm::uint32_t DiffAvx2(const glm::uint16_t* a, const glm::uint16_t* b, glm::uint64_t* changed)
+	{
+		glm::uint32_t count = 0;
+		for (uint32_t word = 0; word < kBrickOccupancyWords; word++)
+		{
+			const uint32_t i = word * 64;
+			const glm::uint64_t low = GetMask32(_mm256_cmpeq_epi16(Load(a + i), Load(b + i)), _mm256_cmpeq_epi16(Load(a + i + 16), Load(b + i + 16)));
+			const glm::uint64_t high = GetMask32(_mm256_cmpeq_epi16(Load(a + i + 32), Load(b + i + 32)), _mm256_cmpeq_epi16(Load(a + i + 48), Load(b + i + 48)));
+
+			changed[word] = ~(low | (high << 32));
+			count += static_cast<glm::uint32_t>(_mm_popcnt_u64(changed[word]));
+		}
+
+		return count;
+	}
+
+	#if AFRE_BRICK_LAYOUT == AFRE_BRICK_LAYOUT_LINEAR
+		// Max of the four rows under a mip row, then of each pair of lanes, packed down to 8 voxels.
+		static AFRE_AVX2 void DownsampleAvx2(const glm::uint16_t* voxels, glm::uint16_t* mip)
+		{
+			const __m256i lowHalves = _mm256_set1_epi32(0xFFFF);
+
+			for (uint32_t z = 0; z < kBrickMipSize; z++)
+				for (uint32_t y = 0; y < kBrickMipSize; y++)
+				{
+					const glm::uint16_t* row = voxels + GetLinearBrickVoxelIndex(0, y * 2, z * 2);
+
+					__m256i rowMax = _mm256_max_epu16(_mm256_max_epu16(Load(row), Load(row + 16)), _mm256_max_epu16(Load(row + 256), Load(row + 272)));
+					rowMax = _mm256_and_si256(_mm256_max_epu16(rowMax, _mm256_srli_epi32(rowMax, 16)), lowHalves);
+
+					// Packs per 128 bit half, the first and third 64 bits are the 8 voxels in order.
+					const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(rowMax, rowMax), _MM_SHUFFLE(3, 1, 2, 0));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(mip + (z * kBrickMipSize + y) * kBrickMipSize), _mm256_castsi256_si128(packed));
+				}
+		}
+
+		static AFRE_AVX2 void FillBoxAvx2(glm::uint16_t* voxels, const glm::uvec3& min, const glm::uvec3& max, glm::uint16_t voxel)
+		{
+			if (min.x >= max.x) return;
+
+			// Lanes at or past min and before max.
+			const __m256i lanes = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+			const __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi16(lanes, _mm256_set1_epi16(static_cast<short>(min.x) - 1)), _mm256_cmpgt_epi16(_mm256_set1_epi16(static_cast<short>(max.x)), lanes));
+			const __m256i value = _mm256_set1_epi16(static_cast<short>(voxel));
+
+			for (uint32_t z = min.z; z < max.z; z++)
+				for (uint32_t y = min.y; y < max.y; y++)
+				{
+					__m256i* row = reinterpret_cast<__m256i*>(voxels + GetLinearBrickVoxelIndex(0, y, z));
+					_mm256_storeu_si256(row, _mm256_blendv_epi8(_mm256_loadu_si256(row), value, mask));
+				}
+		}
+	#endif
+
+	BrickKernels GetAvx2BrickKernels()
+	{
+		BrickKernels kernels = GetScalarBrickKernels();
+		kernels.m_name = "AVX2";
+		kernels.m_countNonAir = CountNonAirAvx2;
+		kernels.m_isUniform = IsUniformAvx2;
+		kernels.m_buildOccupancy = BuildOccupancyAvx2;
+		kernels.m_equal = EqualAvx2;
+		kernels.m_diff = DiffAvx2;
+
+		#if AFRE_BRICK_LAYOUT == AFRE_BRICK_LAYOUT_LINEAR
+			kernels.m_downsample = DownsampleAvx2;
+			kernels.m_fillBox = FillBoxAvx2;
+		#endif
+
+		return kernels;
+	}
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "brick_kernels_simd.h"
+
+#ifdef AFRE_SIMD_X86
+
+#include <immintrin.h>
+
+#define AFRE_AVX512 AFRE_SIMD_TARGET("avx512f,avx512bw,avx2,popcnt")
+
+namespace afre
+{
+	static AFRE_AVX512 inline __m512i Load(const glm::uint16_t* voxels)
+	{
+		return _mm512_loadu_si512(voxels);
+	}
+
+	static AFRE_AVX512 glm::uint32_t CountNonAirAvx512(const glm::uint16_t* voxels)
+	{
+		const __m512i zero = _mm512_setzero_si512();
+
+		glm::uint32_t count = 0;
+		for (uint32_t i = 0; i < kBrickVoxelCount; i += 64)
+		{
+			const glm::uint64_t low = _mm512_cmpneq_epi16_mask(Load(voxels + i), zero);
+			const glm::uint64_t high = _mm512_cmpneq_epi16_mask(Load(voxels + i + 32), zero);
+			count += static_cast<glm::uint32_t>(_mm_popcnt_u64(low | (high << 32)));
+		}
+
+		return count;
+	}
+
+	static AFRE_AVX512 bool IsUniformAvx512(const glm::uint16_t* voxels)
+	{
+		const __m512i first = _mm512_set1_epi16(static_cast<short>(voxels[0]));
+
+		for (uint32_t block = 0; block < kBrickVoxelCount; block += 256)
+		{
+			__m512i differences = _mm512_setzero_si512();
+			for (uint32_t i = block; i < block + 256; i += 32) differences = _mm512_or_si512(differences, _mm512_xor_si512(Load(voxels + i), first));
+
+			if (_mm512_test_epi64_mask(differences, differences)) return false;
+		}
+
+		return true;
+	}
+
+	static AFRE_AVX512 void BuildOccupancyAvx512(const glm::uint16_t* voxels, glm::uint64_t* occupancy)
+	{
+		const __m512i zero = _mm512_setzero_si512();
+
+		for (uint32_t word = 0; word < kBrickOccupancyWords; word++)
+		{
+			const glm::uint64_t low = _mm512_cmpneq_epi16_mask(Load(voxels + word * 64), zero);
+			const glm::uint64_t high = _mm512_cmpneq_epi16_mask(Load(voxels + word * 64 + 32), zero);
+			occupancy[word] = low | (high << 32);
+		}
+	}
+
+	static AFRE_AVX512 bool EqualAvx512(const glm::uint16_t* a, const glm::uint16_t* b)
+	{
+		for (uint32_t block = 0; block < kBrickVoxelCount; block += 256)
+		{
+			__m512i differences = _mm512_setzero_si512();
+			for (uint32_t i = block; i < block + 256; i += 32) differences = _mm512_or_si512(differences, _mm512_xor_si512(Load(a + i), Load(b + i)));
+
+			if (_mm512_test_epi64_mask(differences, differences)) return false;
+		}
+
+		return true;
+	}
+
+	static AFRE_AVX512 glm::uint32_t DiffAvx512(const glm::uint16_t* a, const glm::uint16_t* b, glm::uint64_t* changed)
+	{
+		glm::uint32_t count = 0;
+		for (uint32_t word = 0; word < kBrickOccupancyWords; word++)
+		{
+			const uint32_t i = word * 64;
+			const glm::uint64_t low = _mm512_cmpneq_epi16_mask(Load(a + i), Load(b + i));
+			const glm::uint64_t high = _mm512_cmpneq_epi16_mask(Load(a + i + 32), Load(b + i + 32));
+
+			changed[word] = low | (high << 32);
+			count += static_cast<glm::uint32_t>(_mm_popcnt_u64(changed[word]));
+		}
+
+		return count;
+	}
+
+	#if AFRE_BRICK_LAYOUT == AFRE_BRICK_LAYOUT_LINEAR
+		// A register holds rows y and y + 1, so the max of two covers the 2x2x2 blocks of a mip row in its halves.
+		static AFRE_AVX512 void DownsampleAvx512(const glm::uint16_t* voxels, glm::uint16_t* mip)
+		{
+			const __m256i lowHalves = _mm256_set1_epi32(0xFFFF);
+
+			for (uint32_t z = 0; z < kBrickMipSize; z++)
+				for (uint32_t y = 0; y < kBrickMipSize; y++)
+				{
+					const glm::uint16_t* row = voxels + GetLinearBrickVoxelIndex(0, y * 2, z * 2);
+
+					// Zero masked extracts, GCC builds the plain ones and the 256 bit cast on an uninitialized register and warns.
+					const __m512i rows = _mm512_max_epu16(Load(row), Load(row + 256));
+					const __m256i lowRows = _mm512_maskz_extracti64x4_epi64(0xFF, rows, 0);
+					const __m256i highRows = _mm512_maskz_extracti64x4_epi64(0xFF, rows, 1);
+
+					__m256i rowMax = _mm256_max_epu16(lowRows, highRows);
+					rowMax = _mm256_and_si256(_mm256_max_epu16(rowMax, _mm256_srli_epi32(rowMax, 16)), lowHalves);
+
+					const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(rowMax, rowMax), _MM_SHUFFLE(3, 1, 2, 0));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(mip + (z * kBrickMipSize + y) * kBrickMipSize), _mm256_castsi256_si128(packed));
+				}
+		}
+
+		// Two rows per masked store.
+		static AFRE_AVX512 void FillBoxAvx512(glm::uint16_t* voxels, const glm::uvec3& min, const glm::uvec3& max, glm::uint16_t voxel)
+		{
+			if (min.x >= max.x || min.y >= max.y) return;
+
+			const glm::uint32_t rowMask = ((1u << max.x) - 1) & ~((1u << min.x) - 1);
+			const __m512i value = _mm512_set1_epi16(static_cast<short>(voxel));
+
+			for (uint32_t z = min.z; z < max.z; z++)
+				for (uint32_t y = min.y & ~1u; y < max.y; y += 2)
+				{
+					const glm::uint32_t lowRow = y >= min.y ? rowMask : 0;
+					const glm::uint32_t highRow = y + 1 < max.y ? rowMask : 0;
+
+					_mm512_mask_storeu_epi16(voxels + GetLinearBrickVoxelIndex(0, y, z), lowRow | (highRow << 16), value);
+				}
+		}
+	#endif
+
+	BrickKernels GetAvx512BrickKernels()
+	{
+		BrickKernels kernels = GetScalarBrickKernels();
+		kernels.m_name = "AVX-512";
+		kernels.m_countNonAir = CountNonAirAvx512;
+		kernels.m_isUniform = IsUniformAvx512;
+		kernels.m_buildOccupancy = BuildOccupancyAvx512;
+		kernels.m_equal = EqualAvx512;
+		kernels.m_diff = DiffAvx512;
+
+		#if AFRE_BRICK_LAYOUT == AFRE_BRICK_LAYOUT_LINEAR
+			kernels.m_downsample = DownsampleAvx512;
+			kernels.m_fillBox = FillBoxAvx512;
+		#endif
+
+		return kernels;
+	}
+}
+
+#endif
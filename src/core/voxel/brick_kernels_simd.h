@@ -0,0 +1,31 @@
+#pragma once
+
+#include "brick_kernels.h"
+
+// Only included by the brick_kernels*.cpp files.
+
+// 64 bit only, the kernels count bits with 64 bit popcnt. They're written for rows of 16 voxels, other brick
+// sizes stay scalar.
+#if (defined(__x86_64__) || defined(_M_X64)) && AFRE_BRICK_SIZE == 16
+	#define AFRE_SIMD_X86
+#endif
+
+// Each kernel is compiled for its own instruction set, the rest of the file isn't, so nothing leaks into
+// code that runs before the dispatch checked the CPU. MSVC needs no flags for intrinsics.
+#if defined(_MSC_VER) && !defined(__clang__)
+	#define AFRE_SIMD_TARGET(isa)
+#else
+	#define AFRE_SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace afre
+{
+	// The scalar reference. The vector tables start as a copy of it and replace what they implement.
+	BrickKernels GetScalarBrickKernels();
+
+	#ifdef AFRE_SIMD_X86
+		BrickKernels GetSse42BrickKernels();
+		BrickKernels GetAvx2BrickKernels();
+		BrickKernels GetAvx512BrickKernels();
+	#endif
+}
@@ -0,0 +1,165 @@
+#include "brick_kernels_simd.h"
+
+#ifdef AFRE_SIMD_X86
+
+#include <nmmintrin.h>
+
+#define AFRE_SSE42 AFRE_SIMD_TARGET("sse4.2,popcnt")
+
+namespace afre
+{
+	static inline __m128i Load(const glm::uint16_t* voxels)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(voxels));
+	}
+
+	static AFRE_SSE42 glm::uint32_t CountNonAirSse42(const glm::uint16_t* voxels)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		// Compares give -1 for air, subtracting them counts it per lane, 512 at most.
+		__m128i airCounts = _mm_setzero_si128();
+		for (uint32_t i = 0; i < kBrickVoxelCount; i += 8) airCounts = _mm_sub_epi16(airCounts, _mm_cmpeq_epi16(Load(voxels + i), zero));
+
+		__m128i sums = _mm_madd_epi16(airCounts, _mm_set1_epi16(1));
+		sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+		sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		return kBrickVoxelCount - static_cast<glm::uint32_t>(_mm_cvtsi128_si32(sums));
+	}
+
+	static AFRE_SSE42 bool IsUniformSse42(const glm::uint16_t* voxels)
+	{
+		const __m128i first = _mm_set1_epi16(static_cast<short>(voxels[0]));
+
+		for (uint32_t block = 0; block < kBrickVoxelCount; block += 64)
+		{
+			__m128i differences = _mm_setzero_si128();
+			for (uint32_t i = block; i < block + 64; i += 8) differences = _mm_or_si128(differences, _mm_xor_si128(Load(voxels + i), first));
+
+			if (!_mm_testz_si128(differences, differences)) return false;
+		}
+
+		return true;
+	}
+
+	// Bit per lane where the compare was true, for 16 voxels.
+	static AFRE_SSE42 glm::uint32_t GetMask16(__m128i low, __m128i high)
+	{
+		return static_cast<glm::uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(low, high)));
+	}
+
+	static AFRE_SSE42 void BuildOccupancySse42(const glm::uint16_t* voxels, glm::uint64_t* occupancy)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		for (uint32_t word = 0; word < kBrickOccupancyWords; word++)
+		{
+			glm::uint64_t air = 0;
+			for (uint32_t part = 0; part < 4; part++)
+			{
+				const glm::uint16_t* partVoxels = voxels + word * 64 + part * 16;
+				air |= static_cast<glm::uint64_t>(GetMask16(_mm_cmpeq_epi16(Load(partVoxels), zero), _mm_cmpeq_epi16(Load(partVoxels + 8), zero))) << (part * 16);
+			}
+
+			occupancy[word] = ~air;
+		}
+	}
+
+	static AFRE_SSE42 bool EqualSse42(const glm::uint16_t* a, const glm::uint16_t* b)
+	{
+		for (uint32_t block = 0; block < kBrickVoxelCount; block += 64)
+		{
+			__m128i differences = _mm_setzero_si128();
+			for (uint32_t i = block; i < block + 64; i += 8) differences = _mm_or_si128(differences, _mm_xor_si128(Load(a + i), Load(b + i)));
+
+			if (!_mm_testz_si128(differences, differences)) return false;
+		}
+
+		return true;
+	}
+
+	static AFRE_SSE42 glm::uint32_t DiffSse42(const glm::uint16_t* a, const glm::uint16_t* b, glm::uint64_t* changed)
+	{
+		glm::uint32_t count = 0;
+		for (uint32_t word = 0; word < kBrickOccupancyWords; word++)
+		{
+			glm::uint64_t same = 0;
+			for (uint32_t part = 0; part < 4; part++)
+			{
+				const uint32_t i = word * 64 + part * 16;
+				same |= static_cast<glm::uint64_t>(GetMask16(_mm_cmpeq_epi16(Load(a + i), Load(b + i)), _mm_cmpeq_epi16(Load(a + i + 8), Load(b + i + 8)))) << (part * 16);
+			}
+
+			changed[word] = ~same;
+			count += static_cast<glm::uint32_t>(_mm_popcnt_u64(~same));
+		}
+
+		return count;
+	}
+
+	#if AFRE_BRICK_LAYOUT == AFRE_BRICK_LAYOUT_LINEAR
+		// Max of the four rows under a mip row, then of each pair of lanes, packed down to 8 voxels.
+		static AFRE_SSE42 void DownsampleSse42(const glm::uint16_t* voxels, glm::uint16_t* mip)
+		{
+			const __m128i lowHalves = _mm_set1_epi32(0xFFFF);
+
+			for (uint32_t z = 0; z < kBrickMipSize; z++)
+				for (uint32_t y = 0; y < kBrickMipSize; y++)
+				{
+					const glm::uint16_t* row = voxels + GetLinearBrickVoxelIndex(0, y * 2, z * 2);
+
+					__m128i low = _mm_max_epu16(_mm_max_epu16(Load(row), Load(row + 16)), _mm_max_epu16(Load(row + 256), Load(row + 272)));
+					__m128i high = _mm_max_epu16(_mm_max_epu16(Load(row + 8), Load(row + 24)), _mm_max_epu16(Load(row + 264), Load(row + 280)));
+
+					low = _mm_and_si128(_mm_max_epu16(low, _mm_srli_epi32(low, 16)), lowHalves);
+					high = _mm_and_si128(_mm_max_epu16(high, _mm_srli_epi32(high, 16)), lowHalves);
+
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(mip + (z * kBrickMipSize + y) * kBrickMipSize), _mm_packus_epi32(low, high));
+				}
+		}
+
+		static AFRE_SSE42 void FillBoxSse42(glm::uint16_t* voxels, const glm::uvec3& min, const glm::uvec3& max, glm::uint16_t voxel)
+		{
+			if (min.x >= max.x) return;
+
+			// Lanes at or past min and before max.
+			const __m128i lanes = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+			const __m128i first = _mm_set1_epi16(static_cast<short>(min.x) - 1);
+			const __m128i end = _mm_set1_epi16(static_cast<short>(max.x));
+			const __m128i lowMask = _mm_and_si128(_mm_cmpgt_epi16(lanes, first), _mm_cmpgt_epi16(end, lanes));
+			const __m128i highLanes = _mm_add_epi16(lanes, _mm_set1_epi16(8));
+			const __m128i highMask = _mm_and_si128(_mm_cmpgt_epi16(highLanes, first), _mm_cmpgt_epi16(end, highLanes));
+
+			const __m128i value = _mm_set1_epi16(static_cast<short>(voxel));
+
+			for (uint32_t z = min.z; z < max.z; z++)
+				for (uint32_t y = min.y; y < max.y; y++)
+				{
+					__m128i* row = reinterpret_cast<__m128i*>(voxels + GetLinearBrickVoxelIndex(0, y, z));
+					_mm_storeu_si128(row, _mm_blendv_epi8(_mm_loadu_si128(row), value, lowMask));
+					_mm_storeu_si128(row + 1, _mm_blendv_epi8(_mm_loadu_si128(row + 1), value, highMask));
+				}
+		}
+	#endif
+
+	BrickKernels GetSse42BrickKernels()
+	{
+		BrickKernels kernels = GetScalarBrickKernels();
+		kernels.m_name = "SSE4.2";
+		kernels.m_countNonAir = CountNonAirSse42;
+		kernels.m_isUniform = IsUniformSse42;
+		kernels.m_buildOccupancy = BuildOccupancySse42;
+		kernels.m_equal = EqualSse42;
+		kernels.m_diff = DiffSse42;
+
+		#if AFRE_BRICK_LAYOUT == AFRE_BRICK_LAYOUT_LINEAR
+			kernels.m_downsample = DownsampleSse42;
+			kernels.m_fillBox = FillBoxSse42;
+		#endif
+
+		return kernels;
+	}
+}
+
+#endif
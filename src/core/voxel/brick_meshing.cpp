@@ -0,0 +1,429 @@
+#include "brick_meshing.h"
+#include <algorithm>
+
+namespace afre
+{
+	// The brick with a voxel of its neighbours on every side, x fastest.
+	static constexpr int32_t kPaddedSize = kBrickSize + 2;
+	static constexpr int32_t kPaddedStrides[3] = { 1, kPaddedSize, kPaddedSize * kPaddedSize };
+	// A bit per voxel of a row, shifted down from all ones so 32 voxel rows don't shift by 32.
+	static constexpr uint32_t kFullRow = ~0u >> (32 - kBrickSize);
+
+	static glm::ivec3 GetBrickPosition(const glm::uvec3& sizeInBricks, uint32_t brickIndex)
+	{
+		return glm::ivec3(brickIndex % sizeInBricks.x, (brickIndex / sizeInBricks.x) % sizeInBricks.y, brickIndex / (sizeInBricks.x * sizeInBricks.y));
+	}
+
+	static int32_t GetPaddedIndex(const glm::ivec3& local)
+	{
+		return (local.z + 1) * kPaddedStrides[2] + (local.y + 1) * kPaddedStrides[1] + local.x + 1;
+	}
+
+	void MeshBrick(const WorldSnapshot& snapshot, uint32_t brickIndex, const std::vector<glm::uint8_t>& opaque, BrickMesh& brickMesh)
+	{
+		brickMesh.m_quads.clear();
+		brickMesh.m_version = GetBrickMeshVersion(snapshot, brickIndex);
+		brickMesh.m_hasClearVoxels = false;
+
+		const Brick& brick = snapshot.GetBrick(brickIndex);
+		const glm::ivec3 sizeInBricks = glm::ivec3(snapshot.GetSizeInBricks());
+		const glm::ivec3 brickPosition = GetBrickPosition(snapshot.GetSizeInBricks(), brickIndex);
+
+		// Most bricks of a world are all air or all ground, those only need their border looked at.
+		const glm::uint16_t firstVoxel = brick.m_voxels[0];
+		const bool uniform = std::all_of(brick.m_voxels, brick.m_voxels + kBrickVoxelCount, [&](glm::uint16_t voxel) { return voxel == firstVoxel; });
+
+		if (uniform && !opaque[firstVoxel])
+		{
+			brickMesh.m_hasClearVoxels = firstVoxel != 0;
+			return;
+		}
+
+		glm::uint16_t voxels[kPaddedSize * kPaddedSize * kPaddedSize]{};
+
+		for (int32_t z = 0; z < kBrickSize; z++)
+		{
+			for (int32_t y = 0; y < kBrickSize; y++)
+			{
+				glm::uint16_t* row = &voxels[GetPaddedIndex({ 0, y, z })];
+
+				if (uniform)
+				{
+					std::fill_n(row, kBrickSize, firstVoxel);
+					continue;
+				}
+
+				for (int32_t x = 0; x < kBrickSize; x++)
+				{
+					const glm::uint16_t voxel = brick.At(glm::uvec3(x, y, z));
+					row[x] = voxel;
+
+					if (voxel != 0 && !opaque[voxel]) brickMesh.m_hasClearVoxels = true;
+				}
+			}
+		}
+
+		// Faces only ever look at the neighbour straight across, so the edges and corners of the border stay unset.
+		// Outside the snapshot stays air.
+		for (int32_t axis = 0; axis < 3; axis++)
+		{
+			const int32_t u = (axis + 1) % 3;
+			const int32_t v = (axis + 2) % 3;
+
+			for (int32_t side = -1; side <= kBrickSize; side += kBrickSize + 1)
+			{
+				glm::ivec3 neighborPosition = brickPosition;
+				neighborPosition[axis] += side < 0 ? -1 : 1;
+				if (neighborPosition[axis] < 0 || neighborPosition[axis] >= sizeInBricks[axis]) continue;
+
+				const Brick& neighbor = snapshot.GetBrick(static_cast<uint32_t>((neighborPosition.z * sizeInBricks.y + neighborPosition.y) * sizeInBricks.x + neighborPosition.x));
+
+				for (int32_t j = 0; j < kBrickSize; j++)
+				{
+					for (int32_t i = 0; i < kBrickSize; i++)
+					{
+						glm::ivec3 local{};
+						local[axis] = side;
+						local[u] = i;
+						local[v] = j;
+
+						glm::ivec3 neighborLocal = local;
+						neighborLocal[axis] = side < 0 ? kBrickSize - 1 : 0;
+
+						voxels[GetPaddedIndex(local)] = neighbor.At(glm::uvec3(neighborLocal));
+					}
+				}
+			}
+		}
+
+		for (int32_t axis = 0; axis < 3; axis++)
+		{
+			const int32_t u = (axis + 1) % 3;
+			const int32_t v = (axis + 2) % 3;
+
+			// Opaque bits of the rows along u, by padded position along axis and v. The border slices along axis
+			// are what the faces of the first and last slice look at.
+			uint32_t solidRows[kPaddedSize][kBrickSize]{};
+			for (int32_t slice = 0; slice < kPaddedSize; slice++)
+			{
+				const bool border = slice == 0 || slice == kPaddedSize - 1;
+
+				for (int32_t j = 0; j < kBrickSize; j++)
+				{
+					if (uniform && !border)
+					{
+						solidRows[slice][j] = kFullRow;
+						continue;
+					}
+
+					const int32_t rowIndex = slice * kPaddedStrides[axis] + (j + 1) * kPaddedStrides[v] + kPaddedStrides[u];
+
+					uint32_t bits = 0;
+					for (int32_t i = 0; i < kBrickSize; i++) bits |= static_cast<uint32_t>(opaque[voxels[rowIndex + i * kPaddedStrides[u]]]) << i;
+
+					solidRows[slice][j] = bits;
+				}
+			}
+
+			for (int32_t side = 0; side < 2; side++)
+			{
+				const uint32_t face = static_cast<uint32_t>(axis * 2 + side);
+				const int32_t neighborSlice = side == 0 ? 2 : 0;
+
+				for (int32_t slice = 0; slice < kBrickSize; slice++)
+				{
+					// Faces visible in this slice, a bit per voxel of each row.
+					uint32_t faceRows[kBrickSize];
+					uint32_t anyFace = 0;
+					for (int32_t j = 0; j < kBrickSize; j++)
+					{
+						faceRows[j] = solidRows[slice + 1][j] & ~solidRows[slice + neighborSlice][j];
+						anyFace |= faceRows[j];
+					}
+
+					if (anyFace == 0) continue;
+
+					const int32_t sliceIndex = (slice + 1) * kPaddedStrides[axis] + kPaddedStrides[u] + kPaddedStrides[v];
+					const auto getVoxel = [&](int32_t i, int32_t j) { return voxels[sliceIndex + j * kPaddedStrides[v] + i * kPaddedStrides[u]]; };
+
+					// Widest run first, then as many rows of the same run as there are.
+					for (int32_t j = 0; j < kBrickSize; j++)
+					{
+						int32_t i = 0;
+						while (faceRows[j] != 0)
+						{
+							while (((faceRows[j] >> i) & 1u) == 0) i++;
+
+							const glm::uint16_t voxel = getVoxel(i, j);
+
+							int32_t width = 1;
+							while (i + width < kBrickSize && ((faceRows[j] >> (i + width)) & 1u) != 0 && getVoxel(i + width, j) == voxel) width++;
+
+							const uint32_t runBits = (~0u >> (32 - width)) << i;
+
+							int32_t height = 1;
+							while (j + height < kBrickSize && (faceRows[j + height] & runBits) == runBits)
+							{
+								bool sameVoxel = true;
+								for (int32_t w = 0; w < width && sameVoxel; w++) sameVoxel = getVoxel(i + w, j + height) == voxel;
+								if (!sameVoxel) break;
+
+								height++;
+							}
+
+							for (int32_t h = 0; h < height; h++) faceRows[j + h] &= ~runBits;
+
+							glm::ivec3 local{};
+							local[axis] = slice;
+							local[u] = i;
+							local[v] = j;
+
+							BrickQuad quad{};
+							quad.m_x = static_cast<glm::uint8_t>(local.x);
+							quad.m_y = static_cast<glm::uint8_t>(local.y);
+							quad.m_z = static_cast<glm::uint8_t>(local.z);
+							quad.m_face = static_cast<glm::uint8_t>(face);
+							quad.m_width = static_cast<glm::uint8_t>(width);
+							quad.m_height = static_cast<glm::uint8_t>(height);
+							quad.m_voxel = voxel;
+							brickMesh.m_quads.push_back(quad);
+
+							i += width;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	uint64_t GetBrickMeshVersion(const WorldSnapshot& snapshot, uint32_t brickIndex)
+	{
+		static const glm::ivec3 s_neighborOffsets[6] =
+		{
+			{ 1, 0, 0 }, { -1, 0, 0 },
+			{ 0, 1, 0 }, { 0, -1, 0 },
+			{ 0, 0, 1 }, { 0, 0, -1 }
+		};
+
+		const glm::ivec3 sizeInBricks = glm::ivec3(snapshot.GetSizeInBricks());
+		const glm::ivec3 brickPosition = GetBrickPosition(snapshot.GetSizeInBricks(), brickIndex);
+
+		// Versions only go up, so the highest one changes whenever any of the seven bricks does.
+		uint64_t version = snapshot.GetBrickVersion(brickIndex);
+		for (const glm::ivec3& offset : s_neighborOffsets)
+		{
+			const glm::ivec3 neighbor = brickPosition + offset;
+			if (neighbor.x < 0 || neighbor.y < 0 || neighbor.z < 0 || neighbor.x >= sizeInBricks.x || neighbor.y >= sizeInBricks.y || neighbor.z >= sizeInBricks.z) continue;
+
+			version = std::max(version, snapshot.GetBrickVersion(static_cast<uint32_t>((neighbor.z * sizeInBricks.y + neighbor.y) * sizeInBricks.x + neighbor.x)));
+		}
+
+		return version;
+	}
+
+	BrickMeshCache::BrickMeshCache(uint32_t workerCount) : m_workerCount(std::max(workerCount, 1u))
+	{
+		std::vector<glm::uint8_t> opaque(kMaxMaterials, 1);
+		opaque[0] = 0;
+
+		m_opaque = std::make_shared<const std::vector<glm::uint8_t>>(std::move(opaque));
+	}
+
+	BrickMeshCache::~BrickMeshCache()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_stop = true;
+		}
+
+		m_condition.notify_all();
+
+		for (std::thread& worker : m_workers) worker.join();
+	}
+
+	void BrickMeshCache::SetVoxelOpaque(glm::uint16_t voxel, bool opaque)
+	{
+		if (voxel == 0 || ((*m_opaque)[voxel] != 0) == opaque) return;
+
+		// Jobs in flight keep the table they were queued with.
+		std::vector<glm::uint8_t> newOpaque = *m_opaque;
+		newOpaque[voxel] = opaque ? 1 : 0;
+		m_opaque = std::make_shared<const std::vector<glm::uint8_t>>(std::move(newOpaque));
+
+		ClearMeshes();
+	}
+
+	void BrickMeshCache::SetSnapshot(std::shared_ptr<const WorldSnapshot> snapshot)
+	{
+		const bool resized = !m_snapshot || m_snapshot->GetSizeInBricks() != snapshot->GetSizeInBricks();
+
+		m_snapshot = std::move(snapshot);
+
+		if (resized)
+		{
+			m_meshes.assign(m_snapshot->GetBrickCount(), CachedMesh{});
+			ClearMeshes();
+		}
+	}
+
+	void BrickMeshCache::Rebuild(std::shared_ptr<const WorldSnapshot> snapshot)
+	{
+		m_snapshot = std::move(snapshot);
+		m_meshes.resize(m_snapshot->GetBrickCount());
+
+		ClearMeshes();
+	}
+
+	void BrickMeshCache::ClearMeshes()
+	{
+		m_generation++;
+		m_meshedBrickCount = 0;
+
+		for (CachedMesh& cachedMesh : m_meshes)
+		{
+			cachedMesh.m_valid = false;
+			cachedMesh.m_requested = false;
+		}
+
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_jobs.clear();
+	}
+
+	void BrickMeshCache::RequestMeshes(const std::vector<uint32_t>& brickIndices)
+	{
+		if (!m_snapshot) return;
+
+		bool queued = false;
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+
+			for (const uint32_t brickIndex : brickIndices)
+			{
+				if (brickIndex >= m_meshes.size()) continue;
+
+				CachedMesh& cachedMesh = m_meshes[brickIndex];
+				const uint64_t version = GetBrickMeshVersion(*m_snapshot, brickIndex);
+
+				if (cachedMesh.m_valid && cachedMesh.m_mesh.m_version == version) continue;
+				if (cachedMesh.m_requested && cachedMesh.m_requestedVersion == version) continue;
+
+				cachedMesh.m_requested = true;
+				cachedMesh.m_requestedVersion = version;
+
+				MeshJob job{};
+				job.m_brickIndex = brickIndex;
+				job.m_generation = m_generation;
+				job.m_snapshot = m_snapshot;
+				job.m_opaque = m_opaque;
+				m_jobs.push_back(std::move(job));
+
+				queued = true;
+			}
+		}
+
+		if (!queued) return;
+
+		while (m_workers.size() < m_workerCount) m_workers.emplace_back(&BrickMeshCache::WorkerLoop, this);
+
+		m_condition.notify_all();
+	}
+
+	bool BrickMeshCache::TakeFinishedMeshes()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_taken.swap(m_finished);
+		}
+
+		bool taken = false;
+		for (FinishedMesh& finishedMesh : m_taken)
+		{
+			if (finishedMesh.m_generation != m_generation) continue;
+
+			CachedMesh& cachedMesh = m_meshes[finishedMesh.m_brickIndex];
+			if (cachedMesh.m_requestedVersion == finishedMesh.m_mesh.m_version) cachedMesh.m_requested = false;
+
+			// An older job finishing after a newer one doesn't replace it.
+			if (cachedMesh.m_valid && cachedMesh.m_mesh.m_version > finishedMesh.m_mesh.m_version) continue;
+
+			if (!cachedMesh.m_valid) m_meshedBrickCount++;
+
+			cachedMesh.m_mesh = std::move(finishedMesh.m_mesh);
+			cachedMesh.m_valid = true;
+			taken = true;
+		}
+
+		m_taken.clear();
+
+		return taken;
+	}
+
+	const BrickMesh* BrickMeshCache::GetMesh(uint32_t brickIndex) const
+	{
+		if (!m_snapshot || brickIndex >= m_meshes.size()) return nullptr;
+
+		const CachedMesh& cachedMesh = m_meshes[brickIndex];
+		if (!cachedMesh.m_valid || cachedMesh.m_mesh.m_version != GetBrickMeshVersion(*m_snapshot, brickIndex)) return nullptr;
+
+		return &cachedMesh.m_mesh;
+	}
+
+	void BrickMeshCache::WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		m_idleCondition.wait(lock, [&]() { return m_jobs.empty() && m_busyWorkers == 0; });
+	}
+
+	void BrickMeshCache::WorkerLoop()
+	{
+		MeshJob job{};
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ m_mutex };
+				m_condition.wait(lock, [&]() { return m_stop || !m_jobs.empty(); });
+
+				if (m_stop) return;
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+				m_busyWorkers++;
+			}
+
+			FinishedMesh finishedMesh{};
+			finishedMesh.m_brickIndex = job.m_brickIndex;
+			finishedMesh.m_generation = job.m_generation;
+			MeshBrick(*job.m_snapshot, job.m_brickIndex, *job.m_opaque, finishedMesh.m_mesh);
+
+			// Not holding on to a world version the game has moved past.
+			job.m_snapshot.reset();
+			job.m_opaque.reset();
+
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				m_finished.push_back(std::move(finishedMesh));
+				m_busyWorkers--;
+			}
+
+			m_idleCondition.notify_all();
+		}
+	}
+
+	void SelectRasterBricks(const HybridRenderBands& bands, const glm::vec3& cameraPosition, const glm::uvec3& sizeInBricks, const glm::vec3& origin,
+		const std::vector<uint32_t>& brickIndices, std::vector<uint32_t>& rasterBricks)
+	{
+		rasterBricks.clear();
+
+		if (bands.m_rasterBands == 0 || bands.m_bandWidth <= 0.f) return;
+
+		for (const uint32_t brickIndex : brickIndices)
+		{
+			const glm::vec3 brickMin = origin + glm::vec3(GetBrickPosition(sizeInBricks, brickIndex)) * static_cast<float>(kBrickSize);
+			const glm::vec3 nearest = glm::clamp(cameraPosition, brickMin, brickMin + static_cast<float>(kBrickSize));
+
+			const uint32_t band = static_cast<uint32_t>(glm::length(nearest - cameraPosition) / bands.m_bandWidth);
+			if (band < 32 && (bands.m_rasterBands >> band) & 1u) rasterBricks.push_back(brickIndex);
+		}
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "world_snapshot.h"
+
+namespace afre
+{
+	// Face f looks along axis f / 2, towards + for even f. Same numbering as the shader's mesh pass.
+	constexpr uint32_t kBrickFaceCount = 6;
+
+	// A merged rectangle of faces of one voxel value, in brick local voxels. The rectangle spans m_width voxels
+	// along axis (f / 2 + 1) % 3 and m_height along (f / 2 + 2) % 3 from the voxel at m_x, m_y, m_z.
+	struct BrickQuad
+	{
+		glm::uint8_t m_x = 0;
+		glm::uint8_t m_y = 0;
+		glm::uint8_t m_z = 0;
+		glm::uint8_t m_face = 0;
+		glm::uint8_t m_width = 0;
+		glm::uint8_t m_height = 0;
+		glm::uint16_t m_voxel = 0;
+	};
+
+	struct BrickMesh
+	{
+		std::vector<BrickQuad> m_quads{};
+		// Highest version of the brick and its six neighbours when it was meshed, their voxels decide which faces show.
+		uint64_t m_version = 0;
+		// Clear voxels aren't meshed, a brick with any has to stay with the ray march to tint what's behind them.
+		bool m_hasClearVoxels = false;
+	};
+
+	// Greedy meshes the faces of opaque voxels that border a non opaque one. Outside the snapshot counts as air.
+	// opaque has one entry per voxel value.
+	void MeshBrick(const WorldSnapshot& snapshot, uint32_t brickIndex, const std::vector<glm::uint8_t>& opaque, BrickMesh& brickMesh);
+
+	inline GpuMeshQuad ToGpuMeshQuad(const BrickQuad& quad, const glm::ivec3& brickMin)
+	{
+		GpuMeshQuad gpuMeshQuad{};
+		gpuMeshQuad.m_min = brickMin + glm::ivec3(quad.m_x, quad.m_y, quad.m_z);
+		gpuMeshQuad.m_packed = quad.m_voxel | (static_cast<glm::uint32_t>(quad.m_face) << 16) | (static_cast<glm::uint32_t>(quad.m_width - 1) << 19) | (static_cast<glm::uint32_t>(quad.m_height - 1) << (19 + kBrickSizeBits));
+
+		return gpuMeshQuad;
+	}
+
+	// The version a brick's mesh has to be at to still match the snapshot.
+	uint64_t GetBrickMeshVersion(const WorldSnapshot& snapshot, uint32_t brickIndex);
+
+	// Meshes bricks on worker threads and keeps the result per brick until the brick or a neighbour changes.
+	class BrickMeshCache
+	{
+	public:
+		explicit BrickMeshCache(uint32_t workerCount = 2);
+		~BrickMeshCache();
+
+		BrickMeshCache(const BrickMeshCache&) = delete;
+		BrickMeshCache& operator=(const BrickMeshCache&) = delete;
+
+		// Voxels without a value set are opaque, air never is. Drops every cached mesh when it changes anything.
+		void SetVoxelOpaque(glm::uint16_t voxel, bool opaque);
+
+		// Meshes of bricks whose version didn't change are kept. Snapshots from CopyFrom have no versions,
+		// use Rebuild for those.
+		void SetSnapshot(std::shared_ptr<const WorldSnapshot> snapshot);
+		// Drops every cached mesh.
+		void Rebuild(std::shared_ptr<const WorldSnapshot> snapshot);
+
+		// Queues the bricks without an up to date mesh that aren't already being meshed. Doesn't wait.
+		void RequestMeshes(const std::vector<uint32_t>& brickIndices);
+
+		// Moves the meshes the workers finished into the cache, true if there were any.
+		bool TakeFinishedMeshes();
+
+		// Null until the brick has a mesh matching the current snapshot.
+		const BrickMesh* GetMesh(uint32_t brickIndex) const;
+
+		void WaitIdle();
+
+		inline uint32_t GetMeshedBrickCount() const { return m_meshedBrickCount; }
+
+	private:
+		struct MeshJob
+		{
+			uint32_t m_brickIndex = 0;
+			uint64_t m_generation = 0;
+			std::shared_ptr<const WorldSnapshot> m_snapshot{};
+			std::shared_ptr<const std::vector<glm::uint8_t>> m_opaque{};
+		};
+
+		struct FinishedMesh
+		{
+			uint32_t m_brickIndex = 0;
+			uint64_t m_generation = 0;
+			BrickMesh m_mesh{};
+		};
+
+		struct CachedMesh
+		{
+			BrickMesh m_mesh{};
+			bool m_valid = false;
+			// Version of the job in flight for the brick, so it isn't queued twice.
+			uint64_t m_requestedVersion = 0;
+			bool m_requested = false;
+		};
+
+		void WorkerLoop();
+		void ClearMeshes();
+
+		uint32_t m_workerCount = 0;
+
+		// Owned by the caller's thread
+		std::shared_ptr<const WorldSnapshot> m_snapshot{};
+		std::shared_ptr<const std::vector<glm::uint8_t>> m_opaque{};
+		std::vector<CachedMesh> m_meshes{};
+		// Bumped by everything that drops the cache, finished jobs from an older one are thrown away.
+		uint64_t m_generation = 0;
+		uint32_t m_meshedBrickCount = 0;
+		std::vector<FinishedMesh> m_taken{};
+
+		// Shared with the workers, guarded by m_mutex
+		std::mutex m_mutex{};
+		std::condition_variable m_condition{};
+		std::condition_variable m_idleCondition{};
+
+		std::deque<MeshJob> m_jobs{};
+		std::vector<FinishedMesh> m_finished{};
+		uint32_t m_busyWorkers = 0;
+		bool m_stop = false;
+
+		std::vector<std::thread> m_workers{};
+	};
+
+	struct HybridRenderBands
+	{
+		// Bricks are put in band floor(distance / m_bandWidth) by the distance from the camera to their nearest point.
+		float m_bandWidth = 16.f;
+		// Bit per band, set for the bands that are rasterized from meshes instead of ray marched. Bands past
+		// the last bit are always marched.
+		uint32_t m_rasterBands = 0b11;
+	};
+
+	// Picks the bricks of the list that fall in a rasterized band, keeping their order.
+	void SelectRasterBricks(const HybridRenderBands& bands, const glm::vec3& cameraPosition, const glm::uvec3& sizeInBricks, const glm::vec3& origin,
+		const std::vector<uint32_t>& brickIndices, std::vector<uint32_t>& rasterBricks);
+}
@@ -0,0 +1,770 @@
+#include "brick_navigation.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+namespace afre
+{
+	// Per worker, path requests are taken this many at a time.
+	static constexpr uint32_t kRequestBatchSize = 16;
+	// Portal nodes a single search may touch before it gives up.
+	static constexpr uint32_t kMaxSearchNodes = 1u << 16;
+
+	// BuildWalkable keeps a brick column, the voxel under it and the room a stepping agent needs over its top in one word.
+	static constexpr uint64_t kBrickColumnMask = (1ull << kBrickSize) - 1;
+	static constexpr uint32_t kMaxAgentHeight = std::min<uint32_t>(kBrickSize - 1, 62 - kBrickSize);
+
+	static constexpr uint64_t kStartNode = ~0ull;
+	static constexpr uint64_t kGoalNode = ~0ull - 1;
+
+	// The bricks a single move can cross into, one step sideways and up to one up or down, or straight up or down.
+	static const glm::ivec3 s_neighbourOffsets[14] =
+	{
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ 1, 1, 0 }, { -1, 1, 0 }, { 0, 1, 1 }, { 0, 1, -1 },
+		{ 1, -1, 0 }, { -1, -1, 0 }, { 0, -1, 1 }, { 0, -1, -1 },
+		{ 0, 1, 0 }, { 0, -1, 0 }
+	};
+
+	static const glm::ivec2 s_moveDirections[4] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+	static const int32_t s_moveSteps[3] = { 0, 1, -1 };
+
+	static inline glm::uint16_t GetNavVoxel(const glm::ivec3& local)
+	{
+		return static_cast<glm::uint16_t>((local.z * kBrickSize + local.y) * kBrickSize + local.x);
+	}
+
+	static inline glm::ivec3 GetNavLocal(uint32_t voxel)
+	{
+		return { static_cast<int32_t>(voxel % kBrickSize), static_cast<int32_t>((voxel / kBrickSize) % kBrickSize), static_cast<int32_t>(voxel / (kBrickSize * kBrickSize)) };
+	}
+
+	// Calls visit with every voxel of the brick a move from voxel leads to.
+	template<typename NavBrick, typename Visit>
+	static inline void ForEachBrickMove(const NavBrick& navBrick, glm::uint16_t voxel, const Visit& visit)
+	{
+		const glm::ivec3 local = GetNavLocal(voxel);
+
+		for (const glm::ivec2& direction : s_moveDirections)
+		{
+			const int32_t x = local.x + direction.x;
+			const int32_t z = local.z + direction.y;
+			if (x < 0 || z < 0 || x >= kBrickSize || z >= kBrickSize) continue;
+
+			for (const int32_t step : s_moveSteps)
+			{
+				const int32_t y = local.y + step;
+				if (y < 0 || y >= kBrickSize) continue;
+
+				const glm::uint16_t next = GetNavVoxel({ x, y, z });
+				if (!navBrick.IsWalkable(next)) continue;
+				if (step != 0 && !navBrick.IsSteppable(step > 0 ? voxel : next)) continue;
+
+				visit(next);
+			}
+		}
+	}
+
+	struct BrickNavigator::SearchScratch
+	{
+		struct SearchNode
+		{
+			uint32_t m_cost = 0;
+			uint64_t m_parent = kStartNode;
+			bool m_closed = false;
+		};
+
+		struct OpenNode
+		{
+			uint32_t m_estimate = 0;
+			uint32_t m_cost = 0;
+			uint64_t m_node = 0;
+
+			inline bool operator>(const OpenNode& other) const { return m_estimate > other.m_estimate; }
+		};
+
+		// Of the last WalkBrick, per voxel of the brick.
+		std::vector<glm::uint16_t> m_distances = std::vector<glm::uint16_t>(kBrickVoxelCount);
+		std::vector<glm::uint16_t> m_parents = std::vector<glm::uint16_t>(kBrickVoxelCount);
+		std::vector<glm::uint16_t> m_queue = std::vector<glm::uint16_t>(kBrickVoxelCount);
+
+		// Per endpoint of the goal brick.
+		std::vector<glm::uint16_t> m_goalDistances{};
+		std::unordered_map<uint64_t, SearchNode> m_nodes{};
+		std::vector<OpenNode> m_open{};
+		std::vector<uint64_t> m_chain{};
+
+		std::vector<std::pair<glm::uint16_t, EndpointLink>> m_endpointLinks{};
+	};
+
+	static inline uint64_t GetNodeKey(uint32_t brickIndex, uint32_t endpoint)
+	{
+		return (static_cast<uint64_t>(brickIndex) << 32) | endpoint;
+	}
+
+	BrickNavigator::BrickNavigator(uint32_t workerCount, const NavAgentInfo& agentInfo) : m_workerCount(std::max(workerCount, 1u)), m_agentInfo(agentInfo)
+	{
+		// The room over a voxel has to end in the brick above it and fit in BuildWalkable's columns.
+		m_agentInfo.m_height = std::clamp(m_agentInfo.m_height, 1u, kMaxAgentHeight);
+
+		std::vector<glm::uint8_t> solid(kMaxMaterials, 1);
+		solid[0] = 0;
+
+		m_solid = std::make_shared<const std::vector<glm::uint8_t>>(std::move(solid));
+	}
+
+	BrickNavigator::~BrickNavigator()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_stop = true;
+		}
+
+		m_condition.notify_all();
+
+		for (std::thread& worker : m_workers) worker.join();
+	}
+
+	void BrickNavigator::SetVoxelSolid(glm::uint16_t voxel, bool solid)
+	{
+		if (voxel == 0 || ((*m_solid)[voxel] != 0) == solid) return;
+
+		// An update in flight keeps the table it was queued with.
+		std::vector<glm::uint8_t> newSolid = *m_solid;
+		newSolid[voxel] = solid ? 1 : 0;
+		m_solid = std::make_shared<const std::vector<glm::uint8_t>>(std::move(newSolid));
+
+		if (m_snapshot) QueueUpdate(m_snapshot, true);
+	}
+
+	void BrickNavigator::SetSnapshot(std::shared_ptr<const WorldSnapshot> snapshot)
+	{
+		QueueUpdate(std::move(snapshot), false);
+	}
+
+	void BrickNavigator::Rebuild(std::shared_ptr<const WorldSnapshot> snapshot)
+	{
+		QueueUpdate(std::move(snapshot), true);
+	}
+
+	void BrickNavigator::RequestPath(const NavPathRequest& request)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_requests.push_back(request);
+		}
+
+		StartWorkers();
+		m_condition.notify_one();
+	}
+
+	void BrickNavigator::RequestPaths(const std::vector<NavPathRequest>& requests)
+	{
+		if (requests.empty()) return;
+
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_requests.insert(m_requests.end(), requests.begin(), requests.end());
+		}
+
+		StartWorkers();
+		m_condition.notify_all();
+	}
+
+	void BrickNavigator::TakeFinishedPaths(std::vector<NavPath>& paths)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+
+		if (paths.empty()) paths.swap(m_finished);
+		else
+		{
+			paths.insert(paths.end(), std::make_move_iterator(m_finished.begin()), std::make_move_iterator(m_finished.end()));
+			m_finished.clear();
+		}
+	}
+
+	void BrickNavigator::WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		m_idleCondition.wait(lock, [&]() { return !m_updatePending && m_requests.empty() && m_busyWorkers == 0; });
+	}
+
+	BrickNavigatorStats BrickNavigator::GetStats() const
+	{
+		std::shared_lock<std::shared_mutex> lock{ m_graphMutex };
+		return m_stats;
+	}
+
+	void BrickNavigator::QueueUpdate(std::shared_ptr<const WorldSnapshot> snapshot, bool rebuild)
+	{
+		m_snapshot = std::move(snapshot);
+
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+
+			m_pendingUpdate.m_rebuild = (m_updatePending && m_pendingUpdate.m_rebuild) || rebuild;
+			m_pendingUpdate.m_snapshot = m_snapshot;
+			m_pendingUpdate.m_solid = m_solid;
+			m_updatePending = true;
+		}
+
+		StartWorkers();
+		m_condition.notify_one();
+	}
+
+	void BrickNavigator::StartWorkers()
+	{
+		while (m_workers.size() < m_workerCount) m_workers.emplace_back(&BrickNavigator::WorkerLoop, this);
+	}
+
+	void BrickNavigator::WorkerLoop()
+	{
+		SearchScratch scratch{};
+		GraphUpdate update{};
+		std::vector<NavPathRequest> requests{};
+		std::vector<NavPath> paths{};
+
+		while (true)
+		{
+			bool updating = false;
+
+			{
+				std::unique_lock<std::mutex> lock{ m_mutex };
+				m_condition.wait(lock, [&]()
+					{
+						return m_stop || (!m_updating && (m_updatePending || !m_requests.empty()));
+					});
+
+				if (m_stop) return;
+
+				// Updates go first, requests queued after one are answered on the graph it leaves.
+				if (m_updatePending)
+				{
+					update = std::move(m_pendingUpdate);
+					m_pendingUpdate = {};
+					m_updatePending = false;
+					m_updating = true;
+					updating = true;
+				}
+				else
+				{
+					const size_t count = std::min<size_t>(m_requests.size(), kRequestBatchSize);
+					requests.assign(m_requests.begin(), m_requests.begin() + count);
+					m_requests.erase(m_requests.begin(), m_requests.begin() + count);
+				}
+
+				m_busyWorkers++;
+			}
+
+			if (updating)
+			{
+				std::unique_lock<std::shared_mutex> graphLock{ m_graphMutex };
+				UpdateGraph(update, scratch);
+
+				// Not holding on to a world version the game has moved past.
+				update = {};
+			}
+			else
+			{
+				std::shared_lock<std::shared_mutex> graphLock{ m_graphMutex };
+
+				paths.resize(requests.size());
+				for (size_t r = 0; r < requests.size(); r++) FindPath(requests[r], scratch, paths[r]);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+
+				if (updating) m_updating = false;
+				for (NavPath& path : paths) m_finished.push_back(std::move(path));
+				paths.clear();
+
+				m_busyWorkers--;
+			}
+
+			m_condition.notify_all();
+			m_idleCondition.notify_all();
+		}
+	}
+
+	void BrickNavigator::UpdateGraph(const GraphUpdate& update, SearchScratch& scratch)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		const WorldSnapshot& snapshot = *update.m_snapshot;
+		const glm::ivec3 sizeInBricks = glm::ivec3(snapshot.GetSizeInBricks());
+		const uint32_t brickCount = snapshot.GetBrickCount();
+
+		const bool rebuild = update.m_rebuild || update.m_solid != m_graphSolid || sizeInBricks != m_sizeInBricks;
+		m_graphSolid = update.m_solid;
+
+		// Walking in a brick depends on the voxel under it and the room over it, so the bricks above and below a changed
+		// one are rebuilt with it. Portals and distances follow for those and their neighbours.
+		std::vector<glm::uint8_t> walkDirty(brickCount, rebuild ? 1 : 0);
+		if (rebuild)
+		{
+			m_sizeInBricks = sizeInBricks;
+			m_bricks.assign(brickCount, NavBrick{});
+			m_brickVersions.assign(brickCount, 0);
+			m_stats.m_portalCount = 0;
+		}
+		else
+		{
+			for (uint32_t b = 0; b < brickCount; b++)
+			{
+				if (snapshot.GetBrickVersion(b) == m_brickVersions[b]) continue;
+
+				const glm::ivec3 brickPosition = GetBrickPosition(b);
+				walkDirty[b] = 1;
+				if (brickPosition.y > 0) walkDirty[GetBrickIndex(brickPosition - glm::ivec3(0, 1, 0))] = 1;
+				if (brickPosition.y + 1 < m_sizeInBricks.y) walkDirty[GetBrickIndex(brickPosition + glm::ivec3(0, 1, 0))] = 1;
+			}
+		}
+
+		for (uint32_t b = 0; b < brickCount; b++) m_brickVersions[b] = snapshot.GetBrickVersion(b);
+
+		std::vector<glm::uint8_t> portalDirty = walkDirty;
+		uint32_t walkDirtyCount = 0;
+		for (uint32_t b = 0; b < brickCount; b++)
+		{
+			if (!walkDirty[b]) continue;
+
+			walkDirtyCount++;
+			BuildWalkable(snapshot, b);
+			BuildRegions(b);
+
+			const glm::ivec3 brickPosition = GetBrickPosition(b);
+			for (const glm::ivec3& offset : s_neighbourOffsets)
+			{
+				if (IsInsideBricks(brickPosition + offset)) portalDirty[GetBrickIndex(brickPosition + offset)] = 1;
+			}
+		}
+
+		// Portals first everywhere, the endpoints of a brick come from its own and its neighbours'.
+		for (uint32_t b = 0; b < brickCount; b++)
+		{
+			if (portalDirty[b]) BuildPortals(b);
+		}
+
+		for (uint32_t b = 0; b < brickCount; b++)
+		{
+			if (portalDirty[b]) BuildEndpoints(b, scratch);
+		}
+
+		m_stats.m_rebuiltBricks = walkDirtyCount;
+		m_stats.m_updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void BrickNavigator::BuildWalkable(const WorldSnapshot& snapshot, uint32_t brickIndex)
+	{
+		NavBrick& navBrick = m_bricks[brickIndex];
+		navBrick.m_bits.clear();
+
+		const Brick& brick = snapshot.GetBrick(brickIndex);
+		const glm::ivec3 brickMin = GetBrickPosition(brickIndex) * static_cast<int32_t>(kBrickSize);
+		const std::vector<glm::uint8_t>& solid = *m_graphSolid;
+
+		const uint32_t height = m_agentInfo.m_height;
+		const uint64_t roomMask = (1ull << height) - 1;
+		const uint64_t stepRoomMask = (1ull << (height + 1)) - 1;
+		// From the voxel under the brick to the last one a stepping agent needs free over its top voxel.
+		const int32_t columnTop = kBrickSize + static_cast<int32_t>(height);
+
+		uint64_t walkable[kWordCount]{};
+		uint64_t steppable[kWordCount]{};
+		bool anyWalkable = false;
+
+		for (int32_t z = 0; z < kBrickSize; z++)
+		{
+			for (int32_t x = 0; x < kBrickSize; x++)
+			{
+				// Bit y + 1 is set for a solid voxel at y.
+				uint64_t column = 0;
+				for (int32_t y = -1; y <= columnTop; y++)
+				{
+					const glm::uint16_t voxel = y >= 0 && y < kBrickSize ? brick.At(glm::uvec3(x, y, z)) : snapshot.GetVoxel(brickMin + glm::ivec3(x, y, z));
+					if (solid[voxel]) column |= 1ull << (y + 1);
+				}
+
+				// Solid from the bottom of the brick to past its top, nothing to stand in.
+				if ((column >> 1 & kBrickColumnMask) == kBrickColumnMask) continue;
+
+				for (int32_t y = 0; y < kBrickSize; y++)
+				{
+					const uint64_t above = column >> (y + 1);
+					if ((column >> y & 1) == 0 || (above & roomMask) != 0) continue;
+
+					const uint32_t voxel = GetNavVoxel({ x, y, z });
+					walkable[voxel >> 6] |= 1ull << (voxel & 63);
+					if ((above & stepRoomMask) == 0) steppable[voxel >> 6] |= 1ull << (voxel & 63);
+					anyWalkable = true;
+				}
+			}
+		}
+
+		if (!anyWalkable) return;
+
+		navBrick.m_bits.assign(walkable, walkable + kWordCount);
+		navBrick.m_bits.insert(navBrick.m_bits.end(), steppable, steppable + kWordCount);
+	}
+
+	void BrickNavigator::BuildRegions(uint32_t brickIndex)
+	{
+		NavBrick& navBrick = m_bricks[brickIndex];
+		navBrick.m_regions.clear();
+		if (navBrick.m_bits.empty()) return;
+
+		navBrick.m_regions.assign(kBrickVoxelCount, kNoRegion);
+
+		std::vector<glm::uint16_t> stack{};
+		glm::uint16_t regionCount = 0;
+
+		for (uint32_t voxel = 0; voxel < kBrickVoxelCount; voxel++)
+		{
+			if (!navBrick.IsWalkable(voxel) || navBrick.m_regions[voxel] != kNoRegion) continue;
+
+			const glm::uint16_t region = regionCount++;
+			navBrick.m_regions[voxel] = region;
+			stack.push_back(static_cast<glm::uint16_t>(voxel));
+
+			while (!stack.empty())
+			{
+				const glm::uint16_t current = stack.back();
+				stack.pop_back();
+
+				ForEachBrickMove(navBrick, current, [&](glm::uint16_t next)
+					{
+						if (navBrick.m_regions[next] != kNoRegion) return;
+
+						navBrick.m_regions[next] = region;
+						stack.push_back(next);
+					});
+			}
+		}
+	}
+
+	void BrickNavigator::BuildPortals(uint32_t brickIndex)
+	{
+		NavBrick& navBrick = m_bricks[brickIndex];
+		m_stats.m_portalCount -= static_cast<uint32_t>(navBrick.m_portals.size());
+		navBrick.m_portals.clear();
+		if (navBrick.m_bits.empty()) return;
+
+		struct Crossing
+		{
+			uint32_t m_otherBrick = 0;
+			glm::uint16_t m_region = 0;
+			glm::uint16_t m_otherRegion = 0;
+			glm::uint16_t m_voxel = 0;
+			glm::uint16_t m_otherVoxel = 0;
+		};
+
+		std::vector<Crossing> crossings{};
+		const glm::ivec3 brickPosition = GetBrickPosition(brickIndex);
+
+		// Every move out of the brick into a neighbour with a higher index, the lower ones own the pair.
+		for (uint32_t voxel = 0; voxel < kBrickVoxelCount; voxel++)
+		{
+			if (!navBrick.IsWalkable(voxel)) continue;
+
+			const glm::ivec3 local = GetNavLocal(voxel);
+			const bool border = local.x == 0 || local.z == 0 || local.x == kBrickSize - 1 || local.z == kBrickSize - 1 || local.y == 0 || local.y == kBrickSize - 1;
+			if (!border) continue;
+
+			for (const glm::ivec2& direction : s_moveDirections)
+			{
+				for (const int32_t step : s_moveSteps)
+				{
+					const glm::ivec3 next = local + glm::ivec3(direction.x, step, direction.y);
+					const glm::ivec3 brickOffset = glm::ivec3(glm::floor(glm::vec3(next) / static_cast<float>(kBrickSize)));
+					if (brickOffset == glm::ivec3(0) || !IsInsideBricks(brickPosition + brickOffset)) continue;
+
+					const uint32_t otherBrick = GetBrickIndex(brickPosition + brickOffset);
+					if (otherBrick < brickIndex) continue;
+
+					const NavBrick& otherNavBrick = m_bricks[otherBrick];
+					const glm::uint16_t otherVoxel = GetNavVoxel(next - brickOffset * static_cast<int32_t>(kBrickSize));
+					if (!otherNavBrick.IsWalkable(otherVoxel)) continue;
+					if (step > 0 && !navBrick.IsSteppable(voxel)) continue;
+					if (step < 0 && !otherNavBrick.IsSteppable(otherVoxel)) continue;
+
+					crossings.push_back({ otherBrick, navBrick.m_regions[voxel], otherNavBrick.m_regions[otherVoxel], static_cast<glm::uint16_t>(voxel), otherVoxel });
+				}
+			}
+		}
+
+		// One portal per pair of connected areas, the middle of the crossings between them.
+		std::sort(crossings.begin(), crossings.end(), [](const Crossing& a, const Crossing& b)
+			{
+				if (a.m_otherBrick != b.m_otherBrick) return a.m_otherBrick < b.m_otherBrick;
+				if (a.m_region != b.m_region) return a.m_region < b.m_region;
+				if (a.m_otherRegion != b.m_otherRegion) return a.m_otherRegion < b.m_otherRegion;
+				return a.m_voxel < b.m_voxel;
+			});
+
+		for (size_t first = 0; first < crossings.size();)
+		{
+			size_t last = first + 1;
+			while (last < crossings.size() && crossings[last].m_otherBrick == crossings[first].m_otherBrick
+				&& crossings[last].m_region == crossings[first].m_region && crossings[last].m_otherRegion == crossings[first].m_otherRegion) last++;
+
+			const Crossing& middle = crossings[(first + last) / 2];
+			navBrick.m_portals.push_back({ middle.m_otherBrick, middle.m_voxel, middle.m_otherVoxel });
+
+			first = last;
+		}
+
+		m_stats.m_portalCount += static_cast<uint32_t>(navBrick.m_portals.size());
+	}
+
+	void BrickNavigator::BuildEndpoints(uint32_t brickIndex, SearchScratch& scratch)
+	{
+		NavBrick& navBrick = m_bricks[brickIndex];
+		navBrick.m_endpoints.clear();
+		navBrick.m_links.clear();
+		navBrick.m_distances.clear();
+		if (navBrick.m_bits.empty()) return;
+
+		std::vector<std::pair<glm::uint16_t, EndpointLink>>& endpointLinks = scratch.m_endpointLinks;
+		endpointLinks.clear();
+
+		for (const Portal& portal : navBrick.m_portals) endpointLinks.push_back({ portal.m_voxel, { portal.m_otherBrick, portal.m_otherVoxel } });
+
+		const glm::ivec3 brickPosition = GetBrickPosition(brickIndex);
+		for (const glm::ivec3& offset : s_neighbourOffsets)
+		{
+			if (!IsInsideBricks(brickPosition + offset)) continue;
+
+			const uint32_t otherBrick = GetBrickIndex(brickPosition + offset);
+			if (otherBrick > brickIndex) continue;
+
+			for (const Portal& portal : m_bricks[otherBrick].m_portals)
+			{
+				if (portal.m_otherBrick == brickIndex) endpointLinks.push_back({ portal.m_otherVoxel, { otherBrick, portal.m_voxel } });
+			}
+		}
+
+		std::sort(endpointLinks.begin(), endpointLinks.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+		for (const auto& [voxel, link] : endpointLinks)
+		{
+			if (navBrick.m_endpoints.empty() || navBrick.m_endpoints.back().m_voxel != voxel)
+			{
+				navBrick.m_endpoints.push_back({ voxel, static_cast<uint32_t>(navBrick.m_links.size()), 0 });
+			}
+
+			navBrick.m_links.push_back(link);
+			navBrick.m_endpoints.back().m_linkCount++;
+		}
+
+		const size_t endpointCount = navBrick.m_endpoints.size();
+		navBrick.m_distances.assign(endpointCount * endpointCount, kUnreachable);
+
+		for (size_t from = 0; from < endpointCount; from++)
+		{
+			WalkBrick(brickIndex, navBrick.m_endpoints[from].m_voxel, kNoVoxel, scratch);
+
+			for (size_t to = 0; to < endpointCount; to++)
+			{
+				navBrick.m_distances[from * endpointCount + to] = scratch.m_distances[navBrick.m_endpoints[to].m_voxel];
+			}
+		}
+	}
+
+	void BrickNavigator::FindPath(const NavPathRequest& request, SearchScratch& scratch, NavPath& path) const
+	{
+		path.m_id = request.m_id;
+		path.m_found = false;
+		path.m_voxels.clear();
+
+		if (m_bricks.empty()) return;
+
+		const glm::ivec3 brickSize = glm::ivec3(kBrickSize);
+		if (glm::any(glm::lessThan(request.m_start, glm::ivec3(0))) || glm::any(glm::lessThan(request.m_goal, glm::ivec3(0)))) return;
+
+		const glm::ivec3 startBrickPosition = request.m_start / brickSize;
+		const glm::ivec3 goalBrickPosition = request.m_goal / brickSize;
+		if (!IsInsideBricks(startBrickPosition) || !IsInsideBricks(goalBrickPosition)) return;
+
+		const uint32_t startBrick = GetBrickIndex(startBrickPosition);
+		const uint32_t goalBrick = GetBrickIndex(goalBrickPosition);
+		const glm::uint16_t startVoxel = GetNavVoxel(request.m_start - startBrickPosition * brickSize);
+		const glm::uint16_t goalVoxel = GetNavVoxel(request.m_goal - goalBrickPosition * brickSize);
+
+		const NavBrick& startNavBrick = m_bricks[startBrick];
+		const NavBrick& goalNavBrick = m_bricks[goalBrick];
+		if (!startNavBrick.IsWalkable(startVoxel) || !goalNavBrick.IsWalkable(goalVoxel)) return;
+
+		path.m_voxels.push_back(request.m_start);
+
+		// Connected inside one brick, walked directly.
+		if (startBrick == goalBrick && startNavBrick.m_regions[startVoxel] == goalNavBrick.m_regions[goalVoxel])
+		{
+			AppendBrickPath(startBrick, startVoxel, goalVoxel, scratch, path.m_voxels);
+			path.m_found = true;
+			return;
+		}
+
+		WalkBrick(goalBrick, goalVoxel, kNoVoxel, scratch);
+		scratch.m_goalDistances.resize(goalNavBrick.m_endpoints.size());
+		for (size_t e = 0; e < goalNavBrick.m_endpoints.size(); e++) scratch.m_goalDistances[e] = scratch.m_distances[goalNavBrick.m_endpoints[e].m_voxel];
+
+		std::unordered_map<uint64_t, SearchScratch::SearchNode>& nodes = scratch.m_nodes;
+		std::vector<SearchScratch::OpenNode>& open = scratch.m_open;
+		nodes.clear();
+		open.clear();
+
+		// Moves only go one voxel sideways, so the horizontal distance never overestimates.
+		const auto estimate = [&](uint32_t brickIndex, glm::uint16_t voxel)
+			{
+				const glm::ivec3 position = GetBrickPosition(brickIndex) * brickSize + GetNavLocal(voxel);
+				return static_cast<uint32_t>(std::abs(position.x - request.m_goal.x) + std::abs(position.z - request.m_goal.z));
+			};
+
+		const auto push = [&](uint64_t node, uint32_t cost, uint64_t parent, uint32_t estimated)
+			{
+				const auto [found, inserted] = nodes.try_emplace(node);
+				SearchScratch::SearchNode& searchNode = found->second;
+				if (!inserted && (searchNode.m_closed || searchNode.m_cost <= cost)) return;
+
+				searchNode.m_cost = cost;
+				searchNode.m_parent = parent;
+
+				open.push_back({ cost + estimated, cost, node });
+				std::push_heap(open.begin(), open.end(), std::greater<SearchScratch::OpenNode>());
+			};
+
+		WalkBrick(startBrick, startVoxel, kNoVoxel, scratch);
+		for (uint32_t e = 0; e < startNavBrick.m_endpoints.size(); e++)
+		{
+			const glm::uint16_t voxel = startNavBrick.m_endpoints[e].m_voxel;
+			if (scratch.m_distances[voxel] != kUnreachable) push(GetNodeKey(startBrick, e), scratch.m_distances[voxel], kStartNode, estimate(startBrick, voxel));
+		}
+
+		bool reached = false;
+		while (!open.empty() && nodes.size() < kMaxSearchNodes)
+		{
+			std::pop_heap(open.begin(), open.end(), std::greater<SearchScratch::OpenNode>());
+			const SearchScratch::OpenNode current = open.back();
+			open.pop_back();
+
+			SearchScratch::SearchNode& searchNode = nodes[current.m_node];
+			if (searchNode.m_closed || current.m_cost > searchNode.m_cost) continue;
+			searchNode.m_closed = true;
+
+			if (current.m_node == kGoalNode)
+			{
+				reached = true;
+				break;
+			}
+
+			const uint32_t brickIndex = static_cast<uint32_t>(current.m_node >> 32);
+			const uint32_t endpoint = static_cast<uint32_t>(current.m_node);
+			const NavBrick& navBrick = m_bricks[brickIndex];
+			const size_t endpointCount = navBrick.m_endpoints.size();
+
+			if (brickIndex == goalBrick && scratch.m_goalDistances[endpoint] != kUnreachable)
+			{
+				const uint32_t cost = current.m_cost + scratch.m_goalDistances[endpoint];
+				push(kGoalNode, cost, current.m_node, 0);
+			}
+
+			for (size_t other = 0; other < endpointCount; other++)
+			{
+				const glm::uint16_t distance = navBrick.m_distances[endpoint * endpointCount + other];
+				if (other == endpoint || distance == kUnreachable) continue;
+
+				push(GetNodeKey(brickIndex, static_cast<uint32_t>(other)), current.m_cost + distance, current.m_node, estimate(brickIndex, navBrick.m_endpoints[other].m_voxel));
+			}
+
+			const Endpoint& from = navBrick.m_endpoints[endpoint];
+			for (uint32_t l = from.m_firstLink; l < from.m_firstLink + from.m_linkCount; l++)
+			{
+				const EndpointLink& link = navBrick.m_links[l];
+
+				uint32_t otherEndpoint = 0;
+				if (FindEndpoint(link.m_brick, link.m_voxel, otherEndpoint)) push(GetNodeKey(link.m_brick, otherEndpoint), current.m_cost + 1, current.m_node, estimate(link.m_brick, link.m_voxel));
+			}
+		}
+
+		if (!reached)
+		{
+			path.m_voxels.clear();
+			return;
+		}
+
+		// Back from the goal to the first portal, then walked forward brick by brick.
+		std::vector<uint64_t>& chain = scratch.m_chain;
+		chain.clear();
+		for (uint64_t node = nodes[kGoalNode].m_parent; node != kStartNode; node = nodes[node].m_parent) chain.push_back(node);
+
+		uint32_t brickIndex = startBrick;
+		glm::uint16_t voxel = startVoxel;
+		for (auto node = chain.rbegin(); node != chain.rend(); node++)
+		{
+			const uint32_t nextBrick = static_cast<uint32_t>(*node >> 32);
+			const glm::uint16_t nextVoxel = m_bricks[nextBrick].m_endpoints[static_cast<uint32_t>(*node)].m_voxel;
+
+			if (nextBrick == brickIndex) AppendBrickPath(brickIndex, voxel, nextVoxel, scratch, path.m_voxels);
+			else path.m_voxels.push_back(GetBrickPosition(nextBrick) * brickSize + GetNavLocal(nextVoxel));
+
+			brickIndex = nextBrick;
+			voxel = nextVoxel;
+		}
+
+		AppendBrickPath(goalBrick, voxel, goalVoxel, scratch, path.m_voxels);
+		path.m_found = true;
+	}
+
+	void BrickNavigator::WalkBrick(uint32_t brickIndex, glm::uint16_t voxel, glm::uint16_t target, SearchScratch& scratch) const
+	{
+		const NavBrick& navBrick = m_bricks[brickIndex];
+		std::fill(scratch.m_distances.begin(), scratch.m_distances.end(), kUnreachable);
+
+		uint32_t head = 0;
+		uint32_t tail = 0;
+		scratch.m_queue[tail++] = voxel;
+		scratch.m_distances[voxel] = 0;
+		scratch.m_parents[voxel] = voxel;
+
+		while (head < tail)
+		{
+			const glm::uint16_t current = scratch.m_queue[head++];
+			if (current == target) return;
+
+			const glm::uint16_t distance = scratch.m_distances[current] + 1;
+			ForEachBrickMove(navBrick, current, [&](glm::uint16_t next)
+				{
+					if (scratch.m_distances[next] != kUnreachable) return;
+
+					scratch.m_distances[next] = distance;
+					scratch.m_parents[next] = current;
+					scratch.m_queue[tail++] = next;
+				});
+		}
+	}
+
+	void BrickNavigator::AppendBrickPath(uint32_t brickIndex, glm::uint16_t from, glm::uint16_t to, SearchScratch& scratch, std::vector<glm::ivec3>& voxels) const
+	{
+		if (from == to) return;
+
+		WalkBrick(brickIndex, from, to, scratch);
+
+		const glm::ivec3 brickMin = GetBrickPosition(brickIndex) * static_cast<int32_t>(kBrickSize);
+		const size_t first = voxels.size();
+		for (glm::uint16_t voxel = to; voxel != from; voxel = scratch.m_parents[voxel]) voxels.push_back(brickMin + GetNavLocal(voxel));
+
+		std::reverse(voxels.begin() + first, voxels.end());
+	}
+
+	bool BrickNavigator::FindEndpoint(uint32_t brickIndex, glm::uint16_t voxel, uint32_t& endpoint) const
+	{
+		const std::vector<Endpoint>& endpoints = m_bricks[brickIndex].m_endpoints;
+		const auto found = std::lower_bound(endpoints.begin(), endpoints.end(), voxel, [](const Endpoint& a, glm::uint16_t b) { return a.m_voxel < b; });
+		if (found == endpoints.end() || found->m_voxel != voxel) return false;
+
+		endpoint = static_cast<uint32_t>(found - endpoints.begin());
+		return true;
+	}
+}
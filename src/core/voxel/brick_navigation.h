@@ -0,0 +1,205 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "world_snapshot.h"
+
+namespace afre
+{
+	// The agent stands in a non solid voxel on top of a solid one, with m_height non solid voxels of room from its
+	// own up. It walks to the four horizontal neighbours and steps one voxel up or down, stepping needs one more voxel
+	// of room over the lower of the two.
+	struct NavAgentInfo
+	{
+		uint32_t m_height = 2;
+	};
+
+	struct NavPathRequest
+	{
+		glm::ivec3 m_start{};
+		glm::ivec3 m_goal{};
+		// The caller's, handed back with the path, e.g. the agent's entity.
+		uint32_t m_id = 0;
+	};
+
+	struct NavPath
+	{
+		uint32_t m_id = 0;
+		// False when start or goal isn't a voxel the agent can stand in or there's no way between them.
+		bool m_found = false;
+		// Standing voxels from start to goal, both included, every one a single move from the one before.
+		std::vector<glm::ivec3> m_voxels{};
+	};
+
+	struct BrickNavigatorStats
+	{
+		uint32_t m_portalCount = 0;
+		// Of the last graph update.
+		uint32_t m_rebuiltBricks = 0;
+		double m_updateMs = 0.0;
+	};
+
+	// Hierarchical pathfinding over the brick grid. Every brick knows where the agent can stand in it, which of those
+	// voxels connect inside the brick and one portal per pair of connected areas across each neighbour border, with
+	// the walking distances between its portals. Paths are searched over the portals first and then walked voxel by
+	// voxel inside each brick on the way.
+	// The graph is built and path requests are answered on worker threads, the caller only queues and collects.
+	class BrickNavigator
+	{
+	public:
+		explicit BrickNavigator(uint32_t workerCount = 2, const NavAgentInfo& agentInfo = {});
+		~BrickNavigator();
+
+		BrickNavigator(const BrickNavigator&) = delete;
+		BrickNavigator& operator=(const BrickNavigator&) = delete;
+
+		// Every voxel but air is solid unless set otherwise. Rebuilds the whole graph when it changes anything.
+		void SetVoxelSolid(glm::uint16_t voxel, bool solid);
+
+		// Only the bricks whose version changed and their neighbours are rebuilt. Snapshots from CopyFrom have no
+		// versions, use Rebuild for those.
+		void SetSnapshot(std::shared_ptr<const WorldSnapshot> snapshot);
+		void Rebuild(std::shared_ptr<const WorldSnapshot> snapshot);
+
+		// Requests are answered in order, on the graph of the latest snapshot passed in before them or a newer one.
+		void RequestPath(const NavPathRequest& request);
+		void RequestPaths(const std::vector<NavPathRequest>& requests);
+
+		// Moves out the paths finished since the last call. Doesn't wait.
+		void TakeFinishedPaths(std::vector<NavPath>& paths);
+
+		void WaitIdle();
+
+		// Only meaningful after WaitIdle.
+		BrickNavigatorStats GetStats() const;
+
+	private:
+		// Voxels in a brick are numbered (z * kBrickSize + y) * kBrickSize + x, whatever the brick layout.
+		static constexpr uint32_t kWordCount = kBrickVoxelCount / 64;
+		static constexpr glm::uint16_t kNoRegion = 0xFFFF;
+		static constexpr glm::uint16_t kUnreachable = 0xFFFF;
+		static constexpr glm::uint16_t kNoVoxel = 0xFFFF;
+
+		// Crossing from m_voxel of the brick that owns it to m_otherVoxel of m_otherBrick. A pair of neighbouring
+		// bricks is owned by the one with the lower index.
+		struct Portal
+		{
+			uint32_t m_otherBrick = 0;
+			glm::uint16_t m_voxel = 0;
+			glm::uint16_t m_otherVoxel = 0;
+		};
+
+		struct EndpointLink
+		{
+			uint32_t m_brick = 0;
+			glm::uint16_t m_voxel = 0;
+		};
+
+		// A voxel of the brick at least one portal starts or ends at.
+		struct Endpoint
+		{
+			glm::uint16_t m_voxel = 0;
+			uint32_t m_firstLink = 0;
+			uint32_t m_linkCount = 0;
+		};
+
+		struct NavBrick
+		{
+			// Bit per voxel the agent can stand in, then bit per voxel it can also step up from or down to.
+			// Empty, like the regions, when the brick has nothing walkable, which most bricks of a world don't.
+			std::vector<uint64_t> m_bits{};
+			// Connected area per voxel.
+			std::vector<glm::uint16_t> m_regions{};
+			std::vector<Portal> m_portals{};
+
+			std::vector<Endpoint> m_endpoints{};
+			std::vector<EndpointLink> m_links{};
+			// Endpoint count squared, walking distance inside the brick.
+			std::vector<glm::uint16_t> m_distances{};
+
+			inline bool IsWalkable(uint32_t voxel) const { return !m_bits.empty() && ((m_bits[voxel >> 6] >> (voxel & 63)) & 1) != 0; }
+			inline bool IsSteppable(uint32_t voxel) const { return !m_bits.empty() && ((m_bits[kWordCount + (voxel >> 6)] >> (voxel & 63)) & 1) != 0; }
+		};
+
+		struct GraphUpdate
+		{
+			std::shared_ptr<const WorldSnapshot> m_snapshot{};
+			std::shared_ptr<const std::vector<glm::uint8_t>> m_solid{};
+			bool m_rebuild = false;
+		};
+
+		// Per worker, kept between searches.
+		struct SearchScratch;
+
+		void QueueUpdate(std::shared_ptr<const WorldSnapshot> snapshot, bool rebuild);
+		void StartWorkers();
+		void WorkerLoop();
+
+		// Under the unique graph lock.
+		void UpdateGraph(const GraphUpdate& update, SearchScratch& scratch);
+		void BuildWalkable(const WorldSnapshot& snapshot, uint32_t brickIndex);
+		void BuildRegions(uint32_t brickIndex);
+		void BuildPortals(uint32_t brickIndex);
+		void BuildEndpoints(uint32_t brickIndex, SearchScratch& scratch);
+
+		// Under the shared graph lock.
+		void FindPath(const NavPathRequest& request, SearchScratch& scratch, NavPath& path) const;
+		// Breadth first inside the brick from voxel, distances to every voxel it reaches, or until it reaches target.
+		void WalkBrick(uint32_t brickIndex, glm::uint16_t voxel, glm::uint16_t target, SearchScratch& scratch) const;
+		// Appends the voxels after from up to to, both in the brick.
+		void AppendBrickPath(uint32_t brickIndex, glm::uint16_t from, glm::uint16_t to, SearchScratch& scratch, std::vector<glm::ivec3>& voxels) const;
+		bool FindEndpoint(uint32_t brickIndex, glm::uint16_t voxel, uint32_t& endpoint) const;
+
+		inline uint32_t GetBrickIndex(const glm::ivec3& brickPosition) const
+		{
+			return (brickPosition.z * m_sizeInBricks.y + brickPosition.y) * m_sizeInBricks.x + brickPosition.x;
+		}
+
+		inline glm::ivec3 GetBrickPosition(uint32_t brickIndex) const
+		{
+			const int32_t index = static_cast<int32_t>(brickIndex);
+			return { index % m_sizeInBricks.x, (index / m_sizeInBricks.x) % m_sizeInBricks.y, index / (m_sizeInBricks.x * m_sizeInBricks.y) };
+		}
+
+		inline bool IsInsideBricks(const glm::ivec3& brickPosition) const
+		{
+			return glm::all(glm::greaterThanEqual(brickPosition, glm::ivec3(0))) && glm::all(glm::lessThan(brickPosition, m_sizeInBricks));
+		}
+
+		uint32_t m_workerCount = 0;
+		NavAgentInfo m_agentInfo{};
+
+		// Owned by the caller's thread
+		std::shared_ptr<const WorldSnapshot> m_snapshot{};
+		std::shared_ptr<const std::vector<glm::uint8_t>> m_solid{};
+
+		// Shared with the workers, guarded by m_mutex
+		std::mutex m_mutex{};
+		std::condition_variable m_condition{};
+		std::condition_variable m_idleCondition{};
+
+		// Only the latest one is applied, it's diffed against whatever the graph was built from. Requests wait
+		// while one is pending or applied.
+		GraphUpdate m_pendingUpdate{};
+		bool m_updatePending = false;
+		bool m_updating = false;
+		std::deque<NavPathRequest> m_requests{};
+		std::vector<NavPath> m_finished{};
+		uint32_t m_busyWorkers = 0;
+		bool m_stop = false;
+
+		// The graph, guarded by m_graphMutex
+		mutable std::shared_mutex m_graphMutex{};
+		std::shared_ptr<const std::vector<glm::uint8_t>> m_graphSolid{};
+		glm::ivec3 m_sizeInBricks{};
+		std::vector<NavBrick> m_bricks{};
+		std::vector<uint64_t> m_brickVersions{};
+		BrickNavigatorStats m_stats{};
+
+		std::vector<std::thread> m_workers{};
+	};
+}
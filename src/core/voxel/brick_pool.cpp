@@ -0,0 +1,278 @@
+#include "brick_pool.h"
+#include <algorithm>
+#include <new>
+#include "log.h"
+
+#if defined(AFRE_WINDOWS)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#elif defined(AFRE_LINUX)
+	#include <sys/mman.h>
+#endif
+
+namespace afre
+{
+	// A thread takes this many bricks from the shared list at once and gives half of its cache back past twice that.
+	static constexpr size_t kThreadCacheBatch = 64;
+
+	static const char* const s_tagNames[BRICK_POOL_TAG_COUNT] = { "world", "uniform", "snapshot", "other" };
+
+	const char* GetBrickPoolTagName(BrickPoolTag tag)
+	{
+		return tag < BRICK_POOL_TAG_COUNT ? s_tagNames[tag] : "unknown";
+	}
+
+	// Trivially destructible, so it can still be read while statics that hold bricks are destroyed after the cache.
+	static thread_local bool s_threadCacheDestroyed = false;
+
+	struct BrickPoolThreadCache
+	{
+		std::vector<glm::uint32_t> m_freeIndices{};
+
+		~BrickPoolThreadCache()
+		{
+			s_threadCacheDestroyed = true;
+			if (!m_freeIndices.empty()) BrickPool::Get().Drain(m_freeIndices, 0);
+		}
+	};
+
+	static thread_local BrickPoolThreadCache s_threadCache{};
+
+	// Null once the thread is exiting, the pool then works on the shared list directly.
+	static std::vector<glm::uint32_t>* GetThreadCache()
+	{
+		return s_threadCacheDestroyed ? nullptr : &s_threadCache.m_freeIndices;
+	}
+
+	static Brick* AllocateSlabMemory(bool& hugePages)
+	{
+		hugePages = false;
+
+		#if defined(AFRE_WINDOWS)
+			// Large pages need the lock pages privilege, which most accounts don't have, so failing is expected.
+			const SIZE_T largePageSize = GetLargePageMinimum();
+			if (largePageSize != 0 && BrickPool::kSlabBytes % largePageSize == 0)
+			{
+				void* memory = VirtualAlloc(nullptr, BrickPool::kSlabBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (memory)
+				{
+					hugePages = true;
+					return static_cast<Brick*>(memory);
+				}
+			}
+
+			return static_cast<Brick*>(VirtualAlloc(nullptr, BrickPool::kSlabBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		#elif defined(AFRE_LINUX)
+			// Transparent huge pages only back 2 MB aligned ranges, so map twice that and trim it to an aligned slab.
+			void* mapping = mmap(nullptr, BrickPool::kSlabBytes * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mapping == MAP_FAILED) return nullptr;
+
+			const uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+			const uintptr_t slabStart = (start + BrickPool::kSlabBytes - 1) & ~static_cast<uintptr_t>(BrickPool::kSlabBytes - 1);
+			const uintptr_t slabEnd = slabStart + BrickPool::kSlabBytes;
+
+			if (slabStart > start) munmap(mapping, slabStart - start);
+			if (start + BrickPool::kSlabBytes * 2 > slabEnd) munmap(reinterpret_cast<void*>(slabEnd), start + BrickPool::kSlabBytes * 2 - slabEnd);
+
+			#ifdef MADV_HUGEPAGE
+				hugePages = madvise(reinterpret_cast<void*>(slabStart), BrickPool::kSlabBytes, MADV_HUGEPAGE) == 0;
+			#endif
+
+			return reinterpret_cast<Brick*>(slabStart);
+		#else
+			return static_cast<Brick*>(::operator new(BrickPool::kSlabBytes, std::nothrow));
+		#endif
+	}
+
+	BrickPool& BrickPool::Get()
+	{
+		// Never destroyed, bricks held by other statics are freed after it would be.
+		static BrickPool* pool = new BrickPool();
+
+		return *pool;
+	}
+
+	BrickPool::BrickPool()
+		: m_slabs(new std::atomic<Slab*>[kMaxSlabs])
+	{
+		for (uint32_t i = 0; i < kMaxSlabs; i++) m_slabs[i].store(nullptr, std::memory_order_relaxed);
+	}
+
+	BrickHandle BrickPool::Allocate(BrickPoolTag tag)
+	{
+		std::vector<glm::uint32_t> exitingCache{};
+		std::vector<glm::uint32_t>* cache = GetThreadCache();
+		if (!cache) cache = &exitingCache;
+
+		if (cache->empty() && !Refill(*cache)) return {};
+
+		const glm::uint32_t index = cache->back();
+		cache->pop_back();
+
+		if (cache == &exitingCache) Drain(exitingCache, 0);
+
+		Slab& slab = *m_slabs[index / kSlabBricks].load(std::memory_order_acquire);
+		slab.m_tags[index % kSlabBricks] = static_cast<glm::uint8_t>(tag);
+
+		TagCounters& counters = m_tagCounters[tag];
+		counters.m_allocations.fetch_add(1, std::memory_order_relaxed);
+
+		const uint64_t liveBricks = counters.m_liveBricks.fetch_add(1, std::memory_order_relaxed) + 1;
+		uint64_t peakBricks = counters.m_peakBricks.load(std::memory_order_relaxed);
+		while (liveBricks > peakBricks && !counters.m_peakBricks.compare_exchange_weak(peakBricks, liveBricks, std::memory_order_relaxed)) {}
+
+		return { index, slab.m_generations[index % kSlabBricks].load(std::memory_order_relaxed) };
+	}
+
+	void BrickPool::Free(BrickHandle handle)
+	{
+		if (!handle.IsValid()) return;
+
+		Slab* slab = handle.m_index / kSlabBricks < kMaxSlabs ? m_slabs[handle.m_index / kSlabBricks].load(std::memory_order_acquire) : nullptr;
+
+		// Bumping the generation is what invalidates the handle, so a second free of it fails here.
+		glm::uint32_t generation = handle.m_generation;
+		if (!slab || !slab->m_generations[handle.m_index % kSlabBricks].compare_exchange_strong(generation, generation + 1, std::memory_order_relaxed))
+		{
+			AFRE_ERROR("Freed brick handle {} (generation {}) is not allocated!", handle.m_index, handle.m_generation);
+			return;
+		}
+
+		m_tagCounters[slab->m_tags[handle.m_index % kSlabBricks]].m_liveBricks.fetch_sub(1, std::memory_order_relaxed);
+
+		std::vector<glm::uint32_t>* cache = GetThreadCache();
+		if (!cache)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_freeIndices.push_back(handle.m_index);
+			return;
+		}
+
+		cache->push_back(handle.m_index);
+		if (cache->size() >= kThreadCacheBatch * 2) Drain(*cache, kThreadCacheBatch);
+	}
+
+	Brick* BrickPool::Resolve(BrickHandle handle) const
+	{
+		if (!handle.IsValid() || handle.m_index / kSlabBricks >= kMaxSlabs) return nullptr;
+
+		const Slab* slab = m_slabs[handle.m_index / kSlabBricks].load(std::memory_order_acquire);
+		if (!slab || slab->m_generations[handle.m_index % kSlabBricks].load(std::memory_order_relaxed) != handle.m_generation) return nullptr;
+
+		return slab->m_bricks + handle.m_index % kSlabBricks;
+	}
+
+	BrickPoolStats BrickPool::GetStats() const
+	{
+		BrickPoolStats stats{};
+		for (uint32_t tag = 0; tag < BRICK_POOL_TAG_COUNT; tag++)
+		{
+			stats.m_tags[tag].m_liveBricks = m_tagCounters[tag].m_liveBricks.load(std::memory_order_relaxed);
+			stats.m_tags[tag].m_peakBricks = m_tagCounters[tag].m_peakBricks.load(std::memory_order_relaxed);
+			stats.m_tags[tag].m_allocations = m_tagCounters[tag].m_allocations.load(std::memory_order_relaxed);
+		}
+
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		stats.m_slabCount = m_slabCount;
+		stats.m_hugePageSlabs = m_hugePageSlabs;
+		stats.m_reservedBytes = static_cast<uint64_t>(m_slabCount) * kSlabBytes;
+		stats.m_sharedFreeBricks = m_freeIndices.size();
+
+		return stats;
+	}
+
+	void BrickPool::LogStats() const
+	{
+		const BrickPoolStats stats = GetStats();
+		const double brickMb = static_cast<double>(sizeof(Brick)) / (1024.0 * 1024.0);
+
+		AFRE_INFO("Brick pool: {} slabs ({} with huge pages), {:.1f} MB reserved, {} bricks free in the shared list", stats.m_slabCount, stats.m_hugePageSlabs,
+			static_cast<double>(stats.m_reservedBytes) / (1024.0 * 1024.0), stats.m_sharedFreeBricks);
+
+		for (uint32_t tag = 0; tag < BRICK_POOL_TAG_COUNT; tag++)
+		{
+			const BrickPoolTagStats& tagStats = stats.m_tags[tag];
+			AFRE_INFO("  {}: {:.1f} MB in {} bricks, {:.1f} MB peak, {} allocations", GetBrickPoolTagName(static_cast<BrickPoolTag>(tag)),
+				static_cast<double>(tagStats.m_liveBricks) * brickMb, tagStats.m_liveBricks, static_cast<double>(tagStats.m_peakBricks) * brickMb, tagStats.m_allocations);
+		}
+	}
+
+	bool BrickPool::Refill(std::vector<glm::uint32_t>& cache)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		if (m_freeIndices.empty() && !AddSlab()) return false;
+
+		const size_t count = std::min(kThreadCacheBatch, m_freeIndices.size());
+		cache.insert(cache.end(), m_freeIndices.end() - count, m_freeIndices.end());
+		m_freeIndices.resize(m_freeIndices.size() - count);
+
+		return true;
+	}
+
+	void BrickPool::Drain(std::vector<glm::uint32_t>& cache, size_t keep)
+	{
+		// The oldest entries go, the most recently freed bricks are the likeliest to still be cached.
+		const size_t count = cache.size() - std::min(keep, cache.size());
+
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_freeIndices.insert(m_freeIndices.end(), cache.begin(), cache.begin() + count);
+		cache.erase(cache.begin(), cache.begin() + count);
+	}
+
+	bool BrickPool::AddSlab()
+	{
+		if (m_slabCount == kMaxSlabs)
+		{
+			AFRE_ERROR("The brick pool is out of slabs ({} bricks)!", static_cast<uint64_t>(kMaxSlabs) * kSlabBricks);
+			return false;
+		}
+
+		bool hugePages = false;
+		Brick* bricks = AllocateSlabMemory(hugePages);
+		if (!bricks)
+		{
+			AFRE_ERROR("Failed to allocate a {} MB brick slab!", kSlabBytes / (1024 * 1024));
+			return false;
+		}
+
+		Slab* slab = new Slab();
+		slab->m_bricks = bricks;
+		slab->m_hugePages = hugePages;
+
+		const uint32_t slabIndex = m_slabCount++;
+		m_slabs[slabIndex].store(slab, std::memory_order_release);
+		if (hugePages) m_hugePageSlabs++;
+
+		// Backwards, so the lowest addresses are handed out first.
+		for (uint32_t i = kSlabBricks; i > 0; i--) m_freeIndices.push_back(slabIndex * kSlabBricks + i - 1);
+
+		return true;
+	}
+
+	static std::shared_ptr<Brick> WrapPooledBrick(Brick* brick, BrickHandle handle)
+	{
+		return std::shared_ptr<Brick>(brick, [handle](Brick*) { BrickPool::Get().Free(handle); });
+	}
+
+	std::shared_ptr<Brick> MakePooledBrick(BrickPoolTag tag)
+	{
+		const BrickHandle handle = BrickPool::Get().Allocate(tag);
+		Brick* memory = BrickPool::Get().Resolve(handle);
+
+		// The pool already logged why, the heap still works.
+		if (!memory) return std::make_shared<Brick>();
+
+		return WrapPooledBrick(new (memory) Brick{}, handle);
+	}
+
+	std::shared_ptr<Brick> MakePooledBrick(BrickPoolTag tag, const Brick& brick)
+	{
+		const BrickHandle handle = BrickPool::Get().Allocate(tag);
+		Brick* memory = BrickPool::Get().Resolve(handle);
+
+		if (!memory) return std::make_shared<Brick>(brick);
+
+		return WrapPooledBrick(new (memory) Brick(brick), handle);
+	}
+}
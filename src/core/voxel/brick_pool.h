@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	// Who a brick was allocated for, memory is counted per tag.
+	enum BrickPoolTag
+	{
+		BRICK_POOL_WORLD = 0,
+		BRICK_POOL_UNIFORM = 1,
+		BRICK_POOL_SNAPSHOT = 2,
+		BRICK_POOL_OTHER = 3,
+		BRICK_POOL_TAG_COUNT = 4
+	};
+
+	const char* GetBrickPoolTagName(BrickPoolTag tag);
+
+	// Stays valid as a value after the brick is freed, Resolve returns null for it from then on.
+	struct BrickHandle
+	{
+		static constexpr glm::uint32_t kInvalidIndex = 0xFFFFFFFFu;
+
+		glm::uint32_t m_index = kInvalidIndex;
+		glm::uint32_t m_generation = 0;
+
+		inline bool IsValid() const { return m_index != kInvalidIndex; }
+	};
+
+	struct BrickPoolTagStats
+	{
+		uint64_t m_liveBricks = 0;
+		uint64_t m_peakBricks = 0;
+		uint64_t m_allocations = 0;
+	};
+
+	struct BrickPoolStats
+	{
+		BrickPoolTagStats m_tags[BRICK_POOL_TAG_COUNT]{};
+
+		uint32_t m_slabCount = 0;
+		// Slabs the OS was asked to back with huge pages. On Linux that's a hint, the kernel may still use small ones.
+		uint32_t m_hugePageSlabs = 0;
+		uint64_t m_reservedBytes = 0;
+		// In the shared free list, the per thread caches aren't counted.
+		uint64_t m_sharedFreeBricks = 0;
+	};
+
+	// Fixed size blocks for CPU side bricks, carved out of 2 MB slabs that are never returned to the OS.
+	// Each thread allocates from and frees to its own cache and only locks to move a batch to or from the shared list.
+	class BrickPool
+	{
+	public:
+		// A huge page, whatever the brick size picked with --brick-size.
+		static constexpr size_t kSlabBytes = 2 * 1024 * 1024;
+		static constexpr uint32_t kSlabBricks = static_cast<uint32_t>(std::max<size_t>(1, kSlabBytes / sizeof(Brick)));
+		// 32 GB of bricks.
+		static constexpr uint32_t kMaxSlabs = static_cast<uint32_t>((32ull * 1024 * 1024 * 1024) / kSlabBytes);
+
+		static_assert(kSlabBricks * sizeof(Brick) <= kSlabBytes, "A brick has to fit in a slab");
+
+		static BrickPool& Get();
+
+		// The contents are undefined. Invalid when kMaxSlabs are used up or the OS refused a slab.
+		BrickHandle Allocate(BrickPoolTag tag);
+		void Free(BrickHandle handle);
+
+		// Null for invalid and freed handles. Safe from any thread.
+		Brick* Resolve(BrickHandle handle) const;
+
+		BrickPoolStats GetStats() const;
+		void LogStats() const;
+
+	private:
+		struct Slab
+		{
+			Brick* m_bricks = nullptr;
+			std::atomic<glm::uint32_t> m_generations[kSlabBricks]{};
+			glm::uint8_t m_tags[kSlabBricks]{};
+			bool m_hugePages = false;
+		};
+
+		struct TagCounters
+		{
+			std::atomic<uint64_t> m_liveBricks{ 0 };
+			std::atomic<uint64_t> m_peakBricks{ 0 };
+			std::atomic<uint64_t> m_allocations{ 0 };
+		};
+
+		friend struct BrickPoolThreadCache;
+
+		BrickPool();
+
+		// Fill and drain the calling thread's cache, under m_mutex.
+		bool Refill(std::vector<glm::uint32_t>& cache);
+		void Drain(std::vector<glm::uint32_t>& cache, size_t keep);
+
+		bool AddSlab();
+
+		std::unique_ptr<std::atomic<Slab*>[]> m_slabs{};
+
+		mutable std::mutex m_mutex{};
+		std::vector<glm::uint32_t> m_freeIndices{};
+		uint32_t m_slabCount = 0;
+		uint32_t m_hugePageSlabs = 0;
+
+		TagCounters m_tagCounters[BRICK_POOL_TAG_COUNT]{};
+	};
+
+	// A reference counted brick from the pool, freed with its last reference. Zeroed, or a copy of brick.
+	std::shared_ptr<Brick> MakePooledBrick(BrickPoolTag tag);
+	std::shared_ptr<Brick> MakePooledBrick(BrickPoolTag tag, const Brick& brick);
+}
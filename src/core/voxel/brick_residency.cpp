@@ -0,0 +1,210 @@
+#include "brick_residency.h"
+#include <algorithm>
+#include <functional>
+
+namespace afre
+{
+	BrickResidency::BrickResidency(uint32_t initialCapacity, uint32_t maxCapacity)
+		: m_initialCapacity(std::max(initialCapacity, 1u)), m_maxCapacity(std::max(maxCapacity, std::max(initialCapacity, 1u)))
+	{
+	}
+
+	void BrickResidency::Reset(uint32_t brickCount)
+	{
+		m_brickSlots.assign(brickCount, kNoSlot);
+		m_slots.clear();
+		m_freeSlots.clear();
+		m_requests.clear();
+
+		m_capacityLimit = std::min(m_maxCapacity, std::max(brickCount, 1u));
+		m_capacity = 0;
+		m_residentCount = 0;
+		m_newest = kNoSlot;
+		m_oldest = kNoSlot;
+
+		Grow(std::min(m_initialCapacity, m_capacityLimit));
+	}
+
+	void BrickResidency::Resize(uint32_t brickCount)
+	{
+		BrickResidencyStats stats{};
+		for (uint32_t brick = brickCount; brick < m_brickSlots.size(); brick++)
+		{
+			if (m_brickSlots[brick] != kNoSlot) Evict(m_brickSlots[brick], stats);
+		}
+
+		m_brickSlots.resize(brickCount, kNoSlot);
+		m_requests.erase(std::remove_if(m_requests.begin(), m_requests.end(), [&](uint32_t brick) { return brick >= brickCount; }), m_requests.end());
+
+		// Slots past a smaller limit stay until the next compaction hands them back.
+		m_capacityLimit = std::min(m_maxCapacity, std::max(brickCount, 1u));
+		if (m_capacity == 0) Grow(std::min(m_initialCapacity, m_capacityLimit));
+	}
+
+	void BrickResidency::MarkSlotsUsed(const glm::uint32_t* usedSlots)
+	{
+		for (uint32_t slot = 0; slot < m_capacity; slot++)
+		{
+			if ((usedSlots[slot >> 5] & (1u << (slot & 31))) == 0 || m_slots[slot].m_brick == kNoSlot) continue;
+
+			m_slots[slot].m_lastUsedFrame = m_frame;
+			Unlink(slot);
+			PushNewest(slot);
+		}
+	}
+
+	void BrickResidency::Request(uint32_t brick)
+	{
+		if (brick < m_brickSlots.size() && m_brickSlots[brick] == kNoSlot) m_requests.push_back(brick);
+	}
+
+	bool BrickResidency::Update(std::vector<BrickUpload>& uploads, BrickResidencyStats& stats)
+	{
+		stats = {};
+		bool changed = false;
+
+		while (m_oldest != kNoSlot && m_slots[m_oldest].m_lastUsedFrame + kIdleFrames < m_frame)
+		{
+			Evict(m_oldest, stats);
+			changed = true;
+		}
+
+		for (const uint32_t brick : m_requests)
+		{
+			// The same brick can be asked for more than once in a frame.
+			if (m_brickSlots[brick] != kNoSlot) continue;
+
+			if (m_freeSlots.empty())
+			{
+				if (m_oldest != kNoSlot && m_slots[m_oldest].m_lastUsedFrame < m_frame)
+				{
+					Evict(m_oldest, stats);
+				}
+				else if (m_capacity < m_capacityLimit)
+				{
+					Grow(std::min(m_capacity * 2, m_capacityLimit));
+				}
+				else
+				{
+					stats.m_deferredRequests++;
+					continue;
+				}
+			}
+
+			const uint32_t slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+
+			Assign(slot, brick, uploads);
+			stats.m_uploadedBricks++;
+			changed = true;
+		}
+
+		m_requests.clear();
+
+		changed |= Compact(uploads, stats);
+		m_frame++;
+
+		return changed;
+	}
+
+	void BrickResidency::Unlink(uint32_t slot)
+	{
+		Slot& unlinked = m_slots[slot];
+
+		if (unlinked.m_newer != kNoSlot) m_slots[unlinked.m_newer].m_older = unlinked.m_older;
+		else if (m_newest == slot) m_newest = unlinked.m_older;
+
+		if (unlinked.m_older != kNoSlot) m_slots[unlinked.m_older].m_newer = unlinked.m_newer;
+		else if (m_oldest == slot) m_oldest = unlinked.m_newer;
+
+		unlinked.m_newer = kNoSlot;
+		unlinked.m_older = kNoSlot;
+	}
+
+	void BrickResidency::PushNewest(uint32_t slot)
+	{
+		m_slots[slot].m_older = m_newest;
+		if (m_newest != kNoSlot) m_slots[m_newest].m_newer = slot;
+
+		m_newest = slot;
+		if (m_oldest == kNoSlot) m_oldest = slot;
+	}
+
+	void BrickResidency::Assign(uint32_t slot, uint32_t brick, std::vector<BrickUpload>& uploads)
+	{
+		// Counted as used this frame, so the next request can't evict it before the GPU ever reads it.
+		m_slots[slot].m_brick = brick;
+		m_slots[slot].m_lastUsedFrame = m_frame;
+		PushNewest(slot);
+
+		m_brickSlots[brick] = slot;
+		m_residentCount++;
+
+		uploads.push_back({ brick, slot });
+	}
+
+	void BrickResidency::Evict(uint32_t slot, BrickResidencyStats& stats)
+	{
+		m_brickSlots[m_slots[slot].m_brick] = kNoSlot;
+		m_slots[slot].m_brick = kNoSlot;
+		Unlink(slot);
+
+		m_freeSlots.push_back(slot);
+		m_residentCount--;
+		stats.m_evictedBricks++;
+	}
+
+	void BrickResidency::Grow(uint32_t capacity)
+	{
+		// The new slots are all above the free ones, they go in front so the lowest are still handed out first.
+		for (uint32_t slot = m_capacity; slot < capacity; slot++)
+		{
+			m_slots.push_back({});
+			m_freeSlots.insert(m_freeSlots.begin(), slot);
+		}
+
+		m_capacity = capacity;
+	}
+
+	bool BrickResidency::Compact(std::vector<BrickUpload>& uploads, BrickResidencyStats& stats)
+	{
+		if (m_capacity <= m_initialCapacity || m_residentCount >= m_capacity / 4) return false;
+
+		const uint32_t capacity = std::max(m_capacity / 2, m_initialCapacity);
+
+		m_freeSlots.erase(std::remove_if(m_freeSlots.begin(), m_freeSlots.end(), [&](uint32_t slot) { return slot >= capacity; }), m_freeSlots.end());
+		std::sort(m_freeSlots.begin(), m_freeSlots.end(), std::greater<uint32_t>());
+
+		// Fewer residents than a quarter of the slots, the lower half always has room for the upper one.
+		bool moved = false;
+		for (uint32_t from = capacity; from < m_capacity; from++)
+		{
+			if (m_slots[from].m_brick == kNoSlot) continue;
+
+			const uint32_t to = m_freeSlots.back();
+			m_freeSlots.pop_back();
+
+			// Takes over the place in the recency list as well.
+			Slot& target = m_slots[to];
+			target = m_slots[from];
+
+			if (target.m_newer != kNoSlot) m_slots[target.m_newer].m_older = to;
+			else m_newest = to;
+
+			if (target.m_older != kNoSlot) m_slots[target.m_older].m_newer = to;
+			else m_oldest = to;
+
+			m_brickSlots[target.m_brick] = to;
+			uploads.push_back({ target.m_brick, to });
+
+			stats.m_movedBricks++;
+			stats.m_uploadedBricks++;
+			moved = true;
+		}
+
+		m_slots.resize(capacity);
+		m_capacity = capacity;
+
+		return moved;
+	}
+}
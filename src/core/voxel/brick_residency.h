@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	// A brick to copy into a pool slot before the next frame reads the table.
+	struct BrickUpload
+	{
+		uint32_t m_brick = 0;
+		uint32_t m_slot = 0;
+	};
+
+	struct BrickResidencyStats
+	{
+		uint32_t m_uploadedBricks = 0;
+		uint32_t m_evictedBricks = 0;
+		// Moved down into a free slot by a compaction, counted in m_uploadedBricks too.
+		uint32_t m_movedBricks = 0;
+		// Asked for while every slot held a brick the GPU read this frame, asked for again next frame.
+		uint32_t m_deferredRequests = 0;
+	};
+
+	// Keeps the bricks the GPU asked for in a budget of pool slots. When no slot is free the least recently
+	// used brick is evicted, unless the GPU read every resident brick this frame, then the capacity grows
+	// towards the budget instead. Once the working set shrinks the residents are compacted into the lower
+	// half of the slots and the capacity halves.
+	class BrickResidency
+	{
+	public:
+		static constexpr uint32_t kNoSlot = ~0u;
+		// Bricks no ray read for this many frames give their slot back, so the capacity can shrink again.
+		static constexpr uint64_t kIdleFrames = 120;
+
+		BrickResidency(uint32_t initialCapacity, uint32_t maxCapacity);
+
+		// Every brick starts out non resident and all slots free. Bricks are indexed however the caller likes.
+		// The capacity never grows past brickCount, more slots than bricks would never be used.
+		void Reset(uint32_t brickCount);
+		// Keeps the slots of bricks below brickCount, bricks past it lose theirs. For a world whose bricks were
+		// renumbered, the caller copies the new contents into the slots of the bricks that changed.
+		void Resize(uint32_t brickCount);
+
+		// One bit per slot the GPU read from this frame, up to the capacity.
+		void MarkSlotsUsed(const glm::uint32_t* usedSlots);
+		void Request(uint32_t brick);
+
+		// Hands slots to the bricks requested since the last call and ends the frame. Bricks that lost their
+		// slot read as non resident again. True if any brick's slot changed.
+		bool Update(std::vector<BrickUpload>& uploads, BrickResidencyStats& stats);
+
+		inline uint32_t GetSlot(uint32_t brick) const { return m_brickSlots[brick]; }
+		inline uint32_t GetCapacity() const { return m_capacity; }
+		inline uint32_t GetResidentCount() const { return m_residentCount; }
+
+	private:
+		struct Slot
+		{
+			uint32_t m_brick = kNoSlot;
+			uint64_t m_lastUsedFrame = 0;
+			// Neighbours in the recency list of resident slots, most recently used first.
+			uint32_t m_newer = kNoSlot;
+			uint32_t m_older = kNoSlot;
+		};
+
+		void Unlink(uint32_t slot);
+		void PushNewest(uint32_t slot);
+		void Assign(uint32_t slot, uint32_t brick, std::vector<BrickUpload>& uploads);
+		void Evict(uint32_t slot, BrickResidencyStats& stats);
+		void Grow(uint32_t capacity);
+		bool Compact(std::vector<BrickUpload>& uploads, BrickResidencyStats& stats);
+
+		uint32_t m_initialCapacity = 0;
+		uint32_t m_maxCapacity = 0;
+		// m_maxCapacity, or less for a world with fewer bricks.
+		uint32_t m_capacityLimit = 0;
+		uint32_t m_capacity = 0;
+		uint32_t m_residentCount = 0;
+		uint64_t m_frame = 1;
+
+		std::vector<uint32_t> m_brickSlots{};
+		std::vector<Slot> m_slots{};
+		// Free slots below the capacity, popped from the back so the lowest ones go first.
+		std::vector<uint32_t> m_freeSlots{};
+		uint32_t m_newest = kNoSlot;
+		uint32_t m_oldest = kNoSlot;
+
+		std::vector<uint32_t> m_requests{};
+	};
+}
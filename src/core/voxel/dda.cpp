@@ -0,0 +1,93 @@
+#include "dda.h"
+
+namespace afre
+{
+	static constexpr int32_t kBrickEdge = static_cast<int32_t>(kBrickSize);
+
+	RayHit TraceRay(const VoxelWorld& world, const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance)
+	{
+		RayHit rayHit{};
+
+		const glm::vec3 deltaDist = 1.f / glm::abs(rayDir);
+		glm::ivec3 voxelMap = glm::ivec3(glm::floor(rayOrigin));
+		const glm::ivec3 voxelStep = glm::ivec3(glm::sign(rayDir));
+
+		glm::vec3 sideDist{};
+		for (uint8_t i = 0; i < 3; i++)
+		{
+			const float fraction = rayOrigin[i] - static_cast<float>(voxelMap[i]);
+			sideDist[i] = (rayDir[i] < 0 ? fraction : 1.f - fraction) * deltaDist[i];
+		}
+
+		float currentDistance = 0.f;
+		while (currentDistance < maxDistance)
+		{
+			// Picks the axis with the closest boundary, same order as the shader.
+			uint8_t axis = 0;
+			if (sideDist.x < sideDist.y)
+			{
+				axis = sideDist.x < sideDist.z ? 0 : 2;
+			}
+			else
+			{
+				axis = sideDist.y < sideDist.z ? 1 : 2;
+			}
+
+			voxelMap[axis] += voxelStep[axis];
+			currentDistance = sideDist[axis];
+			sideDist[axis] += deltaDist[axis];
+
+			rayHit.m_steps++;
+
+			const glm::uint16_t voxel = world.GetVoxel(voxelMap);
+			if (voxel > 0)
+			{
+				rayHit.m_hit = true;
+				rayHit.m_voxelPosition = voxelMap;
+				rayHit.m_faceNormal = glm::ivec3(0);
+				rayHit.m_faceNormal[axis] = -voxelStep[axis];
+				rayHit.m_voxel = voxel;
+				rayHit.m_distance = currentDistance;
+
+				return rayHit;
+			}
+
+			// Nothing to hit inside an empty brick, so the ray goes straight to where it leaves it.
+			glm::uint16_t uniformVoxel = 0;
+			if (world.IsInside(voxelMap) && world.IsBrickUniform(glm::uvec3(voxelMap / kBrickEdge), uniformVoxel))
+			{
+				const glm::ivec3 brickMin = voxelMap / kBrickEdge * kBrickEdge;
+
+				float exitDistance = maxDistance;
+				for (uint8_t i = 0; i < 3; i++)
+				{
+					if (rayDir[i] == 0.f) continue;
+
+					const float exitPlane = static_cast<float>(brickMin[i] + (rayDir[i] > 0.f ? kBrickEdge : 0));
+					exitDistance = glm::min(exitDistance, (exitPlane - rayOrigin[i]) / rayDir[i]);
+				}
+
+				if (exitDistance > currentDistance)
+				{
+					// Land on the last voxel of the brick along the ray, the next step leaves it.
+					const glm::ivec3 exitVoxel = glm::clamp(glm::ivec3(glm::floor(rayOrigin + rayDir * exitDistance)), brickMin, brickMin + glm::ivec3(kBrickEdge - 1));
+
+					for (uint8_t i = 0; i < 3; i++)
+					{
+						// Rounding near a brick corner can put the exit point in a voxel the ray already left, stepping back there would loop forever.
+						voxelMap[i] = rayDir[i] > 0.f ? glm::max(exitVoxel[i], voxelMap[i]) : glm::min(exitVoxel[i], voxelMap[i]);
+
+						const float nextPlane = static_cast<float>(voxelMap[i] + (rayDir[i] > 0.f ? 1 : 0));
+						sideDist[i] = rayDir[i] == 0.f ? deltaDist[i] : (nextPlane - rayOrigin[i]) / rayDir[i];
+					}
+
+					currentDistance = exitDistance;
+				}
+			}
+		}
+
+		rayHit.m_distance = currentDistance;
+
+		return rayHit;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "voxel_world.h"
+
+namespace afre
+{
+	struct RayHit
+	{
+		bool m_hit = false;
+		glm::ivec3 m_voxelPosition{};
+		glm::ivec3 m_faceNormal{};
+		glm::uint16_t m_voxel = 0;
+		float m_distance = 0.f;
+		uint32_t m_steps = 0;
+	};
+
+	// CPU version of the 3D DDA traversal in FragMain. Used for picking, benchmarks and tooling.
+	RayHit TraceRay(const VoxelWorld& world, const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance);
+}
@@ -0,0 +1,582 @@
+#include "edit_replication.h"
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <type_traits>
+#include "brick_kernels.h"
+#include "log.h"
+
+namespace afre
+{
+	// Everything is written in host byte order, every platform the engine targets is little endian.
+	static constexpr uint8_t kBrickPacket = 1;
+	static constexpr uint8_t kAckPacket = 2;
+
+	// Type, sequence and brick count.
+	static constexpr size_t kPacketHeaderSize = 1 + 4 + 2;
+	static constexpr size_t kBrickCountOffset = 1 + 4;
+	// The delta of a 32 voxel brick can take more than 64 KB.
+	using PayloadSize = std::conditional_t<kBrickVoxelCount <= 4096, uint16_t, uint32_t>;
+
+	// Brick index, base version, version, encoding and payload size.
+	static constexpr size_t kBrickHeaderSize = 4 + 8 + 8 + 1 + sizeof(PayloadSize);
+
+	static constexpr size_t kChangeMaskSize = kBrickVoxelCount / 8;
+
+	template<typename T>
+	static void WriteValue(std::vector<uint8_t>& data, T value)
+	{
+		const size_t offset = data.size();
+		data.resize(offset + sizeof(T));
+		std::memcpy(data.data() + offset, &value, sizeof(T));
+	}
+
+	class PacketReader
+	{
+	public:
+		PacketReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+		template<typename T>
+		bool Read(T& value)
+		{
+			if (m_size - m_position < sizeof(T)) return false;
+
+			std::memcpy(&value, m_data + m_position, sizeof(T));
+			m_position += sizeof(T);
+
+			return true;
+		}
+
+		bool ReadBytes(const uint8_t*& bytes, size_t size)
+		{
+			if (m_size - m_position < size) return false;
+
+			bytes = m_data + m_position;
+			m_position += size;
+
+			return true;
+		}
+
+		inline bool IsAtEnd() const { return m_position == m_size; }
+
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		size_t m_position = 0;
+	};
+
+	static const Brick s_emptyBrick{};
+
+	// Picks the smallest encoding of brick against base, null meaning the empty brick.
+	static BrickDeltaEncoding EncodeBrickDelta(const Brick& brick, const Brick* base, std::vector<glm::uint16_t>& compressed, std::vector<uint8_t>& encoded)
+	{
+		encoded.clear();
+		compressed.clear();
+
+		const glm::uint16_t* voxels = brick.m_voxels;
+		const glm::uint16_t* baseVoxels = base ? base->m_voxels : s_emptyBrick.m_voxels;
+		const glm::uint16_t firstVoxel = voxels[0];
+
+		// One pass for the uniform check, the bit-packing size and the runs, which are (length, value) pairs like CompressBrick's.
+		bool uniform = true;
+		uint32_t changedCount = 0;
+		glm::uint16_t changedBits = 0;
+		glm::uint16_t runValue = voxels[0] ^ baseVoxels[0];
+		glm::uint16_t runLength = 0;
+
+		// Edits leave most of a delta zero, so four voxels at a time extend a run of unchanged ones.
+		const uint64_t firstVoxels = firstVoxel * 0x0001000100010001ull;
+		for (uint32_t block = 0; block < kBrickVoxelCount; block += 4)
+		{
+			uint64_t blockVoxels = 0;
+			uint64_t blockBaseVoxels = 0;
+			std::memcpy(&blockVoxels, voxels + block, sizeof(blockVoxels));
+			std::memcpy(&blockBaseVoxels, baseVoxels + block, sizeof(blockBaseVoxels));
+
+			uniform &= blockVoxels == firstVoxels;
+
+			if (blockVoxels == blockBaseVoxels && runValue == 0)
+			{
+				runLength += 4;
+				continue;
+			}
+
+			for (uint32_t i = block; i < block + 4; i++)
+			{
+				const glm::uint16_t value = voxels[i] ^ baseVoxels[i];
+
+				changedCount += value != 0 ? 1 : 0;
+				changedBits |= value;
+
+				if (value != runValue)
+				{
+					compressed.push_back(runLength);
+					compressed.push_back(runValue);
+
+					runValue = value;
+					runLength = 0;
+				}
+
+				runLength++;
+			}
+		}
+
+		compressed.push_back(runLength);
+		compressed.push_back(runValue);
+
+		if (uniform)
+		{
+			WriteValue<glm::uint16_t>(encoded, firstVoxel);
+			return BRICK_DELTA_UNIFORM;
+		}
+
+		uint32_t bitWidth = 1;
+		while (bitWidth < 16 && (changedBits >> bitWidth) != 0) bitWidth++;
+
+		const size_t rleSize = compressed.size() * sizeof(glm::uint16_t);
+		const size_t bitpackSize = kChangeMaskSize + 1 + (changedCount * bitWidth + 7) / 8;
+
+		if (rleSize <= bitpackSize)
+		{
+			encoded.resize(rleSize);
+			std::memcpy(encoded.data(), compressed.data(), rleSize);
+			return BRICK_DELTA_RLE;
+		}
+
+		// The change mask is the diff's words as little endian bytes.
+		glm::uint64_t changed[kBrickOccupancyWords]{};
+		GetBrickKernels().m_diff(voxels, baseVoxels, changed);
+
+		encoded.resize(kChangeMaskSize);
+		std::memcpy(encoded.data(), changed, kChangeMaskSize);
+
+		encoded.push_back(static_cast<uint8_t>(bitWidth));
+
+		// Least significant bits first.
+		uint32_t bitBuffer = 0;
+		uint32_t bitCount = 0;
+		for (uint32_t i = 0; i < kBrickVoxelCount; i++)
+		{
+			const glm::uint16_t value = voxels[i] ^ baseVoxels[i];
+			if (value == 0) continue;
+
+			bitBuffer |= static_cast<uint32_t>(value) << bitCount;
+			bitCount += bitWidth;
+
+			while (bitCount >= 8)
+			{
+				encoded.push_back(static_cast<uint8_t>(bitBuffer));
+				bitBuffer >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		if (bitCount > 0) encoded.push_back(static_cast<uint8_t>(bitBuffer));
+
+		return BRICK_DELTA_BITPACK;
+	}
+
+	// Checked before anything is applied, so a malformed brick leaves the replica untouched.
+	static bool IsValidBrickDelta(uint8_t encoding, const uint8_t* payload, size_t payloadSize)
+	{
+		if (encoding == BRICK_DELTA_UNIFORM) return payloadSize == sizeof(glm::uint16_t);
+
+		if (encoding == BRICK_DELTA_RLE)
+		{
+			if (payloadSize % (2 * sizeof(glm::uint16_t)) != 0) return false;
+
+			uint32_t voxelCount = 0;
+			for (size_t offset = 0; offset < payloadSize; offset += 2 * sizeof(glm::uint16_t))
+			{
+				glm::uint16_t runLength = 0;
+				std::memcpy(&runLength, payload + offset, sizeof(runLength));
+
+				if (runLength == 0 || voxelCount + runLength > kBrickVoxelCount) return false;
+				voxelCount += runLength;
+			}
+
+			return voxelCount == kBrickVoxelCount;
+		}
+
+		if (encoding != BRICK_DELTA_BITPACK || payloadSize < kChangeMaskSize + 1) return false;
+
+		const uint32_t bitWidth = payload[kChangeMaskSize];
+		if (bitWidth == 0 || bitWidth > 16) return false;
+
+		uint32_t changedCount = 0;
+		for (size_t i = 0; i < kChangeMaskSize; i++) changedCount += static_cast<uint32_t>(std::bitset<8>(payload[i]).count());
+
+		return payloadSize - kChangeMaskSize - 1 == (changedCount * bitWidth + 7) / 8;
+	}
+
+	// XORs a validated delta into the voxels. Runs of unchanged voxels are skipped without touching them.
+	static void ApplyBrickDelta(uint8_t encoding, const uint8_t* payload, size_t payloadSize, glm::uint16_t* voxels)
+	{
+		if (encoding == BRICK_DELTA_RLE)
+		{
+			uint32_t voxelIndex = 0;
+			for (size_t offset = 0; offset < payloadSize; offset += 2 * sizeof(glm::uint16_t))
+			{
+				glm::uint16_t run[2]{};
+				std::memcpy(run, payload + offset, sizeof(run));
+
+				if (run[1] != 0)
+				{
+					for (uint32_t i = voxelIndex; i < voxelIndex + run[0]; i++) voxels[i] ^= run[1];
+				}
+
+				voxelIndex += run[0];
+			}
+
+			return;
+		}
+
+		const uint32_t bitWidth = payload[kChangeMaskSize];
+		const uint8_t* packed = payload + kChangeMaskSize + 1;
+		const uint32_t valueMask = (1u << bitWidth) - 1;
+
+		uint32_t bitBuffer = 0;
+		uint32_t bitCount = 0;
+		for (uint32_t i = 0; i < kBrickVoxelCount; i++)
+		{
+			if ((payload[i >> 3] & (1u << (i & 7))) == 0) continue;
+
+			while (bitCount < bitWidth)
+			{
+				bitBuffer |= static_cast<uint32_t>(*packed++) << bitCount;
+				bitCount += 8;
+			}
+
+			voxels[i] ^= static_cast<glm::uint16_t>(bitBuffer & valueMask);
+			bitBuffer >>= bitWidth;
+			bitCount -= bitWidth;
+		}
+	}
+
+	uint32_t ReplicationServer::AddClient(const ReplicationClientInfo& replicationClientInfo)
+	{
+		const uint32_t clientId = m_nextClientId++;
+		m_clients[clientId].m_info = replicationClientInfo;
+
+		return clientId;
+	}
+
+	void ReplicationServer::RemoveClient(uint32_t clientId)
+	{
+		m_clients.erase(clientId);
+	}
+
+	void ReplicationServer::WritePackets(uint32_t clientId, const WorldSnapshot& snapshot, std::vector<std::vector<uint8_t>>& packets)
+	{
+		const std::unordered_map<uint32_t, ClientState>::iterator client = m_clients.find(clientId);
+		if (client == m_clients.end())
+		{
+			AFRE_ERROR("Tried to replicate to an unknown client {}!", clientId);
+			return;
+		}
+
+		ClientState& clientState = client->second;
+		const uint32_t brickCount = snapshot.GetBrickCount();
+
+		// New clients start out with the empty world.
+		if (clientState.m_bricks.size() != brickCount) clientState.m_bricks.assign(brickCount, ClientBrick{});
+
+		clientState.m_tick++;
+		ResendLostPackets(clientState);
+
+		// Unused budget isn't saved up, an overdraft is carried over.
+		const int64_t bytesPerTick = clientState.m_info.m_bytesPerTick;
+		clientState.m_credit = std::min(clientState.m_credit + bytesPerTick, bytesPerTick);
+
+		size_t packetIndex = 0;
+		bool packetOpen = false;
+		uint16_t packetBrickCount = 0;
+
+		const auto closePacket = [&]()
+		{
+			std::memcpy(packets[packetIndex].data() + kBrickCountOffset, &packetBrickCount, sizeof(packetBrickCount));
+
+			clientState.m_stats.m_packetsSent++;
+			clientState.m_stats.m_bytesSent += packets[packetIndex].size();
+			packetOpen = false;
+		};
+
+		for (uint32_t n = 0; n < brickCount && clientState.m_credit > 0; n++)
+		{
+			const uint32_t brickIndex = (clientState.m_cursor + n) % brickCount;
+			ClientBrick& clientBrick = clientState.m_bricks[brickIndex];
+
+			const uint64_t version = snapshot.GetBrickVersion(brickIndex);
+			if (version == clientBrick.m_sentVersion) continue;
+
+			const std::shared_ptr<const Brick>& brick = snapshot.GetSharedBrick(brickIndex);
+			const BrickDeltaEncoding encoding = EncodeBrickDelta(*brick, clientBrick.m_sentBrick.get(), m_compressed, m_encoded);
+			const size_t entrySize = kBrickHeaderSize + m_encoded.size();
+
+			if (packetOpen && packets[packetIndex].size() + entrySize > clientState.m_info.m_maxPacketSize) closePacket();
+
+			if (!packetOpen)
+			{
+				packetIndex = packets.size();
+				packets.emplace_back();
+				packetOpen = true;
+				packetBrickCount = 0;
+
+				std::vector<uint8_t>& packet = packets[packetIndex];
+				WriteValue<uint8_t>(packet, kBrickPacket);
+				WriteValue<uint32_t>(packet, clientState.m_nextSequence);
+				WriteValue<uint16_t>(packet, 0);
+
+				InFlightPacket inFlightPacket{};
+				inFlightPacket.m_sequence = clientState.m_nextSequence++;
+				inFlightPacket.m_tick = clientState.m_tick;
+				clientState.m_inFlightPackets.push_back(std::move(inFlightPacket));
+
+				clientState.m_credit -= static_cast<int64_t>(kPacketHeaderSize);
+			}
+
+			std::vector<uint8_t>& packet = packets[packetIndex];
+			WriteValue<uint32_t>(packet, brickIndex);
+			WriteValue<uint64_t>(packet, clientBrick.m_sentVersion);
+			WriteValue<uint64_t>(packet, version);
+			WriteValue<uint8_t>(packet, static_cast<uint8_t>(encoding));
+			WriteValue<PayloadSize>(packet, static_cast<PayloadSize>(m_encoded.size()));
+			packet.insert(packet.end(), m_encoded.begin(), m_encoded.end());
+			packetBrickCount++;
+
+			clientState.m_inFlightPackets.back().m_bricks.push_back({ brickIndex, version, brick });
+
+			clientState.m_stats.m_bricksSent++;
+			clientState.m_stats.m_encodings[encoding]++;
+			if (clientBrick.m_resend) clientState.m_stats.m_bricksResent++;
+
+			clientBrick.m_sentBrick = brick;
+			clientBrick.m_sentVersion = version;
+			clientBrick.m_resend = false;
+
+			clientState.m_credit -= static_cast<int64_t>(entrySize);
+			clientState.m_cursor = (brickIndex + 1) % brickCount;
+		}
+
+		if (packetOpen) closePacket();
+	}
+
+	void ReplicationServer::ResendLostPackets(ClientState& clientState)
+	{
+		std::deque<InFlightPacket>& inFlightPackets = clientState.m_inFlightPackets;
+
+		while (!inFlightPackets.empty() && inFlightPackets.front().m_tick + clientState.m_info.m_resendTicks <= clientState.m_tick)
+		{
+			for (const SentBrick& sentBrick : inFlightPackets.front().m_bricks)
+			{
+				ClientBrick& clientBrick = clientState.m_bricks[sentBrick.m_brickIndex];
+
+				// A newer version went out after it, that packet decides.
+				if (clientBrick.m_sentVersion != sentBrick.m_version) continue;
+
+				clientBrick.m_sentBrick = clientBrick.m_ackedBrick;
+				clientBrick.m_sentVersion = clientBrick.m_ackedVersion;
+				clientBrick.m_resend = true;
+			}
+
+			inFlightPackets.pop_front();
+		}
+	}
+
+	bool ReplicationServer::ReadAck(uint32_t clientId, const uint8_t* data, size_t size)
+	{
+		const std::unordered_map<uint32_t, ClientState>::iterator client = m_clients.find(clientId);
+		if (client == m_clients.end()) return false;
+
+		ClientState& clientState = client->second;
+
+		PacketReader reader{ data, size };
+		uint8_t type = 0;
+		uint32_t sequence = 0;
+		uint16_t resyncCount = 0;
+		if (!reader.Read(type) || type != kAckPacket || !reader.Read(sequence) || !reader.Read(resyncCount)) return false;
+
+		std::deque<InFlightPacket>& inFlightPackets = clientState.m_inFlightPackets;
+		const std::deque<InFlightPacket>::iterator inFlightPacket = std::find_if(inFlightPackets.begin(), inFlightPackets.end(),
+			[&](const InFlightPacket& packet) { return packet.m_sequence == sequence; });
+
+		// Packets already given up on have their bricks on the way again, the new ones get acked instead.
+		if (inFlightPacket != inFlightPackets.end())
+		{
+			for (SentBrick& sentBrick : inFlightPacket->m_bricks)
+			{
+				ClientBrick& clientBrick = clientState.m_bricks[sentBrick.m_brickIndex];
+				if (sentBrick.m_version <= clientBrick.m_ackedVersion) continue;
+
+				clientBrick.m_ackedBrick = std::move(sentBrick.m_brick);
+				clientBrick.m_ackedVersion = sentBrick.m_version;
+			}
+
+			inFlightPackets.erase(inFlightPacket);
+		}
+
+		// The client didn't have the version the delta was against, a packet before it was lost. Start it over from the
+		// empty brick.
+		for (uint16_t r = 0; r < resyncCount; r++)
+		{
+			uint32_t brickIndex = 0;
+			if (!reader.Read(brickIndex) || brickIndex >= clientState.m_bricks.size()) return false;
+
+			ClientBrick& clientBrick = clientState.m_bricks[brickIndex];
+			clientBrick.m_ackedBrick.reset();
+			clientBrick.m_ackedVersion = 0;
+			clientBrick.m_sentBrick.reset();
+			clientBrick.m_sentVersion = 0;
+			clientBrick.m_resend = true;
+		}
+
+		return reader.IsAtEnd();
+	}
+
+	uint32_t ReplicationServer::GetPendingBrickCount(uint32_t clientId, const WorldSnapshot& snapshot) const
+	{
+		const std::unordered_map<uint32_t, ClientState>::const_iterator client = m_clients.find(clientId);
+		if (client == m_clients.end()) return 0;
+
+		const std::vector<ClientBrick>& clientBricks = client->second.m_bricks;
+
+		uint32_t pendingCount = 0;
+		for (uint32_t brickIndex = 0; brickIndex < snapshot.GetBrickCount(); brickIndex++)
+		{
+			const uint64_t sentVersion = brickIndex < clientBricks.size() ? clientBricks[brickIndex].m_sentVersion : 0;
+			pendingCount += snapshot.GetBrickVersion(brickIndex) != sentVersion ? 1 : 0;
+		}
+
+		return pendingCount;
+	}
+
+	const ReplicationStats& ReplicationServer::GetStats(uint32_t clientId) const
+	{
+		static const ReplicationStats s_noStats{};
+
+		const std::unordered_map<uint32_t, ClientState>::const_iterator client = m_clients.find(clientId);
+		return client != m_clients.end() ? client->second.m_stats : s_noStats;
+	}
+
+	ReplicationClient::ReplicationClient(const glm::uvec3& sizeInBricks)
+		: m_world(sizeInBricks), m_brickVersions(m_world.GetBrickCount(), 0)
+	{
+	}
+
+	bool ReplicationClient::ReadPacket(const uint8_t* data, size_t size, std::vector<uint8_t>& ack)
+	{
+		PacketReader reader{ data, size };
+		uint8_t type = 0;
+		uint32_t sequence = 0;
+		uint16_t brickCount = 0;
+		if (!reader.Read(type) || type != kBrickPacket || !reader.Read(sequence) || !reader.Read(brickCount)) return false;
+
+		const glm::uvec3 sizeInBricks = m_world.GetSizeInBricks();
+		m_resyncBricks.clear();
+
+		for (uint16_t b = 0; b < brickCount; b++)
+		{
+			uint32_t brickIndex = 0;
+			uint64_t baseVersion = 0;
+			uint64_t version = 0;
+			uint8_t encoding = 0;
+			PayloadSize payloadSize = 0;
+			const uint8_t* payload = nullptr;
+
+			if (!reader.Read(brickIndex) || !reader.Read(baseVersion) || !reader.Read(version) || !reader.Read(encoding)
+				|| !reader.Read(payloadSize) || !reader.ReadBytes(payload, payloadSize)) return false;
+
+			if (brickIndex >= m_brickVersions.size()) return false;
+
+			// Already newer, from a packet that overtook this one.
+			if (version <= m_brickVersions[brickIndex]) continue;
+
+			if (!IsValidBrickDelta(encoding, payload, payloadSize)) return false;
+
+			const bool uniform = encoding == BRICK_DELTA_UNIFORM;
+			if (!uniform && baseVersion != 0 && baseVersion != m_brickVersions[brickIndex])
+			{
+				m_resyncBricks.push_back(brickIndex);
+				continue;
+			}
+
+			const glm::uvec3 brickPosition{ brickIndex % sizeInBricks.x, brickIndex / sizeInBricks.x % sizeInBricks.y, brickIndex / (sizeInBricks.x * sizeInBricks.y) };
+			glm::uint16_t* voxels = m_world.GetMutableBrick(brickPosition).m_voxels;
+
+			if (uniform)
+			{
+				glm::uint16_t uniformVoxel = 0;
+				std::memcpy(&uniformVoxel, payload, sizeof(uniformVoxel));
+				std::fill(voxels, voxels + kBrickVoxelCount, uniformVoxel);
+			}
+			else
+			{
+				// Base 0 is the empty brick, whatever the client has.
+				if (baseVersion == 0) std::fill(voxels, voxels + kBrickVoxelCount, static_cast<glm::uint16_t>(0));
+				ApplyBrickDelta(encoding, payload, payloadSize, voxels);
+			}
+
+			m_brickVersions[brickIndex] = version;
+		}
+
+		if (!reader.IsAtEnd()) return false;
+
+		ack.clear();
+		WriteValue<uint8_t>(ack, kAckPacket);
+		WriteValue<uint32_t>(ack, sequence);
+		WriteValue<uint16_t>(ack, static_cast<uint16_t>(m_resyncBricks.size()));
+		for (const uint32_t brickIndex : m_resyncBricks) WriteValue<uint32_t>(ack, brickIndex);
+
+		return true;
+	}
+
+	bool LoopbackTransport::ShouldDrop()
+	{
+		if (m_info.m_lossRate <= 0.f) return false;
+
+		m_random ^= m_random << 13;
+		m_random ^= m_random >> 7;
+		m_random ^= m_random << 17;
+
+		return static_cast<float>(m_random >> 40) / static_cast<float>(1u << 24) < m_info.m_lossRate;
+	}
+
+	void LoopbackTransport::Tick()
+	{
+		m_tick++;
+	}
+
+	void LoopbackTransport::SendToClient(uint32_t clientId, std::vector<uint8_t> packet)
+	{
+		m_bytesToClients += packet.size();
+		if (!ShouldDrop()) m_toClients[clientId].push_back({ m_tick + m_info.m_latencyTicks, clientId, std::move(packet) });
+	}
+
+	void LoopbackTransport::SendToServer(uint32_t clientId, std::vector<uint8_t> packet)
+	{
+		m_bytesToServer += packet.size();
+		if (!ShouldDrop()) m_toServer.push_back({ m_tick + m_info.m_latencyTicks, clientId, std::move(packet) });
+	}
+
+	bool LoopbackTransport::ReceiveOnClient(uint32_t clientId, std::vector<uint8_t>& packet)
+	{
+		std::deque<QueuedPacket>& queue = m_toClients[clientId];
+		if (queue.empty() || queue.front().m_arrivalTick > m_tick) return false;
+
+		packet = std::move(queue.front().m_data);
+		queue.pop_front();
+
+		return true;
+	}
+
+	bool LoopbackTransport::ReceiveOnServer(uint32_t& clientId, std::vector<uint8_t>& packet)
+	{
+		if (m_toServer.empty() || m_toServer.front().m_arrivalTick > m_tick) return false;
+
+		clientId = m_toServer.front().m_clientId;
+		packet = std::move(m_toServer.front().m_data);
+		m_toServer.pop_front();
+
+		return true;
+	}
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "voxel_world.h"
+
+namespace afre
+{
+	enum BrickDeltaEncoding
+	{
+		// The whole brick is one voxel value, sent as that value whatever the client had.
+		BRICK_DELTA_UNIFORM = 0,
+		// XOR against the client's version, run-length encoded as (length, value) pairs like CompressBrick.
+		BRICK_DELTA_RLE = 1,
+		// XOR against the client's version, a bit per voxel marking changes, then the changed ones packed at the smallest bit width that fits.
+		BRICK_DELTA_BITPACK = 2
+	};
+
+	struct ReplicationClientInfo
+	{
+		// Average bytes a tick may send. A brick bigger than what's left still goes out, the overdraft is paid back next ticks.
+		uint32_t m_bytesPerTick = 64 * 1024;
+		// Bricks are never split, so a packet only goes over this with a single brick in it.
+		uint32_t m_maxPacketSize = 16 * 1024;
+		// Ticks without an ack after which a packet counts as lost and its bricks are sent again.
+		uint32_t m_resendTicks = 30;
+	};
+
+	struct ReplicationStats
+	{
+		uint64_t m_packetsSent = 0;
+		uint64_t m_bytesSent = 0;
+		uint64_t m_bricksSent = 0;
+		// Bricks sent again after their packet was lost or the client couldn't apply them.
+		uint64_t m_bricksResent = 0;
+		uint64_t m_encodings[3]{};
+	};
+
+	// Authoritative side. Sends changed bricks as deltas against the version last sent to each client, which packets
+	// arriving in order have already given it, so edits don't wait for acks. A lost packet falls back to the version
+	// the client acknowledged. The kept bricks are shared with the world's snapshots, so keeping them is free until
+	// the world writes to them.
+	class ReplicationServer
+	{
+	public:
+		uint32_t AddClient(const ReplicationClientInfo& replicationClientInfo);
+		void RemoveClient(uint32_t clientId);
+
+		// Call once per tick per client. Appends the packets this tick's budget allows, bricks that don't fit are
+		// picked up next tick from where this one stopped.
+		void WritePackets(uint32_t clientId, const WorldSnapshot& snapshot, std::vector<std::vector<uint8_t>>& packets);
+
+		// False if the ack is malformed or for an unknown client.
+		bool ReadAck(uint32_t clientId, const uint8_t* data, size_t size);
+
+		// Bricks changed since what the client has acknowledged or has in flight.
+		uint32_t GetPendingBrickCount(uint32_t clientId, const WorldSnapshot& snapshot) const;
+		const ReplicationStats& GetStats(uint32_t clientId) const;
+
+	private:
+		struct ClientBrick
+		{
+			// Null while the client is known to have the empty brick at version 0.
+			std::shared_ptr<const Brick> m_ackedBrick{};
+			uint64_t m_ackedVersion = 0;
+			// What the next delta is against, null for the empty brick.
+			std::shared_ptr<const Brick> m_sentBrick{};
+			uint64_t m_sentVersion = 0;
+			bool m_resend = false;
+		};
+
+		struct SentBrick
+		{
+			uint32_t m_brickIndex = 0;
+			uint64_t m_version = 0;
+			std::shared_ptr<const Brick> m_brick{};
+		};
+
+		struct InFlightPacket
+		{
+			uint32_t m_sequence = 0;
+			uint64_t m_tick = 0;
+			std::vector<SentBrick> m_bricks{};
+		};
+
+		struct ClientState
+		{
+			ReplicationClientInfo m_info{};
+			std::vector<ClientBrick> m_bricks{};
+			std::deque<InFlightPacket> m_inFlightPackets{};
+
+			uint64_t m_tick = 0;
+			uint32_t m_nextSequence = 1;
+			// Round robin start, so a budget too small for every change doesn't starve the bricks at the end.
+			uint32_t m_cursor = 0;
+			int64_t m_credit = 0;
+
+			ReplicationStats m_stats{};
+		};
+
+		void ResendLostPackets(ClientState& clientState);
+
+		std::unordered_map<uint32_t, ClientState> m_clients{};
+		uint32_t m_nextClientId = 0;
+
+		// Scratch kept between calls so encoding doesn't allocate.
+		std::vector<uint8_t> m_encoded{};
+		std::vector<glm::uint16_t> m_compressed{};
+	};
+
+	// Client side, a replica of the server's world built from its packets.
+	class ReplicationClient
+	{
+	public:
+		explicit ReplicationClient(const glm::uvec3& sizeInBricks);
+
+		// Applies the packet's bricks and writes the ack to send back. Bricks whose delta is against a version the
+		// client doesn't have are asked for again in full. False if the packet is malformed, nothing after the
+		// malformed brick is applied and no ack is written.
+		bool ReadPacket(const uint8_t* data, size_t size, std::vector<uint8_t>& ack);
+
+		inline const VoxelWorld& GetWorld() const { return m_world; }
+		inline uint64_t GetBrickVersion(uint32_t brickIndex) const { return m_brickVersions[brickIndex]; }
+
+	private:
+		VoxelWorld m_world{};
+		std::vector<uint64_t> m_brickVersions{};
+
+		std::vector<uint32_t> m_resyncBricks{};
+	};
+
+	struct LoopbackTransportInfo
+	{
+		// Fraction of packets dropped, to exercise resending.
+		float m_lossRate = 0.f;
+		// Ticks a packet takes in either direction, so acks come back late like over a real link.
+		uint32_t m_latencyTicks = 0;
+		uint64_t m_seed = 1;
+	};
+
+	// Moves packets between a server and its clients in process, for benchmarks and tests of the protocol.
+	// Tick advances the clock packets are delayed by, without latency it never has to be called.
+	class LoopbackTransport
+	{
+	public:
+		LoopbackTransport() = default;
+		explicit LoopbackTransport(const LoopbackTransportInfo& loopbackTransportInfo) : m_info(loopbackTransportInfo), m_random(loopbackTransportInfo.m_seed ? loopbackTransportInfo.m_seed : 1) {}
+
+		void SendToClient(uint32_t clientId, std::vector<uint8_t> packet);
+		void SendToServer(uint32_t clientId, std::vector<uint8_t> packet);
+
+		void Tick();
+
+		// In send order, false once no packet has arrived.
+		bool ReceiveOnClient(uint32_t clientId, std::vector<uint8_t>& packet);
+		bool ReceiveOnServer(uint32_t& clientId, std::vector<uint8_t>& packet);
+
+		inline uint64_t GetBytesToClients() const { return m_bytesToClients; }
+		inline uint64_t GetBytesToServer() const { return m_bytesToServer; }
+
+	private:
+		struct QueuedPacket
+		{
+			uint64_t m_arrivalTick = 0;
+			uint32_t m_clientId = 0;
+			std::vector<uint8_t> m_data{};
+		};
+
+		bool ShouldDrop();
+
+		LoopbackTransportInfo m_info{};
+		uint64_t m_random = 1;
+		uint64_t m_tick = 0;
+
+		std::unordered_map<uint32_t, std::deque<QueuedPacket>> m_toClients{};
+		std::deque<QueuedPacket> m_toServer{};
+
+		uint64_t m_bytesToClients = 0;
+		uint64_t m_bytesToServer = 0;
+	};
+}
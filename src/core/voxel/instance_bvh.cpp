@@ -0,0 +1,214 @@
+#include "instance_bvh.h"
+
+namespace afre
+{
+	static constexpr uint32_t kBinCount = 8;
+
+	void InstanceBvh::Update(const std::vector<Aabb>& bounds)
+	{
+		if (bounds.size() != m_instanceIndices.size())
+		{
+			Build(bounds);
+			return;
+		}
+
+		Refit(bounds);
+
+		if (m_cost > m_builtCost * kRebuildCostRatio) Build(bounds);
+	}
+
+	void InstanceBvh::Build(const std::vector<Aabb>& bounds)
+	{
+		const uint32_t instanceCount = static_cast<uint32_t>(bounds.size());
+
+		m_instanceIndices.resize(instanceCount);
+		for (uint32_t i = 0; i < instanceCount; i++) m_instanceIndices[i] = i;
+
+		m_buildCount++;
+
+		if (instanceCount == 0)
+		{
+			m_nodeCount = 0;
+			m_cost = m_builtCost = 0.f;
+			return;
+		}
+
+		std::vector<glm::vec3> centers(instanceCount);
+		for (uint32_t i = 0; i < instanceCount; i++) centers[i] = bounds[i].GetCenter();
+
+		// Every split adds a pair of nodes after the root, so there are never more than 2n.
+		m_nodes.resize(static_cast<size_t>(instanceCount) * 2);
+		m_nodes[0] = BvhNode{};
+		m_nodes[0].m_count = instanceCount;
+		m_nodeCount = 1;
+
+		UpdateNodeBounds(m_nodes[0], bounds);
+		Subdivide(0, 0, bounds, centers);
+
+		m_cost = m_builtCost = ComputeCost();
+	}
+
+	void InstanceBvh::Refit(const std::vector<Aabb>& bounds)
+	{
+		// Children always come after their parent.
+		for (uint32_t n = m_nodeCount; n-- > 0;)
+		{
+			BvhNode& node = m_nodes[n];
+
+			if (node.m_count > 0)
+			{
+				UpdateNodeBounds(node, bounds);
+				continue;
+			}
+
+			const BvhNode& left = m_nodes[node.m_leftOrFirst];
+			const BvhNode& right = m_nodes[node.m_leftOrFirst + 1];
+			node.m_min = glm::min(left.m_min, right.m_min);
+			node.m_max = glm::max(left.m_max, right.m_max);
+		}
+
+		m_cost = ComputeCost();
+	}
+
+	void InstanceBvh::UpdateNodeBounds(BvhNode& node, const std::vector<Aabb>& bounds) const
+	{
+		Aabb nodeBounds{};
+		for (uint32_t i = 0; i < node.m_count; i++) nodeBounds.Grow(bounds[m_instanceIndices[node.m_leftOrFirst + i]]);
+
+		node.m_min = nodeBounds.m_min;
+		node.m_max = nodeBounds.m_max;
+	}
+
+	void InstanceBvh::Subdivide(uint32_t nodeIndex, uint32_t depth, const std::vector<Aabb>& bounds, const std::vector<glm::vec3>& centers)
+	{
+		BvhNode& node = m_nodes[nodeIndex];
+		if (node.m_count <= kMaxLeafSize || depth >= kMaxDepth) return;
+
+		const uint32_t first = node.m_leftOrFirst;
+		const uint32_t count = node.m_count;
+
+		Aabb centerBounds{};
+		for (uint32_t i = 0; i < count; i++) centerBounds.Grow(centers[m_instanceIndices[first + i]]);
+
+		// Binned surface area heuristic, the cheapest of kBinCount - 1 planes on each axis.
+		uint8_t bestAxis = 0;
+		uint32_t bestPlane = 0;
+		float bestCost = std::numeric_limits<float>::max();
+
+		for (uint8_t axis = 0; axis < 3; axis++)
+		{
+			const float axisMin = centerBounds.m_min[axis];
+			const float axisExtent = centerBounds.m_max[axis] - axisMin;
+			if (axisExtent <= 0.f) continue;
+
+			Aabb binBounds[kBinCount]{};
+			uint32_t binCounts[kBinCount]{};
+
+			const float binScale = kBinCount / axisExtent;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const uint32_t instance = m_instanceIndices[first + i];
+				const uint32_t bin = glm::min(static_cast<uint32_t>((centers[instance][axis] - axisMin) * binScale), kBinCount - 1);
+
+				binBounds[bin].Grow(bounds[instance]);
+				binCounts[bin]++;
+			}
+
+			// Left side costs swept forwards, right side backwards.
+			float leftCosts[kBinCount - 1]{};
+			Aabb sweepBounds{};
+			uint32_t sweepCount = 0;
+			for (uint32_t b = 0; b < kBinCount - 1; b++)
+			{
+				sweepBounds.Grow(binBounds[b]);
+				sweepCount += binCounts[b];
+				leftCosts[b] = sweepBounds.GetSurfaceArea() * sweepCount;
+			}
+
+			sweepBounds = Aabb{};
+			sweepCount = 0;
+			for (uint32_t b = kBinCount - 1; b > 0; b--)
+			{
+				sweepBounds.Grow(binBounds[b]);
+				sweepCount += binCounts[b];
+
+				const float cost = leftCosts[b - 1] + sweepBounds.GetSurfaceArea() * sweepCount;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestPlane = b;
+				}
+			}
+		}
+
+		// All centers in one spot, or no split beats keeping the leaf.
+		const Aabb nodeBounds{ node.m_min, node.m_max };
+		if (bestCost >= nodeBounds.GetSurfaceArea() * count) return;
+
+		const float axisMin = centerBounds.m_min[bestAxis];
+		const float binScale = kBinCount / (centerBounds.m_max[bestAxis] - axisMin);
+
+		uint32_t i = first;
+		uint32_t j = first + count - 1;
+		while (i <= j)
+		{
+			const uint32_t bin = glm::min(static_cast<uint32_t>((centers[m_instanceIndices[i]][bestAxis] - axisMin) * binScale), kBinCount - 1);
+			if (bin < bestPlane)
+			{
+				i++;
+			}
+			else
+			{
+				std::swap(m_instanceIndices[i], m_instanceIndices[j]);
+				if (j == 0) break;
+				j--;
+			}
+		}
+
+		const uint32_t leftCount = i - first;
+		if (leftCount == 0 || leftCount == count) return;
+
+		const uint32_t leftIndex = m_nodeCount;
+		m_nodeCount += 2;
+
+		BvhNode& left = m_nodes[leftIndex];
+		left = BvhNode{};
+		left.m_leftOrFirst = first;
+		left.m_count = leftCount;
+
+		BvhNode& right = m_nodes[leftIndex + 1];
+		right = BvhNode{};
+		right.m_leftOrFirst = i;
+		right.m_count = count - leftCount;
+
+		node.m_leftOrFirst = leftIndex;
+		node.m_count = 0;
+
+		UpdateNodeBounds(m_nodes[leftIndex], bounds);
+		UpdateNodeBounds(m_nodes[leftIndex + 1], bounds);
+
+		Subdivide(leftIndex, depth + 1, bounds, centers);
+		Subdivide(leftIndex + 1, depth + 1, bounds, centers);
+	}
+
+	float InstanceBvh::ComputeCost() const
+	{
+		if (m_nodeCount == 0) return 0.f;
+
+		const float rootArea = Aabb{ m_nodes[0].m_min, m_nodes[0].m_max }.GetSurfaceArea();
+		if (rootArea <= 0.f) return 0.f;
+
+		// Inner nodes cost a box test, leaves one per instance.
+		float cost = 0.f;
+		for (uint32_t n = 0; n < m_nodeCount; n++)
+		{
+			const BvhNode& node = m_nodes[n];
+			const float area = Aabb{ node.m_min, node.m_max }.GetSurfaceArea();
+
+			cost += area * (node.m_count > 0 ? static_cast<float>(node.m_count) : 1.f);
+		}
+
+		return cost / rootArea;
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	struct Aabb
+	{
+		glm::vec3 m_min{ std::numeric_limits<float>::max() };
+		glm::vec3 m_max{ -std::numeric_limits<float>::max() };
+
+		inline void Grow(const glm::vec3& point)
+		{
+			m_min = glm::min(m_min, point);
+			m_max = glm::max(m_max, point);
+		}
+
+		inline void Grow(const Aabb& aabb)
+		{
+			m_min = glm::min(m_min, aabb.m_min);
+			m_max = glm::max(m_max, aabb.m_max);
+		}
+
+		inline glm::vec3 GetCenter() const { return (m_min + m_max) * 0.5f; }
+
+		inline float GetSurfaceArea() const
+		{
+			const glm::vec3 extent = m_max - m_min;
+			if (extent.x < 0.f) return 0.f;
+
+			return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+		}
+	};
+
+	// Slab test. Distances are along the ray, tEnter is negative when the origin is inside.
+	inline bool IntersectAabb(const glm::vec3& aabbMin, const glm::vec3& aabbMax, const glm::vec3& rayOrigin, const glm::vec3& rayInvDir, float maxDistance, float& tEnter, float& tExit)
+	{
+		const glm::vec3 t0 = (aabbMin - rayOrigin) * rayInvDir;
+		const glm::vec3 t1 = (aabbMax - rayOrigin) * rayInvDir;
+		const glm::vec3 tNear = glm::min(t0, t1);
+		const glm::vec3 tFar = glm::max(t0, t1);
+
+		tEnter = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+		tExit = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+
+		return tExit >= glm::max(tEnter, 0.f) && tEnter < maxDistance;
+	}
+
+	// Top level BVH over instance bounds. Moving instances only refit it, it is rebuilt when the
+	// instance count changes or refitting has made it noticeably slower to trace than a fresh build.
+	class InstanceBvh
+	{
+	public:
+		// Nodes are what the shader gets, so the depth is capped to keep its traversal stack small.
+		static constexpr uint32_t kMaxDepth = 24;
+		static constexpr uint32_t kMaxLeafSize = 2;
+		// Refitted SAH cost relative to the one right after the last build that triggers a rebuild.
+		static constexpr float kRebuildCostRatio = 1.5f;
+
+		void Update(const std::vector<Aabb>& bounds);
+		void Build(const std::vector<Aabb>& bounds);
+		// Same instance count as the last build, only their bounds changed.
+		void Refit(const std::vector<Aabb>& bounds);
+
+		// Calls onInstance(instanceIndex, maxDistance) for every instance whose bounds the ray enters before maxDistance,
+		// nearer nodes first. It returns the new max distance, so a hit culls everything behind it.
+		template<typename OnInstance>
+		void Traverse(const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance, OnInstance&& onInstance) const;
+
+		inline const std::vector<BvhNode>& GetNodes() const { return m_nodes; }
+		inline uint32_t GetNodeCount() const { return m_nodeCount; }
+		// Leaves index into this, not straight into the bounds.
+		inline const std::vector<uint32_t>& GetInstanceIndices() const { return m_instanceIndices; }
+
+		// Surface area heuristic cost of the current tree, relative to its root.
+		inline float GetCost() const { return m_cost; }
+		inline uint32_t GetBuildCount() const { return m_buildCount; }
+
+	private:
+		void UpdateNodeBounds(BvhNode& node, const std::vector<Aabb>& bounds) const;
+		void Subdivide(uint32_t nodeIndex, uint32_t depth, const std::vector<Aabb>& bounds, const std::vector<glm::vec3>& centers);
+		float ComputeCost() const;
+
+		std::vector<BvhNode> m_nodes{};
+		uint32_t m_nodeCount = 0;
+		std::vector<uint32_t> m_instanceIndices{};
+
+		float m_cost = 0.f;
+		float m_builtCost = 0.f;
+		uint32_t m_buildCount = 0;
+	};
+
+	template<typename OnInstance>
+	void InstanceBvh::Traverse(const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance, OnInstance&& onInstance) const
+	{
+		if (m_nodeCount == 0) return;
+
+		const glm::vec3 rayInvDir = 1.f / rayDir;
+
+		uint32_t stack[kMaxDepth + 2];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			// Tested again when popped, a hit since it was pushed may have moved maxDistance in front of it.
+			const BvhNode& node = m_nodes[stack[--stackSize]];
+
+			float tEnter = 0.f, tExit = 0.f;
+			if (!IntersectAabb(node.m_min, node.m_max, rayOrigin, rayInvDir, maxDistance, tEnter, tExit)) continue;
+
+			if (node.m_count > 0)
+			{
+				for (uint32_t i = 0; i < node.m_count; i++)
+				{
+					maxDistance = onInstance(m_instanceIndices[node.m_leftOrFirst + i], maxDistance);
+				}
+
+				continue;
+			}
+
+			const BvhNode& left = m_nodes[node.m_leftOrFirst];
+			const BvhNode& right = m_nodes[node.m_leftOrFirst + 1];
+
+			float leftEnter = 0.f, rightEnter = 0.f;
+			const bool leftHit = IntersectAabb(left.m_min, left.m_max, rayOrigin, rayInvDir, maxDistance, leftEnter, tExit);
+			const bool rightHit = IntersectAabb(right.m_min, right.m_max, rayOrigin, rayInvDir, maxDistance, rightEnter, tExit);
+
+			// The nearer child goes on top.
+			if (leftHit && rightHit)
+			{
+				const bool leftFirst = leftEnter <= rightEnter;
+				stack[stackSize++] = leftFirst ? node.m_leftOrFirst + 1 : node.m_leftOrFirst;
+				stack[stackSize++] = leftFirst ? node.m_leftOrFirst : node.m_leftOrFirst + 1;
+			}
+			else if (leftHit)
+			{
+				stack[stackSize++] = node.m_leftOrFirst;
+			}
+			else if (rightHit)
+			{
+				stack[stackSize++] = node.m_leftOrFirst + 1;
+			}
+		}
+	}
+}
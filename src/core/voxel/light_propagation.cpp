@@ -0,0 +1,477 @@
+#include "light_propagation.h"
+#include <algorithm>
+#include "brick_kernels.h"
+
+namespace afre
+{
+	static const glm::ivec3 s_neighborOffsets[6] =
+	{
+		{ 1, 0, 0 }, { -1, 0, 0 },
+		{ 0, 1, 0 }, { 0, -1, 0 },
+		{ 0, 0, 1 }, { 0, 0, -1 }
+	};
+
+	static constexpr uint8_t kDownNeighbor = 3;
+
+	static constexpr uint32_t kOpaqueWordsPerBrick = kBrickVoxelCount / 64;
+
+	LightPropagator::~LightPropagator()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_stop = true;
+		}
+
+		m_condition.notify_all();
+
+		if (m_worker.joinable()) m_worker.join();
+	}
+
+	void LightPropagator::SetVoxelLighting(glm::uint16_t voxel, const VoxelLightingInfo& voxelLightingInfo)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+
+		if (m_voxelLighting.size() <= voxel) m_voxelLighting.resize(static_cast<size_t>(voxel) + 1, VoxelLightingInfo{});
+
+		m_voxelLighting[voxel] = voxelLightingInfo;
+		m_voxelLighting[voxel].m_emission = glm::min(voxelLightingInfo.m_emission, kMaxLightLevel);
+	}
+
+	void LightPropagator::Rebuild(const Brick* bricks, const glm::uvec3& sizeInBricks)
+	{
+		Rebuild(WorldSnapshot::CopyFrom(bricks, sizeInBricks));
+	}
+
+	void LightPropagator::Rebuild(std::shared_ptr<const WorldSnapshot> snapshot)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+
+			m_pendingRebuild = std::move(snapshot);
+			// Edits queued before the rebuild are already part of the snapshot it got.
+			m_pendingEdits.clear();
+		}
+
+		if (!m_worker.joinable()) m_worker = std::thread{ &LightPropagator::WorkerLoop, this };
+
+		m_initialized = true;
+		m_condition.notify_one();
+	}
+
+	void LightPropagator::QueueVoxelEdit(const VoxelEdit& voxelEdit)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_pendingEdits.push_back(voxelEdit);
+		}
+
+		m_condition.notify_one();
+	}
+
+	uint32_t LightPropagator::QueueBrickEdits(const glm::uvec3& brickPosition, const Brick& oldBrick, const Brick& newBrick)
+	{
+		glm::uint64_t changed[kBrickOccupancyWords]{};
+		const glm::uint32_t changedCount = DiffBricks(oldBrick, newBrick, changed);
+		if (changedCount == 0) return 0;
+
+		const glm::ivec3 brickMin = glm::ivec3(brickPosition * static_cast<uint32_t>(kBrickSize));
+
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+
+			for (uint32_t z = 0; z < kBrickSize; z++)
+			{
+				for (uint32_t y = 0; y < kBrickSize; y++)
+				{
+					for (uint32_t x = 0; x < kBrickSize; x++)
+					{
+						// The bits are in storage order, whatever the brick layout.
+						const uint32_t i = GetBrickVoxelIndex(x, y, z);
+						if ((changed[i >> 6] & (1ull << (i & 63))) == 0) continue;
+
+						m_pendingEdits.push_back({ brickMin + glm::ivec3(x, y, z), oldBrick.m_voxels[i], newBrick.m_voxels[i] });
+					}
+				}
+			}
+		}
+
+		m_condition.notify_one();
+
+		return changedCount;
+	}
+
+	void LightPropagator::TakeLitBricks(std::vector<LitBrick>& litBricks)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+
+		litBricks.swap(m_litBricks);
+		m_litBricks.clear();
+		std::fill(m_litBrickSlots.begin(), m_litBrickSlots.end(), -1);
+	}
+
+	void LightPropagator::RequeueLitBrick(const LitBrick& litBrick)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+
+		// A rebuild since the take publishes every brick again.
+		if (litBrick.m_brickIndex >= m_litBrickSlots.size() || m_litBrickSlots[litBrick.m_brickIndex] >= 0) return;
+
+		m_litBrickSlots[litBrick.m_brickIndex] = static_cast<int32_t>(m_litBricks.size());
+		m_litBricks.push_back(litBrick);
+	}
+
+	void LightPropagator::WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		m_idleCondition.wait(lock, [&]() { return !m_busy && !m_pendingRebuild && m_pendingEdits.empty(); });
+	}
+
+	glm::uint8_t LightPropagator::GetLight(const glm::ivec3& position) const
+	{
+		if (!IsInside(position)) return kMaxLightLevel << 4;
+
+		return (GetLevel(SKY, position) << 4) | GetLevel(BLOCK, position);
+	}
+
+	void LightPropagator::WorkerLoop()
+	{
+		std::shared_ptr<const WorldSnapshot> rebuild{};
+		std::vector<VoxelEdit> edits{};
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ m_mutex };
+				m_condition.wait(lock, [&]() { return m_stop || m_pendingRebuild || !m_pendingEdits.empty(); });
+
+				if (m_stop) return;
+
+				rebuild = std::move(m_pendingRebuild);
+				m_pendingRebuild.reset();
+
+				edits.swap(m_pendingEdits);
+				m_busy = true;
+			}
+
+			if (rebuild)
+			{
+				PropagateFull(*rebuild);
+				rebuild.reset();
+			}
+
+			for (const VoxelEdit& voxelEdit : edits)
+			{
+				ApplyEdit(voxelEdit);
+			}
+			edits.clear();
+
+			PublishDirtyBricks();
+		}
+	}
+
+	void LightPropagator::PropagateFull(const WorldSnapshot& snapshot)
+	{
+		m_sizeInBricks = snapshot.GetSizeInBricks();
+		const uint32_t brickCount = snapshot.GetBrickCount();
+
+		m_light.assign(brickCount, BrickLight{});
+		m_opaque.assign(static_cast<size_t>(brickCount) * kOpaqueWordsPerBrick, 0);
+		m_isBrickDirty.assign(brickCount, false);
+		m_dirtyBricks.clear();
+		m_emitters.clear();
+
+		std::vector<VoxelLightingInfo> voxelLighting{};
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			voxelLighting = m_voxelLighting;
+			m_litBrickSlots.assign(brickCount, -1);
+			m_litBricks.clear();
+		}
+
+		std::vector<LightNode> blockQueue{};
+
+		for (uint32_t b = 0; b < brickCount; b++)
+		{
+			const glm::ivec3 brickOrigin = glm::ivec3(
+				b % m_sizeInBricks.x,
+				(b / m_sizeInBricks.x) % m_sizeInBricks.y,
+				b / (m_sizeInBricks.x * m_sizeInBricks.y)) * static_cast<int32_t>(kBrickSize);
+
+			const Brick& brick = snapshot.GetBrick(b);
+
+			for (uint16_t z = 0; z < kBrickSize; z++)
+			{
+				for (uint16_t y = 0; y < kBrickSize; y++)
+				{
+					for (uint16_t x = 0; x < kBrickSize; x++)
+					{
+						const glm::uint16_t voxel = brick.At({ x, y, z });
+						if (voxel == 0) continue;
+
+						const VoxelLightingInfo voxelLightingInfo = GetVoxelLighting(voxelLighting, voxel);
+						const glm::ivec3 position = brickOrigin + glm::ivec3(x, y, z);
+						SetOpaque(position, voxelLightingInfo.m_opaque);
+
+						if (voxelLightingInfo.m_emission > 0)
+						{
+							m_emitters[GetPositionKey(position)] = voxelLightingInfo.m_emission;
+							SetLevel(BLOCK, position, voxelLightingInfo.m_emission);
+							blockQueue.push_back({ position, voxelLightingInfo.m_emission });
+						}
+					}
+				}
+			}
+
+			// Every brick gets uploaded after a rebuild, lit or not.
+			m_isBrickDirty[b] = true;
+			m_dirtyBricks.push_back(b);
+		}
+
+		// Sky light falls straight down the columns without losing strength, then spreads sideways.
+		std::vector<LightNode> skyQueue{};
+		const glm::ivec3 sizeInVoxels = glm::ivec3(m_sizeInBricks * static_cast<uint32_t>(kBrickSize));
+		for (int32_t z = 0; z < sizeInVoxels.z; z++)
+		{
+			for (int32_t x = 0; x < sizeInVoxels.x; x++)
+			{
+				for (int32_t y = sizeInVoxels.y - 1; y >= 0 && !IsOpaque({ x, y, z }); y--)
+				{
+					SetLevel(SKY, { x, y, z }, kMaxLightLevel);
+					skyQueue.push_back({ { x, y, z }, kMaxLightLevel });
+				}
+			}
+		}
+
+		PropagateAdd(SKY, skyQueue);
+		PropagateAdd(BLOCK, blockQueue);
+	}
+
+	void LightPropagator::ApplyEdit(const VoxelEdit& voxelEdit)
+	{
+		if (!IsInside(voxelEdit.m_position)) return;
+
+		const glm::ivec3& position = voxelEdit.m_position;
+
+		VoxelLightingInfo oldLighting{};
+		VoxelLightingInfo newLighting{};
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			oldLighting = GetVoxelLighting(m_voxelLighting, voxelEdit.m_oldVoxel);
+			newLighting = GetVoxelLighting(m_voxelLighting, voxelEdit.m_newVoxel);
+		}
+
+		const bool wasOpaque = oldLighting.m_opaque;
+		const bool isOpaque = newLighting.m_opaque;
+		const glm::uint8_t oldEmission = oldLighting.m_emission;
+		const glm::uint8_t newEmission = newLighting.m_emission;
+
+		SetOpaque(position, isOpaque);
+
+		if (newEmission > 0) m_emitters[GetPositionKey(position)] = newEmission;
+		else m_emitters.erase(GetPositionKey(position));
+
+		std::vector<LightNode> removeQueue{};
+		std::vector<LightNode> addQueue{};
+
+		for (const LightChannel channel : { SKY, BLOCK })
+		{
+			removeQueue.clear();
+			addQueue.clear();
+
+			const glm::uint8_t level = GetLevel(channel, position);
+			const bool lostEmission = channel == BLOCK && newEmission < oldEmission;
+
+			// Whatever light went through or came from this voxel has to be taken back first.
+			if (level > 0 && ((isOpaque && !wasOpaque) || lostEmission))
+			{
+				SetLevel(channel, position, 0);
+				removeQueue.push_back({ position, level });
+				PropagateRemove(channel, removeQueue, addQueue);
+			}
+
+			if (!isOpaque && wasOpaque)
+			{
+				if (channel == SKY && position.y == static_cast<int32_t>(m_sizeInBricks.y * kBrickSize) - 1)
+				{
+					SetLevel(SKY, position, kMaxLightLevel);
+					addQueue.push_back({ position, kMaxLightLevel });
+				}
+
+				for (const glm::ivec3& offset : s_neighborOffsets)
+				{
+					const glm::ivec3 neighbor = position + offset;
+					if (IsInside(neighbor) && GetLevel(channel, neighbor) > 0) addQueue.push_back({ neighbor, GetLevel(channel, neighbor) });
+				}
+			}
+
+			if (channel == BLOCK && newEmission > GetLevel(BLOCK, position))
+			{
+				SetLevel(BLOCK, position, newEmission);
+				addQueue.push_back({ position, newEmission });
+			}
+
+			PropagateAdd(channel, addQueue);
+		}
+	}
+
+	void LightPropagator::PropagateAdd(LightChannel channel, std::vector<LightNode>& addQueue)
+	{
+		for (size_t i = 0; i < addQueue.size(); i++)
+		{
+			const glm::ivec3 position = addQueue[i].m_position;
+			const glm::uint8_t level = GetLevel(channel, position);
+			if (level <= 1) continue;
+
+			for (uint8_t n = 0; n < 6; n++)
+			{
+				const glm::ivec3 neighbor = position + s_neighborOffsets[n];
+				if (!IsInside(neighbor) || IsOpaque(neighbor)) continue;
+
+				const glm::uint8_t neighborLevel = channel == SKY && n == kDownNeighbor && level == kMaxLightLevel ? kMaxLightLevel : level - 1;
+				if (GetLevel(channel, neighbor) >= neighborLevel) continue;
+
+				SetLevel(channel, neighbor, neighborLevel);
+				addQueue.push_back({ neighbor, neighborLevel });
+			}
+		}
+
+		addQueue.clear();
+	}
+
+	void LightPropagator::PropagateRemove(LightChannel channel, std::vector<LightNode>& removeQueue, std::vector<LightNode>& addQueue)
+	{
+		for (size_t i = 0; i < removeQueue.size(); i++)
+		{
+			const glm::ivec3 position = removeQueue[i].m_position;
+			const glm::uint8_t level = removeQueue[i].m_level;
+
+			for (uint8_t n = 0; n < 6; n++)
+			{
+				const glm::ivec3 neighbor = position + s_neighborOffsets[n];
+				if (!IsInside(neighbor)) continue;
+
+				const glm::uint8_t neighborLevel = GetLevel(channel, neighbor);
+				if (neighborLevel == 0) continue;
+
+				// Opaque voxels only hold light they emit themselves.
+				const bool litByRemoved = !IsOpaque(neighbor) && (neighborLevel < level || (channel == SKY && n == kDownNeighbor && level == kMaxLightLevel));
+				if (litByRemoved)
+				{
+					SetLevel(channel, neighbor, 0);
+					removeQueue.push_back({ neighbor, neighborLevel });
+
+					// A clear emitter keeps its own light and relights what the removal takes.
+					const glm::uint8_t emission = channel == BLOCK ? GetEmitterLevel(neighbor) : 0;
+					if (emission > 0)
+					{
+						SetLevel(BLOCK, neighbor, emission);
+						addQueue.push_back({ neighbor, emission });
+					}
+				}
+				else
+				{
+					// Lit from elsewhere, it refills the hole once the removal is done.
+					addQueue.push_back({ neighbor, neighborLevel });
+				}
+			}
+		}
+
+		removeQueue.clear();
+	}
+
+	void LightPropagator::PublishDirtyBricks()
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+
+		for (const uint32_t brickIndex : m_dirtyBricks)
+		{
+			if (m_litBrickSlots[brickIndex] < 0)
+			{
+				m_litBrickSlots[brickIndex] = static_cast<int32_t>(m_litBricks.size());
+				m_litBricks.push_back({ brickIndex, m_light[brickIndex] });
+			}
+			else
+			{
+				m_litBricks[m_litBrickSlots[brickIndex]].m_light = m_light[brickIndex];
+			}
+
+			m_isBrickDirty[brickIndex] = false;
+		}
+
+		m_dirtyBricks.clear();
+		m_busy = false;
+
+		m_idleCondition.notify_all();
+	}
+
+	VoxelLightingInfo LightPropagator::GetVoxelLighting(const std::vector<VoxelLightingInfo>& voxelLighting, glm::uint16_t voxel) const
+	{
+		if (voxel == 0) return { 0, false };
+
+		return voxel < voxelLighting.size() ? voxelLighting[voxel] : VoxelLightingInfo{};
+	}
+
+	glm::uint8_t LightPropagator::GetEmitterLevel(const glm::ivec3& position) const
+	{
+		const auto emitter = m_emitters.find(GetPositionKey(position));
+
+		return emitter != m_emitters.end() ? emitter->second : 0;
+	}
+
+	uint64_t LightPropagator::GetPositionKey(const glm::ivec3& position) const
+	{
+		return (static_cast<uint64_t>(position.z) << 42) | (static_cast<uint64_t>(position.y) << 21) | static_cast<uint64_t>(position.x);
+	}
+
+	bool LightPropagator::IsInside(const glm::ivec3& position) const
+	{
+		return position.x >= 0 && position.y >= 0 && position.z >= 0
+			&& static_cast<uint32_t>(position.x) < m_sizeInBricks.x * kBrickSize
+			&& static_cast<uint32_t>(position.y) < m_sizeInBricks.y * kBrickSize
+			&& static_cast<uint32_t>(position.z) < m_sizeInBricks.z * kBrickSize;
+	}
+
+	bool LightPropagator::IsOpaque(const glm::ivec3& position) const
+	{
+		const uint32_t voxelIndex = (position.z % kBrickSize * kBrickSize + position.y % kBrickSize) * kBrickSize + position.x % kBrickSize;
+		const uint64_t word = m_opaque[GetBrickIndex(position) * kOpaqueWordsPerBrick + voxelIndex / 64];
+
+		return (word >> (voxelIndex % 64)) & 1;
+	}
+
+	void LightPropagator::SetOpaque(const glm::ivec3& position, bool opaque)
+	{
+		const uint32_t voxelIndex = (position.z % kBrickSize * kBrickSize + position.y % kBrickSize) * kBrickSize + position.x % kBrickSize;
+		uint64_t& word = m_opaque[GetBrickIndex(position) * kOpaqueWordsPerBrick + voxelIndex / 64];
+
+		word = opaque ? word | (1ull << (voxelIndex % 64)) : word & ~(1ull << (voxelIndex % 64));
+	}
+
+	glm::uint8_t LightPropagator::GetLevel(LightChannel channel, const glm::ivec3& position) const
+	{
+		const glm::uint8_t light = m_light[GetBrickIndex(position)].m_light[position.z % kBrickSize][position.y % kBrickSize][position.x % kBrickSize];
+
+		return channel == SKY ? light >> 4 : light & 0xF;
+	}
+
+	void LightPropagator::SetLevel(LightChannel channel, const glm::ivec3& position, glm::uint8_t level)
+	{
+		const uint32_t brickIndex = GetBrickIndex(position);
+		glm::uint8_t& light = m_light[brickIndex].m_light[position.z % kBrickSize][position.y % kBrickSize][position.x % kBrickSize];
+
+		light = channel == SKY ? (light & 0xF) | (level << 4) : (light & 0xF0) | level;
+
+		if (!m_isBrickDirty[brickIndex])
+		{
+			m_isBrickDirty[brickIndex] = true;
+			m_dirtyBricks.push_back(brickIndex);
+		}
+	}
+
+	uint32_t LightPropagator::GetBrickIndex(const glm::ivec3& position) const
+	{
+		const glm::uvec3 brickPosition = glm::uvec3(position) / static_cast<uint32_t>(kBrickSize);
+
+		return (brickPosition.z * m_sizeInBricks.y + brickPosition.y) * m_sizeInBricks.x + brickPosition.x;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "world_snapshot.h"
+
+namespace afre
+{
+	constexpr glm::uint8_t kMaxLightLevel = 15;
+
+	struct VoxelEdit
+	{
+		glm::ivec3 m_position{};
+		glm::uint16_t m_oldVoxel = 0;
+		glm::uint16_t m_newVoxel = 0;
+	};
+
+	struct VoxelLightingInfo
+	{
+		glm::uint8_t m_emission = 0;
+		bool m_opaque = true;
+	};
+
+	struct LitBrick
+	{
+		uint32_t m_brickIndex = 0;
+		BrickLight m_light{};
+	};
+
+	// Flood fills sky and block light over the voxels on a worker thread.
+	// The worker keeps its own opacity copy of the world, so it never reads voxels the game is editing.
+	class LightPropagator
+	{
+	public:
+		LightPropagator() = default;
+		~LightPropagator();
+
+		LightPropagator(const LightPropagator&) = delete;
+		LightPropagator& operator=(const LightPropagator&) = delete;
+
+		// Call before Rebuild. Voxels without info are opaque and don't give off block light, air is always clear.
+		void SetVoxelLighting(glm::uint16_t voxel, const VoxelLightingInfo& voxelLightingInfo);
+
+		// Relights the whole world. The worker reads the snapshot directly, it isn't copied.
+		void Rebuild(std::shared_ptr<const WorldSnapshot> snapshot);
+		// Bricks are laid out z, y, x like VoxelData::m_bricks and copied before returning.
+		void Rebuild(const Brick* bricks, const glm::uvec3& sizeInBricks);
+
+		// After Rebuild, every voxel change has to come through here for the lighting to follow it.
+		void QueueVoxelEdit(const VoxelEdit& voxelEdit);
+		// A whole brick written over, queues an edit for each voxel that differs. Returns how many it queued.
+		uint32_t QueueBrickEdits(const glm::uvec3& brickPosition, const Brick& oldBrick, const Brick& newBrick);
+
+		// Moves out the bricks whose light changed since the last call. Doesn't wait for the worker.
+		void TakeLitBricks(std::vector<LitBrick>& litBricks);
+		// Hands back a taken brick that couldn't be uploaded. Light published for it since then wins.
+		void RequeueLitBrick(const LitBrick& litBrick);
+
+		void WaitIdle();
+
+		inline bool IsInitialized() const { return m_initialized; }
+
+		// Only meaningful after WaitIdle.
+		glm::uint8_t GetLight(const glm::ivec3& position) const;
+
+	private:
+		struct LightNode
+		{
+			glm::ivec3 m_position{};
+			glm::uint8_t m_level = 0;
+		};
+
+		enum LightChannel
+		{
+			BLOCK = 0,
+			SKY = 1
+		};
+
+		void WorkerLoop();
+
+		void PropagateFull(const WorldSnapshot& snapshot);
+		void ApplyEdit(const VoxelEdit& voxelEdit);
+
+		void PropagateAdd(LightChannel channel, std::vector<LightNode>& addQueue);
+		void PropagateRemove(LightChannel channel, std::vector<LightNode>& removeQueue, std::vector<LightNode>& addQueue);
+
+		void PublishDirtyBricks();
+
+		VoxelLightingInfo GetVoxelLighting(const std::vector<VoxelLightingInfo>& voxelLighting, glm::uint16_t voxel) const;
+		glm::uint8_t GetEmitterLevel(const glm::ivec3& position) const;
+		uint64_t GetPositionKey(const glm::ivec3& position) const;
+
+		bool IsInside(const glm::ivec3& position) const;
+		bool IsOpaque(const glm::ivec3& position) const;
+		void SetOpaque(const glm::ivec3& position, bool opaque);
+
+		glm::uint8_t GetLevel(LightChannel channel, const glm::ivec3& position) const;
+		void SetLevel(LightChannel channel, const glm::ivec3& position, glm::uint8_t level);
+
+		uint32_t GetBrickIndex(const glm::ivec3& position) const;
+
+		// Shared with the worker, guarded by m_mutex
+		std::mutex m_mutex{};
+		std::condition_variable m_condition{};
+		std::condition_variable m_idleCondition{};
+
+		std::shared_ptr<const WorldSnapshot> m_pendingRebuild{};
+		std::vector<VoxelEdit> m_pendingEdits{};
+		bool m_busy = false;
+		bool m_stop = false;
+
+		std::vector<LitBrick> m_litBricks{};
+		std::vector<int32_t> m_litBrickSlots{};
+
+		std::vector<VoxelLightingInfo> m_voxelLighting{};
+
+		// Owned by the worker
+		glm::uvec3 m_sizeInBricks{};
+		std::vector<BrickLight> m_light{};
+		std::vector<uint64_t> m_opaque{};
+		std::vector<uint32_t> m_dirtyBricks{};
+		std::vector<bool> m_isBrickDirty{};
+		// Emitters are rare, so they're kept by position instead of per voxel.
+		std::unordered_map<uint64_t, glm::uint8_t> m_emitters{};
+
+		std::thread m_worker{};
+		bool m_initialized = false;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "material_registry.h"
+#include <cmath>
+
+namespace afre
+{
+	MaterialRegistry::MaterialRegistry()
+	{
+		// Unknown voxels stand out instead of silently disappearing.
+		MaterialData missingMaterial{};
+		missingMaterial.m_albedo = glm::vec4(1.f, 0.f, 1.f, 1.f);
+		missingMaterial.m_flags = MATERIAL_OPAQUE;
+
+		m_materials.assign(kMaxMaterials, missingMaterial);
+		m_materials[0] = MaterialData{ glm::vec4(0.f), glm::vec3(0.f), MATERIAL_TRANSPARENT };
+
+		m_dirtyEnd = kMaxMaterials;
+
+		SetMaterial(1, { glm::vec4(1.f, 0.f, 0.f, 1.f), glm::vec3(0.f), MATERIAL_OPAQUE });
+		SetMaterial(2, { glm::vec4(0.f, 1.f, 0.f, 1.f), glm::vec3(0.f), MATERIAL_OPAQUE });
+	}
+
+	void MaterialRegistry::SetMaterial(glm::uint16_t voxel, const MaterialData& material)
+	{
+		const VoxelLightingInfo oldLighting = GetLightingInfo(voxel);
+		const glm::uint32_t oldFlags = m_materials[voxel].m_flags;
+
+		m_materials[voxel] = material;
+
+		if ((oldFlags & MATERIAL_OPAQUE) != (material.m_flags & MATERIAL_OPAQUE)) m_opacityChanged = true;
+
+		const VoxelLightingInfo newLighting = GetLightingInfo(voxel);
+		if (oldLighting.m_emission != newLighting.m_emission || oldLighting.m_opaque != newLighting.m_opaque)
+		{
+			m_lightingChanged = true;
+		}
+
+		m_lightingEnd = glm::max(m_lightingEnd, static_cast<uint32_t>(voxel) + 1);
+
+		if (m_dirtyFirst == m_dirtyEnd)
+		{
+			m_dirtyFirst = voxel;
+			m_dirtyEnd = static_cast<uint32_t>(voxel) + 1;
+		}
+		else
+		{
+			m_dirtyFirst = glm::min(m_dirtyFirst, static_cast<uint32_t>(voxel));
+			m_dirtyEnd = glm::max(m_dirtyEnd, static_cast<uint32_t>(voxel) + 1);
+		}
+	}
+
+	VoxelLightingInfo MaterialRegistry::GetLightingInfo(glm::uint16_t voxel) const
+	{
+		const MaterialData& material = m_materials[voxel];
+
+		const float brightest = glm::max(material.m_emissive.x, glm::max(material.m_emissive.y, material.m_emissive.z));
+
+		VoxelLightingInfo voxelLightingInfo{};
+		voxelLightingInfo.m_emission = static_cast<glm::uint8_t>(glm::clamp(std::round(brightest * kMaxLightLevel), 0.f, static_cast<float>(kMaxLightLevel)));
+		voxelLightingInfo.m_opaque = (material.m_flags & MATERIAL_TRANSPARENT) == 0;
+
+		return voxelLightingInfo;
+	}
+
+	bool MaterialRegistry::TakeDirtyRange(uint32_t& firstMaterial, uint32_t& materialCount)
+	{
+		if (m_dirtyFirst == m_dirtyEnd) return false;
+
+		firstMaterial = m_dirtyFirst;
+		materialCount = m_dirtyEnd - m_dirtyFirst;
+
+		m_dirtyFirst = 0;
+		m_dirtyEnd = 0;
+
+		return true;
+	}
+
+	void MaterialRegistry::ApplyToLightPropagator(LightPropagator& lightPropagator)
+	{
+		for (uint32_t voxel = 1; voxel < m_lightingEnd; voxel++)
+		{
+			lightPropagator.SetVoxelLighting(static_cast<glm::uint16_t>(voxel), GetLightingInfo(static_cast<glm::uint16_t>(voxel)));
+		}
+
+		m_lightingChanged = false;
+	}
+
+	void MaterialRegistry::ApplyToBrickMeshCache(BrickMeshCache& brickMeshCache)
+	{
+		for (uint32_t voxel = 1; voxel < m_lightingEnd; voxel++)
+		{
+			brickMeshCache.SetVoxelOpaque(static_cast<glm::uint16_t>(voxel), (m_materials[voxel].m_flags & MATERIAL_OPAQUE) != 0);
+		}
+
+		m_opacityChanged = false;
+	}
+}
\ No newline at end of file
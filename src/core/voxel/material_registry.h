@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include "brick_meshing.h"
+#include "light_propagation.h"
+
+namespace afre
+{
+	// CPU side of the material table the shader looks voxels up in. Changes are uploaded without touching the pipeline.
+	class MaterialRegistry
+	{
+	public:
+		MaterialRegistry();
+
+		void SetMaterial(glm::uint16_t voxel, const MaterialData& material);
+		inline const MaterialData& GetMaterial(glm::uint16_t voxel) const { return m_materials[voxel]; }
+
+		// Emissive materials give off block light at their brightest emissive channel, scaled to 0-15.
+		VoxelLightingInfo GetLightingInfo(glm::uint16_t voxel) const;
+
+		// Range of materials changed since the last call, so only that part of the table is copied.
+		bool TakeDirtyRange(uint32_t& firstMaterial, uint32_t& materialCount);
+
+		inline bool HasLightingChanged() const { return m_lightingChanged; }
+		void ApplyToLightPropagator(LightPropagator& lightPropagator);
+
+		// Which voxels the mesher treats as opaque, rays stop at the same ones.
+		inline bool HasOpacityChanged() const { return m_opacityChanged; }
+		void ApplyToBrickMeshCache(BrickMeshCache& brickMeshCache);
+
+	private:
+		std::vector<MaterialData> m_materials{};
+
+		uint32_t m_dirtyFirst = 0;
+		uint32_t m_dirtyEnd = 0;
+
+		// Only materials up to here were ever set, the rest keep the default lighting.
+		uint32_t m_lightingEnd = 0;
+		bool m_lightingChanged = true;
+		bool m_opacityChanged = true;
+	};
+}
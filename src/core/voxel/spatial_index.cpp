@@ -0,0 +1,278 @@
+#include "spatial_index.h"
+#include <algorithm>
+#include <cstring>
+#include "core/system_scheduler.h"
+
+namespace afre
+{
+	static constexpr uint32_t kUpdateChunkSize = 4096;
+	static constexpr uint32_t kQueryChunkSize = 256;
+
+	SpatialIndex::SpatialIndex(uint32_t cellBricks)
+	{
+		m_cellSize = static_cast<float>(kBrickSize * std::max(cellBricks, 1u));
+		m_inverseCellSize = 1.f / m_cellSize;
+	}
+
+	uint64_t SpatialIndex::GetCellKey(const glm::ivec3& coord)
+	{
+		constexpr uint64_t kMask = (1ull << 21) - 1;
+		return (static_cast<uint64_t>(coord.x) & kMask) | ((static_cast<uint64_t>(coord.y) & kMask) << 21) | ((static_cast<uint64_t>(coord.z) & kMask) << 42);
+	}
+
+	template<typename Test>
+	void SpatialIndex::QueryCells(const glm::vec3& min, const glm::vec3& max, const Test& test, std::vector<entt::entity>& entities) const
+	{
+		const glm::ivec3 minCoord = GetCellCoord(min);
+		const glm::ivec3 maxCoord = GetCellCoord(max);
+		const glm::ivec3 extent = maxCoord - minCoord + 1;
+
+		// Past as many cells as there are occupied ones, walking those is cheaper than looking up every cell in range.
+		if (static_cast<uint64_t>(extent.x) * extent.y * extent.z > m_cellLookup.size())
+		{
+			for (const Cell& cell : m_cells)
+			{
+				if (cell.m_entries.empty()) continue;
+				if (glm::any(glm::lessThan(cell.m_coord, minCoord)) || glm::any(glm::greaterThan(cell.m_coord, maxCoord))) continue;
+
+				for (const Entry& entry : cell.m_entries)
+				{
+					if (test(entry.m_position)) entities.push_back(entry.m_entity);
+				}
+			}
+			return;
+		}
+
+		for (int32_t z = minCoord.z; z <= maxCoord.z; z++)
+		{
+			for (int32_t y = minCoord.y; y <= maxCoord.y; y++)
+			{
+				for (int32_t x = minCoord.x; x <= maxCoord.x; x++)
+				{
+					const Cell* cell = FindCell({ x, y, z });
+					if (!cell) continue;
+
+					for (const Entry& entry : cell->m_entries)
+					{
+						if (test(entry.m_position)) entities.push_back(entry.m_entity);
+					}
+				}
+			}
+		}
+	}
+
+	template<typename Query, typename RunQuery>
+	void SpatialIndex::QueryBatch(const std::vector<Query>& queries, SystemScheduler& scheduler, SpatialQueryResults& results, const RunQuery& runQuery) const
+	{
+		const uint32_t queryCount = static_cast<uint32_t>(queries.size());
+		const uint32_t chunkCount = (queryCount + kQueryChunkSize - 1) / kQueryChunkSize;
+
+		results.m_offsets.assign(queryCount + 1, 0);
+		if (results.m_chunkEntities.size() < chunkCount) results.m_chunkEntities.resize(chunkCount);
+
+		// Every chunk into its own buffer, counts first and moved into place once the offsets are known.
+		scheduler.ParallelFor(queryCount, kQueryChunkSize, [&](uint32_t begin, uint32_t end)
+			{
+				std::vector<entt::entity>& chunkEntities = results.m_chunkEntities[begin / kQueryChunkSize];
+				chunkEntities.clear();
+
+				for (uint32_t query = begin; query < end; query++)
+				{
+					const size_t before = chunkEntities.size();
+					runQuery(queries[query], chunkEntities);
+					results.m_offsets[query + 1] = static_cast<uint32_t>(chunkEntities.size() - before);
+				}
+			});
+
+		for (uint32_t query = 0; query < queryCount; query++) results.m_offsets[query + 1] += results.m_offsets[query];
+		results.m_entities.resize(results.m_offsets[queryCount]);
+
+		scheduler.ParallelFor(chunkCount, 16, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t chunk = begin; chunk < end; chunk++)
+				{
+					const std::vector<entt::entity>& chunkEntities = results.m_chunkEntities[chunk];
+					if (chunkEntities.empty()) continue;
+
+					std::memcpy(results.m_entities.data() + results.m_offsets[chunk * kQueryChunkSize], chunkEntities.data(), chunkEntities.size() * sizeof(entt::entity));
+				}
+			});
+	}
+
+	void SpatialIndex::Connect(entt::registry& registry)
+	{
+		registry.on_construct<Transform>().connect<&SpatialIndex::OnConstruct>(*this);
+		registry.on_destroy<Transform>().connect<&SpatialIndex::OnDestroy>(*this);
+
+		for (const auto [entity, transform] : registry.view<const Transform>().each())
+		{
+			Insert(entity, transform.m_position);
+		}
+	}
+
+	void SpatialIndex::Disconnect(entt::registry& registry)
+	{
+		registry.on_construct<Transform>().disconnect<&SpatialIndex::OnConstruct>(*this);
+		registry.on_destroy<Transform>().disconnect<&SpatialIndex::OnDestroy>(*this);
+
+		m_cellLookup.clear();
+		m_cells.clear();
+		m_freeCells.clear();
+		m_locations.clear();
+		m_stats = {};
+	}
+
+	void SpatialIndex::Update(entt::registry& registry, SystemScheduler& scheduler)
+	{
+		const auto& transforms = registry.storage<Transform>();
+		const uint32_t count = static_cast<uint32_t>(transforms.size());
+
+		// The components and the entities are packed in the same order.
+		const auto components = transforms.cbegin();
+		const auto entities = static_cast<const entt::sparse_set&>(transforms).cbegin();
+
+		const uint32_t chunkCount = (count + kUpdateChunkSize - 1) / kUpdateChunkSize;
+		if (m_movedChunks.size() < chunkCount) m_movedChunks.resize(chunkCount);
+
+		// Entities that stayed in their cell only get their position written, every one has its own entry.
+		scheduler.ParallelFor(count, kUpdateChunkSize, [&](uint32_t begin, uint32_t end)
+			{
+				std::vector<entt::entity>& moved = m_movedChunks[begin / kUpdateChunkSize];
+				moved.clear();
+
+				for (uint32_t i = begin; i < end; i++)
+				{
+					const entt::entity entity = entities[i];
+					const glm::vec3& position = components[i].m_position;
+
+					const EntityLocation& location = m_locations[entt::to_entity(entity)];
+					Cell& cell = m_cells[location.m_cell];
+
+					if (GetCellCoord(position) == cell.m_coord) cell.m_entries[location.m_slot].m_position = position;
+					else moved.push_back(entity);
+				}
+			});
+
+		m_stats.m_movedEntities = 0;
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			for (const entt::entity entity : m_movedChunks[chunk])
+			{
+				Remove(entity);
+				Insert(entity, transforms.get(entity).m_position);
+			}
+
+			m_stats.m_movedEntities += static_cast<uint32_t>(m_movedChunks[chunk].size());
+		}
+	}
+
+	void SpatialIndex::QueryRadius(const glm::vec3& center, float radius, std::vector<entt::entity>& entities) const
+	{
+		const float radiusSquared = radius * radius;
+		QueryCells(center - radius, center + radius, [&](const glm::vec3& position)
+			{
+				const glm::vec3 offset = position - center;
+				return glm::dot(offset, offset) <= radiusSquared;
+			}, entities);
+	}
+
+	void SpatialIndex::QueryAabb(const Aabb& aabb, std::vector<entt::entity>& entities) const
+	{
+		QueryCells(aabb.m_min, aabb.m_max, [&](const glm::vec3& position)
+			{
+				return glm::all(glm::greaterThanEqual(position, aabb.m_min)) && glm::all(glm::lessThanEqual(position, aabb.m_max));
+			}, entities);
+	}
+
+	void SpatialIndex::QueryRadii(const std::vector<SpatialRadiusQuery>& queries, SystemScheduler& scheduler, SpatialQueryResults& results) const
+	{
+		QueryBatch(queries, scheduler, results, [this](const SpatialRadiusQuery& query, std::vector<entt::entity>& entities)
+			{
+				QueryRadius(query.m_center, query.m_radius, entities);
+			});
+	}
+
+	void SpatialIndex::QueryAabbs(const std::vector<Aabb>& queries, SystemScheduler& scheduler, SpatialQueryResults& results) const
+	{
+		QueryBatch(queries, scheduler, results, [this](const Aabb& query, std::vector<entt::entity>& entities)
+			{
+				QueryAabb(query, entities);
+			});
+	}
+
+	void SpatialIndex::OnConstruct(entt::registry& registry, entt::entity entity)
+	{
+		Insert(entity, registry.get<Transform>(entity).m_position);
+	}
+
+	void SpatialIndex::OnDestroy(entt::registry&, entt::entity entity)
+	{
+		Remove(entity);
+	}
+
+	void SpatialIndex::Insert(entt::entity entity, const glm::vec3& position)
+	{
+		const glm::ivec3 coord = GetCellCoord(position);
+
+		uint32_t cellIndex = kNoCell;
+		const auto found = m_cellLookup.find(GetCellKey(coord));
+		if (found != m_cellLookup.end())
+		{
+			cellIndex = found->second;
+		}
+		else
+		{
+			if (!m_freeCells.empty())
+			{
+				cellIndex = m_freeCells.back();
+				m_freeCells.pop_back();
+			}
+			else
+			{
+				cellIndex = static_cast<uint32_t>(m_cells.size());
+				m_cells.emplace_back();
+			}
+
+			m_cells[cellIndex].m_coord = coord;
+			m_cellLookup.emplace(GetCellKey(coord), cellIndex);
+		}
+
+		const uint32_t entityIndex = static_cast<uint32_t>(entt::to_entity(entity));
+		if (entityIndex >= m_locations.size()) m_locations.resize(entityIndex + 1);
+
+		Cell& cell = m_cells[cellIndex];
+		m_locations[entityIndex] = { cellIndex, static_cast<uint32_t>(cell.m_entries.size()) };
+		cell.m_entries.push_back({ position, entity });
+
+		m_stats.m_entityCount++;
+		m_stats.m_cellCount = static_cast<uint32_t>(m_cellLookup.size());
+	}
+
+	void SpatialIndex::Remove(entt::entity entity)
+	{
+		const uint32_t entityIndex = static_cast<uint32_t>(entt::to_entity(entity));
+		if (entityIndex >= m_locations.size() || m_locations[entityIndex].m_cell == kNoCell) return;
+
+		EntityLocation& location = m_locations[entityIndex];
+		const uint32_t cellIndex = location.m_cell;
+		Cell& cell = m_cells[cellIndex];
+
+		// The last entry takes the removed one's slot.
+		if (location.m_slot + 1 < cell.m_entries.size())
+		{
+			cell.m_entries[location.m_slot] = cell.m_entries.back();
+			m_locations[entt::to_entity(cell.m_entries[location.m_slot].m_entity)].m_slot = location.m_slot;
+		}
+		cell.m_entries.pop_back();
+		location.m_cell = kNoCell;
+
+		if (cell.m_entries.empty())
+		{
+			m_cellLookup.erase(GetCellKey(cell.m_coord));
+			m_freeCells.push_back(cellIndex);
+		}
+
+		m_stats.m_entityCount--;
+		m_stats.m_cellCount = static_cast<uint32_t>(m_cellLookup.size());
+	}
+}
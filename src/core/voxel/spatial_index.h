@@ -0,0 +1,127 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <entt.hpp>
+#include "core/transform.h"
+#include "instance_bvh.h"
+
+namespace afre
+{
+	class SystemScheduler;
+
+	struct SpatialRadiusQuery
+	{
+		glm::vec3 m_center{};
+		float m_radius = 0.f;
+	};
+
+	// What a batch of queries found, the entities of query i are m_entities[m_offsets[i], m_offsets[i + 1]).
+	// Reuse it between batches, the buffers are kept.
+	struct SpatialQueryResults
+	{
+		std::vector<uint32_t> m_offsets{};
+		std::vector<entt::entity> m_entities{};
+
+		// Per ParallelFor chunk, while the batch runs.
+		std::vector<std::vector<entt::entity>> m_chunkEntities{};
+
+		inline uint32_t GetCount(uint32_t query) const { return m_offsets[query + 1] - m_offsets[query]; }
+		inline const entt::entity* GetEntities(uint32_t query) const { return m_entities.data() + m_offsets[query]; }
+	};
+
+	struct SpatialIndexStats
+	{
+		uint32_t m_entityCount = 0;
+		uint32_t m_cellCount = 0;
+		// Entities the last Update moved to another cell.
+		uint32_t m_movedEntities = 0;
+	};
+
+	// Entities with a Transform hashed by position into cells aligned to the brick grid, cellBricks bricks on a side.
+	// Entities are added and removed through the registry's signals and Update picks up the ones that moved, only those
+	// that left their cell are re-bucketed. Queries test the positions cached in the cells, not the registry, and can
+	// run on any number of threads at once, just not next to Update.
+	class SpatialIndex
+	{
+	public:
+		explicit SpatialIndex(uint32_t cellBricks = 1);
+
+		SpatialIndex(const SpatialIndex&) = delete;
+		SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+		// Adds the entities that already have a Transform.
+		void Connect(entt::registry& registry);
+		void Disconnect(entt::registry& registry);
+
+		// From a system that reads Transform, the entities are split over the scheduler's threads.
+		void Update(entt::registry& registry, SystemScheduler& scheduler);
+
+		// Appended to entities. The entity at the center is found too.
+		void QueryRadius(const glm::vec3& center, float radius, std::vector<entt::entity>& entities) const;
+		void QueryAabb(const Aabb& aabb, std::vector<entt::entity>& entities) const;
+
+		// The queries are split over the scheduler's threads, for many at once, like a neighbour query per entity.
+		void QueryRadii(const std::vector<SpatialRadiusQuery>& queries, SystemScheduler& scheduler, SpatialQueryResults& results) const;
+		void QueryAabbs(const std::vector<Aabb>& queries, SystemScheduler& scheduler, SpatialQueryResults& results) const;
+
+		inline float GetCellSize() const { return m_cellSize; }
+		inline const SpatialIndexStats& GetStats() const { return m_stats; }
+
+	private:
+		static constexpr uint32_t kNoCell = 0xFFFFFFFFu;
+
+		struct Entry
+		{
+			glm::vec3 m_position{};
+			entt::entity m_entity = entt::null;
+		};
+
+		struct Cell
+		{
+			glm::ivec3 m_coord{};
+			std::vector<Entry> m_entries{};
+		};
+
+		// Indexed by the entity part of the identifier.
+		struct EntityLocation
+		{
+			uint32_t m_cell = kNoCell;
+			uint32_t m_slot = 0;
+		};
+
+		void OnConstruct(entt::registry& registry, entt::entity entity);
+		void OnDestroy(entt::registry& registry, entt::entity entity);
+
+		void Insert(entt::entity entity, const glm::vec3& position);
+		void Remove(entt::entity entity);
+
+		inline glm::ivec3 GetCellCoord(const glm::vec3& position) const { return glm::ivec3(glm::floor(position * m_inverseCellSize)); }
+		// 21 bits per axis, cells wrap around every 2^21 of them, far beyond the brick grid.
+		static uint64_t GetCellKey(const glm::ivec3& coord);
+		inline const Cell* FindCell(const glm::ivec3& coord) const
+		{
+			const auto cell = m_cellLookup.find(GetCellKey(coord));
+			return cell == m_cellLookup.end() ? nullptr : &m_cells[cell->second];
+		}
+
+		template<typename Test>
+		void QueryCells(const glm::vec3& min, const glm::vec3& max, const Test& test, std::vector<entt::entity>& entities) const;
+		template<typename Query, typename RunQuery>
+		void QueryBatch(const std::vector<Query>& queries, SystemScheduler& scheduler, SpatialQueryResults& results, const RunQuery& runQuery) const;
+
+		float m_cellSize = 0.f;
+		float m_inverseCellSize = 0.f;
+
+		std::unordered_map<uint64_t, uint32_t> m_cellLookup{};
+		std::vector<Cell> m_cells{};
+		// Cells that emptied, reused before new ones are added.
+		std::vector<uint32_t> m_freeCells{};
+		std::vector<EntityLocation> m_locations{};
+
+		// Per Update chunk, the entities that left their cell.
+		std::vector<std::vector<entt::entity>> m_movedChunks{};
+
+		SpatialIndexStats m_stats{};
+	};
+}
@@ -0,0 +1,667 @@
+#include "voxel_import.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include "log.h"
+#include "material_registry.h"
+
+namespace afre
+{
+	// .vox is little endian like every platform the engine targets, values are copied as they are.
+	static constexpr uint32_t kVoxReadVoxels = 65536;
+	// Scene chunks are a few bytes, anything bigger is a broken file.
+	static constexpr int32_t kMaxVoxChunkBytes = 16 * 1024 * 1024;
+	static constexpr uint32_t kMaxVoxNodeDepth = 64;
+	// How MagicaVoxel writes a rotation that doesn't rotate.
+	static constexpr const char* kVoxIdentityRotation = "4";
+
+	static double GetElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Runs work on workerCount new threads and the calling one, returns once all of them returned.
+	static void RunOnWorkers(uint32_t workerCount, const std::function<void()>& work)
+	{
+		std::vector<std::thread> workers{};
+		for (uint32_t w = 0; w < workerCount; w++) workers.emplace_back(work);
+
+		work();
+
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	static glm::uvec3 GetSizeInBricks(const glm::uvec3& sizeInVoxels)
+	{
+		return (sizeInVoxels + static_cast<uint32_t>(kBrickSize) - 1u) / static_cast<uint32_t>(kBrickSize);
+	}
+
+	// Kept per worker and added to the stats once it's done.
+	struct ImportCounts
+	{
+		uint64_t m_bytesRead = 0;
+		uint64_t m_voxelCount = 0;
+		uint32_t m_brickCount = 0;
+		uint32_t m_emptyBricks = 0;
+		uint32_t m_uniformBricks = 0;
+		uint32_t m_storedBricks = 0;
+		double m_readMs = 0.0;
+
+		void AddTo(VoxelImportStats& stats) const
+		{
+			stats.m_bytesRead += m_bytesRead;
+			stats.m_voxelCount += m_voxelCount;
+			stats.m_brickCount += m_brickCount;
+			stats.m_emptyBricks += m_emptyBricks;
+			stats.m_uniformBricks += m_uniformBricks;
+			stats.m_storedBricks += m_storedBricks;
+			stats.m_readMs += m_readMs;
+		}
+	};
+
+	// Uniform bricks point at the shared brick of their value, only the others are allocated.
+	static void StoreBrick(VoxelWorld& world, const glm::uvec3& brickPosition, const Brick& brick, ImportCounts& counts)
+	{
+		counts.m_brickCount++;
+
+		glm::uint16_t uniformVoxel = 0;
+		if (IsBrickUniform(brick, uniformVoxel))
+		{
+			if (uniformVoxel == 0) counts.m_emptyBricks++;
+			else counts.m_uniformBricks++;
+
+			glm::uint16_t currentVoxel = 0;
+			if (!world.IsBrickUniform(brickPosition, currentVoxel) || currentVoxel != uniformVoxel) world.SetUniformBrick(brickPosition, uniformVoxel);
+
+			return;
+		}
+
+		world.SetBrick(brickPosition, brick);
+		counts.m_storedBricks++;
+	}
+
+	// Bounds checked reads from a chunk's content.
+	struct VoxBytes
+	{
+		const std::vector<char>& m_data;
+		size_t m_offset = 0;
+		bool m_failed = false;
+
+		int32_t ReadInt()
+		{
+			int32_t value = 0;
+			if (m_offset + sizeof(value) > m_data.size())
+			{
+				m_failed = true;
+				return 0;
+			}
+
+			std::memcpy(&value, m_data.data() + m_offset, sizeof(value));
+			m_offset += sizeof(value);
+
+			return value;
+		}
+
+		std::string ReadString()
+		{
+			const int32_t size = ReadInt();
+			if (size < 0 || m_offset + size > m_data.size())
+			{
+				m_failed = true;
+				return {};
+			}
+
+			std::string string{ m_data.data() + m_offset, static_cast<size_t>(size) };
+			m_offset += size;
+
+			return string;
+		}
+
+		// Only the value of key, the rest of the pairs are skipped.
+		std::string ReadDict(const char* key, bool& found)
+		{
+			std::string value{};
+			found = false;
+
+			const int32_t pairCount = ReadInt();
+			for (int32_t p = 0; p < pairCount && !m_failed; p++)
+			{
+				const std::string pairKey = ReadString();
+				std::string pairValue = ReadString();
+
+				if (pairKey == key)
+				{
+					value = std::move(pairValue);
+					found = true;
+				}
+			}
+
+			return value;
+		}
+	};
+
+	struct VoxModel
+	{
+		glm::ivec3 m_size{};
+		std::streamoff m_voxelsOffset = 0;
+		uint32_t m_voxelCount = 0;
+	};
+
+	struct VoxNode
+	{
+		glm::ivec3 m_translation{};
+		bool m_rotated = false;
+		std::vector<int32_t> m_children{};
+		std::vector<int32_t> m_models{};
+	};
+
+	struct VoxPlacement
+	{
+		uint32_t m_model = 0;
+		// Lowest corner in the file's z up space.
+		glm::ivec3 m_min{};
+	};
+
+	struct VoxFile
+	{
+		std::vector<VoxModel> m_models{};
+		std::unordered_map<int32_t, VoxNode> m_nodes{};
+		uint32_t m_palette[256]{};
+		bool m_hasPalette = false;
+	};
+
+	static bool ReadVoxChunks(std::ifstream& file, VoxFile& voxFile, uint64_t& bytesRead)
+	{
+		char header[8]{};
+		file.read(header, sizeof(header));
+		if (!file || std::memcmp(header, "VOX ", 4) != 0)
+		{
+			AFRE_ERROR("Not a .vox file!");
+			return false;
+		}
+
+		bytesRead += sizeof(header);
+
+		std::vector<char> content{};
+		while (true)
+		{
+			char chunkId[4]{};
+			int32_t sizes[2]{};
+			file.read(chunkId, sizeof(chunkId));
+			file.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+			if (!file) break;
+
+			bytesRead += sizeof(chunkId) + sizeof(sizes);
+
+			const int32_t contentBytes = sizes[0];
+			if (contentBytes < 0)
+			{
+				AFRE_ERROR("A .vox chunk has a negative size!");
+				return false;
+			}
+
+			// MAIN has no content, its children are simply the chunks after it.
+			if (std::memcmp(chunkId, "MAIN", 4) == 0) continue;
+
+			if (std::memcmp(chunkId, "XYZI", 4) == 0)
+			{
+				// Only found here, the voxels are read once the world exists.
+				VoxModel* model = voxFile.m_models.empty() ? nullptr : &voxFile.m_models.back();
+				int32_t voxelCount = 0;
+				file.read(reinterpret_cast<char*>(&voxelCount), sizeof(voxelCount));
+				if (!file || !model || voxelCount < 0 || static_cast<int64_t>(voxelCount) * 4 + 4 > contentBytes)
+				{
+					AFRE_ERROR("A .vox XYZI chunk doesn't match its SIZE chunk!");
+					return false;
+				}
+
+				model->m_voxelsOffset = file.tellg();
+				model->m_voxelCount = static_cast<uint32_t>(voxelCount);
+				file.seekg(contentBytes - static_cast<int32_t>(sizeof(voxelCount)), std::ios::cur);
+				continue;
+			}
+
+			const bool needed = std::memcmp(chunkId, "SIZE", 4) == 0 || std::memcmp(chunkId, "RGBA", 4) == 0
+				|| std::memcmp(chunkId, "nTRN", 4) == 0 || std::memcmp(chunkId, "nGRP", 4) == 0 || std::memcmp(chunkId, "nSHP", 4) == 0;
+			if (!needed)
+			{
+				file.seekg(contentBytes, std::ios::cur);
+				continue;
+			}
+
+			if (contentBytes > kMaxVoxChunkBytes)
+			{
+				AFRE_ERROR("A .vox {} chunk is too big ({} bytes)!", std::string_view(chunkId, 4), contentBytes);
+				return false;
+			}
+
+			content.resize(contentBytes);
+			file.read(content.data(), contentBytes);
+			if (!file)
+			{
+				AFRE_ERROR("The .vox file ends in the middle of a {} chunk!", std::string_view(chunkId, 4));
+				return false;
+			}
+
+			bytesRead += contentBytes;
+
+			VoxBytes bytes{ content };
+			if (std::memcmp(chunkId, "SIZE", 4) == 0)
+			{
+				VoxModel model{};
+				model.m_size.x = bytes.ReadInt();
+				model.m_size.y = bytes.ReadInt();
+				model.m_size.z = bytes.ReadInt();
+				voxFile.m_models.push_back(model);
+			}
+			else if (std::memcmp(chunkId, "RGBA", 4) == 0)
+			{
+				// Entry i is the color of palette index i + 1, 0 is always empty.
+				const size_t colorCount = std::min<size_t>(content.size() / 4, 255);
+				std::memcpy(voxFile.m_palette + 1, content.data(), colorCount * 4);
+				voxFile.m_hasPalette = true;
+			}
+			else
+			{
+				const int32_t nodeId = bytes.ReadInt();
+				VoxNode& node = voxFile.m_nodes[nodeId];
+				bool found = false;
+				bytes.ReadDict("", found);
+
+				if (std::memcmp(chunkId, "nTRN", 4) == 0)
+				{
+					node.m_children.push_back(bytes.ReadInt());
+					// Reserved, layer and frame count, only the first frame is used.
+					bytes.ReadInt();
+					bytes.ReadInt();
+					const int32_t frameCount = bytes.ReadInt();
+
+					if (frameCount > 0)
+					{
+						const size_t frameOffset = bytes.m_offset;
+						const std::string translation = bytes.ReadDict("_t", found);
+						if (found) std::istringstream{ translation } >> node.m_translation.x >> node.m_translation.y >> node.m_translation.z;
+
+						bytes.m_offset = frameOffset;
+						const std::string rotation = bytes.ReadDict("_r", found);
+						node.m_rotated = found && rotation != kVoxIdentityRotation;
+					}
+				}
+				else if (std::memcmp(chunkId, "nGRP", 4) == 0)
+				{
+					const int32_t childCount = bytes.ReadInt();
+					for (int32_t c = 0; c < childCount && !bytes.m_failed; c++) node.m_children.push_back(bytes.ReadInt());
+				}
+				else
+				{
+					const int32_t modelCount = bytes.ReadInt();
+					for (int32_t m = 0; m < modelCount && !bytes.m_failed; m++)
+					{
+						node.m_models.push_back(bytes.ReadInt());
+						bytes.ReadDict("", found);
+					}
+				}
+			}
+
+			if (bytes.m_failed)
+			{
+				AFRE_ERROR("A .vox {} chunk is cut short!", std::string_view(chunkId, 4));
+				return false;
+			}
+		}
+
+		if (!file.eof())
+		{
+			AFRE_ERROR("Failed reading the .vox file!");
+			return false;
+		}
+
+		return true;
+	}
+
+	static void PlaceVoxNode(const VoxFile& voxFile, int32_t nodeId, const glm::ivec3& translation, uint32_t depth, bool& rotated, std::vector<VoxPlacement>& placements)
+	{
+		const auto found = voxFile.m_nodes.find(nodeId);
+		if (found == voxFile.m_nodes.end() || depth > kMaxVoxNodeDepth) return;
+
+		const VoxNode& node = found->second;
+		const glm::ivec3 nodeTranslation = translation + node.m_translation;
+		rotated |= node.m_rotated;
+
+		for (const int32_t modelId : node.m_models)
+		{
+			if (modelId < 0 || static_cast<size_t>(modelId) >= voxFile.m_models.size()) continue;
+
+			// MagicaVoxel centers models on their translation.
+			placements.push_back({ static_cast<uint32_t>(modelId), nodeTranslation - voxFile.m_models[modelId].m_size / 2 });
+		}
+
+		for (const int32_t childId : node.m_children) PlaceVoxNode(voxFile, childId, nodeTranslation, depth + 1, rotated, placements);
+	}
+
+	// z up and right handed in the file, y up in the world. Flipping y keeps models from being mirrored.
+	static inline glm::ivec3 GetVoxWorldPosition(const glm::ivec3& position)
+	{
+		return { position.x, position.z, -position.y - 1 };
+	}
+
+	bool ImportVox(const std::string& path, const VoxelImportInfo& importInfo, VoxelWorld& world, VoxelImportStats& stats)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		stats = {};
+
+		std::ifstream file{ path, std::ios::binary };
+		if (!file)
+		{
+			AFRE_ERROR("Failed to open {}!", path);
+			return false;
+		}
+
+		VoxFile voxFile{};
+		if (!ReadVoxChunks(file, voxFile, stats.m_bytesRead)) return false;
+
+		std::vector<VoxPlacement> placements{};
+		bool rotated = false;
+		if (voxFile.m_nodes.count(0) > 0) PlaceVoxNode(voxFile, 0, {}, 0, rotated, placements);
+		else
+		{
+			// Files from before the scene graph have the models on top of each other.
+			for (uint32_t m = 0; m < voxFile.m_models.size(); m++) placements.push_back({ m, {} });
+		}
+
+		if (rotated) AFRE_WARN("{} has rotated models, they're imported unrotated!", path);
+
+		if (placements.empty())
+		{
+			AFRE_ERROR("{} has no models!", path);
+			return false;
+		}
+
+		glm::ivec3 boundsMin{ INT32_MAX };
+		glm::ivec3 boundsMax{ INT32_MIN };
+		for (const VoxPlacement& placement : placements)
+		{
+			const VoxModel& model = voxFile.m_models[placement.m_model];
+			if (glm::any(glm::lessThanEqual(model.m_size, glm::ivec3(0))) || model.m_voxelsOffset == 0)
+			{
+				AFRE_ERROR("{} has a model without voxels!", path);
+				return false;
+			}
+
+			const glm::ivec3 a = GetVoxWorldPosition(placement.m_min);
+			const glm::ivec3 b = GetVoxWorldPosition(placement.m_min + model.m_size - 1);
+			boundsMin = glm::min(boundsMin, glm::min(a, b));
+			boundsMax = glm::max(boundsMax, glm::max(a, b));
+		}
+
+		world = VoxelWorld{ GetSizeInBricks(glm::uvec3(boundsMax - boundsMin + 1)) };
+
+		// Palette index to material, identical colors share one.
+		glm::uint16_t indexMaterials[256]{};
+		std::unordered_map<uint32_t, glm::uint16_t> colorMaterials{};
+		for (uint32_t index = 1; index < 256; index++)
+		{
+			if (!voxFile.m_hasPalette)
+			{
+				indexMaterials[index] = static_cast<glm::uint16_t>(std::min<uint32_t>(importInfo.m_firstMaterial + index - 1, kMaxMaterials - 1));
+				continue;
+			}
+
+			const uint32_t color = voxFile.m_palette[index];
+			const auto material = colorMaterials.find(color);
+			if (material != colorMaterials.end())
+			{
+				indexMaterials[index] = material->second;
+				continue;
+			}
+
+			const uint32_t materialId = importInfo.m_firstMaterial + static_cast<uint32_t>(colorMaterials.size());
+			if (materialId >= kMaxMaterials)
+			{
+				AFRE_ERROR("{} has more colors than there are materials after {}!", path, importInfo.m_firstMaterial);
+				return false;
+			}
+
+			indexMaterials[index] = static_cast<glm::uint16_t>(materialId);
+			colorMaterials.emplace(color, indexMaterials[index]);
+
+			if (importInfo.m_materialRegistry)
+			{
+				const uint32_t alpha = color >> 24;
+				const glm::vec4 albedo{ (color & 0xFF) / 255.f, ((color >> 8) & 0xFF) / 255.f, ((color >> 16) & 0xFF) / 255.f, alpha / 255.f };
+				importInfo.m_materialRegistry->SetMaterial(indexMaterials[index], { albedo, glm::vec3(0.f), static_cast<glm::uint32_t>(alpha < 255 ? MATERIAL_TRANSPARENT : MATERIAL_OPAQUE) });
+			}
+		}
+
+		stats.m_materialCount = voxFile.m_hasPalette ? static_cast<uint32_t>(colorMaterials.size()) : 255;
+
+		if (!voxFile.m_hasPalette) AFRE_WARN("{} has no palette, palette indices are used as materials!", path);
+
+		std::mutex statsMutex{};
+		std::vector<std::vector<uint32_t>> brickVoxels{};
+		std::vector<glm::uint8_t> voxelBuffer(kVoxReadVoxels * 4);
+
+		file.clear();
+		for (const VoxPlacement& placement : placements)
+		{
+			const VoxModel& model = voxFile.m_models[placement.m_model];
+
+			// World bricks the model touches, models aren't brick aligned.
+			const glm::ivec3 a = GetVoxWorldPosition(placement.m_min) - boundsMin;
+			const glm::ivec3 b = GetVoxWorldPosition(placement.m_min + model.m_size - 1) - boundsMin;
+			const glm::uvec3 firstBrick = glm::uvec3(glm::min(a, b)) / static_cast<uint32_t>(kBrickSize);
+			const glm::uvec3 brickCount = glm::uvec3(glm::max(a, b)) / static_cast<uint32_t>(kBrickSize) - firstBrick + 1u;
+
+			// Every voxel of the model sorted into its brick as its index in the brick and its material.
+			brickVoxels.resize(static_cast<size_t>(brickCount.x) * brickCount.y * brickCount.z);
+			for (std::vector<uint32_t>& voxels : brickVoxels) voxels.clear();
+
+			const std::chrono::steady_clock::time_point readStart = std::chrono::steady_clock::now();
+			file.seekg(model.m_voxelsOffset);
+
+			for (uint32_t first = 0; first < model.m_voxelCount; first += kVoxReadVoxels)
+			{
+				const uint32_t count = std::min(model.m_voxelCount - first, kVoxReadVoxels);
+				file.read(reinterpret_cast<char*>(voxelBuffer.data()), count * 4);
+				if (!file)
+				{
+					AFRE_ERROR("{} ends in the middle of a model!", path);
+					return false;
+				}
+
+				for (uint32_t v = 0; v < count; v++)
+				{
+					const glm::uint8_t* voxel = &voxelBuffer[v * 4];
+					const glm::ivec3 local{ voxel[0], voxel[1], voxel[2] };
+					if (voxel[3] == 0 || glm::any(glm::greaterThanEqual(local, model.m_size))) continue;
+
+					const glm::uvec3 position = glm::uvec3(GetVoxWorldPosition(placement.m_min + local) - boundsMin);
+					const glm::uvec3 brick = position / static_cast<uint32_t>(kBrickSize);
+					const glm::uvec3 inBrick = position - brick * static_cast<uint32_t>(kBrickSize);
+					const glm::uvec3 modelBrick = brick - firstBrick;
+
+					brickVoxels[(modelBrick.z * brickCount.y + modelBrick.y) * brickCount.x + modelBrick.x].push_back(GetBrickVoxelIndex(inBrick.x, inBrick.y, inBrick.z) | (static_cast<uint32_t>(indexMaterials[voxel[3]]) << 16));
+				}
+
+				stats.m_voxelCount += count;
+				stats.m_bytesRead += count * 4;
+			}
+
+			stats.m_readMs += GetElapsedMs(readStart);
+
+			// Written over what earlier models left in the brick.
+			std::atomic<uint32_t> nextBrick{ 0 };
+			RunOnWorkers(importInfo.m_workerCount, [&]()
+				{
+					ImportCounts counts{};
+					Brick brick{};
+
+					uint32_t b = 0;
+					while ((b = nextBrick.fetch_add(1)) < brickVoxels.size())
+					{
+						if (brickVoxels[b].empty()) continue;
+
+						const glm::uvec3 brickPosition = firstBrick + glm::uvec3(b % brickCount.x, (b / brickCount.x) % brickCount.y, b / (brickCount.x * brickCount.y));
+
+						brick = world.GetBrick(brickPosition);
+						for (const uint32_t voxel : brickVoxels[b]) brick.m_voxels[voxel & 0xFFFF] = static_cast<glm::uint16_t>(voxel >> 16);
+
+						StoreBrick(world, brickPosition, brick, counts);
+					}
+
+					std::lock_guard<std::mutex> lock{ statsMutex };
+					counts.AddTo(stats);
+				});
+		}
+
+		stats.m_totalMs = GetElapsedMs(start);
+
+		return true;
+	}
+
+	bool ImportRawVolume(const std::string& path, const RawVolumeInfo& rawVolumeInfo, const VoxelImportInfo& importInfo, VoxelWorld& world, VoxelImportStats& stats)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		stats = {};
+
+		const glm::uvec3 size = rawVolumeInfo.m_size;
+		const uint32_t bytesPerVoxel = rawVolumeInfo.m_bytesPerVoxel;
+		if (bytesPerVoxel != 1 && bytesPerVoxel != 2)
+		{
+			AFRE_ERROR("Raw volumes have 1 or 2 bytes per voxel, not {}!", bytesPerVoxel);
+			return false;
+		}
+
+		if (bytesPerVoxel == 1 && importInfo.m_firstMaterial + 254u >= kMaxMaterials)
+		{
+			AFRE_ERROR("8 bit volumes need 255 materials after {}!", importInfo.m_firstMaterial);
+			return false;
+		}
+
+		std::ifstream file{ path, std::ios::binary | std::ios::ate };
+		if (!file)
+		{
+			AFRE_ERROR("Failed to open {}!", path);
+			return false;
+		}
+
+		const uint64_t expectedBytes = static_cast<uint64_t>(size.x) * size.y * size.z * bytesPerVoxel;
+		const uint64_t fileBytes = static_cast<uint64_t>(file.tellg());
+		if (fileBytes < expectedBytes || expectedBytes == 0)
+		{
+			AFRE_ERROR("{} has {} bytes, a {}x{}x{} volume needs {}!", path, fileBytes, size.x, size.y, size.z, expectedBytes);
+			return false;
+		}
+
+		if (fileBytes > expectedBytes) AFRE_WARN("{} is longer than a {}x{}x{} volume, the rest is ignored!", path, size.x, size.y, size.z);
+
+		file.close();
+
+		const glm::uvec3 sizeInBricks = GetSizeInBricks(size);
+		world = VoxelWorld{ sizeInBricks };
+
+		// A row of bricks along x is kBrickSize runs of kBrickSize rows in the file, one per slice.
+		const uint32_t rowCount = sizeInBricks.y * sizeInBricks.z;
+		const size_t rowBytes = static_cast<size_t>(size.x) * bytesPerVoxel;
+
+		std::atomic<uint32_t> nextRow{ 0 };
+		std::atomic<bool> failed{ false };
+		std::mutex statsMutex{};
+
+		RunOnWorkers(importInfo.m_workerCount, [&]()
+			{
+				ImportCounts counts{};
+				std::ifstream workerFile{ path, std::ios::binary };
+				std::vector<char> buffer(kBrickSize * kBrickSize * rowBytes);
+				Brick brick{};
+
+				uint32_t row = 0;
+				while (!failed && workerFile && (row = nextRow.fetch_add(1)) < rowCount)
+				{
+					const uint32_t firstY = (row % sizeInBricks.y) * kBrickSize;
+					const uint32_t firstZ = (row / sizeInBricks.y) * kBrickSize;
+					const uint32_t ySize = std::min<uint32_t>(kBrickSize, size.y - firstY);
+					const uint32_t zSize = std::min<uint32_t>(kBrickSize, size.z - firstZ);
+
+					const std::chrono::steady_clock::time_point readStart = std::chrono::steady_clock::now();
+					for (uint32_t z = 0; z < zSize; z++)
+					{
+						const uint64_t offset = (static_cast<uint64_t>(firstZ + z) * size.y + firstY) * rowBytes;
+						workerFile.seekg(static_cast<std::streamoff>(offset));
+						workerFile.read(buffer.data() + z * kBrickSize * rowBytes, ySize * rowBytes);
+					}
+
+					counts.m_readMs += GetElapsedMs(readStart);
+
+					if (!workerFile)
+					{
+						AFRE_ERROR("Failed reading {}!", path);
+						failed = true;
+						break;
+					}
+
+					counts.m_bytesRead += static_cast<uint64_t>(zSize) * ySize * rowBytes;
+
+					for (uint32_t brickX = 0; brickX < sizeInBricks.x; brickX++)
+					{
+						const uint32_t firstX = brickX * kBrickSize;
+						const uint32_t xSize = std::min<uint32_t>(kBrickSize, size.x - firstX);
+
+						// Past the end of the volume stays empty.
+						if (xSize < kBrickSize || ySize < kBrickSize || zSize < kBrickSize) brick = {};
+
+						for (uint32_t z = 0; z < zSize; z++)
+						{
+							for (uint32_t y = 0; y < ySize; y++)
+							{
+								const char* source = buffer.data() + (z * kBrickSize + y) * rowBytes + static_cast<size_t>(firstX) * bytesPerVoxel;
+								for (uint32_t x = 0; x < xSize; x++)
+								{
+									glm::uint16_t voxel = 0;
+									if (bytesPerVoxel == 1)
+									{
+										const glm::uint8_t index = static_cast<glm::uint8_t>(source[x]);
+										voxel = index == 0 ? 0 : static_cast<glm::uint16_t>(importInfo.m_firstMaterial + index - 1);
+									}
+									else
+									{
+										std::memcpy(&voxel, source + x * 2, sizeof(voxel));
+									}
+
+									brick.m_voxels[GetBrickVoxelIndex(x, y, z)] = voxel;
+								}
+							}
+						}
+
+						counts.m_voxelCount += static_cast<uint64_t>(xSize) * ySize * zSize;
+						StoreBrick(world, { brickX, row % sizeInBricks.y, row / sizeInBricks.y }, brick, counts);
+					}
+				}
+
+				std::lock_guard<std::mutex> lock{ statsMutex };
+				counts.AddTo(stats);
+			});
+
+		stats.m_materialCount = 0;
+		stats.m_totalMs = GetElapsedMs(start);
+
+		return !failed;
+	}
+
+	void LogImportStats(const std::string& path, const VoxelImportStats& stats)
+	{
+		const double seconds = std::max(stats.m_totalMs, 1e-3) / 1000.0;
+
+		AFRE_INFO("Imported {} in {:.2f} s: {:.1f} M voxels/s, {:.1f} MB/s read ({:.2f} s spent reading over all threads)!", path, seconds,
+			static_cast<double>(stats.m_voxelCount) / seconds / 1e6, static_cast<double>(stats.m_bytesRead) / seconds / (1024.0 * 1024.0), stats.m_readMs / 1000.0);
+		AFRE_INFO("  {} bricks: {} stored, {} uniform and {} empty dropped, {} materials", stats.m_brickCount, stats.m_storedBricks, stats.m_uniformBricks, stats.m_emptyBricks, stats.m_materialCount);
+	}
+}
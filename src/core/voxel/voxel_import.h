@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include "voxel_world.h"
+
+namespace afre
+{
+	class MaterialRegistry;
+
+	struct VoxelImportInfo
+	{
+		// Threads converting bricks besides the calling one.
+		uint32_t m_workerCount = 3;
+		// .vox palette colors get material ids from here up, identical colors sharing one.
+		// Raw 8 bit values are offset by it too, 0 stays empty.
+		glm::uint16_t m_firstMaterial = 1;
+		// When set, the .vox palette colors are written to it as opaque materials, or transparent ones below full alpha.
+		MaterialRegistry* m_materialRegistry = nullptr;
+	};
+
+	// Dense volumes without a header: x fastest, then y (up), then z.
+	struct RawVolumeInfo
+	{
+		glm::uvec3 m_size{};
+		// 1 for 8 bit palette indices, 2 for 16 bit material ids used as they are.
+		uint32_t m_bytesPerVoxel = 1;
+	};
+
+	struct VoxelImportStats
+	{
+		uint64_t m_bytesRead = 0;
+		// Solid voxels for .vox, every voxel of the volume for raw.
+		uint64_t m_voxelCount = 0;
+
+		uint32_t m_brickCount = 0;
+		// Dropped while converting, only the bricks with more than one value get memory of their own.
+		uint32_t m_emptyBricks = 0;
+		uint32_t m_uniformBricks = 0;
+		uint32_t m_storedBricks = 0;
+		uint32_t m_materialCount = 0;
+
+		double m_readMs = 0.0;
+		double m_totalMs = 0.0;
+	};
+
+	// MagicaVoxel .vox, every model placed by the translations of the scene graph when there is one. The file is
+	// read a model at a time and only the model being converted is in memory besides the world.
+	// Creates world sized to the models, z up in the file is y up in the world.
+	bool ImportVox(const std::string& path, const VoxelImportInfo& importInfo, VoxelWorld& world, VoxelImportStats& stats);
+
+	// Workers each read a row of bricks along x at a time, that is all the volume ever in memory.
+	bool ImportRawVolume(const std::string& path, const RawVolumeInfo& rawVolumeInfo, const VoxelImportInfo& importInfo, VoxelWorld& world, VoxelImportStats& stats);
+
+	// Voxels and megabytes per second and where the bricks went.
+	void LogImportStats(const std::string& path, const VoxelImportStats& stats);
+}
@@ -0,0 +1,119 @@
+#include "voxel_instance.h"
+
+namespace afre
+{
+	// TraceRay starts testing at the voxel after the origin, so rays start just outside the model.
+	static constexpr float kEntryOffset = 1e-3f;
+
+	Aabb GetInstanceBounds(const VoxelInstance& instance)
+	{
+		const glm::vec3 halfSize = glm::vec3(instance.m_model->GetSizeInVoxels()) * 0.5f;
+
+		Aabb bounds{};
+		for (uint8_t c = 0; c < 8; c++)
+		{
+			const glm::vec3 corner = glm::vec3(c & 1 ? halfSize.x : -halfSize.x, c & 2 ? halfSize.y : -halfSize.y, c & 4 ? halfSize.z : -halfSize.z);
+			bounds.Grow(instance.m_position + instance.m_rotation * corner);
+		}
+
+		return bounds;
+	}
+
+	glm::mat4 GetWorldToModel(const VoxelInstance& instance)
+	{
+		const glm::quat inverseRotation = glm::conjugate(instance.m_rotation);
+		const glm::vec3 halfSize = glm::vec3(instance.m_model->GetSizeInVoxels()) * 0.5f;
+
+		glm::mat4 worldToModel = glm::mat4_cast(inverseRotation);
+		worldToModel[3] = glm::vec4(halfSize - inverseRotation * instance.m_position, 1.f);
+
+		return worldToModel;
+	}
+
+	RayHit TraceInstance(const VoxelInstance& instance, const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance)
+	{
+		const glm::quat inverseRotation = glm::conjugate(instance.m_rotation);
+		const glm::vec3 modelSize = glm::vec3(instance.m_model->GetSizeInVoxels());
+
+		const glm::vec3 modelOrigin = inverseRotation * (rayOrigin - instance.m_position) + modelSize * 0.5f;
+		const glm::vec3 modelDir = inverseRotation * rayDir;
+
+		float tEnter = 0.f, tExit = 0.f;
+		if (!IntersectAabb(glm::vec3(0.f), modelSize, modelOrigin, 1.f / modelDir, maxDistance, tEnter, tExit)) return RayHit{};
+
+		const float tStart = glm::max(tEnter - kEntryOffset, 0.f);
+		RayHit rayHit = TraceRay(*instance.m_model, modelOrigin + modelDir * tStart, modelDir, glm::min(tExit, maxDistance) - tStart);
+		rayHit.m_distance += tStart;
+		if (rayHit.m_distance >= maxDistance) rayHit.m_hit = false;
+
+		return rayHit;
+	}
+
+	InstanceRayHit TraceInstances(const std::vector<VoxelInstance>& instances, const InstanceBvh& bvh, const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance)
+	{
+		InstanceRayHit instanceRayHit{};
+
+		bvh.Traverse(rayOrigin, rayDir, maxDistance, [&](uint32_t instanceIndex, float currentMaxDistance)
+		{
+			const RayHit rayHit = TraceInstance(instances[instanceIndex], rayOrigin, rayDir, currentMaxDistance);
+			if (!rayHit.m_hit) return currentMaxDistance;
+
+			instanceRayHit.m_rayHit = rayHit;
+			instanceRayHit.m_instance = instanceIndex;
+
+			return rayHit.m_distance;
+		});
+
+		return instanceRayHit;
+	}
+
+	ModelBrickAllocator::ModelBrickAllocator(uint32_t brickCount)
+	{
+		if (brickCount > 0) m_freeRanges[0] = brickCount;
+	}
+
+	uint32_t ModelBrickAllocator::Allocate(uint32_t brickCount)
+	{
+		for (auto range = m_freeRanges.begin(); range != m_freeRanges.end(); range++)
+		{
+			if (range->second < brickCount) continue;
+
+			const uint32_t firstBrick = range->first;
+			const uint32_t leftOver = range->second - brickCount;
+
+			m_freeRanges.erase(range);
+			if (leftOver > 0) m_freeRanges[firstBrick + brickCount] = leftOver;
+
+			return firstBrick;
+		}
+
+		return kNoBricks;
+	}
+
+	void ModelBrickAllocator::Free(uint32_t firstBrick, uint32_t brickCount)
+	{
+		if (brickCount == 0) return;
+
+		auto next = m_freeRanges.lower_bound(firstBrick);
+
+		// Merged into the range in front when it ends right here.
+		if (next != m_freeRanges.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == firstBrick)
+			{
+				firstBrick = previous->first;
+				brickCount += previous->second;
+				m_freeRanges.erase(previous);
+			}
+		}
+
+		if (next != m_freeRanges.end() && firstBrick + brickCount == next->first)
+		{
+			brickCount += next->second;
+			m_freeRanges.erase(next);
+		}
+
+		m_freeRanges[firstBrick] = brickCount;
+	}
+}
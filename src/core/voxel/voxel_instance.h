@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <glm/gtc/quaternion.hpp>
+#include "dda.h"
+#include "instance_bvh.h"
+
+namespace afre
+{
+	// A movable voxel model, e.g. a vehicle, door or creature. The model is shared and not edited
+	// through the instance, so any number of instances can point at the same one.
+	struct VoxelInstance
+	{
+		std::shared_ptr<const VoxelWorld> m_model{};
+		// Where the model's center ends up, it also rotates around it.
+		glm::vec3 m_position{};
+		glm::quat m_rotation{ 1.f, 0.f, 0.f, 0.f };
+	};
+
+	struct InstanceRayHit
+	{
+		// Voxel position and face normal are in model space, the distance is along the world ray.
+		RayHit m_rayHit{};
+		uint32_t m_instance = 0;
+	};
+
+	Aabb GetInstanceBounds(const VoxelInstance& instance);
+	// Rotation and translation only, so distances are the same in both spaces.
+	glm::mat4 GetWorldToModel(const VoxelInstance& instance);
+
+	// Ray against a single instance, for when the caller already knows which one it wants.
+	RayHit TraceInstance(const VoxelInstance& instance, const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance);
+
+	// Nearest instance hit before maxDistance. The BVH has to be over the instances' bounds in the same order.
+	InstanceRayHit TraceInstances(const std::vector<VoxelInstance>& instances, const InstanceBvh& bvh, const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance);
+
+	// Ranges of the GPU's model bricks, one per uploaded model. First fit, freed ranges merge with their neighbours
+	// so models of any size keep fitting as others come and go.
+	class ModelBrickAllocator
+	{
+	public:
+		static constexpr uint32_t kNoBricks = ~0u;
+
+		explicit ModelBrickAllocator(uint32_t brickCount);
+
+		// The first brick of the range, kNoBricks when no free range is large enough.
+		uint32_t Allocate(uint32_t brickCount);
+		void Free(uint32_t firstBrick, uint32_t brickCount);
+
+	private:
+		// Brick count by first brick, never touching each other.
+		std::map<uint32_t, uint32_t> m_freeRanges{};
+	};
+}
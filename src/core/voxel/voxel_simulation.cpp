@@ -0,0 +1,380 @@
+#include "voxel_simulation.h"
+#include <algorithm>
+#include <chrono>
+#include "core/system_scheduler.h"
+
+namespace afre
+{
+	// Picks between equally good moves, the same for a voxel and step wherever the brick is stepped.
+	static inline uint32_t HashVoxel(const glm::ivec3& position, uint32_t step)
+	{
+		uint32_t hash = static_cast<uint32_t>(position.x) * 73856093u ^ static_cast<uint32_t>(position.y) * 19349663u ^ static_cast<uint32_t>(position.z) * 83492791u ^ step * 2654435761u;
+		hash ^= hash >> 13;
+		hash *= 0x5bd1e995u;
+		hash ^= hash >> 15;
+
+		return hash;
+	}
+
+	static const glm::ivec2 s_sideOffsets[4] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+
+	VoxelSimulation::VoxelSimulation(VoxelWorld& world)
+		: m_world(world), m_sizeInBricks(glm::ivec3(world.GetSizeInBricks()))
+	{
+		m_voxelInfos.resize(kMaxMaterials);
+		m_active.assign(world.GetBrickCount(), 0);
+		m_dirty.assign(world.GetBrickCount(), 0);
+	}
+
+	void VoxelSimulation::SetVoxelInfo(glm::uint16_t voxel, const VoxelSimulationInfo& voxelSimulationInfo)
+	{
+		// Air is what everything moves through.
+		if (voxel == 0) return;
+
+		m_voxelInfos[voxel] = voxelSimulationInfo;
+		m_voxelInfos[voxel].m_interval = std::max<glm::uint8_t>(voxelSimulationInfo.m_interval, 1);
+	}
+
+	void VoxelSimulation::Wake(const glm::ivec3& position)
+	{
+		if (!m_world.IsInside(position)) return;
+
+		const glm::ivec3 brickPosition = position / static_cast<int32_t>(kBrickSize);
+		const glm::ivec3 local = position - brickPosition * static_cast<int32_t>(kBrickSize);
+
+		for (int32_t z = -1; z <= 1; z++)
+		{
+			for (int32_t y = -1; y <= 1; y++)
+			{
+				for (int32_t x = -1; x <= 1; x++)
+				{
+					const glm::ivec3 offset{ x, y, z };
+
+					// Only the neighbours on the sides the voxel lies on.
+					bool borders = true;
+					for (int32_t axis = 0; axis < 3; axis++)
+					{
+						if (offset[axis] < 0 && local[axis] != 0) borders = false;
+						if (offset[axis] > 0 && local[axis] != kBrickSize - 1) borders = false;
+					}
+
+					if (borders && IsInsideBricks(brickPosition + offset)) ActivateBrick(GetBrickIndex(brickPosition + offset));
+				}
+			}
+		}
+	}
+
+	void VoxelSimulation::WakeAll()
+	{
+		for (uint32_t b = 0; b < m_world.GetBrickCount(); b++) ActivateBrick(b);
+	}
+
+	void VoxelSimulation::Step(SystemScheduler& scheduler)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		m_step++;
+		m_stats = {};
+		for (auto& [brickIndex, moves] : m_stepMoves) moves.clear();
+
+		// Whatever the step wakes goes to the next one.
+		std::vector<uint32_t> activeBricks{};
+		activeBricks.swap(m_activeBricks);
+		for (const uint32_t brickIndex : activeBricks) m_active[brickIndex] = 0;
+
+		m_stats.m_activeBricks = static_cast<uint32_t>(activeBricks.size());
+
+		// Bricks of one pass are at least two apart on some axis, the voxels one brick reads and writes, its own
+		// and the layer around them, are never another's of the same pass.
+		for (uint32_t pass = 0; pass < 8; pass++)
+		{
+			uint32_t jobCount = 0;
+			for (const uint32_t brickIndex : activeBricks)
+			{
+				const glm::ivec3 brickPosition = GetBrickPosition(brickIndex);
+				if (static_cast<uint32_t>((brickPosition.x & 1) | (brickPosition.y & 1) << 1 | (brickPosition.z & 1) << 2) != pass) continue;
+
+				if (jobCount == m_jobs.size()) m_jobs.emplace_back();
+				m_jobs[jobCount++].m_brickIndex = brickIndex;
+			}
+
+			if (jobCount == 0) continue;
+
+			// Only reads the world, it's written below once every brick of the pass is done.
+			scheduler.ParallelFor(jobCount, 1, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t j = begin; j < end; j++)
+					{
+						LoadJob(m_jobs[j]);
+						StepJob(m_jobs[j]);
+					}
+				});
+
+			// Unsharing a brick isn't thread safe, the changed ones are made writable here and filled in parallel.
+			m_changedJobs.clear();
+			m_changedBricks.clear();
+			for (uint32_t j = 0; j < jobCount; j++)
+			{
+				if (m_jobs[j].m_movedVoxels == 0) continue;
+
+				m_changedJobs.push_back(j);
+				m_changedBricks.push_back(&m_world.GetMutableBrick(glm::uvec3(GetBrickPosition(m_jobs[j].m_brickIndex))));
+			}
+
+			scheduler.ParallelFor(static_cast<uint32_t>(m_changedJobs.size()), 4, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t c = begin; c < end; c++) StoreJob(m_jobs[m_changedJobs[c]], *m_changedBricks[c]);
+				});
+
+			for (uint32_t j = 0; j < jobCount; j++)
+			{
+				BrickJob& job = m_jobs[j];
+
+				for (const ShellWrite& shellWrite : job.m_shellWrites)
+				{
+					m_world.SetVoxel(shellWrite.m_position, shellWrite.m_voxel);
+					MarkDirty(GetBrickIndex(shellWrite.m_position / static_cast<int32_t>(kBrickSize)));
+					Wake(shellWrite.m_position);
+				}
+
+				if (!job.m_borderMoves.empty()) m_stepMoves[job.m_brickIndex].swap(job.m_borderMoves);
+
+				// Still moving, or waiting for its turn.
+				if (job.m_movedVoxels > 0 || job.m_waiting) ActivateBrick(job.m_brickIndex);
+				if (job.m_movedVoxels == 0) continue;
+
+				MarkDirty(job.m_brickIndex);
+				m_stats.m_changedBricks++;
+				m_stats.m_movedVoxels += job.m_movedVoxels;
+
+				// Neighbours on the sides something changed at may have lost what held their voxels up.
+				const glm::ivec3 brickPosition = GetBrickPosition(job.m_brickIndex);
+				for (int32_t z = -1; z <= 1; z++)
+				{
+					for (int32_t y = -1; y <= 1; y++)
+					{
+						for (int32_t x = -1; x <= 1; x++)
+						{
+							const glm::ivec3 offset{ x, y, z };
+
+							bool touched = offset != glm::ivec3(0);
+							for (int32_t axis = 0; axis < 3; axis++)
+							{
+								if (offset[axis] < 0 && !job.m_touchedLow[axis]) touched = false;
+								if (offset[axis] > 0 && !job.m_touchedHigh[axis]) touched = false;
+							}
+
+							if (touched && IsInsideBricks(brickPosition + offset)) ActivateBrick(GetBrickIndex(brickPosition + offset));
+						}
+					}
+				}
+			}
+		}
+
+		m_stats.m_stepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void VoxelSimulation::TakeDirtyBricks(std::vector<uint32_t>& brickIndices)
+	{
+		for (const uint32_t brickIndex : m_dirtyBricks) m_dirty[brickIndex] = 0;
+
+		brickIndices.swap(m_dirtyBricks);
+		m_dirtyBricks.clear();
+	}
+
+	void VoxelSimulation::ActivateBrick(uint32_t brickIndex)
+	{
+		if (m_active[brickIndex]) return;
+
+		m_active[brickIndex] = 1;
+		m_activeBricks.push_back(brickIndex);
+	}
+
+	void VoxelSimulation::MarkDirty(uint32_t brickIndex)
+	{
+		if (m_dirty[brickIndex]) return;
+
+		m_dirty[brickIndex] = 1;
+		m_dirtyBricks.push_back(brickIndex);
+	}
+
+	void VoxelSimulation::LoadJob(BrickJob& job) const
+	{
+		const glm::ivec3 brickPosition = GetBrickPosition(job.m_brickIndex);
+		const glm::ivec3 brickMin = brickPosition * static_cast<int32_t>(kBrickSize);
+		const Brick& brick = m_world.GetBrick(glm::uvec3(brickPosition));
+
+		std::fill(std::begin(job.m_claimed), std::end(job.m_claimed), 0ull);
+		job.m_movedVoxels = 0;
+		job.m_waiting = false;
+		std::fill(std::begin(job.m_touchedLow), std::end(job.m_touchedLow), false);
+		std::fill(std::begin(job.m_touchedHigh), std::end(job.m_touchedHigh), false);
+		job.m_shellWrites.clear();
+		job.m_borderMoves.clear();
+
+		for (int32_t z = -1; z <= kBrickSize; z++)
+		{
+			for (int32_t y = -1; y <= kBrickSize; y++)
+			{
+				for (int32_t x = -1; x <= kBrickSize; x++)
+				{
+					const uint32_t index = GetPaddedIndex(x, y, z);
+					const bool inside = x >= 0 && y >= 0 && z >= 0 && x < kBrickSize && y < kBrickSize && z < kBrickSize;
+
+					if (inside)
+					{
+						job.m_voxels[index] = brick.At(glm::uvec3(x, y, z));
+						continue;
+					}
+
+					const glm::ivec3 position = brickMin + glm::ivec3(x, y, z);
+					job.m_voxels[index] = m_world.GetVoxel(position);
+
+					// Outside the world is a wall.
+					if (!m_world.IsInside(position)) job.m_claimed[index >> 6] |= 1ull << (index & 63);
+				}
+			}
+		}
+
+		// What an earlier pass of this step moved in the brick or its shell already had its move. Only a neighbour's
+		// copy overlaps this one.
+		for (int32_t z = -1; z <= 1; z++)
+		{
+			for (int32_t y = -1; y <= 1; y++)
+			{
+				for (int32_t x = -1; x <= 1; x++)
+				{
+					const glm::ivec3 neighbor = brickPosition + glm::ivec3(x, y, z);
+					if (!IsInsideBricks(neighbor)) continue;
+
+					const auto moves = m_stepMoves.find(GetBrickIndex(neighbor));
+					if (moves == m_stepMoves.end()) continue;
+
+					for (const glm::ivec3& position : moves->second)
+					{
+						const glm::ivec3 local = position - brickMin;
+						if (glm::any(glm::lessThan(local, glm::ivec3(-1))) || glm::any(glm::greaterThan(local, glm::ivec3(kBrickSize)))) continue;
+
+						const uint32_t index = GetPaddedIndex(local.x, local.y, local.z);
+						job.m_claimed[index >> 6] |= 1ull << (index & 63);
+					}
+				}
+			}
+		}
+	}
+
+	void VoxelSimulation::StepJob(BrickJob& job) const
+	{
+		const glm::ivec3 brickMin = GetBrickPosition(job.m_brickIndex) * static_cast<int32_t>(kBrickSize);
+
+		const auto isClaimed = [&](uint32_t index) { return ((job.m_claimed[index >> 6] >> (index & 63)) & 1) != 0; };
+		const auto claim = [&](uint32_t index) { job.m_claimed[index >> 6] |= 1ull << (index & 63); };
+
+		const auto touch = [&](const glm::ivec3& local)
+			{
+				bool border = false;
+				for (int32_t axis = 0; axis < 3; axis++)
+				{
+					if (local[axis] <= 0) job.m_touchedLow[axis] = true;
+					if (local[axis] >= kBrickSize - 1) job.m_touchedHigh[axis] = true;
+
+					border |= local[axis] <= 0 || local[axis] >= kBrickSize - 1;
+				}
+
+				if (border) job.m_borderMoves.push_back(brickMin + local);
+			};
+
+		// The other way round every other step, so liquids don't drift towards one side.
+		const bool flipX = (m_step & 1) != 0;
+		const bool flipZ = (m_step & 2) != 0;
+
+		// Bottom up, a voxel that fell is already past the rows still to come.
+		for (int32_t y = 0; y < kBrickSize; y++)
+		{
+			for (int32_t zStep = 0; zStep < kBrickSize; zStep++)
+			{
+				const int32_t z = flipZ ? kBrickSize - 1 - zStep : zStep;
+
+				for (int32_t xStep = 0; xStep < kBrickSize; xStep++)
+				{
+					const int32_t x = flipX ? kBrickSize - 1 - xStep : xStep;
+					const uint32_t index = GetPaddedIndex(x, y, z);
+
+					const glm::uint16_t voxel = job.m_voxels[index];
+					if (voxel == 0) continue;
+
+					const VoxelSimulationInfo& info = m_voxelInfos[voxel];
+					if (info.m_behavior == VOXEL_BEHAVIOR_STATIC || isClaimed(index)) continue;
+
+					const bool powder = info.m_behavior == VOXEL_BEHAVIOR_POWDER;
+					const auto canEnter = [&](const glm::ivec3& local)
+						{
+							const uint32_t target = GetPaddedIndex(local.x, local.y, local.z);
+							if (isClaimed(target)) return false;
+
+							const glm::uint16_t targetVoxel = job.m_voxels[target];
+							return targetVoxel == 0 || (powder && m_voxelInfos[targetVoxel].m_behavior == VOXEL_BEHAVIOR_LIQUID);
+						};
+
+					const glm::ivec3 local{ x, y, z };
+					const uint32_t hash = HashVoxel(brickMin + local, m_step);
+
+					// Straight down, then diagonally down, then for liquids sideways, each starting at a random side.
+					bool found = false;
+					glm::ivec3 target = local - glm::ivec3(0, 1, 0);
+					found = canEnter(target);
+
+					for (uint32_t s = 0; s < 4 && !found; s++)
+					{
+						const glm::ivec2 side = s_sideOffsets[(s + hash) & 3];
+						target = local + glm::ivec3(side.x, -1, side.y);
+						found = canEnter(target);
+					}
+
+					// Sideways only under the weight of more liquid and onto something, into a cell nothing falls into
+					// from above, so a pool flattens out and comes to rest instead of shuffling its holes about forever.
+					const auto isLiquid = [&](const glm::ivec3& cell) { return m_voxelInfos[job.m_voxels[GetPaddedIndex(cell.x, cell.y, cell.z)]].m_behavior == VOXEL_BEHAVIOR_LIQUID; };
+					const bool pressed = !powder && isLiquid(local + glm::ivec3(0, 1, 0));
+					for (uint32_t s = 0; s < 4 && !found && pressed; s++)
+					{
+						const glm::ivec2 side = s_sideOffsets[(s + (hash >> 2)) & 3];
+						target = local + glm::ivec3(side.x, 0, side.y);
+						found = canEnter(target) && job.m_voxels[GetPaddedIndex(target.x, target.y - 1, target.z)] != 0 && !isLiquid(target + glm::ivec3(0, 1, 0));
+					}
+
+					if (!found) continue;
+
+					if (info.m_interval > 1 && (m_step + hash) % info.m_interval != 0)
+					{
+						job.m_waiting = true;
+						continue;
+					}
+
+					const uint32_t targetIndex = GetPaddedIndex(target.x, target.y, target.z);
+					job.m_voxels[index] = job.m_voxels[targetIndex];
+					job.m_voxels[targetIndex] = voxel;
+					claim(index);
+					claim(targetIndex);
+
+					touch(local);
+					touch(target);
+					job.m_movedVoxels++;
+
+					const bool shell = target.x < 0 || target.y < 0 || target.z < 0 || target.x >= kBrickSize || target.y >= kBrickSize || target.z >= kBrickSize;
+					if (shell) job.m_shellWrites.push_back({ brickMin + target, voxel });
+				}
+			}
+		}
+	}
+
+	void VoxelSimulation::StoreJob(const BrickJob& job, Brick& brick) const
+	{
+		for (int32_t z = 0; z < kBrickSize; z++)
+		{
+			for (int32_t y = 0; y < kBrickSize; y++)
+			{
+				for (int32_t x = 0; x < kBrickSize; x++) brick.At(glm::uvec3(x, y, z)) = job.m_voxels[GetPaddedIndex(x, y, z)];
+			}
+		}
+	}
+}
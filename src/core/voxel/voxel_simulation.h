@@ -0,0 +1,144 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "voxel_world.h"
+
+namespace afre
+{
+	class SystemScheduler;
+
+	enum VoxelBehavior
+	{
+		// Never moves, the default.
+		VOXEL_BEHAVIOR_STATIC = 0,
+		// Falls straight or diagonally down and sinks through liquids, like sand.
+		VOXEL_BEHAVIOR_POWDER = 1,
+		// Falls like a powder and spreads sideways while more liquid presses on it, like water.
+		VOXEL_BEHAVIOR_LIQUID = 2
+	};
+
+	struct VoxelSimulationInfo
+	{
+		VoxelBehavior m_behavior = VOXEL_BEHAVIOR_STATIC;
+		// Moves every m_interval steps, slower liquids like lava use more than 1.
+		glm::uint8_t m_interval = 1;
+	};
+
+	struct VoxelSimulationStats
+	{
+		// Of the last step.
+		uint32_t m_activeBricks = 0;
+		uint32_t m_changedBricks = 0;
+		uint32_t m_movedVoxels = 0;
+		double m_stepMs = 0.0;
+	};
+
+	// Steps falling and flowing voxels of a world as a cellular automaton, a voxel moving at most one voxel per step.
+	// Only active bricks are stepped: a brick stays active while something in it moves and wakes its neighbours when
+	// a voxel at its border changes, so a step costs what moves, not the world's size. Bricks are stepped in parallel,
+	// in eight passes by the parity of their position so no two bricks of a pass touch the same voxels.
+	class VoxelSimulation
+	{
+	public:
+		explicit VoxelSimulation(VoxelWorld& world);
+
+		void SetVoxelInfo(glm::uint16_t voxel, const VoxelSimulationInfo& voxelSimulationInfo);
+
+		// After any change to the world outside Step, or nothing will react to it. Wakes the voxel's brick and the
+		// neighbours it borders on.
+		void Wake(const glm::ivec3& position);
+		void WakeAll();
+
+		void Step(SystemScheduler& scheduler);
+
+		// Bricks written by the steps since the last call, for the GPU to upload, each once.
+		void TakeDirtyBricks(std::vector<uint32_t>& brickIndices);
+
+		inline uint32_t GetActiveBrickCount() const { return static_cast<uint32_t>(m_activeBricks.size()); }
+		inline const VoxelSimulationStats& GetStats() const { return m_stats; }
+
+	private:
+		// The brick and one voxel around it.
+		static constexpr int32_t kPaddedSize = kBrickSize + 2;
+		static constexpr uint32_t kPaddedCount = kPaddedSize * kPaddedSize * kPaddedSize;
+
+		struct ShellWrite
+		{
+			glm::ivec3 m_position{};
+			glm::uint16_t m_voxel = 0;
+		};
+
+		// A brick of the current pass, worked on in its own copy so the world is only written when something moved.
+		struct BrickJob
+		{
+			uint32_t m_brickIndex = 0;
+			glm::uint16_t m_voxels[kPaddedCount]{};
+			// Moved this step or outside the world, neither moves nor is moved into again.
+			uint64_t m_claimed[(kPaddedCount + 63) / 64]{};
+
+			uint32_t m_movedVoxels = 0;
+			// Something could move but waits for its interval, the brick stays active.
+			bool m_waiting = false;
+			// Whether a voxel changed at the low and high side of the brick on each axis.
+			bool m_touchedLow[3]{};
+			bool m_touchedHigh[3]{};
+			// Moves out of the brick, written by the caller's thread once the pass is done.
+			std::vector<ShellWrite> m_shellWrites{};
+			// Voxels a move went from or to at the brick's border or past it, which later passes' bricks can see.
+			std::vector<glm::ivec3> m_borderMoves{};
+		};
+
+		void ActivateBrick(uint32_t brickIndex);
+		void MarkDirty(uint32_t brickIndex);
+
+		void LoadJob(BrickJob& job) const;
+		void StepJob(BrickJob& job) const;
+		void StoreJob(const BrickJob& job, Brick& brick) const;
+
+		static inline uint32_t GetPaddedIndex(int32_t x, int32_t y, int32_t z)
+		{
+			return ((z + 1) * kPaddedSize + (y + 1)) * kPaddedSize + (x + 1);
+		}
+
+		inline uint32_t GetBrickIndex(const glm::ivec3& brickPosition) const
+		{
+			return (brickPosition.z * m_sizeInBricks.y + brickPosition.y) * m_sizeInBricks.x + brickPosition.x;
+		}
+
+		inline glm::ivec3 GetBrickPosition(uint32_t brickIndex) const
+		{
+			const int32_t index = static_cast<int32_t>(brickIndex);
+			return { index % m_sizeInBricks.x, (index / m_sizeInBricks.x) % m_sizeInBricks.y, index / (m_sizeInBricks.x * m_sizeInBricks.y) };
+		}
+
+		inline bool IsInsideBricks(const glm::ivec3& brickPosition) const
+		{
+			return glm::all(glm::greaterThanEqual(brickPosition, glm::ivec3(0))) && glm::all(glm::lessThan(brickPosition, m_sizeInBricks));
+		}
+
+		VoxelWorld& m_world;
+		glm::ivec3 m_sizeInBricks{};
+
+		std::vector<VoxelSimulationInfo> m_voxelInfos{};
+
+		// Bricks the next step works on, each once.
+		std::vector<uint32_t> m_activeBricks{};
+		std::vector<glm::uint8_t> m_active{};
+
+		std::vector<uint32_t> m_dirtyBricks{};
+		std::vector<glm::uint8_t> m_dirty{};
+
+		// The border moves of the step's passes so far by the brick that made them, claimed by the neighbours stepped
+		// in the passes after them so nothing moves twice in a step.
+		std::unordered_map<uint32_t, std::vector<glm::ivec3>> m_stepMoves{};
+
+		// Reused every pass.
+		std::vector<BrickJob> m_jobs{};
+		std::vector<uint32_t> m_changedJobs{};
+		std::vector<Brick*> m_changedBricks{};
+
+		uint32_t m_step = 0;
+		VoxelSimulationStats m_stats{};
+	};
+}
@@ -0,0 +1,163 @@
+#include "voxel_world.h"
+#include <unordered_map>
+#include "brick_kernels.h"
+#include "brick_pool.h"
+
+namespace afre
+{
+	VoxelWorld::VoxelWorld(const glm::uvec3& sizeInBricks)
+		: m_sizeInBricks(sizeInBricks)
+	{
+		const size_t brickCount = static_cast<size_t>(sizeInBricks.x) * sizeInBricks.y * sizeInBricks.z;
+
+		// Every brick starts out as the shared empty one and gets its own copy on the first write.
+		BrickSlot emptySlot{};
+		emptySlot.m_brick = GetUniformBrick(0);
+		emptySlot.m_uniform = true;
+		m_brickSlots.assign(brickCount, emptySlot);
+	}
+
+	glm::uint16_t VoxelWorld::GetVoxel(const glm::ivec3& position) const
+	{
+		if (!IsInside(position)) return 0;
+
+		const glm::uvec3 brickPosition = glm::uvec3(position) / static_cast<uint32_t>(kBrickSize);
+		const glm::uvec3 local = glm::uvec3(position) - brickPosition * static_cast<uint32_t>(kBrickSize);
+
+		return m_brickSlots[GetBrickIndex(brickPosition)].m_brick->At(local);
+	}
+
+	void VoxelWorld::SetVoxel(const glm::ivec3& position, glm::uint16_t voxel)
+	{
+		if (!IsInside(position)) return;
+
+		const glm::uvec3 brickPosition = glm::uvec3(position) / static_cast<uint32_t>(kBrickSize);
+		const glm::uvec3 local = glm::uvec3(position) - brickPosition * static_cast<uint32_t>(kBrickSize);
+
+		MakeBrickWritable(GetBrickIndex(brickPosition)).At(local) = voxel;
+	}
+
+	bool VoxelWorld::IsInside(const glm::ivec3& position) const
+	{
+		const glm::uvec3 size = GetSizeInVoxels();
+
+		return position.x >= 0 && position.y >= 0 && position.z >= 0
+			&& static_cast<uint32_t>(position.x) < size.x
+			&& static_cast<uint32_t>(position.y) < size.y
+			&& static_cast<uint32_t>(position.z) < size.z;
+	}
+
+	const Brick& VoxelWorld::GetBrick(const glm::uvec3& brickPosition) const
+	{
+		return *m_brickSlots[GetBrickIndex(brickPosition)].m_brick;
+	}
+
+	Brick& VoxelWorld::GetMutableBrick(const glm::uvec3& brickPosition)
+	{
+		return MakeBrickWritable(GetBrickIndex(brickPosition));
+	}
+
+	void VoxelWorld::SetBrick(const glm::uvec3& brickPosition, const Brick& brick)
+	{
+		BrickSlot& brickSlot = m_brickSlots[GetBrickIndex(brickPosition)];
+
+		// Reused when nothing else holds it, importers set the same bricks over and over.
+		if (brickSlot.m_writableEpoch == m_snapshotEpoch || (!brickSlot.m_uniform && brickSlot.m_brick.use_count() == 1)) *brickSlot.m_brick = brick;
+		else brickSlot.m_brick = MakePooledBrick(BRICK_POOL_WORLD, brick);
+
+		brickSlot.m_writableEpoch = m_snapshotEpoch;
+		brickSlot.m_version = m_snapshotEpoch;
+		brickSlot.m_uniform = false;
+	}
+
+	void VoxelWorld::SetUniformBrick(const glm::uvec3& brickPosition, glm::uint16_t voxel)
+	{
+		BrickSlot& brickSlot = m_brickSlots[GetBrickIndex(brickPosition)];
+
+		brickSlot.m_brick = GetUniformBrick(voxel);
+		brickSlot.m_writableEpoch = 0;
+		brickSlot.m_version = m_snapshotEpoch;
+		brickSlot.m_uniform = true;
+		brickSlot.m_uniformVoxel = voxel;
+	}
+
+	std::shared_ptr<const WorldSnapshot> VoxelWorld::TakeSnapshot()
+	{
+		std::vector<std::shared_ptr<const Brick>> bricks(m_brickSlots.size());
+		std::vector<uint64_t> brickVersions(m_brickSlots.size());
+		for (size_t i = 0; i < m_brickSlots.size(); i++)
+		{
+			bricks[i] = m_brickSlots[i].m_brick;
+			brickVersions[i] = m_brickSlots[i].m_version;
+		}
+
+		const uint64_t version = m_snapshotEpoch;
+
+		// Everything handed out above is shared now, so the next write to any brick checks its refcount again.
+		m_snapshotEpoch++;
+
+		return std::make_shared<const WorldSnapshot>(m_sizeInBricks, std::move(bricks), std::move(brickVersions), version);
+	}
+
+	BrickDeduplicationStats VoxelWorld::DeduplicateBricks()
+	{
+		BrickDeduplicationStats stats{};
+
+		std::unordered_map<uint64_t, uint32_t> uniqueBricks{};
+
+		for (uint32_t b = 0; b < static_cast<uint32_t>(m_brickSlots.size()); b++)
+		{
+			BrickSlot& brickSlot = m_brickSlots[b];
+
+			if (brickSlot.m_uniform)
+			{
+				stats.m_uniformBricks++;
+				continue;
+			}
+
+			glm::uint16_t uniformVoxel = 0;
+			if (afre::IsBrickUniform(*brickSlot.m_brick, uniformVoxel))
+			{
+				brickSlot.m_brick = GetUniformBrick(uniformVoxel);
+				brickSlot.m_uniform = true;
+				brickSlot.m_uniformVoxel = uniformVoxel;
+				brickSlot.m_writableEpoch = 0;
+
+				stats.m_uniformBricks++;
+				continue;
+			}
+
+			const uint64_t hash = HashBrick(*brickSlot.m_brick);
+			const auto uniqueBrick = uniqueBricks.find(hash);
+			if (uniqueBrick != uniqueBricks.end())
+			{
+				BrickSlot& uniqueSlot = m_brickSlots[uniqueBrick->second];
+				if (uniqueSlot.m_brick == brickSlot.m_brick || AreBricksEqual(*uniqueSlot.m_brick, *brickSlot.m_brick))
+				{
+					brickSlot.m_brick = uniqueSlot.m_brick;
+					// Both are shared now, the next write to either has to copy.
+					brickSlot.m_writableEpoch = 0;
+					uniqueSlot.m_writableEpoch = 0;
+
+					stats.m_duplicateBricks++;
+					continue;
+				}
+			}
+
+			uniqueBricks.emplace(hash, b);
+			stats.m_uniqueBricks++;
+		}
+
+		return stats;
+	}
+
+	void VoxelWorld::UnshareBrick(BrickSlot& brickSlot)
+	{
+		// Only this thread hands out references, so a count of one can't go up behind our back.
+		if (brickSlot.m_brick.use_count() > 1) brickSlot.m_brick = MakePooledBrick(BRICK_POOL_WORLD, *brickSlot.m_brick);
+
+		brickSlot.m_writableEpoch = m_snapshotEpoch;
+		brickSlot.m_version = m_snapshotEpoch;
+		brickSlot.m_uniform = false;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "brick_deduplication.h"
+#include "world_snapshot.h"
+
+namespace afre
+{
+	// A CPU side grid of bricks, sized at runtime unlike VoxelData.
+	// Bricks are reference counted and copied on write, so snapshots can be handed to other threads for free.
+	class VoxelWorld
+	{
+	public:
+		VoxelWorld() = default;
+		VoxelWorld(const glm::uvec3& sizeInBricks);
+
+		// A copy would share the bricks while believing them unshared and write into the original's, take a
+		// snapshot instead.
+		VoxelWorld(const VoxelWorld&) = delete;
+		VoxelWorld& operator=(const VoxelWorld&) = delete;
+		VoxelWorld(VoxelWorld&&) = default;
+		VoxelWorld& operator=(VoxelWorld&&) = default;
+
+		glm::uint16_t GetVoxel(const glm::ivec3& position) const;
+		void SetVoxel(const glm::ivec3& position, glm::uint16_t voxel);
+
+		bool IsInside(const glm::ivec3& position) const;
+
+		const Brick& GetBrick(const glm::uvec3& brickPosition) const;
+		// Unshares the brick first, so snapshots holding it keep the old contents.
+		Brick& GetMutableBrick(const glm::uvec3& brickPosition);
+
+		// Replace the whole brick, without the copy on write of the old one. Both are safe to call from several
+		// threads as long as each writes different bricks and nothing else uses the world meanwhile.
+		void SetBrick(const glm::uvec3& brickPosition, const Brick& brick);
+		// Points the brick at the shared uniform brick of the value, nothing is allocated.
+		void SetUniformBrick(const glm::uvec3& brickPosition, glm::uint16_t voxel);
+
+		// O(brick count) pointer copies, no voxel data is copied.
+		std::shared_ptr<const WorldSnapshot> TakeSnapshot();
+
+		// Points uniform bricks at the shared uniform brick of their value and identical bricks at one copy.
+		// They split again on the next write to them.
+		BrickDeduplicationStats DeduplicateBricks();
+
+		inline bool IsBrickUniform(const glm::uvec3& brickPosition, glm::uint16_t& voxel) const
+		{
+			const BrickSlot& brickSlot = m_brickSlots[GetBrickIndex(brickPosition)];
+			voxel = brickSlot.m_uniformVoxel;
+
+			return brickSlot.m_uniform;
+		}
+
+		inline glm::uvec3 GetSizeInBricks() const { return m_sizeInBricks; }
+		inline glm::uvec3 GetSizeInVoxels() const { return m_sizeInBricks * static_cast<uint32_t>(kBrickSize); }
+		inline uint32_t GetBrickCount() const { return static_cast<uint32_t>(m_brickSlots.size()); }
+
+		// The version goes up with every snapshot, a brick's version is the world version it was last written in.
+		inline uint64_t GetVersion() const { return m_snapshotEpoch; }
+		inline uint64_t GetBrickVersion(const glm::uvec3& brickPosition) const { return m_brickSlots[GetBrickIndex(brickPosition)].m_version; }
+
+	private:
+		// Kept together so an edit touches a single cache line of bookkeeping.
+		struct BrickSlot
+		{
+			std::shared_ptr<Brick> m_brick{};
+			uint64_t m_version = 0;
+			// A brick whose epoch matches m_snapshotEpoch is known to be unshared and versioned already.
+			uint64_t m_writableEpoch = 0;
+			bool m_uniform = false;
+			glm::uint16_t m_uniformVoxel = 0;
+		};
+
+		inline uint32_t GetBrickIndex(const glm::uvec3& brickPosition) const
+		{
+			return (brickPosition.z * m_sizeInBricks.y + brickPosition.y) * m_sizeInBricks.x + brickPosition.x;
+		}
+
+		inline Brick& MakeBrickWritable(uint32_t brickIndex)
+		{
+			BrickSlot& brickSlot = m_brickSlots[brickIndex];
+			if (brickSlot.m_writableEpoch != m_snapshotEpoch) UnshareBrick(brickSlot);
+
+			return *brickSlot.m_brick;
+		}
+
+		void UnshareBrick(BrickSlot& brickSlot);
+
+		glm::uvec3 m_sizeInBricks{};
+
+		std::vector<BrickSlot> m_brickSlots{};
+		uint64_t m_snapshotEpoch = 1;
+	};
+}
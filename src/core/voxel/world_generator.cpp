@@ -0,0 +1,59 @@
+#include "world_generator.h"
+#include <cmath>
+
+namespace afre
+{
+	static float HashToFloat(int32_t x, int32_t z, uint32_t seed)
+	{
+		uint32_t hash = static_cast<uint32_t>(x) * 0x8da6b343u ^ static_cast<uint32_t>(z) * 0xd8163841u ^ seed * 0xcb1ab31fu;
+		hash ^= hash >> 13;
+		hash *= 0x5bd1e995u;
+		hash ^= hash >> 15;
+
+		return static_cast<float>(hash & 0xffffffu) / static_cast<float>(0xffffffu);
+	}
+
+	static float ValueNoise(float x, float z, uint32_t seed)
+	{
+		const int32_t cellX = static_cast<int32_t>(std::floor(x));
+		const int32_t cellZ = static_cast<int32_t>(std::floor(z));
+
+		float fractionX = x - static_cast<float>(cellX);
+		float fractionZ = z - static_cast<float>(cellZ);
+		fractionX = fractionX * fractionX * (3.f - 2.f * fractionX);
+		fractionZ = fractionZ * fractionZ * (3.f - 2.f * fractionZ);
+
+		const float top = HashToFloat(cellX, cellZ, seed) + (HashToFloat(cellX + 1, cellZ, seed) - HashToFloat(cellX, cellZ, seed)) * fractionX;
+		const float bottom = HashToFloat(cellX, cellZ + 1, seed) + (HashToFloat(cellX + 1, cellZ + 1, seed) - HashToFloat(cellX, cellZ + 1, seed)) * fractionX;
+
+		return top + (bottom - top) * fractionZ;
+	}
+
+	void GenerateWorld(VoxelWorld& world, const WorldGeneratorInfo& worldGeneratorInfo)
+	{
+		const glm::uvec3 size = world.GetSizeInVoxels();
+		const float baseHeight = static_cast<float>(size.y) * (1.f - worldGeneratorInfo.m_heightScale) * 0.5f;
+
+		for (uint32_t z = 0; z < size.z; z++)
+		{
+			for (uint32_t x = 0; x < size.x; x++)
+			{
+				// Two octaves are enough to get hills without flattening the bricks into noise.
+				const float noise =
+					ValueNoise(x * worldGeneratorInfo.m_frequency, z * worldGeneratorInfo.m_frequency, worldGeneratorInfo.m_seed) * 0.75f +
+					ValueNoise(x * worldGeneratorInfo.m_frequency * 4.f, z * worldGeneratorInfo.m_frequency * 4.f, worldGeneratorInfo.m_seed + 1) * 0.25f;
+
+				const uint32_t height = glm::min(size.y, static_cast<uint32_t>(baseHeight + noise * static_cast<float>(size.y) * worldGeneratorInfo.m_heightScale));
+
+				for (uint32_t y = 0; y < height; y++)
+				{
+					const glm::ivec3 position{ static_cast<int32_t>(x), static_cast<int32_t>(y), static_cast<int32_t>(z) };
+					world.SetVoxel(position, y + 1 == height ? worldGeneratorInfo.m_surfaceVoxel : worldGeneratorInfo.m_groundVoxel);
+				}
+			}
+		}
+
+		// Solid ground and open sky end up mostly as uniform bricks.
+		world.DeduplicateBricks();
+	}
+}
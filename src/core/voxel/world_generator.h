@@ -0,0 +1,19 @@
+#pragma once
+
+#include "voxel_world.h"
+
+namespace afre
+{
+	struct WorldGeneratorInfo
+	{
+		uint32_t m_seed = 0;
+		float m_frequency = 1.f / 32.f;
+		// Fraction of the world's height the terrain surface varies in.
+		float m_heightScale = 0.5f;
+		glm::uint16_t m_surfaceVoxel = 2;
+		glm::uint16_t m_groundVoxel = 1;
+	};
+
+	// Fills the world with a value noise heightmap terrain. Deterministic for a given seed.
+	void GenerateWorld(VoxelWorld& world, const WorldGeneratorInfo& worldGeneratorInfo);
+}
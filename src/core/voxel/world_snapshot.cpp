@@ -0,0 +1,42 @@
+#include "world_snapshot.h"
+#include "brick_pool.h"
+
+namespace afre
+{
+	WorldSnapshot::WorldSnapshot(const glm::uvec3& sizeInBricks, std::vector<std::shared_ptr<const Brick>> bricks, std::vector<uint64_t> brickVersions, uint64_t version)
+		: m_sizeInBricks(sizeInBricks), m_bricks(std::move(bricks)), m_brickVersions(std::move(brickVersions)), m_version(version)
+	{
+	}
+
+	std::shared_ptr<const WorldSnapshot> WorldSnapshot::CopyFrom(const Brick* bricks, const glm::uvec3& sizeInBricks)
+	{
+		const size_t brickCount = static_cast<size_t>(sizeInBricks.x) * sizeInBricks.y * sizeInBricks.z;
+
+		std::vector<std::shared_ptr<const Brick>> sharedBricks(brickCount);
+		for (size_t i = 0; i < brickCount; i++)
+		{
+			sharedBricks[i] = MakePooledBrick(BRICK_POOL_SNAPSHOT, bricks[i]);
+		}
+
+		return std::make_shared<const WorldSnapshot>(sizeInBricks, std::move(sharedBricks), std::vector<uint64_t>(brickCount, 0), 0);
+	}
+
+	glm::uint16_t WorldSnapshot::GetVoxel(const glm::ivec3& position) const
+	{
+		if (!IsInside(position)) return 0;
+
+		const glm::uvec3 brickPosition = glm::uvec3(position) / static_cast<uint32_t>(kBrickSize);
+		const glm::uvec3 local = glm::uvec3(position) - brickPosition * static_cast<uint32_t>(kBrickSize);
+		const uint32_t brickIndex = (brickPosition.z * m_sizeInBricks.y + brickPosition.y) * m_sizeInBricks.x + brickPosition.x;
+
+		return m_bricks[brickIndex]->At(local);
+	}
+
+	bool WorldSnapshot::IsInside(const glm::ivec3& position) const
+	{
+		return position.x >= 0 && position.y >= 0 && position.z >= 0
+			&& static_cast<uint32_t>(position.x) < m_sizeInBricks.x * kBrickSize
+			&& static_cast<uint32_t>(position.y) < m_sizeInBricks.y * kBrickSize
+			&& static_cast<uint32_t>(position.z) < m_sizeInBricks.z * kBrickSize;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "core/buffer_data_types.h"
+
+namespace afre
+{
+	// An immutable view of a VoxelWorld at one version. Bricks are shared with the world until it writes to them,
+	// so holding one costs a pointer per brick and any thread can read it without locking.
+	class WorldSnapshot
+	{
+	public:
+		WorldSnapshot(const glm::uvec3& sizeInBricks, std::vector<std::shared_ptr<const Brick>> bricks, std::vector<uint64_t> brickVersions, uint64_t version);
+
+		// Copies raw bricks laid out z, y, x like VoxelData::m_bricks.
+		static std::shared_ptr<const WorldSnapshot> CopyFrom(const Brick* bricks, const glm::uvec3& sizeInBricks);
+
+		glm::uint16_t GetVoxel(const glm::ivec3& position) const;
+		bool IsInside(const glm::ivec3& position) const;
+
+		inline const Brick& GetBrick(uint32_t brickIndex) const { return *m_bricks[brickIndex]; }
+		inline const std::shared_ptr<const Brick>& GetSharedBrick(uint32_t brickIndex) const { return m_bricks[brickIndex]; }
+		inline uint64_t GetBrickVersion(uint32_t brickIndex) const { return m_brickVersions[brickIndex]; }
+
+		inline glm::uvec3 GetSizeInBricks() const { return m_sizeInBricks; }
+		inline uint32_t GetBrickCount() const { return static_cast<uint32_t>(m_bricks.size()); }
+		inline uint64_t GetVersion() const { return m_version; }
+
+	private:
+		glm::uvec3 m_sizeInBricks{};
+
+		std::vector<std::shared_ptr<const Brick>> m_bricks{};
+		std::vector<uint64_t> m_brickVersions{};
+
+		uint64_t m_version = 0;
+	};
+}
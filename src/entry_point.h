@@ -3,7 +3,7 @@
 #pragma once
 
 #include "application.h"
-#include <spdlog/spdlog.h>
+#include "log.h"
 
 // Define this in your application
 namespace afre { Application CreateApplication(); }
@@ -11,9 +11,11 @@ namespace afre { Application CreateApplication(); }
 // This is not a good way of doing it...
 int main()
 {
-    spdlog::set_pattern("%^[%l] %v%$");
+    afre::InitLogging();
 
     afre::CreateApplication();
 
+    afre::ShutdownLogging();
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace afre
+{
+	// Messages queued for the logging thread. When it falls behind the oldest ones are dropped instead of blocking the caller.
+	static constexpr size_t kLogQueueSize = 8192;
+
+	static constexpr uint32_t kFlightRecordCount = 4096;
+	// Longer messages are cut off in the flight recorder only.
+	static constexpr uint32_t kFlightRecordMessageSize = 240;
+
+	struct FlightRecord
+	{
+		// Ticket + 1 once written, anything else while being written or never written. Read like a seqlock.
+		std::atomic<uint64_t> m_sequence{ 0 };
+		int64_t m_time = 0;
+		spdlog::level::level_enum m_level = spdlog::level::info;
+		uint32_t m_length = 0;
+		char m_message[kFlightRecordMessageSize]{};
+	};
+
+	static FlightRecord s_flightRecords[kFlightRecordCount]{};
+	static std::atomic<uint64_t> s_nextFlightRecord{ 0 };
+
+	static LoggingInfo s_loggingInfo{};
+	static std::atomic<bool> s_dumping{ false };
+
+	static int64_t GetLogTime()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static void OnCrashSignal(int signal)
+	{
+		char reason[32]{};
+		std::snprintf(reason, sizeof(reason), "signal %d", signal);
+		DumpFlightRecorder(reason);
+
+		std::signal(signal, SIG_DFL);
+		std::raise(signal);
+	}
+
+	void InitLogging(const LoggingInfo& loggingInfo)
+	{
+		s_loggingInfo = loggingInfo;
+
+		spdlog::init_thread_pool(kLogQueueSize, 1);
+
+		std::shared_ptr<spdlog::sinks::stdout_color_sink_mt> sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+		std::shared_ptr<spdlog::async_logger> logger = std::make_shared<spdlog::async_logger>("afre", sink, spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+
+		logger->set_pattern("%^[%l] %v%$");
+		logger->flush_on(spdlog::level::err);
+		spdlog::set_default_logger(logger);
+
+		if (loggingInfo.m_crashHandlers)
+		{
+			std::signal(SIGSEGV, OnCrashSignal);
+			std::signal(SIGABRT, OnCrashSignal);
+			std::signal(SIGFPE, OnCrashSignal);
+			std::signal(SIGILL, OnCrashSignal);
+		}
+	}
+
+	void ShutdownLogging()
+	{
+		spdlog::default_logger_raw()->flush();
+		spdlog::shutdown();
+	}
+
+	void RecordLog(spdlog::level::level_enum level, std::string_view message)
+	{
+		const uint64_t ticket = s_nextFlightRecord.fetch_add(1, std::memory_order_relaxed);
+		FlightRecord& flightRecord = s_flightRecords[ticket % kFlightRecordCount];
+
+		flightRecord.m_sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		flightRecord.m_time = GetLogTime();
+		flightRecord.m_level = level;
+		flightRecord.m_length = static_cast<uint32_t>(std::min<size_t>(message.size(), kFlightRecordMessageSize));
+		std::memcpy(flightRecord.m_message, message.data(), flightRecord.m_length);
+
+		flightRecord.m_sequence.store(ticket + 1, std::memory_order_release);
+	}
+
+	void DumpFlightRecorder(const char* reason)
+	{
+		// A crash while dumping would otherwise dump again from the signal handler.
+		if (s_dumping.exchange(true)) return;
+
+		// Not through spdlog, its thread may be the one that crashed. Plain stdio isn't signal safe either, but it's the best a crash gets.
+		std::FILE* dumpFile = s_loggingInfo.m_dumpPath ? std::fopen(s_loggingInfo.m_dumpPath, "w") : nullptr;
+		const auto write = [&](const char* text, size_t length)
+		{
+			std::fwrite(text, 1, length, stderr);
+			if (dumpFile) std::fwrite(text, 1, length, dumpFile);
+		};
+
+		char line[kFlightRecordMessageSize + 64]{};
+		int lineLength = std::snprintf(line, sizeof(line), "---- flight recorder (%s), last %.1f s ----\n", reason, s_loggingInfo.m_flightRecorderSeconds);
+		write(line, static_cast<size_t>(lineLength));
+
+		const int64_t now = GetLogTime();
+		const int64_t oldest = now - static_cast<int64_t>(s_loggingInfo.m_flightRecorderSeconds * 1e9);
+
+		const uint64_t end = s_nextFlightRecord.load(std::memory_order_acquire);
+		const uint64_t begin = end > kFlightRecordCount ? end - kFlightRecordCount : 0;
+		for (uint64_t ticket = begin; ticket < end; ticket++)
+		{
+			const FlightRecord& flightRecord = s_flightRecords[ticket % kFlightRecordCount];
+
+			const uint64_t sequence = flightRecord.m_sequence.load(std::memory_order_acquire);
+			if (sequence != ticket + 1) continue;
+
+			const int64_t time = flightRecord.m_time;
+			const spdlog::level::level_enum level = flightRecord.m_level;
+			char message[kFlightRecordMessageSize];
+			const uint32_t length = std::min(flightRecord.m_length, kFlightRecordMessageSize);
+			std::memcpy(message, flightRecord.m_message, length);
+
+			// Overwritten while copying.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (flightRecord.m_sequence.load(std::memory_order_relaxed) != sequence || time < oldest) continue;
+
+			const spdlog::string_view_t levelName = spdlog::level::to_string_view(level);
+			lineLength = std::snprintf(line, sizeof(line), "%+9.3f s [%.*s] %.*s\n", static_cast<double>(time - now) * 1e-9,
+				static_cast<int>(levelName.size()), levelName.data(), static_cast<int>(length), message);
+			write(line, std::min(static_cast<size_t>(lineLength), sizeof(line) - 1));
+		}
+
+		std::fflush(stderr);
+		if (dumpFile) std::fclose(dumpFile);
+
+		s_dumping.store(false);
+	}
+}
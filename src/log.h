@@ -1,8 +1,86 @@
 #pragma once
 
+#include <iterator>
+#include <string_view>
 #include <spdlog/spdlog.h>
 
-#define AFRE_INFO(msg) spdlog::info(msg)
-#define AFRE_WARN(msg) spdlog::warn(msg)
-#define AFRE_ERROR(msg) spdlog::error(msg)
-#define AFRE_CRIT(msg, returnVal) spdlog::critical(msg)
\ No newline at end of file
+#define AFRE_LOG_LEVEL_INFO 0
+#define AFRE_LOG_LEVEL_WARN 1
+#define AFRE_LOG_LEVEL_ERROR 2
+#define AFRE_LOG_LEVEL_CRIT 3
+#define AFRE_LOG_LEVEL_OFF 4
+
+// Set with premake's --log-level. Calls below it compile to nothing, their arguments aren't evaluated either.
+#ifndef AFRE_LOG_LEVEL
+	#define AFRE_LOG_LEVEL AFRE_LOG_LEVEL_INFO
+#endif
+
+namespace afre
+{
+	struct LoggingInfo
+	{
+		// How far back a flight recorder dump goes.
+		float m_flightRecorderSeconds = 10.f;
+		// The dump also goes to stderr.
+		const char* m_dumpPath = "afre_flight_recorder.log";
+		// Dumps the flight recorder on SIGSEGV, SIGABRT, SIGFPE and SIGILL.
+		bool m_crashHandlers = true;
+	};
+
+	// Moves logging to a background thread. Until then messages go out synchronously.
+	void InitLogging(const LoggingInfo& loggingInfo = {});
+	// Flushes what's queued and joins the logging thread.
+	void ShutdownLogging();
+
+	// Writes the recent messages, oldest first. Called by AFRE_CRIT and the crash handlers.
+	void DumpFlightRecorder(const char* reason);
+
+	// Lock free, the calling thread copies the message into the flight recorder's ring.
+	void RecordLog(spdlog::level::level_enum level, std::string_view message);
+
+	inline void WriteLog(spdlog::level::level_enum level, std::string_view message)
+	{
+		spdlog::logger& logger = *spdlog::default_logger_raw();
+		if (!logger.should_log(level)) return;
+
+		RecordLog(level, message);
+		logger.log(level, message);
+	}
+
+	// Formats once and only when the level is enabled, then the queue takes a copy of the text.
+	template<typename Arg, typename... Args>
+	inline void WriteLog(spdlog::level::level_enum level, fmt::format_string<Arg, Args...> format, Arg&& arg, Args&&... args)
+	{
+		if (!spdlog::default_logger_raw()->should_log(level)) return;
+
+		fmt::memory_buffer buffer{};
+		fmt::format_to(std::back_inserter(buffer), format, std::forward<Arg>(arg), std::forward<Args>(args)...);
+
+		WriteLog(level, std::string_view(buffer.data(), buffer.size()));
+	}
+}
+
+#if AFRE_LOG_LEVEL <= AFRE_LOG_LEVEL_INFO
+	#define AFRE_INFO(...) ::afre::WriteLog(spdlog::level::info, __VA_ARGS__)
+#else
+	#define AFRE_INFO(...) ((void)0)
+#endif
+
+#if AFRE_LOG_LEVEL <= AFRE_LOG_LEVEL_WARN
+	#define AFRE_WARN(...) ::afre::WriteLog(spdlog::level::warn, __VA_ARGS__)
+#else
+	#define AFRE_WARN(...) ((void)0)
+#endif
+
+#if AFRE_LOG_LEVEL <= AFRE_LOG_LEVEL_ERROR
+	#define AFRE_ERROR(...) ::afre::WriteLog(spdlog::level::err, __VA_ARGS__)
+#else
+	#define AFRE_ERROR(...) ((void)0)
+#endif
+
+// Usually the last thing logged before giving up, so the flight recorder is dumped with it.
+#if AFRE_LOG_LEVEL <= AFRE_LOG_LEVEL_CRIT
+	#define AFRE_CRIT(...) do { ::afre::WriteLog(spdlog::level::critical, __VA_ARGS__); ::afre::DumpFlightRecorder("critical error"); } while (false)
+#else
+	#define AFRE_CRIT(...) ::afre::DumpFlightRecorder("critical error")
+#endif
@@ -1,9 +1,10 @@
 #include "scene.h"
 #include "core/camera/camera.h"
+#include "core/voxel/brick_kernels.h"
 
 namespace afre
 {
-	Scene::Scene()
+	void Scene::Load()
 	{
 		// Creating the camera
 		entt::entity camera = m_registry.create();
@@ -12,5 +13,115 @@ namespace afre
 		// Creating the voxel world
 		entt::entity voxelWorld = m_registry.create();
 		m_registry.emplace<VoxelData>(voxelWorld);
+
+		m_spatialIndex.Connect(m_registry);
+		m_systems.AddSystem("spatial index", SystemAccess{}.Reads<Transform>().WritesResource<SpatialIndex>(), [this](entt::registry& registry, SystemScheduler& scheduler, float)
+			{
+				m_spatialIndex.Update(registry, scheduler);
+			});
+
+		m_systems.AddSystem("voxel data", SystemAccess{}.Writes<VoxelData>().WritesResource<VoxelWorld>().WritesResource<LightPropagator>(), [this](entt::registry& registry, SystemScheduler&, float)
+			{
+				registry.view<VoxelData>().each([this](VoxelData& voxelData) { ApplyVoxelData(voxelData); });
+			});
+
+		m_systems.AddSystem("voxel simulation", SystemAccess{}.Writes<VoxelData>().WritesResource<VoxelWorld>().WritesResource<LightPropagator>(), [this](entt::registry& registry, SystemScheduler& scheduler, float)
+			{
+				registry.view<VoxelData>().each([&](VoxelData& voxelData) { StepVoxelSimulation(voxelData, scheduler); });
+			});
+
+		// Only rebuilds the bricks whose version changed since the snapshot it had.
+		m_systems.AddSystem("brick navigation", SystemAccess{}.ReadsResource<VoxelWorld>().WritesResource<BrickNavigator>(), [this](entt::registry&, SystemScheduler&, float)
+			{
+				if (!m_voxelWorldSnapshot || m_voxelWorldSnapshot->GetVersion() == m_navigatedVersion) return;
+
+				m_brickNavigator.SetSnapshot(m_voxelWorldSnapshot);
+				m_navigatedVersion = m_voxelWorldSnapshot->GetVersion();
+			});
+	}
+
+	void Scene::Update()
+	{
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		// The first frame has no previous one to measure from.
+		const float deltaTime = m_frame > 0 ? std::chrono::duration<float>(now - m_lastUpdate).count() : 0.f;
+		m_lastUpdate = now;
+
+		m_systems.Run(m_registry, deltaTime);
+
+		m_frame++;
+		if (m_systemsLogInterval > 0 && m_frame % m_systemsLogInterval == 0) m_systems.LogReport();
+	}
+
+	void Scene::ApplyVoxelData(VoxelData& voxelData)
+	{
+		if (!voxelData.SetVoxelData()) return;
+
+		// The first world is lit and uploaded whole, after that only the bricks that changed are.
+		const bool relight = !m_lightPropagator.IsInitialized();
+		uint32_t changedBricks = 0;
+		uint32_t changedVoxels = 0;
+
+		const glm::uvec3 sizeInBricks = m_voxelWorld.GetSizeInBricks();
+		const Brick* bricks = &voxelData.m_bricks[0][0][0];
+		for (uint32_t brickIndex = 0; brickIndex < m_voxelWorld.GetBrickCount(); brickIndex++)
+		{
+			const glm::uvec3 brickPosition{ brickIndex % sizeInBricks.x, brickIndex / sizeInBricks.x % sizeInBricks.y, brickIndex / (sizeInBricks.x * sizeInBricks.y) };
+			if (!relight && AreBricksEqual(m_voxelWorld.GetBrick(brickPosition), bricks[brickIndex])) continue;
+
+			if (!relight) changedVoxels += m_lightPropagator.QueueBrickEdits(brickPosition, m_voxelWorld.GetBrick(brickPosition), bricks[brickIndex]);
+
+			m_voxelWorld.SetBrick(brickPosition, bricks[brickIndex]);
+			m_changedBricks.push_back(brickIndex);
+			changedBricks++;
+
+			// The corners border on every neighbour, whatever was resting against the brick may move now.
+			if (!relight)
+			{
+				for (uint32_t corner = 0; corner < 8; corner++)
+				{
+					const glm::uvec3 cornerOffset = glm::uvec3(corner & 1, (corner >> 1) & 1, corner >> 2) * static_cast<uint32_t>(kBrickSize - 1);
+					m_voxelSimulation.Wake(glm::ivec3(brickPosition * static_cast<uint32_t>(kBrickSize) + cornerOffset));
+				}
+			}
+		}
+
+		if (changedBricks == 0) return;
+		if (relight) m_voxelSimulation.WakeAll();
+
+		m_voxelWorldSnapshot = m_voxelWorld.TakeSnapshot();
+
+		// Past a quarter of the world relighting all of it is cheaper than following every voxel, the rebuild drops
+		// the edits it makes up for.
+		if (relight || changedVoxels > m_voxelWorld.GetBrickCount() * kBrickVoxelCount / 4)
+		{
+			m_materialRegistry.ApplyToLightPropagator(m_lightPropagator);
+			m_lightPropagator.Rebuild(m_voxelWorldSnapshot);
+		}
+	}
+
+	void Scene::StepVoxelSimulation(VoxelData& voxelData, SystemScheduler& scheduler)
+	{
+		if (m_voxelSimulation.GetActiveBrickCount() == 0) return;
+
+		m_voxelSimulation.Step(scheduler);
+		m_voxelSimulation.TakeDirtyBricks(m_simulatedBricks);
+		if (m_simulatedBricks.empty()) return;
+
+		// The same way as the game's changes: relit voxel by voxel and uploaded by the voxel data updater.
+		const glm::uvec3 sizeInBricks = m_voxelWorld.GetSizeInBricks();
+		Brick* bricks = &voxelData.m_bricks[0][0][0];
+		for (const uint32_t brickIndex : m_simulatedBricks)
+		{
+			const glm::uvec3 brickPosition{ brickIndex % sizeInBricks.x, brickIndex / sizeInBricks.x % sizeInBricks.y, brickIndex / (sizeInBricks.x * sizeInBricks.y) };
+			const Brick& brick = m_voxelWorld.GetBrick(brickPosition);
+
+			m_lightPropagator.QueueBrickEdits(brickPosition, bricks[brickIndex], brick);
+			bricks[brickIndex] = brick;
+			m_changedBricks.push_back(brickIndex);
+		}
+
+		m_voxelWorldSnapshot = m_voxelWorld.TakeSnapshot();
 	}
-}
\ No newline at end of file
+}
@@ -1,17 +1,104 @@
 #pragma once
 
+#include <chrono>
 #include <entt.hpp>
+#include "core/brick_config.h"
+#include "core/system_scheduler.h"
+#include "core/voxel/brick_culling.h"
+#include "core/voxel/brick_navigation.h"
+#include "core/voxel/brick_residency.h"
+#include "core/voxel/material_registry.h"
+#include "core/voxel/spatial_index.h"
+#include "core/voxel/voxel_simulation.h"
+#include "core/voxel/voxel_instance.h"
+
+#ifdef AFRE_RAY_STATS
+#include "core/debug/ray_stats.h"
+#endif
 
 namespace afre
 {
 	class Scene
 	{
 	public:
+		// Creates the scene's entities. A startup task, so it runs next to the Vulkan setup instead of before main.
+		void Load();
+
+		// Runs the registered systems for the frame.
 		void Update();
 
+		// Logs the system timings every that many frames, 0 turns logging off.
+		inline void SetSystemsLogInterval(uint32_t frames) { m_systemsLogInterval = frames; }
+
 		entt::registry m_registry{};
 
-		Scene();
+		// Game logic, systems that don't touch the same components run in parallel.
+		SystemScheduler m_systems{ SystemScheduler::GetDefaultWorkerCount() };
+
+		// Entities with a Transform by position, brought up to date by the first system of the frame. Systems that
+		// query it declare ReadsResource<SpatialIndex>() so they run after it.
+		SpatialIndex m_spatialIndex{};
+
+		// What the game last wrote into the VoxelData, on the CPU. The next write is diffed against it brick by brick,
+		// only the bricks that differ are relit and uploaded again.
+		VoxelWorld m_voxelWorld{ glm::uvec3(3) };
+		// Bricks of m_voxelWorld written this frame, for the voxel data updater to pick up and clear.
+		std::vector<uint32_t> m_changedBricks{};
+		// Taken after every write to m_voxelWorld, a newer version tells the systems following the world it changed.
+		std::shared_ptr<const WorldSnapshot> m_voxelWorldSnapshot{};
+		// Falling and flowing voxels of m_voxelWorld, stepped once a frame. The bricks it moves voxels in are copied
+		// back into the VoxelData and relit like the game's own changes.
+		VoxelSimulation m_voxelSimulation{ m_voxelWorld };
+
+		// Lighting for the voxel world entity, uploaded next to its VoxelData.
+		LightPropagator m_lightPropagator{};
+
+		MaterialRegistry m_materialRegistry{};
+
+		// Bricks of the voxel world the camera can see this frame, nearest first.
+		BrickVisibility m_brickVisibility{};
+		BrickCuller m_brickCuller{};
+
+		// Which unique bricks of the voxel world have a GPU pool slot, driven by what the shader asked for and read.
+		BrickResidency m_brickResidency{ 4, AFRE_BRICK_POOL_SLOTS };
+
+		// Visible bricks in the rasterized bands are drawn from their greedy meshes before the ray march.
+		HybridRenderBands m_hybridRenderBands{};
+		BrickMeshCache m_brickMeshCache{};
+		// Bricks the mesh pass draws this frame and their quads, rebuilt when either changes.
+		std::vector<uint32_t> m_rasterBricks{};
+		std::vector<GpuMeshQuad> m_meshQuads{};
+		// Starts out set so the raster mask gets its first upload, device memory isn't cleared.
+		bool m_meshQuadsChanged = true;
+		// What the last upload left in the quad buffer, the mesh pass draws this many.
+		uint32_t m_uploadedMeshQuadCount = 0;
+
+		// Paths through the voxel world for game logic, kept up to date with m_voxelWorldSnapshot by its own system.
+		BrickNavigator m_brickNavigator{};
+
+		// Gathered from the VoxelInstance components every frame before upload, in registry order. The BVH is built
+		// over their bounds in this order and reaches them through GetInstanceIndices.
+		std::vector<VoxelInstance> m_voxelInstances{};
+		InstanceBvh m_instanceBvh{};
+
+		#ifdef AFRE_RAY_STATS
+			RayStatsReadback m_rayStats{};
+		#endif
+
+	private:
+		// Brings m_voxelWorld and the lighting up to date with what the game wrote into the VoxelData, if anything.
+		void ApplyVoxelData(VoxelData& voxelData);
+		// Steps m_voxelSimulation and writes the bricks it changed into the VoxelData.
+		void StepVoxelSimulation(VoxelData& voxelData, SystemScheduler& scheduler);
+
+		// The m_voxelWorldSnapshot version the navigator was last given, snapshot versions start at 1.
+		uint64_t m_navigatedVersion = 0;
+		// Reused by StepVoxelSimulation.
+		std::vector<uint32_t> m_simulatedBricks{};
+
+		std::chrono::steady_clock::time_point m_lastUpdate{};
+		uint64_t m_frame = 0;
+		uint32_t m_systemsLogInterval = 600;
 	};
 
 	_declspec(selectany) Scene g_scene{};